@@ -0,0 +1,2298 @@
+//---------------------------------------------------------------------------
+// CliSelfTest implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "CliSelfTest.h"
+#include <System.SysUtils.hpp>
+#include <System.StrUtils.hpp>
+#include <IOUtils.hpp>
+#include <algorithm>
+#include <cstring>
+#include <cwchar>
+#include <memory>
+#include <map>
+#include <set>
+#include <atomic>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <chrono>
+#include "Core/ProfileManager.h"
+#include "Core/IDEDetector.h"
+#include "Core/RegistryChangeSet.h"
+#include "Core/PathList.h"
+#include "Core/CompileScheduler.h"
+#include "Core/SourceDiff.h"
+#include "Core/BinaryPack.h"
+#include "Core/ScratchDir.h"
+#include "Core/TaskPool.h"
+#include "Core/ContentHash.h"
+#include "Core/InterfaceHash.h"
+#include "Core/PackageRules.h"
+#include "Core/ComponentGraph.h"
+#include "Core/InstallPlan.h"
+#include "Core/Installer.h"
+#include "Core/SourceArchive.h"
+#include "Core/PackageCompiler.h"
+#include "Core/FileOps.h"
+#include "Core/Prefetcher.h"
+
+using namespace DxCore;
+
+//---------------------------------------------------------------------------
+// Helpers
+//---------------------------------------------------------------------------
+// Directory below %TEMP%, removed with everything in it
+class TTempDir
+{
+private:
+    String FPath;
+
+public:
+    TTempDir()
+        : FPath(TPath::Combine(TPath::GetTempPath(), L"DxSelfTest-" + TPath::GetGUIDFileName()))
+    {
+        ForceDirectories(FPath);
+    }
+
+    ~TTempDir()
+    {
+        try
+        {
+            TDirectory::Delete(FPath, true);
+        }
+        catch (...)
+        {
+        }
+    }
+
+    const String& GetPath() const { return FPath; }
+
+    String WriteFile(const String& relativePath, const String& text) const
+    {
+        String fileName = TPath::Combine(FPath, relativePath);
+        ForceDirectories(ExtractFileDir(fileName));
+        TFile::WriteAllText(fileName, text);
+        return fileName;
+    }
+};
+
+//---------------------------------------------------------------------------
+// package-names: .dpk base names back to profile names (DiscoverPackages)
+//---------------------------------------------------------------------------
+static void CheckPackageNames(TSelfTest& test)
+{
+    std::vector<String> suffixes = TProfileManager::GetKnownPackageSuffixes();
+
+    // File base name -> profile name; digits and "Painters" belong to the name
+    const wchar_t* cases[][2] = {
+        { L"dxCore370", L"dxCore" },
+        { L"dxCore290", L"dxCore" },
+        { L"dxCoreRS37", L"dxCore" },
+        { L"dxCoreD29", L"dxCore" },
+        { L"dxSkinVS2010370", L"dxSkinVS2010" },
+        { L"dxSkinVS2010RS29", L"dxSkinVS2010" },
+        { L"dxSkinSummer2008370", L"dxSkinSummer2008" },
+        { L"dcldxSkinsdxBarsPainters370", L"dcldxSkinsdxBarsPainters" },
+        { L"dcldxSkinsdxRibbonPainters370", L"dcldxSkinsdxRibbonPainters" },
+        { L"dcldxSkinsdxBarsPainters", L"dcldxSkinsdxBarsPainters" },
+        { L"dxSkinVS2010", L"dxSkinVS2010" },
+        { L"SynEditDR", L"SynEditDR" },
+        { L"dxCorers37", L"dxCorers37" }       // Only the installer's upper-case RS
+    };
+    for (const auto& c : cases)
+        test.Equal(c[0], TProfileManager::NormalizePackageName(c[0], suffixes), c[1]);
+
+    // Every name of the shipped profile, in every form FindPackageFile accepts
+    TProfileManager profile;
+    profile.LoadFromResource();
+    int names = 0;
+    int wrong = 0;
+    String firstWrong;
+    for (const auto& component : profile.GetComponents())
+    {
+        const std::vector<String>* lists[] = { &component->RequiredPackages, &component->OptionalPackages };
+        for (auto* list : lists)
+        {
+            for (const auto& base : *list)
+            {
+                for (const auto& suffix : suffixes)
+                {
+                    String rsNum = suffix.SubString(1, suffix.Length() - 1);
+                    const String fileNames[] = { base + suffix, base + L"RS" + rsNum, base + L"D" + rsNum, base };
+                    for (const auto& fileName : fileNames)
+                    {
+                        std::vector<String> candidates = TProfileManager::GetPackageBaseNames(fileName, suffixes);
+                        names++;
+                        if (std::find(candidates.begin(), candidates.end(), base) == candidates.end())
+                        {
+                            if (wrong++ == 0)
+                                firstWrong = fileName + L" -> " + candidates.front();
+                        }
+                    }
+                }
+            }
+        }
+    }
+    test.Check(L"profile names (" + String(names) + L" file names)", names > 0 && wrong == 0,
+               String(wrong) + L" not mapped back, first: " + firstWrong);
+}
+
+//---------------------------------------------------------------------------
+// profile: text parser, binary form and the embedded PROFILEBIN
+//---------------------------------------------------------------------------
+static bool SameBinary(const TProfileManager& a, const TProfileManager& b)
+{
+    std::unique_ptr<TMemoryStream> sa(new TMemoryStream());
+    std::unique_ptr<TMemoryStream> sb(new TMemoryStream());
+    a.SaveToBinaryStream(sa.get());
+    b.SaveToBinaryStream(sb.get());
+    return sa->Size == sb->Size &&
+           memcmp(sa->Memory, sb->Memory, static_cast<size_t>(sa->Size)) == 0;
+}
+
+static void CheckProfile(TSelfTest& test)
+{
+    // Windows profile rules: first value wins, duplicate sections merge,
+    // one pair of quotes removed; names shared across components are pooled
+    TProfileManager parsed;
+    parsed.LoadFromText(L"; comment\r\n"
+                        L"[Core]\r\n"
+                        L"RequiredPackages = dxCore, cxLibrary  dxGDIPlus\r\n"
+                        L"RequiredPackages = ignored\r\n"
+                        L"IsBase = 1\r\n"
+                        L"[Grid]\r\n"
+                        L"OptionalPackages = \"dxCore,cxGrid\"\r\n"
+                        L"[core]\r\n"
+                        L"OutdatedPackages = dxOld\r\n");
+    const auto& components = parsed.GetComponents();
+    test.Equal(L"sections", static_cast<__int64>(components.size()), 2);
+    if (components.size() == 2)
+    {
+        const auto& core = *components[0];
+        const auto& grid = *components[1];
+        test.Equal(L"required count", static_cast<__int64>(core.RequiredPackages.size()), 3);
+        test.Equal(L"first value wins", core.RequiredPackages.empty() ? String() : core.RequiredPackages[0], L"dxCore");
+        test.Check(L"is base", core.IsBase && !grid.IsBase);
+        test.Equal(L"sections merge", core.OutdatedPackages.empty() ? String() : core.OutdatedPackages[0], L"dxOld");
+        test.Equal(L"quotes removed", grid.OptionalPackages.empty() ? String() : grid.OptionalPackages[0], L"dxCore");
+        test.Check(L"names pooled", !core.RequiredPackages.empty() && !grid.OptionalPackages.empty() &&
+                   core.RequiredPackages[0].c_str() == grid.OptionalPackages[0].c_str());
+    }
+
+    // Text -> binary -> text
+    TProfileManager builtIn;
+    builtIn.LoadFromText(TProfileManager::GetBuiltInProfileText());
+    test.Check(L"built-in profile parsed", !builtIn.GetComponents().empty());
+
+    std::unique_ptr<TMemoryStream> stream(new TMemoryStream());
+    builtIn.SaveToBinaryStream(stream.get());
+    stream->Position = 0;
+    TProfileManager reloaded;
+    test.Check(L"binary round trip loads", reloaded.LoadFromBinaryStream(stream.get()));
+    test.Check(L"binary round trip", reloaded.SaveToText() == builtIn.SaveToText());
+
+    std::unique_ptr<TMemoryStream> truncated(new TMemoryStream());
+    truncated->CopyFrom(stream.get(), 0);
+    truncated->Size = truncated->Size / 2;
+    truncated->Position = 0;
+    TProfileManager broken;
+    test.Check(L"truncated binary rejected", !broken.LoadFromBinaryStream(truncated.get()) &&
+               broken.GetComponents().empty());
+
+    // The shipped Profile.bin is Profile.ini compiled
+    TProfileManager embedded;
+    bool hasBinary = embedded.LoadFromBuiltInBinary();
+    test.Check(L"PROFILEBIN embedded", hasBinary);
+    if (hasBinary)
+        test.Check(L"PROFILEBIN matches PROFILE", SameBinary(embedded, builtIn),
+                   L"Resources\\Profile.bin is stale; run compile-profile");
+}
+
+//---------------------------------------------------------------------------
+// ide-paths: TIDEInfo output paths from the registry backend, memoized
+//---------------------------------------------------------------------------
+class TCountingRegistryBackend : public TMemoryRegistryBackend
+{
+public:
+    int Reads;
+
+    TCountingRegistryBackend() : Reads(0) {}
+
+    bool ReadValue(const String& key, const String& name, String& value) override
+    {
+        Reads++;
+        return TMemoryRegistryBackend::ReadValue(key, name, value);
+    }
+};
+
+static void CheckIDEPaths(TSelfTest& test)
+{
+    const String key = L"Software\\Embarcadero\\BDS\\37.0";
+    auto backend = std::make_shared<TCountingRegistryBackend>();
+    backend->WriteValue(key + L"\\Library\\Win32", L"Package DPL Output", L"$(BDSCOMMONDIR)\\Bpl");
+    backend->WriteValue(key + L"\\Library\\Win64", L"Package DPL Output", L"D:\\Bpl\\$(Platform)");
+    backend->WriteValue(key + L"\\Library\\Win64x", L"Package DCP Output", L"$(Unknown)\\Dcp");
+    backend->WriteValue(key + L"\\Library\\Win32", L"Search Path", L"C:\\Lib");
+
+    TIDEInfo ide;
+    ide.BDSVersion = L"37.0";
+    ide.RegistryKey = key;
+    ide.SetRegistryBackend(backend);
+
+    test.Equal(L"package suffix", ide.GetPackageSuffix(), L"370");
+    int resolveReads = backend->Reads;
+    test.Equal(L"reads per resolve", resolveReads, 6);    // DPL + DCP for 3 platforms
+    test.Equal(L"expanded path", ide.GetBPLOutputPath(TIDEPlatform::Win64), L"D:\\Bpl\\Win64");
+    test.Check(L"$(BDSCOMMONDIR) expanded",
+               EndsText(L"\\Studio\\37.0\\Bpl", ide.GetBPLOutputPath(TIDEPlatform::Win32)),
+               ide.GetBPLOutputPath(TIDEPlatform::Win32));
+    test.Check(L"unexpanded macro falls back",
+               EndsText(L"\\Studio\\37.0\\Dcp\\Win64x", ide.GetDCPOutputPath(TIDEPlatform::Win64Modern)),
+               ide.GetDCPOutputPath(TIDEPlatform::Win64Modern));
+
+    // Memoized: no registry reads until Refresh()
+    for (int i = 0; i < 100; i++)
+    {
+        ide.GetBPLOutputPath(TIDEPlatform::Win32);
+        ide.GetDCPOutputPath(TIDEPlatform::Win64);
+        ide.GetHPPOutputPath(TIDEPlatform::Win64Modern);
+        ide.GetPackageSuffix();
+        ide.GetDesignTimeBPLPath();
+        ide.GetInstallLibraryDir(L"C:\\Dx", TIDEPlatform::Win64);
+    }
+    test.Equal(L"memoized", backend->Reads, resolveReads);
+    test.Equal(L"library dir", ide.GetInstallLibraryDir(L"C:\\Dx", TIDEPlatform::Win64Modern),
+               L"C:\\Dx\\Library\\370\\Win64x");
+    test.Equal(L"library dir of another install", ide.GetInstallLibraryDir(L"D:\\Old", TIDEPlatform::Win32),
+               L"D:\\Old\\Library\\370\\Win32");
+    test.Equal(L"library dir back", ide.GetInstallLibraryDir(L"C:\\Dx", TIDEPlatform::Win64),
+               L"C:\\Dx\\Library\\370\\Win64");
+
+    backend->WriteValue(key + L"\\Library\\Win64", L"Package DPL Output", L"E:\\Bpl64");
+    test.Equal(L"stale until refresh", ide.GetBPLOutputPath(TIDEPlatform::Win64), L"D:\\Bpl\\Win64");
+    ide.Refresh();
+    test.Equal(L"refresh", ide.GetBPLOutputPath(TIDEPlatform::Win64), L"E:\\Bpl64");
+    test.Equal(L"reads after refresh", backend->Reads, resolveReads * 2);
+
+    // Library paths are read live
+    test.Equal(L"search path", ide.GetLibrarySearchPath(TIDEPlatform::Win32), L"C:\\Lib");
+    backend->WriteValue(key + L"\\Library\\Win32", L"Search Path", L"C:\\Lib;D:\\Dx");
+    test.Equal(L"search path live", ide.GetLibrarySearchPath(TIDEPlatform::Win32), L"C:\\Lib;D:\\Dx");
+    test.Equal(L"missing value", ide.GetLibraryBrowsingPath(TIDEPlatform::Win64), L"");
+}
+
+//---------------------------------------------------------------------------
+// path-list: exact-entry search path edits (TPathList)
+//---------------------------------------------------------------------------
+static void CheckPathList(TSelfTest& test)
+{
+    // Order of the remaining and added entries is kept
+    TPathList list(L"A;B;C;D");
+    list.Add(L"E");
+    list.Remove(L"B");
+    test.Equal(L"add/remove order", list.ToString(), L"A;C;D;E");
+    std::vector<String> removals = { L"D", L"A" };
+    test.Equal(L"batch remove", list.RemoveRange(removals), 2);
+    test.Equal(L"batch remove order", list.ToString(), L"C;E");
+    std::vector<String> additions = { L"F", L"C", L"G" };
+    test.Equal(L"batch add", list.AddRange(additions), 2);
+    test.Equal(L"batch add order", list.ToString(), L"C;E;F;G");
+
+    // \Win32 is a different entry than \Win32x
+    TPathList platforms(L"X\\Lib\\Win32x");
+    test.Check(L"\\Win32 not in \\Win32x", !platforms.Contains(L"X\\Lib\\Win32"));
+    test.Check(L"\\Win32 added next to \\Win32x", platforms.Add(L"X\\Lib\\Win32"));
+    platforms.Remove(L"X\\Lib\\Win32");
+    test.Equal(L"removing \\Win32 keeps \\Win32x", platforms.ToString(), L"X\\Lib\\Win32x");
+
+    // Trailing delimiter, '/' and case do not make a different entry
+    TPathList normalized(L"C:\\DevExpress\\Library\\Win32;D:\\");
+    test.Check(L"trailing backslash", normalized.Contains(L"C:\\DevExpress\\Library\\Win32\\"));
+    test.Check(L"case and slashes", normalized.Contains(L" c:/devexpress/library/WIN32/ "));
+    test.Check(L"no duplicate add", !normalized.Add(L"c:\\DEVEXPRESS\\Library\\Win32\\"));
+    test.Equal(L"drive root", TPathList::Normalize(L"D:\\"), L"d:\\");
+    test.Equal(L"remove normalized", normalized.Remove(L"C:/DevExpress/Library/Win32/"), 1);
+    test.Equal(L"original spelling kept", normalized.ToString(), L"D:\\");
+
+    // Empty entries: parsed away; a value only gets rewritten when it changes
+    TPathList empties(L";A;;B;");
+    test.Equal(L"empty entries skipped", empties.GetCount(), 2);
+    test.Check(L"empty entry not added", !empties.Add(L"  "));
+    test.Check(L"unmodified", !empties.IsModified());
+    empties.Add(L"C");
+    test.Equal(L"rewritten without empties", empties.ToString(), L"A;B;C");
+
+    auto backend = std::make_shared<TMemoryRegistryBackend>();
+    backend->WriteValue(L"Library", L"Search Path", L";A;;B;");
+    TRegistryChangeSet unchanged(backend);
+    unchanged.AddPathEntry(L"Library", L"Search Path", L"a\\");
+    String value;
+    unchanged.ReadValue(L"Library", L"Search Path", value);
+    test.Equal(L";; round trip unchanged", value, L";A;;B;");
+    TRegistryChangeSet changed(backend);
+    changed.AddPathEntry(L"Library", L"Search Path", L"C");
+    changed.RemovePathEntry(L"Library", L"Search Path", L"C");
+    changed.ReadValue(L"Library", L"Search Path", value);
+    test.Equal(L";; round trip add/remove", value, L"A;B");
+
+    // Duplicates are removed together
+    TPathList duplicates(L"A;b;a\\;B");
+    test.Equal(L"duplicates removed", duplicates.Remove(L"A"), 2);
+    test.Equal(L"duplicates remaining", duplicates.ToString(), L"b;B");
+}
+
+//---------------------------------------------------------------------------
+// registry: TRegistryChangeSet merge, Apply/rollback, Discard, Diff
+//---------------------------------------------------------------------------
+class TFaultyRegistryBackend : public TMemoryRegistryBackend
+{
+public:
+    String FailName;          // Writes of this value name fail
+    int Writes;
+
+    TFaultyRegistryBackend() : Writes(0) {}
+
+    bool WriteValue(const String& key, const String& name, const String& value) override
+    {
+        if (!FailName.IsEmpty() && SameText(name, FailName))
+            return false;
+        Writes++;
+        return TMemoryRegistryBackend::WriteValue(key, name, value);
+    }
+};
+
+static String ReadOrMissing(TRegistryBackend& backend, const String& key, const String& name)
+{
+    String value;
+    return backend.ReadValue(key, name, value) ? value : String(L"<missing>");
+}
+
+static void CheckRegistry(TSelfTest& test)
+{
+    const String key = L"Software\\Embarcadero\\BDS\\37.0\\Library\\Win32";
+    auto backend = std::make_shared<TFaultyRegistryBackend>();
+    backend->WriteValue(key, L"Search Path", L"C:\\Lib;C:\\Other");
+    backend->WriteValue(key, L"Browsing Path", L"C:\\Src");
+    backend->WriteValue(key, L"Obsolete", L"1");
+    backend->Writes = 0;
+
+    // Merge: many calls per value, one read and at most one write each
+    {
+        TRegistryChangeSet changes(backend);
+        changes.AddPathEntry(key, L"Search Path", L"D:\\Dx\\Win32");
+        changes.AddPathEntry(key, L"search path", L"D:\\Dx\\Win64");
+        changes.RemovePathEntry(key, L"Search Path", L"C:\\Other");
+        changes.AddPathEntry(key, L"Search Path", L"d:\\dx\\win32\\");
+        changes.AddPathEntry(key, L"Browsing Path", L"C:\\Src");      // Already there
+        changes.SetValue(key, L"Obsolete", L"2");
+        changes.DeleteValue(key, L"Obsolete");                          // Overrides the set
+        changes.SetValue(key, L"New", L"x");
+        test.Equal(L"recorded calls", changes.GetChangeCount(), 8);
+        test.Equal(L"merged values", changes.GetValueCount(), 4);
+
+        String pending;
+        changes.ReadValue(key, L"Search Path", pending);
+        test.Equal(L"reads see pending changes", pending, L"C:\\Lib;D:\\Dx\\Win32;D:\\Dx\\Win64");
+        test.Equal(L"backend untouched before Apply", ReadOrMissing(*backend, key, L"Search Path"),
+                   L"C:\\Lib;C:\\Other");
+
+        std::unique_ptr<TStringList> names(new TStringList());
+        changes.GetValueNames(key, names.get());
+        test.Check(L"pending value names", names->IndexOf(L"New") >= 0 && names->IndexOf(L"Obsolete") < 0,
+                   names->CommaText);
+
+        // Dry run: Diff describes, writes nothing
+        std::unique_ptr<TStringList> diff(new TStringList());
+        changes.Diff(diff.get());
+        test.Equal(L"diff lines", diff->Count, 3);       // Browsing Path is unchanged
+        test.Check(L"diff added", diff->IndexOf(L"+ " + key + L"\\New = \"x\"") >= 0, diff->Text);
+        test.Check(L"diff removed", diff->IndexOf(L"- " + key + L"\\Obsolete (was \"1\")") >= 0, diff->Text);
+        test.Check(L"diff modified", diff->IndexOf(L"~ " + key + L"\\Search Path: \"C:\\Lib;C:\\Other\" -> "
+                   L"\"C:\\Lib;D:\\Dx\\Win32;D:\\Dx\\Win64\"") >= 0, diff->Text);
+        test.Equal(L"diff writes nothing", backend->Writes, 0);
+
+        int written = 0;
+        test.Check(L"apply", changes.Apply(&written));
+        test.Equal(L"written values", written, 3);
+        test.Equal(L"backend writes", backend->Writes, 2);  // Plus one delete
+        test.Equal(L"applied path", ReadOrMissing(*backend, key, L"Search Path"),
+                   L"C:\\Lib;D:\\Dx\\Win32;D:\\Dx\\Win64");
+        test.Equal(L"unchanged value keeps spelling", ReadOrMissing(*backend, key, L"Browsing Path"), L"C:\\Src");
+        test.Equal(L"applied delete", ReadOrMissing(*backend, key, L"Obsolete"), L"<missing>");
+        test.Check(L"cleared after apply", changes.IsEmpty());
+    }
+
+    // Failed Apply: values written before the failure are restored
+    {
+        backend->FailName = L"Zzz";     // Values apply in key/name order; this one last
+        TRegistryChangeSet changes(backend);
+        changes.SetValue(key, L"Browsing Path", L"E:\\Src");
+        changes.SetValue(key, L"Created", L"y");
+        changes.DeleteValue(key, L"New");
+        changes.SetValue(key, L"Zzz", L"fails");
+        test.Check(L"failed apply reports failure", !changes.Apply());
+        test.Equal(L"rollback restores value", ReadOrMissing(*backend, key, L"Browsing Path"), L"C:\\Src");
+        test.Equal(L"rollback removes created value", ReadOrMissing(*backend, key, L"Created"), L"<missing>");
+        test.Equal(L"rollback restores deleted value", ReadOrMissing(*backend, key, L"New"), L"x");
+        test.Check(L"cleared after failed apply", changes.IsEmpty());
+        backend->FailName = L"";
+    }
+
+    // Cancelled install: Discard drops everything, nothing is written
+    {
+        backend->Writes = 0;
+        TRegistryChangeSet changes(backend);
+        changes.AddPathEntry(key, L"Search Path", L"F:\\Cancelled");
+        changes.DeleteValue(key, L"Browsing Path");
+        changes.Discard();
+        test.Check(L"discard clears", changes.IsEmpty());
+        test.Check(L"discard applies nothing", changes.Apply());
+        test.Equal(L"discard writes nothing", backend->Writes, 0);
+        test.Equal(L"discarded delete", ReadOrMissing(*backend, key, L"Browsing Path"), L"C:\\Src");
+    }
+}
+
+//---------------------------------------------------------------------------
+// compile-scheduler: job graph without compilers (reuse, cycles)
+//---------------------------------------------------------------------------
+static TPlanCompileJob MakeJob(int id, const String& name, std::vector<int> dependsOn)
+{
+    TPlanCompileJob job;
+    job.Id = id;
+    job.PackageName = name;
+    job.Compiler = L"<none>";
+    job.DependsOn = dependsOn;
+    return job;
+}
+
+static void CheckCompileGraph(TSelfTest& test)
+{
+    std::vector<TPlanCompileJob> jobs;
+    jobs.push_back(MakeJob(0, L"Base", {}));
+    jobs.push_back(MakeJob(1, L"AboveBase", { 0 }));
+    jobs.push_back(MakeJob(2, L"CycleA", { 3 }));
+    jobs.push_back(MakeJob(3, L"CycleB", { 2 }));
+    jobs.push_back(MakeJob(4, L"AboveCycle", { 0, 2 }));
+    jobs.push_back(MakeJob(5, L"Missing", { 99 }));
+    jobs.push_back(MakeJob(6, L"Self", { 6 }));
+
+    TWorkerBudget budget(1);
+    std::map<String, String> errors;
+    int started = 0;
+    int reuseAsked = 0;
+    TCompileScheduler scheduler(jobs, budget);
+    scheduler.CanReuse = [&](const TPlanCompileJob&) { reuseAsked++; return true; };
+    scheduler.OnStart = [&](const TPlanCompileJob&) { started++; };
+    scheduler.OnFinished = [&](const TPlanCompileJob& job, const TCompileResult& result) {
+        errors[job.PackageName] = result.Success ? String(L"<success>") : result.ErrorMessage;
+    };
+
+    // A cycle used to leave Run() reporting success with jobs never run
+    test.Check(L"run returns", scheduler.Run());
+    test.Equal(L"no compiler started", started, 0);
+    test.Equal(L"reuse asked for ready jobs", reuseAsked, 2);
+    test.Equal(L"failed jobs", static_cast<__int64>(errors.size()), 5);
+
+    const wchar_t* expected[][2] = {
+        { L"CycleA", L"CycleB" },
+        { L"CycleB", L"CycleA" },
+        { L"AboveCycle", L"CycleA" },
+        { L"Missing", L"job 99 (not in the plan)" },
+        { L"Self", L"Self" }
+    };
+    const String prefix = L"Unsatisfiable dependencies (cycle or missing job): ";
+    for (const auto& e : expected)
+        test.Equal(String(L"unsatisfiable ") + e[0], errors[e[0]], prefix + e[1]);
+    test.Check(L"budget released", budget.TryAcquire());
+    budget.Release();
+}
+
+//---------------------------------------------------------------------------
+// source-diff: changed files -> rebuild set (TSourceDiff, TRebuildSet)
+//---------------------------------------------------------------------------
+static String MakeDpk(const String& name, const String& requires, const String& unit)
+{
+    return L"package " + name + L";\r\n"
+           L"requires\r\n"
+           L"  " + requires + L";\r\n"
+           L"contains\r\n"
+           L"  " + unit + L" in '" + unit + L".pas';\r\n"
+           L"end.\r\n";
+}
+
+static void WriteSourceTree(const TTempDir& dir, const String& root, bool newRelease)
+{
+    String base = root + L"\\Sources\\";
+    dir.WriteFile(base + L"dxA.pas", L"unit dxA;\r\n{$I dxOpts.inc}\r\ninterface\r\nimplementation\r\nend.\r\n");
+    dir.WriteFile(base + L"dxB.pas", L"unit dxB;\r\ninterface\r\nimplementation\r\nend.\r\n");
+    dir.WriteFile(base + L"dxC.pas", L"unit dxC;\r\ninterface\r\nimplementation\r\nend.\r\n");
+    dir.WriteFile(base + L"dxD.pas", L"unit dxD;\r\ninterface\r\nimplementation\r\nend.\r\n");
+    dir.WriteFile(base + L"dxOpts.inc", L"{$INCLUDE 'dxBase.inc'}\r\n");
+    dir.WriteFile(base + L"dxBase.inc", newRelease ? L"{$DEFINE DX_NEW}\r\n" : L"{$DEFINE DX_OLD}\r\n");
+    // Installer copies are not sources
+    dir.WriteFile(root + L"\\Library\\Sources\\dxA.pas", newRelease ? L"new" : L"old");
+    if (newRelease)
+        dir.WriteFile(base + L"dxOrphan.pas", L"unit dxOrphan;\r\nend.\r\n");
+    else
+        dir.WriteFile(base + L"dxGone.pas", L"unit dxGone;\r\nend.\r\n");
+}
+
+static void CheckSourceDiff(TSelfTest& test)
+{
+    TTempDir dir;
+    WriteSourceTree(dir, L"old", false);
+    WriteSourceTree(dir, L"new", true);
+    String oldRoot = TPath::Combine(dir.GetPath(), L"old");
+    String newRoot = TPath::Combine(dir.GetPath(), L"new");
+
+    // PkgB requires PkgA, PkgD requires PkgB; PkgC stands alone
+    auto profile = std::make_shared<TComponentProfile>();
+    profile->ComponentName = L"Express Test";
+    auto component = std::make_shared<TComponent>(profile);
+    const wchar_t* packages[][3] = {
+        { L"PkgA", L"rtl", L"dxA" },
+        { L"PkgB", L"PkgA", L"dxB" },
+        { L"PkgC", L"rtl", L"dxC" },
+        { L"PkgD", L"PkgB", L"dxD" }
+    };
+    for (const auto& p : packages)
+    {
+        std::unique_ptr<TStringList> dpk(new TStringList());
+        dpk->Text = MakeDpk(p[0], p[1], p[2]);
+        component->Packages.push_back(std::make_shared<TPackage>(
+            TPath::Combine(newRoot, String(L"Packages\\") + p[0] + L".dpk"), dpk.get()));
+    }
+    TComponentList components;
+    components.push_back(component);
+
+    TRebuildSet set;
+    test.Check(L"analyze", TSourceDiff::Analyze(oldRoot, newRoot, components, set));
+    test.Equal(L"changes", static_cast<__int64>(set.Changes.size()), 3);    // .inc, added, removed
+    test.Equal(L"unmapped files", static_cast<__int64>(set.UnmappedFiles.size()), 2);
+    test.Equal(L"total packages", set.TotalPackages, 4);
+
+    std::map<String, const TRebuildPackage*> byName;
+    for (const auto& package : set.Packages)
+        byName[package.PackageName] = &package;
+    test.Equal(L"rebuild set", static_cast<__int64>(set.Packages.size()), 3);
+    test.Check(L"nested include reaches its unit", byName.count(L"PkgA") > 0 && byName[L"PkgA"]->Direct &&
+               byName[L"PkgA"]->Reason == L"modified: Sources\\dxBase.inc",
+               byName.count(L"PkgA") > 0 ? byName[L"PkgA"]->Reason : String(L"PkgA missing"));
+    test.Check(L"requires closure", byName.count(L"PkgB") > 0 && !byName[L"PkgB"]->Direct &&
+               byName.count(L"PkgD") > 0 && byName[L"PkgD"]->Reason == L"requires PkgB");
+    test.Check(L"unchanged package kept", byName.count(L"PkgC") == 0);
+    test.Check(L"Library\\ ignored", std::none_of(set.Changes.begin(), set.Changes.end(),
+               [](const TSourceChange& change) { return StartsText(L"Library\\", change.Path); }));
+
+    std::set<String> changed = set.GetChangedPackageNames();
+    test.Check(L"changed package names", changed.size() == 1 && changed.count(L"pkga") == 1);
+    test.Equal(L"package names", static_cast<__int64>(set.GetPackageNames().size()), 3);
+    test.Check(L"estimate below full build", set.EstimatedSeconds > 0 && set.EstimatedSeconds < set.FullBuildSeconds);
+
+    // rebuild.json round trip
+    TRebuildSet loaded;
+    test.Check(L"json loads", TRebuildSet::FromJSON(set.ToJSON(), loaded));
+    test.Check(L"json round trip", loaded.ToJSON() == set.ToJSON());
+    test.Check(L"json other version rejected",
+               !TRebuildSet::FromJSON(L"{\"formatVersion\": 99, \"packages\": []}", loaded));
+
+    // Identical trees: nothing to rebuild
+    TRebuildSet same;
+    TSourceDiff::Analyze(newRoot, newRoot, components, same);
+    test.Check(L"identical trees", same.Changes.empty() && same.Packages.empty());
+}
+
+//---------------------------------------------------------------------------
+// binary-pack: export on one machine layout, import on another
+//---------------------------------------------------------------------------
+static __int64 GetWriteTime(const String& fileName)
+{
+    WIN32_FILE_ATTRIBUTE_DATA data;
+    if (!GetFileAttributesExW(fileName.c_str(), GetFileExInfoStandard, &data))
+        return -1;
+    return ((__int64)data.ftLastWriteTime.dwHighDateTime << 32) | data.ftLastWriteTime.dwLowDateTime;
+}
+
+static TPathMacros MakeMachineMacros(const String& root, bool withWin64)
+{
+    TPathMacros macros;
+    macros.Add(L"$(DX)", TPath::Combine(root, L"DevExpress"));
+    macros.Add(L"$(BPL.Win32)", TPath::Combine(root, L"Bpl"));
+    if (withWin64)
+        macros.Add(L"$(BPL.Win64)", TPath::Combine(root, L"Bpl\\Win64"));   // Inside $(BPL.Win32)
+    return macros;
+}
+
+static void CheckBinaryPack(TSelfTest& test)
+{
+    TTempDir dir;
+    String machineA = TPath::Combine(dir.GetPath(), L"A");
+    String machineB = TPath::Combine(dir.GetPath(), L"B");
+    TPathMacros macrosA = MakeMachineMacros(machineA, true);
+
+    // Macros replace whole path components, the longest path first
+    test.Equal(L"collapse nested", macrosA.Collapse(machineA + L"\\Bpl\\Win64\\dxCore370.bpl"),
+               L"$(BPL.Win64)\\dxCore370.bpl");
+    test.Equal(L"collapse list", macrosA.Collapse(machineA + L"\\DevExpress\\Library;" + machineA + L"\\Bpl"),
+               L"$(DX)\\Library;$(BPL.Win32)");
+    test.Equal(L"collapse component only", macrosA.Collapse(machineA + L"\\DevExpress2\\x"),
+               machineA + L"\\DevExpress2\\x");
+    test.Equal(L"expand", macrosA.Expand(L"$(dx)\\Library"), machineA + L"\\DevExpress\\Library");
+
+    // Build output of machine A, with a binary and an empty file
+    std::vector<String> files;
+    files.push_back(dir.WriteFile(L"A\\DevExpress\\Library\\370\\Win32\\dxCore.dcu", L"unit dxCore"));
+    files.push_back(dir.WriteFile(L"A\\DevExpress\\Library\\370\\Win32\\empty.res", L""));
+    files.push_back(dir.WriteFile(L"A\\Bpl\\dxCore370.bpl", L"MZ win32"));
+    files.push_back(dir.WriteFile(L"A\\Bpl\\Win64\\dxCore370.bpl", L"MZ win64"));
+    {
+        std::unique_ptr<TFileStream> binary(new TFileStream(files[0], fmCreate));
+        unsigned char bytes[4096];
+        for (size_t i = 0; i < sizeof(bytes); i++)
+            bytes[i] = (unsigned char)(i * 7);
+        binary->WriteBuffer(bytes, sizeof(bytes));
+    }
+
+    TBinaryPackManifest manifest;
+    manifest.BDSVersion = L"37.0";
+    manifest.PackageSuffix = L"370";
+    manifest.DxBuildNumber = 20250101;
+    manifest.CreatedAt = Now();
+    TRegistryChangeRecord change;
+    change.Key = L"Software\\Embarcadero\\BDS\\37.0\\Known Packages";
+    change.Name = macrosA.Collapse(files[2]);
+    change.Kind = TRegistryChangeKind::SetValue;
+    change.Data = L"ExpressCore";
+    manifest.RegistryChanges.push_back(change);
+
+    String packFile = TPath::Combine(dir.GetPath(), L"build.dxpack");
+    TBinaryPack::Write(packFile, manifest, files, macrosA);
+    test.Equal(L"manifest files", static_cast<__int64>(manifest.Files.size()), 4);
+    test.Equal(L"file paths with macros", manifest.Files.size() == 4 ? manifest.Files[3].Path : String(),
+               L"$(BPL.Win64)\\dxCore370.bpl");
+
+    TBinaryPackManifest read;
+    test.Check(L"manifest read back", TBinaryPack::ReadManifest(packFile, read));
+    test.Check(L"manifest round trip", read.ToJSON() == manifest.ToJSON());
+    TBinaryPackManifest notAPack;
+    test.Check(L"not a pack", !TBinaryPack::ReadManifest(files[2], notAPack));
+
+    bool outsideRejected = false;
+    try
+    {
+        std::vector<String> outside(1, dir.WriteFile(L"Elsewhere\\x.dcu", L"x"));
+        TBinaryPackManifest other;
+        TBinaryPack::Write(TPath::Combine(dir.GetPath(), L"other.dxpack"), other, outside, macrosA);
+    }
+    catch (Exception&)
+    {
+        outsideRejected = true;
+    }
+    test.Check(L"file outside the macros rejected", outsideRejected);
+
+    // Machine B: other directories; import needs every macro the pack uses
+    std::vector<String> missing = TBinaryPack::GetMissingMacros(read, MakeMachineMacros(machineB, false));
+    test.Check(L"missing macro reported", missing.size() == 1 && missing[0] == L"$(BPL.Win64)",
+               missing.empty() ? String(L"none") : missing[0]);
+    TPathMacros macrosB = MakeMachineMacros(machineB, true);
+    test.Check(L"all macros defined", TBinaryPack::GetMissingMacros(read, macrosB).empty());
+
+    std::vector<String> written;
+    test.Check(L"extract", TBinaryPack::Extract(packFile, read, macrosB, written));
+    bool same = written.size() == files.size();
+    bool times = same;
+    for (size_t i = 0; same && i < files.size(); i++)
+    {
+        THash128 hashA, hashB;
+        same = StartsText(machineB, written[i]) &&
+               TContentHash::HashFile(files[i], hashA) && TContentHash::HashFile(written[i], hashB) &&
+               hashA == hashB;
+        times = times && GetWriteTime(written[i]) == read.Files[i].WriteTime;
+    }
+    test.Check(L"extracted content", same);
+    test.Check(L"write times restored", times);
+    test.Equal(L"registry name expanded", macrosB.Expand(read.RegistryChanges[0].Name),
+               machineB + L"\\Bpl\\dxCore370.bpl");
+
+    // A manifest that does not match the entry is refused
+    TBinaryPackManifest corrupt = read;
+    corrupt.Files[2].Hash = read.Files[3].Hash;
+    bool corruptRejected = false;
+    try
+    {
+        TBinaryPack::Extract(packFile, corrupt, macrosB, written);
+    }
+    catch (Exception& e)
+    {
+        corruptRejected = ContainsText(e.Message, L"corrupt");
+    }
+    test.Check(L"corrupt entry rejected", corruptRejected);
+
+    // BPLs over ChunkSize, more of them than I/O slots: every one is hashed
+    // inside an I/O task of the writer
+    std::vector<String> large;
+    std::vector<THash128> largeHashes;
+    size_t largeSize = (size_t)TContentHash::ChunkSize * 2 + 777;
+    std::vector<uint8_t> content(largeSize);
+    for (int n = 0; n < TTaskPool::DefaultIOCapacity + 2; n++)
+    {
+        for (size_t i = 0; i < largeSize; i++)
+            content[i] = (uint8_t)((i % 251) ^ n);
+        String fileName = TPath::Combine(machineA, L"Bpl\\dxLarge" + String(n) + L"370.bpl");
+        std::unique_ptr<TFileStream> stream(new TFileStream(fileName, fmCreate));
+        stream->WriteBuffer(content.data(), (NativeInt)largeSize);
+        large.push_back(fileName);
+        largeHashes.push_back(TContentHash::HashContent(content.data(), largeSize));
+    }
+    TBinaryPackManifest largeManifest;
+    String largePack = TPath::Combine(dir.GetPath(), L"large.dxpack");
+    TBinaryPack::Write(largePack, largeManifest, large, macrosA);
+    bool largeHashed = largeManifest.Files.size() == large.size();
+    for (size_t i = 0; largeHashed && i < large.size(); i++)
+        largeHashed = largeManifest.Files[i].Hash == largeHashes[i] && largeManifest.Files[i].Size == (__int64)largeSize;
+    test.Check(L"large files hashed", largeHashed);
+
+    std::vector<String> largeWritten;
+    TBinaryPackManifest largeRead;
+    test.Check(L"large extract", TBinaryPack::ReadManifest(largePack, largeRead) &&
+                                 TBinaryPack::Extract(largePack, largeRead, macrosB, largeWritten));
+    bool largeSame = largeWritten.size() == large.size();
+    for (size_t i = 0; largeSame && i < largeWritten.size(); i++)
+    {
+        THash128 hash;
+        largeSame = TContentHash::HashFile(largeWritten[i], hash) && hash == largeHashes[i];
+    }
+    test.Check(L"large extracted content", largeSame);
+}
+
+//---------------------------------------------------------------------------
+// pipe-multiplexer: real child processes through TCompileScheduler
+//---------------------------------------------------------------------------
+// Stub compiler output, written in halves so lines arrive split
+static void WriteStubText(HANDLE output, const String& text)
+{
+    AnsiString bytes = text;
+    int half = bytes.Length() / 2;
+    DWORD written = 0;
+    WriteFile(output, bytes.c_str(), half, &written, nullptr);
+    Sleep(1);
+    WriteFile(output, bytes.c_str() + half, bytes.Length() - half, &written, nullptr);
+}
+
+static String StubLine(const String& tag, int index)
+{
+    return tag + L": line " + String(index);
+}
+
+// A line longer than the multiplexer's read buffer
+static String StubLongLine(const String& tag)
+{
+    return tag + L": long " + StringOfChar(L'x', 10000);
+}
+
+int TSelfTest::RunStubCompiler(const String& tag, int lines, int exitCode, int delayMs)
+{
+    HANDLE output = GetStdHandle(STD_OUTPUT_HANDLE);
+    WriteStubText(output, tag + L": pid " + String((int)GetCurrentProcessId()) + L"\r\n");
+    for (int i = 1; i <= lines; i++)
+        WriteStubText(output, StubLine(tag, i) + L"\r\n");
+    WriteStubText(output, StubLongLine(tag) + L"\n");
+    // Unterminated: passed on when the output closes
+    WriteStubText(output, tag + L": done");
+    if (delayMs > 0)
+        Sleep(delayMs);
+    return exitCode;
+}
+
+static TPlanCompileJob MakeStubJob(int id, const String& name, std::vector<int> dependsOn,
+                                   int lines, int exitCode, int delayMs, const String& workDir)
+{
+    TPlanCompileJob job = MakeJob(id, name, dependsOn);
+    job.Compiler = ParamStr(0);
+    job.CommandLine = L"self-test stub-compiler " + name + L" " + String(lines) + L" " +
+                      String(exitCode) + L" " + String(delayMs);
+    job.WorkDir = workDir;
+    return job;
+}
+
+static void CheckStubOutput(TSelfTest& test, const String& tag, int lines, const std::vector<String>& output)
+{
+    std::vector<String> expected;
+    for (int i = 1; i <= lines; i++)
+        expected.push_back(StubLine(tag, i));
+    expected.push_back(StubLongLine(tag));
+    expected.push_back(tag + L": done");
+
+    test.Equal(tag + L" line count", static_cast<__int64>(output.size()), static_cast<__int64>(expected.size() + 1));
+    test.Check(tag + L" pid line", !output.empty() && StartsStr(tag + L": pid ", output[0]),
+               output.empty() ? String(L"no output") : output[0]);
+    for (size_t i = 0; i < expected.size() && i + 1 < output.size(); i++)
+    {
+        if (output[i + 1] != expected[i])
+        {
+            test.Equal(tag + L" line " + String((int)i + 1), output[i + 1], expected[i]);
+            return;
+        }
+    }
+}
+
+static void CheckPipeMultiplexer(TSelfTest& test)
+{
+    TTempDir dir;
+    std::vector<TPlanCompileJob> jobs;
+    jobs.push_back(MakeStubJob(0, L"A", {}, 20, 0, 300, dir.GetPath()));
+    jobs.push_back(MakeStubJob(1, L"B", {}, 20, 0, 300, dir.GetPath()));
+    jobs.push_back(MakeStubJob(2, L"C", {}, 20, 0, 300, dir.GetPath()));
+    jobs.push_back(MakeStubJob(3, L"Fail", {}, 5, 2, 0, dir.GetPath()));
+    jobs.push_back(MakeStubJob(4, L"AfterA", { 0 }, 3, 0, 0, dir.GetPath()));
+    jobs.push_back(MakeStubJob(5, L"AfterFail", { 3 }, 3, 0, 0, dir.GetPath()));
+
+    TWorkerBudget budget(2);
+    std::map<String, std::vector<String>> output;
+    std::map<String, TCompileResult> results;
+    std::map<String, String> skipped;
+    int running = 0;
+    int maxRunning = 0;
+    TCompileScheduler scheduler(jobs, budget);
+    scheduler.OnStart = [&](const TPlanCompileJob&) { maxRunning = std::max(maxRunning, ++running); };
+    scheduler.OnOutput = [&](const TPlanCompileJob& job, const String& line) {
+        output[job.PackageName].push_back(line);
+    };
+    scheduler.OnFinished = [&](const TPlanCompileJob& job, const TCompileResult& result) {
+        running--;
+        results[job.PackageName] = result;
+    };
+    scheduler.OnSkipped = [&](const TPlanCompileJob& job, const TPlanCompileJob& failed) {
+        skipped[job.PackageName] = failed.PackageName;
+    };
+
+    test.Check(L"run returns", scheduler.Run());
+    test.Equal(L"finished jobs", static_cast<__int64>(results.size()), 5);
+    test.Equal(L"concurrency within budget", maxRunning, 2);
+    test.Check(L"budget released", budget.TryAcquire());
+    budget.Release();
+
+    // Every line of every child, in order, to the job that wrote it
+    CheckStubOutput(test, L"A", 20, output[L"A"]);
+    CheckStubOutput(test, L"B", 20, output[L"B"]);
+    CheckStubOutput(test, L"C", 20, output[L"C"]);
+    CheckStubOutput(test, L"Fail", 5, output[L"Fail"]);
+    CheckStubOutput(test, L"AfterA", 3, output[L"AfterA"]);
+
+    test.Check(L"exit 0 succeeds", results[L"A"].Success && results[L"AfterA"].Success,
+               results[L"A"].ErrorMessage + results[L"AfterA"].ErrorMessage);
+    test.Check(L"exit 2 fails", !results[L"Fail"].Success);
+    test.Equal(L"exit code", results[L"Fail"].ExitCode, 2);
+    test.Equal(L"failure message", results[L"Fail"].ErrorMessage, L"Compilation failed with exit code 2");
+    test.Equal(L"dependent of failed job skipped", skipped[L"AfterFail"], L"Fail");
+    test.Equal(L"skipped job not started", static_cast<__int64>(output.count(L"AfterFail")), 0);
+
+    // Stop flag: a child that would run for a minute is terminated
+    std::vector<TPlanCompileJob> hangJobs;
+    hangJobs.push_back(MakeStubJob(0, L"Hang", {}, 1, 0, 60000, dir.GetPath()));
+    std::atomic<bool> stopped(false);
+    DWORD pid = 0;
+    TWorkerBudget hangBudget(1);
+    ULONGLONG start = GetTickCount64();
+    {
+        TCompileScheduler hang(hangJobs, hangBudget, &stopped);
+        hang.OnOutput = [&](const TPlanCompileJob&, const String& line) {
+            if (StartsStr(L"Hang: pid ", line))
+            {
+                pid = static_cast<DWORD>(StrToIntDef(line.SubString(11, line.Length() - 10), 0));
+                stopped = true;
+            }
+        };
+        test.Check(L"stopped run returns false", !hang.Run());
+    }
+    ULONGLONG elapsed = GetTickCount64() - start;
+    test.Check(L"stop is prompt", elapsed < 30000, String((__int64)elapsed) + L" ms");
+    test.Check(L"child pid seen", pid != 0);
+    HANDLE child = pid ? OpenProcess(SYNCHRONIZE, FALSE, pid) : nullptr;
+    bool exited = !child || WaitForSingleObject(child, 5000) == WAIT_OBJECT_0;
+    if (child)
+        CloseHandle(child);
+    test.Check(L"child terminated", exited);
+    test.Check(L"stopped budget released", hangBudget.TryAcquire());
+    hangBudget.Release();
+}
+
+//---------------------------------------------------------------------------
+// scratch-dir: RAM build mode redirection and copy-back (TScratchDir)
+//---------------------------------------------------------------------------
+static void CheckScratchDir(TSelfTest& test)
+{
+    TTempDir dir;
+    String library = TPath::Combine(dir.GetPath(), L"Library\\RS37");
+    String win64 = library + L"\\Win64";
+    String win64x = library + L"\\Win64x";
+    dir.WriteFile(L"Library\\RS37\\Win64\\dxOld.dcu", L"previous build");
+    dir.WriteFile(L"Library\\RS37\\Win64\\dxKept.dcu", L"untouched");
+
+    String scratchDir;
+    {
+        TScratchDir scratch(TPath::Combine(dir.GetPath(), L"Ram"));
+        scratchDir = scratch.GetDir();
+        String mapped = scratch.Map(win64);
+        test.Check(L"map below scratch dir", StartsText(IncludeTrailingPathDelimiter(scratchDir), mapped), mapped);
+        test.Check(L"map creates dir", DirectoryExists(mapped));
+        test.Equal(L"map again", scratch.Map(win64.UpperCase() + L"\\"), mapped);
+        String mappedX = scratch.Map(win64x);
+        test.Check(L"second dir gets its own", !SameText(mappedX, mapped), mappedX);
+
+        // Paths
+        test.Equal(L"path in dir", scratch.MapPath(win64 + L"\\dxCore.dcu"), mapped + L"\\dxCore.dcu");
+        test.Equal(L"path case", scratch.MapPath(win64.LowerCase() + L"\\Sub\\dxA.hpp"), mapped + L"\\Sub\\dxA.hpp");
+        test.Equal(L"dir itself", scratch.MapPath(win64), mapped);
+        test.Equal(L"dir with delimiter", scratch.MapPath(win64 + L"\\"), mapped + L"\\");
+        test.Equal(L"sibling prefix", scratch.MapPath(library + L"\\Win64y\\dxCore.dcu"),
+                   library + L"\\Win64y\\dxCore.dcu");
+        test.Equal(L"prefix of sibling", scratch.MapPath(win64x + L"\\dxCore.dcu"), mappedX + L"\\dxCore.dcu");
+        test.Equal(L"unmapped", scratch.MapPath(library + L"\\Win32\\dxCore.dcu"), library + L"\\Win32\\dxCore.dcu");
+
+        // Command lines: quoted dirs only, whole quotes only
+        String cmdLine = L"-NU\"" + win64.UpperCase() + L"\" -NH\"" + win64x + L"\" -U\"" + library +
+                         L"\" -I" + win64 + L" dxCore.dpk";
+        test.Equal(L"command line", scratch.MapCommandLine(cmdLine),
+                   L"-NU\"" + mapped + L"\" -NH\"" + mappedX + L"\" -U\"" + library + L"\" -I" + win64 +
+                   L" dxCore.dpk");
+
+        // Persist: new files, nested dirs and overwrites; others are kept
+        TFile::WriteAllText(mapped + L"\\dxNew.dcu", L"new unit");
+        TFile::WriteAllText(mapped + L"\\dxOld.dcu", L"rebuilt");
+        ForceDirectories(mapped + L"\\Sub");
+        TFile::WriteAllText(mapped + L"\\Sub\\dxA.hpp", L"header");
+        TFile::WriteAllText(mappedX + L"\\dxX.dcu", L"win64x unit");
+        test.Equal(L"persist count", scratch.Persist(), 4);
+        test.Equal(L"persisted new", TFile::ReadAllText(win64 + L"\\dxNew.dcu"), L"new unit");
+        test.Equal(L"persisted overwrite", TFile::ReadAllText(win64 + L"\\dxOld.dcu"), L"rebuilt");
+        test.Equal(L"persisted nested", TFile::ReadAllText(win64 + L"\\Sub\\dxA.hpp"), L"header");
+        test.Equal(L"persisted second dir", TFile::ReadAllText(win64x + L"\\dxX.dcu"), L"win64x unit");
+        test.Equal(L"persistent file kept", TFile::ReadAllText(win64 + L"\\dxKept.dcu"), L"untouched");
+        test.Check(L"scratch files stay until destroyed", FileExists(mapped + L"\\dxNew.dcu"));
+
+        // Once stopped, nothing more is copied (the installer checks the flag)
+        TFile::WriteAllText(mapped + L"\\dxLate.dcu", L"late");
+        std::atomic<bool> stopped(true);
+        test.Check(L"stopped persist copies nothing", scratch.Persist(&stopped) <= 0);
+        test.Check(L"stopped persist skips files", !FileExists(win64 + L"\\dxLate.dcu"));
+    }
+    test.Check(L"destructor removes scratch dir", !DirectoryExists(scratchDir), scratchDir);
+
+    // Capacity
+    String reason;
+    test.Check(L"capacity missing root", !TScratchDir::CheckCapacity(TPath::Combine(dir.GetPath(), L"Missing"), 0, 0, reason));
+    test.Check(L"capacity missing reason", StartsText(L"Scratch directory not available", reason), reason);
+    reason = L"";
+    test.Check(L"capacity too large", !TScratchDir::CheckCapacity(dir.GetPath(), __int64(1) << 60, 0, reason));
+    test.Check(L"capacity too large reason", StartsText(L"Scratch volume has", reason), reason);
+    reason = L"";
+    test.Check(L"capacity nothing needed", TScratchDir::CheckCapacity(dir.GetPath(), 0, 0, reason), reason);
+}
+
+//---------------------------------------------------------------------------
+// task-pool: nesting, I/O budget and cancellation (TTaskPool, TTaskGroup)
+//---------------------------------------------------------------------------
+struct TNestedRun
+{
+    TTaskPool Pool;
+    std::atomic<int> Leaves{0};
+    std::atomic<int> Active{0};
+    std::atomic<int> MaxActive{0};
+    std::atomic<bool> Done{false};
+    String Error;
+
+    TNestedRun() : Pool(4, 2) {}
+};
+
+// Every level runs three I/O tasks that each wait for a group one level deeper
+static void RunNestedIO(TNestedRun& run, int depth)
+{
+    TTaskGroup group(nullptr, run.Pool);
+    for (int i = 0; i < 3; i++)
+    {
+        group.RunIO([&run, depth]() {
+            if (depth > 1)
+            {
+                RunNestedIO(run, depth - 1);
+                return;
+            }
+            int now = ++run.Active;
+            int seen = run.MaxActive.load();
+            while (now > seen && !run.MaxActive.compare_exchange_weak(seen, now))
+                ;
+            Sleep(1);
+            run.Active--;
+            run.Leaves++;
+        });
+    }
+    group.Wait();
+}
+
+static void CheckTaskPool(TSelfTest& test)
+{
+    // Nested deeper than the I/O capacity used to leave every slot with a
+    // thread waiting for one. A hang leaks the run instead of the process.
+    std::unique_ptr<TNestedRun> run(new TNestedRun());
+    TNestedRun* state = run.get();
+    std::thread runner([state]() {
+        try
+        {
+            RunNestedIO(*state, 5);
+        }
+        catch (Exception& e)
+        {
+            state->Error = e.Message;
+        }
+        state->Done = true;
+    });
+    for (int waited = 0; !state->Done && waited < 60000; waited += 10)
+        Sleep(10);
+    test.Check(L"nested I/O deeper than capacity finishes", state->Done.load());
+    if (!state->Done)
+    {
+        runner.detach();
+        run.release();
+        return;
+    }
+    runner.join();
+    test.Equal(L"nested error", state->Error, L"");
+    test.Equal(L"nested leaves", state->Leaves.load(), 243);
+    test.Check(L"nested I/O within capacity", state->MaxActive.load() <= 2, String(state->MaxActive.load()));
+    test.Equal(L"nested slots released", state->Pool.GetIOBudget().GetInUse(), 0);
+
+    TTaskPool pool(4, 2);
+
+    // Stopped before the batch: nothing runs
+    {
+        std::atomic<bool> stopped(true);
+        std::atomic<int> ran(0);
+        TTaskGroup group(&stopped, pool);
+        for (int i = 0; i < 20; i++)
+            group.RunIO([&]() { ran++; });
+        test.Check(L"stopped batch returns false", !group.Wait());
+        test.Equal(L"stopped batch runs nothing", ran.load(), 0);
+    }
+
+    // Stopped from inside: the rest of the batch is skipped
+    {
+        std::atomic<bool> stopped(false);
+        std::atomic<int> ran(0);
+        TTaskGroup group(&stopped, pool);
+        for (int i = 0; i < 200; i++)
+        {
+            group.RunIO([&]() {
+                ran++;
+                stopped = true;
+                Sleep(5);
+            });
+        }
+        test.Check(L"stop mid-batch returns false", !group.Wait());
+        test.Check(L"stop mid-batch skips tasks", ran.load() < 200, String(ran.load()));
+    }
+
+    // Stopped while nested I/O groups wait
+    {
+        std::atomic<bool> stopped(false);
+        std::atomic<int> inner(0);
+        TTaskGroup outer(&stopped, pool);
+        for (int i = 0; i < 4; i++)
+        {
+            outer.RunIO([&]() {
+                TTaskGroup nested(&stopped, pool);
+                for (int j = 0; j < 50; j++)
+                {
+                    nested.RunIO([&]() {
+                        if (++inner == 10)
+                            stopped = true;
+                        Sleep(2);
+                    });
+                }
+                nested.Wait();
+            });
+        }
+        test.Check(L"nested stop returns false", !outer.Wait());
+        test.Check(L"nested stop skips tasks", inner.load() < 200, String(inner.load()));
+    }
+
+    // The first failure is thrown to the waiter and cancels the rest
+    {
+        std::atomic<int> ran(0);
+        String message;
+        TTaskGroup group(nullptr, pool);
+        for (int i = 0; i < 200; i++)
+        {
+            group.RunIO([&]() {
+                if (++ran == 1)
+                    throw Exception(L"first failure");
+                Sleep(5);
+            });
+        }
+        try
+        {
+            group.Wait();
+        }
+        catch (Exception& e)
+        {
+            message = e.Message;
+        }
+        test.Equal(L"failure thrown", message, L"first failure");
+        test.Check(L"failure cancels batch", ran.load() < 200, String(ran.load()));
+    }
+    test.Equal(L"slots released", pool.GetIOBudget().GetInUse(), 0);
+}
+
+//---------------------------------------------------------------------------
+// content-hash: kernels agree, chunked files (TContentHash)
+//---------------------------------------------------------------------------
+static std::vector<uint8_t> MakeNoise(size_t size)
+{
+    std::vector<uint8_t> data(size);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (auto& b : data)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        b = (uint8_t)(seed >> 56);
+    }
+    return data;
+}
+
+static String WriteBinaryFile(const TTempDir& dir, const String& name, const uint8_t* data, size_t size)
+{
+    String fileName = TPath::Combine(dir.GetPath(), name);
+    std::unique_ptr<TFileStream> stream(new TFileStream(fileName, fmCreate));
+    if (size > 0)
+        stream->WriteBuffer(data, (NativeInt)size);
+    return fileName;
+}
+
+static void CheckContentHash(TSelfTest& test)
+{
+    // Hashes are stored in the hash cache and in packs that move between
+    // machines: every kernel must give the scalar result
+    const size_t chunk = (size_t)TContentHash::ChunkSize;
+    const size_t sizes[] = {
+        0, 1, 2, 3, 7, 8, 15, 16, 31, 33, 63, 64, 65, 127, 128, 129,   // Stripe is 64 bytes
+        1023, 1024, 1025, 2047, 2048, 2049, 3 * 1024 + 17,            // Block is 16 stripes
+        65536 + 1, chunk - 1, chunk, chunk + 1
+    };
+    std::vector<uint8_t> data = MakeNoise(chunk * 2 + 12345);
+
+    THashIsa best = TContentHash::GetIsa();
+    test.Check(L"scalar supported", TContentHash::SetIsa(THashIsa::Scalar));
+    std::vector<THash128> expected;
+    std::vector<THash128> expectedUnaligned;
+    for (size_t size : sizes)
+    {
+        expected.push_back(TContentHash::HashBuffer(data.data(), size));
+        expectedUnaligned.push_back(TContentHash::HashBuffer(data.data() + 1, size));
+    }
+
+    const THashIsa isas[] = { THashIsa::SSE2, THashIsa::AVX2, THashIsa::AVX512 };
+    for (THashIsa isa : isas)
+    {
+        if (!TContentHash::SetIsa(isa))
+            continue;
+        String name = TContentHash::GetIsaName(isa);
+        int mismatches = 0;
+        String first;
+        for (size_t i = 0; i < sizeof(sizes) / sizeof(sizes[0]); i++)
+        {
+            bool same = TContentHash::HashBuffer(data.data(), sizes[i]) == expected[i] &&
+                        TContentHash::HashBuffer(data.data() + 1, sizes[i]) == expectedUnaligned[i];
+            if (!same && mismatches++ == 0)
+                first = L"first at " + String((__int64)sizes[i]) + L" bytes";
+        }
+        test.Check(name + L" matches scalar", mismatches == 0, String(mismatches) + L" lengths differ, " + first);
+    }
+    TContentHash::SetIsa(best);
+
+    // Lengths and contents are told apart
+    std::set<THash128> distinct(expected.begin(), expected.end());
+    test.Equal(L"lengths distinct", static_cast<__int64>(distinct.size()), static_cast<__int64>(expected.size()));
+    std::vector<uint8_t> flipped(data.begin(), data.begin() + chunk);
+    flipped[chunk / 2] ^= 1;
+    test.Check(L"one bit changes hash",
+               TContentHash::HashBuffer(flipped.data(), chunk) != TContentHash::HashBuffer(data.data(), chunk));
+
+    // Files: one piece up to ChunkSize, chunks above - also from a pool task,
+    // where the chunks are hashed inline
+    TTempDir dir;
+    const size_t fileSizes[] = { 0, 1, chunk, chunk + 1, chunk * 2 + 12345 };
+    for (size_t size : fileSizes)
+    {
+        String fileName = WriteBinaryFile(dir, L"data" + String((__int64)size) + L".bin", data.data(), size);
+        String label = String((__int64)size) + L" byte file";
+        THash128 fileHash;
+        test.Check(label + L" hashed", TContentHash::HashFile(fileName, fileHash));
+        test.Check(label + L" equals content hash", fileHash == TContentHash::HashContent(data.data(), size));
+        if (size <= chunk)
+            test.Check(label + L" equals buffer hash", fileHash == TContentHash::HashBuffer(data.data(), size));
+
+        THash128 taskHash;
+        bool taskOk = false;
+        TTaskGroup group;
+        group.RunIO([&]() { taskOk = TContentHash::HashFile(fileName, taskHash); });
+        group.Wait();
+        test.Check(label + L" same from pool task", taskOk && taskHash == fileHash);
+    }
+}
+
+//---------------------------------------------------------------------------
+// interface-hash: fingerprints and early cutoff (TInterfaceHash, TEarlyCutoff)
+//---------------------------------------------------------------------------
+static const wchar_t* const CutInterface =
+    L"type\r\n"
+    L"  TdxCut = class\r\n"
+    L"  public\r\n"
+    L"    procedure Run;\r\n"
+    L"  end;\r\n"
+    L"\r\n"
+    L"function Twice(Value: Integer): Integer;\r\n";
+
+static const wchar_t* const CutImplementation =
+    L"procedure TdxCut.Run;\r\n"
+    L"begin\r\n"
+    L"end;\r\n"
+    L"\r\n"
+    L"function Twice(Value: Integer): Integer;\r\n"
+    L"begin\r\n"
+    L"  Result := Value * 2;\r\n"
+    L"end;\r\n";
+
+static String CutUnit(const String& interfacePart, const String& implementationPart)
+{
+    return L"unit dxCut;\r\n\r\ninterface\r\n\r\n{$I dxCut.inc}\r\n\r\n" + interfacePart +
+           L"\r\nimplementation\r\n\r\n{$I dxImpl.inc}\r\n\r\n" + implementationPart + L"\r\nend.\r\n";
+}
+
+// Writes the unit and its include files to a directory of their own. The
+// include below 'implementation' differs per label; it must only count
+// where the whole unit does.
+static THash128 HashCutUnit(TSelfTest& test, const TTempDir& dir, const String& label, const String& unit,
+                            const String& include = L"{$DEFINE DXCUT}", const String& hpp = String())
+{
+    String sub = TPath::GetGUIDFileName() + L"\\";
+    String pasFile = dir.WriteFile(sub + L"dxCut.pas", unit);
+    dir.WriteFile(sub + L"dxCut.inc", include);
+    dir.WriteFile(sub + L"dxImpl.inc", L"{$DEFINE DXIMPL_" + label.UpperCase().SubString(1, 4) + L"}");
+    String hppFile = hpp.IsEmpty() ? String() : dir.WriteFile(sub + L"dxCut.hpp", hpp);
+    THash128 hash;
+    test.Check(label + L" hashed", TInterfaceHash::HashUnit(pasFile, hppFile, hash));
+    return hash;
+}
+
+static std::set<String> RunCutoff(const std::vector<TPlanCompileJob>& jobs, const std::set<String>& changed)
+{
+    std::set<String> started;
+    TWorkerBudget budget(2);
+    TEarlyCutoff cutoff(jobs);
+    TCompileScheduler scheduler(jobs, budget);
+    // The installer's CanReuse, less its checks for the previous BPL/DCP
+    scheduler.CanReuse = [&](const TPlanCompileJob& job) {
+        if (!job.Reusable || !cutoff.DependenciesUnchanged(job))
+            return false;
+        cutoff.SetChanged(job, false);
+        return true;
+    };
+    scheduler.OnStart = [&](const TPlanCompileJob& job) { started.insert(job.PackageName); };
+    scheduler.OnFinished = [&](const TPlanCompileJob& job, const TCompileResult& result) {
+        if (result.Success)
+            cutoff.SetChanged(job, changed.count(job.PackageName) > 0);
+    };
+    scheduler.Run();
+    return started;
+}
+
+static String JoinNames(const std::set<String>& names)
+{
+    String result;
+    for (const auto& name : names)
+        result += (result.IsEmpty() ? L"" : L",") + name;
+    return result;
+}
+
+static void CheckInterfaceHash(TSelfTest& test)
+{
+    TTempDir dir;
+    String editedImplementation = StringReplace(CutImplementation, L"Value * 2", L"Value + Value", TReplaceFlags());
+    THash128 base = HashCutUnit(test, dir, L"base", CutUnit(CutInterface, CutImplementation));
+
+    // Edits the units above cannot see keep the fingerprint
+    String commented =
+        L"// The class\r\n"
+        L"type  { one type }\r\n"
+        L"  TdxCut = class (* was: TObject *)\r\n"
+        L"\tpublic\r\n"
+        L"      procedure   Run ;\r\n"
+        L"  end;\r\n"
+        L"function Twice(Value: Integer): Integer;   // doubles\r\n";
+    String upperCase =
+        L"TYPE\r\n"
+        L"  tdxcut = CLASS\r\n"
+        L"  PUBLIC\r\n"
+        L"    PROCEDURE Run;\r\n"
+        L"  END;\r\n"
+        L"\r\n"
+        L"Function TWICE(value: integer): INTEGER;\r\n";
+    test.Check(L"comments and whitespace keep",
+               HashCutUnit(test, dir, L"comments", CutUnit(commented, CutImplementation)) == base);
+    test.Check(L"case keeps", HashCutUnit(test, dir, L"case", CutUnit(upperCase, CutImplementation)) == base);
+    test.Check(L"implementation edit keeps",
+               HashCutUnit(test, dir, L"implementation", CutUnit(CutInterface, editedImplementation)) == base);
+
+    // What the units above compile against changes it
+    String extended = String(CutInterface) + L"procedure Stop;\r\n";
+    test.Check(L"interface edit changes",
+               HashCutUnit(test, dir, L"interface", CutUnit(extended, CutImplementation)) != base);
+    test.Check(L"include edit changes",
+               HashCutUnit(test, dir, L"include", CutUnit(CutInterface, CutImplementation), L"{$DEFINE DXCUT2}") != base);
+    test.Check(L"hpp edit changes",
+               HashCutUnit(test, dir, L"hpp1", CutUnit(CutInterface, CutImplementation), L"{$DEFINE DXCUT}", L"class A;") !=
+               HashCutUnit(test, dir, L"hpp2", CutUnit(CutInterface, CutImplementation), L"{$DEFINE DXCUT}", L"class B;"));
+
+    // Inline routines and generics copy their implementation into the users
+    const wchar_t* whole[][2] = {
+        { L"inline", L"function Half(Value: Integer): Integer; inline;\r\n" },
+        { L"generic routine", L"function Pick<T>(const A, B: T): T;\r\n" },
+        { L"generic type", L"type\r\n  TdxBox<T> = class\r\n    Value: T;\r\n  end;\r\n" }
+    };
+    for (const auto& w : whole)
+    {
+        String interfacePart = String(CutInterface) + w[1];
+        test.Check(String(w[0]) + L" implementation edit changes",
+                   HashCutUnit(test, dir, w[0], CutUnit(interfacePart, CutImplementation)) !=
+                   HashCutUnit(test, dir, w[0], CutUnit(interfacePart, editedImplementation)));
+    }
+
+    // An interface include that cannot be read: no fingerprint, rebuild
+    String broken = dir.WriteFile(L"broken\\dxCut.pas", CutUnit(CutInterface, CutImplementation));
+    THash128 unused;
+    test.Check(L"missing include fails", !TInterfaceHash::HashUnit(broken, String(), unused));
+
+    std::vector<THash128> ab = { base, THash128(1, 2) };
+    std::vector<THash128> ba = { THash128(1, 2), base };
+    test.Check(L"combine is ordered", TInterfaceHash::Combine(ab) != TInterfaceHash::Combine(ba));
+
+    // Scheduler: Side depends on nothing, Mid on Base, Top on Mid
+    std::vector<TPlanCompileJob> jobs;
+    jobs.push_back(MakeStubJob(0, L"Base", {}, 1, 0, 0, dir.GetPath()));
+    jobs.push_back(MakeStubJob(1, L"Mid", { 0 }, 1, 0, 0, dir.GetPath()));
+    jobs.push_back(MakeStubJob(2, L"Top", { 1 }, 1, 0, 0, dir.GetPath()));
+    jobs.push_back(MakeStubJob(3, L"Side", {}, 1, 0, 0, dir.GetPath()));
+    for (size_t i = 1; i < jobs.size(); i++)
+        jobs[i].Reusable = true;
+
+    test.Equal(L"unchanged base keeps all above", JoinNames(RunCutoff(jobs, {})), L"Base");
+    test.Equal(L"changed base rebuilds its dependent", JoinNames(RunCutoff(jobs, { L"Base" })), L"Base,Mid");
+    test.Equal(L"change propagates", JoinNames(RunCutoff(jobs, { L"Base", L"Mid" })), L"Base,Mid,Top");
+
+    TEarlyCutoff cutoff(jobs);
+    test.Check(L"jobs start changed", cutoff.IsChanged(jobs[0]) && !cutoff.DependenciesUnchanged(jobs[1]));
+    test.Check(L"missing dependency ignored", cutoff.DependenciesUnchanged(MakeJob(9, L"Orphan", { 42 })));
+}
+
+//---------------------------------------------------------------------------
+// package-rules: compiled rule table vs the checks it replaced
+//---------------------------------------------------------------------------
+// TPackage::DetectCategory before the rule table
+static TPackageCategory OldCategory(const String& name)
+{
+    String upperName = name.UpperCase();
+    if (upperName.Pos(L"IBX") > 0)
+        return TPackageCategory::IBX;
+    if (upperName.Pos(L"TEECHART") > 0)
+        return TPackageCategory::TeeChart;
+    if (upperName.Pos(L"FIREDAC") > 0)
+        return TPackageCategory::FireDAC;
+    if (upperName.Pos(L"BDE") > 0)
+        return TPackageCategory::BDE;
+    return TPackageCategory::Normal;
+}
+
+// TInstaller::DetectThirdPartyComponents, -1 for none
+static int OldInstalled(const String& valueName)
+{
+    String fileName = valueName.LowerCase();
+    if (fileName.Pos(L"dclib") > 0)
+        return (int)TThirdPartyComponent::IBX;
+    if (fileName.Pos(L"dcltee") > 0)
+        return (int)TThirdPartyComponent::TeeChart;
+    if (fileName.Pos(L"dclfiredac") > 0 || fileName.Pos(L"anydac_") > 0)
+        return (int)TThirdPartyComponent::FireDAC;
+    if (fileName.Pos(L"dclbde") > 0)
+        return (int)TThirdPartyComponent::BDE;
+    return -1;
+}
+
+// The uninstall cleanup's prefix test
+static bool OldIsDevExpress(const String& fileName)
+{
+    String lowerName = fileName.LowerCase();
+    return lowerName.Pos(L"dx") == 1 || lowerName.Pos(L"cx") == 1 ||
+           lowerName.Pos(L"dcldx") == 1 || lowerName.Pos(L"dclcx") == 1;
+}
+
+static int NewInstalled(const TPackageClassifier& classifier, const String& valueName)
+{
+    TThirdPartyComponent component;
+    return classifier.GetInstalledComponent(valueName, component) ? (int)component : -1;
+}
+
+static void CheckPackageRules(TSelfTest& test)
+{
+    // .dpk base names of the DevExpress tree and Known Packages entries
+    const wchar_t* names[] = {
+        L"dxCoreRS37", L"cxLibraryRS37", L"dxGDIPlusRS37", L"dxFireDACEMFRS37", L"dxEMFRS37",
+        L"dxServerModeFireDACDriverRS37", L"dxServerModeIBXDriverRS37", L"dxServerModeBDEDriverRS37",
+        L"dxPSTeeChartProviderRS37", L"dxPScxGridLnkRS37", L"dxSkinVS2010RS37", L"dxSkinscxPCPainterRS37",
+        L"dcldxCoreRS37", L"dclcxGridRS37", L"dcldxFireDACEMFRS37", L"dxFireDACEMF370", L"dxCoreD29",
+        L"dxSpreadSheetCoreRS37", L"dxRichEditControlRS37", L"cxSchedulerRibbonStyleEventEditorRS37",
+        L"dxgettext", L"xdxCore", L"MyDxLib", L"DXSKINSCORERS37.BPL", L"CXGRIDRS37.DCP",
+        L"C:\\Program Files (x86)\\Embarcadero\\Studio\\23.0\\bin\\dclib290.bpl",
+        L"C:\\Program Files (x86)\\Embarcadero\\Studio\\23.0\\bin\\dcltee9290.bpl",
+        L"C:\\Program Files (x86)\\Embarcadero\\Studio\\23.0\\bin\\dclFireDAC290.bpl",
+        L"C:\\Program Files (x86)\\Embarcadero\\Studio\\23.0\\bin\\dclbde290.bpl",
+        L"$(BDS)\\bin\\AnyDAC_Comp_D29.bpl", L"$(BDS)\\bin\\dclusr290.bpl", L"$(BDS)\\bin\\dclIndyCore290.bpl",
+        L"C:\\Users\\Public\\Documents\\Embarcadero\\Studio\\23.0\\Bpl\\dcldxCoreRS37.bpl"
+    };
+
+    // Built-in rules only: what the replaced code did, name by name
+    TPackageClassifier builtIn(TPackageClassifier::WithBuiltInRules(TPackageRuleList()));
+    std::vector<String> suffixes = TProfileManager::GetKnownPackageSuffixes();
+    int categoryDiffs = 0, installedDiffs = 0, vendorDiffs = 0, strippedDiffs = 0;
+    String firstDiff;
+    for (const wchar_t* name : names)
+    {
+        String fileName = ExtractFileName(name);
+        bool category = builtIn.GetCategory(name) == OldCategory(name);
+        bool installed = NewInstalled(builtIn, name) == OldInstalled(name);
+        bool vendor = builtIn.IsDevExpress(fileName) == OldIsDevExpress(fileName);
+        // Stripping the IDE suffix leaves the category alone
+        String stripped = TProfileManager::NormalizePackageName(ChangeFileExt(fileName, L""), suffixes);
+        bool strip = builtIn.GetCategory(stripped) == OldCategory(stripped) &&
+                     OldCategory(stripped) == OldCategory(name);
+        categoryDiffs += !category;
+        installedDiffs += !installed;
+        vendorDiffs += !vendor;
+        strippedDiffs += !strip;
+        if ((!category || !installed || !vendor || !strip) && firstDiff.IsEmpty())
+            firstDiff = name;
+    }
+    test.Equal(L"category as before", categoryDiffs, 0);
+    test.Equal(L"installed as before", installedDiffs, 0);
+    test.Equal(L"DevExpress files as before", vendorDiffs, 0);
+    test.Equal(L"stripped names as before", strippedDiffs, 0);
+    test.Equal(L"first difference", firstDiff, L"");
+
+    // Spot checks, so an old and new mistake cannot agree unnoticed
+    test.Check(L"FireDAC package", builtIn.GetCategory(L"dxFireDACEMFRS37") == TPackageCategory::FireDAC);
+    test.Check(L"TeeChart package", builtIn.GetCategory(L"dxPSTeeChartProviderRS37") == TPackageCategory::TeeChart);
+    test.Check(L"IBX package", builtIn.GetCategory(L"dxServerModeIBXDriverRS37") == TPackageCategory::IBX);
+    test.Check(L"normal package", builtIn.GetCategory(L"dxCoreRS37") == TPackageCategory::Normal);
+    test.Equal(L"stripped", TProfileManager::NormalizePackageName(L"dxFireDACEMFRS37", suffixes), L"dxFireDACEMF");
+    test.Equal(L"AnyDAC installs FireDAC", NewInstalled(builtIn, L"$(BDS)\\bin\\AnyDAC_Comp_D29.bpl"),
+               (int)TThirdPartyComponent::FireDAC);
+    test.Check(L"dcldx is DevExpress", builtIn.IsDevExpress(L"dcldxCoreRS37.bpl"));
+    test.Check(L"x-prefix is not", !builtIn.IsDevExpress(L"xdxCore.dcu"));
+
+    // Profile.ini rules come first and override the built-in ones
+    TProfileManager profile;
+    profile.LoadFromText(L"[@PackageRules]\r\n"
+                         L"Vendor.dxgettext = prefix:dxgettext\r\n"
+                         L"Installed.IBX = contains:ibexpress\r\n"
+                         L"Category.TeeChart = contains:chartpack, prefix:tee\r\n"
+                         L"Category.Oracle = contains:ora\r\n"
+                         L"Vendor.TMS = prefix:tms, prefix:dcltms\r\n");
+    test.Equal(L"profile rules parsed", static_cast<__int64>(profile.GetPackageRules().size()), 6);
+    TPackageClassifier withProfile(TPackageClassifier::WithBuiltInRules(profile.GetPackageRules()));
+    test.Check(L"profile vendor overrides", !withProfile.IsDevExpress(L"dxgettext.bpl") &&
+               withProfile.GetVendor(L"dxgettext.bpl") == L"dxgettext");
+    test.Check(L"built-in vendor kept", withProfile.IsDevExpress(L"dxCoreRS37.bpl"));
+    test.Equal(L"profile vendor", withProfile.GetVendor(L"DCLTMSVCLUIPack.bpl"), L"TMS");
+    test.Equal(L"profile installed", NewInstalled(withProfile, L"$(BDS)\\bin\\IBExpress290.bpl"),
+               (int)TThirdPartyComponent::IBX);
+    test.Check(L"profile category", withProfile.GetCategory(L"dxChartPackRS37") == TPackageCategory::TeeChart);
+    test.Check(L"profile category first", withProfile.GetCategory(L"TeeFireDACRS37") == TPackageCategory::TeeChart);
+    test.Check(L"unknown category ignored", withProfile.GetCategory(L"dxOracleRS37") == TPackageCategory::Normal);
+
+    // Rules survive the binary profile
+    std::unique_ptr<TMemoryStream> stream(new TMemoryStream());
+    profile.SaveToBinaryStream(stream.get());
+    stream->Position = 0;
+    TProfileManager reloaded;
+    test.Check(L"binary rules load", reloaded.LoadFromBinaryStream(stream.get()));
+    test.Equal(L"binary rules", static_cast<__int64>(reloaded.GetPackageRules().size()),
+               static_cast<__int64>(profile.GetPackageRules().size()));
+}
+
+//---------------------------------------------------------------------------
+// component-graph: selection closures (TComponentGraph)
+//---------------------------------------------------------------------------
+static const wchar_t ComponentStateChars[] = L"INFSM";   // TComponentState order
+
+// One component per character of states, named C0, C1, ...
+static TComponentList MakeComponents(const String& states)
+{
+    TComponentList list;
+    for (int i = 1; i <= states.Length(); i++)
+    {
+        auto profile = std::make_shared<TComponentProfile>();
+        profile->ComponentName = L"C" + IntToStr(i - 1);
+        auto comp = std::make_shared<TComponent>(profile);
+        comp->State = static_cast<TComponentState>(std::wcschr(ComponentStateChars, states[i]) - ComponentStateChars);
+        list.push_back(comp);
+    }
+    return list;
+}
+
+static void Depend(const TComponentList& list, int child, int parent)
+{
+    list[child]->ParentComponents.push_back(list[parent].get());
+    list[parent]->SubComponents.push_back(list[child].get());
+}
+
+static String StateString(const TComponentList& list)
+{
+    String result;
+    for (const auto& comp : list)
+        result += ComponentStateChars[static_cast<int>(comp->State)];
+    return result;
+}
+
+static String BitString(const TBitSet& set)
+{
+    String result;
+    set.ForEach([&result](int i) {
+        if (!result.IsEmpty())
+            result += L",";
+        result += IntToStr(i);
+    });
+    return result;
+}
+
+// Indices whose state differs between two StateStrings
+static String ChangedString(const String& before, const String& after)
+{
+    TBitSet changed(before.Length());
+    for (int i = 1; i <= before.Length(); i++)
+    {
+        if (before[i] != after[i])
+            changed.Add(i - 1);
+    }
+    return BitString(changed);
+}
+
+static void CheckComponentGraph(TSelfTest& test)
+{
+    // Core <- Mid (not found) <- Top <- Leaf: an unavailable ancestor makes
+    // the whole chain Missing; Other is untouched
+    TComponentList chain = MakeComponents(L"IFIIN");
+    Depend(chain, 1, 0);
+    Depend(chain, 2, 1);
+    Depend(chain, 3, 2);
+    TComponentGraph::Attach(chain);
+    test.Equal(L"transitive missing", StateString(chain), L"IFMMN");
+    test.Equal(L"indices", static_cast<__int64>(chain[4]->Index), 4);
+    test.Check(L"shared graph", chain[0]->Graph && chain[0]->Graph == chain[4]->Graph);
+    test.Equal(L"install count", static_cast<__int64>(chain[0]->Graph->GetInstallCount()), 1);
+    chain[3]->SetState(TComponentState::Install);
+    test.Equal(L"missing not selectable", StateString(chain), L"IFMMN");
+    chain[0]->SetState(TComponentState::NotInstall);
+    test.Equal(L"deselect through missing", StateString(chain), L"NFMMN");
+
+    // Closures stop at a component that cannot be selected: selecting Pack
+    // does not reach Core past Skin, deselecting Core does not reach Pack
+    TComponentList cut = MakeComponents(L"NSN");
+    Depend(cut, 1, 0);
+    Depend(cut, 2, 1);
+    TComponentGraph::Attach(cut);
+    TComponentGraph& cutGraph = *cut[0]->Graph;
+    test.Equal(L"no ancestors past skin", BitString(cutGraph.GetAncestors(2)), L"");
+    test.Equal(L"no descendants past skin", BitString(cutGraph.GetDescendants(0)), L"");
+    test.Equal(L"select stops", BitString(cutGraph.SetState(2, TComponentState::Install)), L"2");
+    test.Equal(L"select stops state", StateString(cut), L"NSI");
+    cutGraph.SetState(0, TComponentState::Install);
+    test.Equal(L"deselect stops", BitString(cutGraph.SetState(0, TComponentState::NotInstall)), L"0");
+    test.Equal(L"deselect stops state", StateString(cut), L"NSI");
+
+    // A <- B <- C, all selected; B becoming unavailable cuts the path
+    TComponentList cutLater = MakeComponents(L"III");
+    Depend(cutLater, 1, 0);
+    Depend(cutLater, 2, 1);
+    TComponentGraph::Attach(cutLater);
+    TComponentGraph& laterGraph = *cutLater[0]->Graph;
+    test.Equal(L"descendants before cut", BitString(laterGraph.GetDescendants(0)), L"1,2");
+    test.Equal(L"unavailable changes itself", BitString(laterGraph.SetState(1, TComponentState::NotFound)), L"1");
+    test.Equal(L"descendants after cut", BitString(laterGraph.GetDescendants(0)), L"");
+    laterGraph.SetState(0, TComponentState::NotInstall);
+    test.Equal(L"deselect after cut", StateString(cutLater), L"NFI");
+    test.Equal(L"install count after cut", static_cast<__int64>(laterGraph.GetInstallCount()), 1);
+
+    // X <-> Y cycle with Z depending on Y: closures terminate and leave
+    // the component itself out
+    TComponentList cycle = MakeComponents(L"NNN");
+    Depend(cycle, 0, 1);
+    Depend(cycle, 1, 0);
+    Depend(cycle, 2, 1);
+    TComponentGraph::Attach(cycle);
+    TComponentGraph& cycleGraph = *cycle[0]->Graph;
+    test.Equal(L"cycle ancestors", BitString(cycleGraph.GetAncestors(0)), L"1");
+    test.Equal(L"cycle descendants", BitString(cycleGraph.GetDescendants(0)), L"1,2");
+    test.Equal(L"select into cycle", BitString(cycleGraph.SetState(2, TComponentState::Install)), L"0,1,2");
+    test.Equal(L"select into cycle count", static_cast<__int64>(cycleGraph.GetInstallCount()), 3);
+    test.Equal(L"deselect cycle", BitString(cycleGraph.SetState(1, TComponentState::NotInstall)), L"0,1,2");
+    test.Equal(L"deselect cycle state", StateString(cycle), L"NNN");
+    test.Equal(L"unchanged is empty", BitString(cycleGraph.SetState(1, TComponentState::NotInstall)), L"");
+
+    // Same selections on an acyclic graph against the old recursive
+    // TComponent::SetState (a list without a graph): diamond 0 <- 1,2 <- 3,
+    // a not supported 4 under 1 with a selectable 5 under it, 7 joining 5
+    // and 6
+    const String initial = L"NNNNSNNN";
+    TComponentList graphList = MakeComponents(initial);
+    TComponentList oldList = MakeComponents(initial);
+    const int edges[][2] = { {1, 0}, {2, 0}, {3, 1}, {3, 2}, {4, 1}, {5, 4}, {6, 3}, {7, 5}, {7, 6} };
+    for (const auto& edge : edges)
+    {
+        Depend(graphList, edge[0], edge[1]);
+        Depend(oldList, edge[0], edge[1]);
+    }
+    TComponentGraph::Attach(graphList);
+    test.Equal(L"attach keeps selectable", StateString(graphList), initial);
+
+    String mismatch;
+    for (int step = 0; step < 64 && mismatch.IsEmpty(); step++)
+    {
+        int index = (step * 5 + 3) % (int)initial.Length();
+        TComponentState value = ((step * 7) / 3) % 2 ? TComponentState::Install : TComponentState::NotInstall;
+        if (step == 40)
+            value = TComponentState::NotFound;   // Cuts 3 out half way
+
+        String before = StateString(graphList);
+        TBitSet changed = graphList[0]->Graph->SetState(index, value);
+        oldList[index]->SetState(value);
+        String after = StateString(graphList);
+        if (after != StateString(oldList))
+            mismatch = Format(L"step %d: %s, old %s", ARRAYOFCONST((step, after, StateString(oldList))));
+        else if (BitString(changed) != ChangedString(before, after))
+            mismatch = Format(L"step %d: changed %s, expected %s",
+                              ARRAYOFCONST((step, BitString(changed), ChangedString(before, after))));
+        else if (graphList[0]->Graph->GetInstallCount() != (int)std::count(after.c_str(), after.c_str() + after.Length(), L'I'))
+            mismatch = Format(L"step %d: install count", ARRAYOFCONST((step)));
+    }
+    test.Check(L"matches recursive SetState", mismatch.IsEmpty(), mismatch);
+}
+
+//---------------------------------------------------------------------------
+// install-manifest: uninstall from the manifest (TInstaller, in-memory
+// registry)
+//---------------------------------------------------------------------------
+static TRegistryChangeRecord MakeChangeRecord(TRegistryChangeKind kind, const String& key,
+                                              const String& name, const String& data)
+{
+    TRegistryChangeRecord record;
+    record.Kind = kind;
+    record.Key = key;
+    record.Name = name;
+    record.Data = data;
+    return record;
+}
+
+static void CheckInstallManifest(TSelfTest& test)
+{
+    TTempDir temp;
+    const String key = L"Software\\Embarcadero\\BDS\\37.0";
+    const String knownPackages = key + L"\\Known Packages";
+    const String knownPackages64 = key + L"\\Known Packages x64";
+    const String library = key + L"\\Library\\Win32";
+    const String installDir = TPath::Combine(temp.GetPath(), L"DevExpress");
+    const String ownedDir = TPath::Combine(installDir, L"Library\\370");
+
+    // Shared output dirs hold our files, an older DevExpress file the
+    // install did not create and somebody else's
+    String ourBpl = temp.WriteFile(L"Bpl\\dxCoreRS37.bpl", L"bpl");
+    String ourDcp = temp.WriteFile(L"Dcp\\dxCoreRS37.dcp", L"dcp");
+    String oldBpl = temp.WriteFile(L"Bpl\\dxGDIPlusRS29.bpl", L"old");
+    String otherBpl = temp.WriteFile(L"Bpl\\TMSVCLUIPack.bpl", L"other");
+    String ownedFile = temp.WriteFile(L"DevExpress\\Library\\370\\Win32\\Release\\dxCore.dcu", L"dcu");
+    String source = temp.WriteFile(L"DevExpress\\Library\\Sources\\dxCore.pas", L"unit");
+
+    auto backend = std::make_shared<TMemoryRegistryBackend>();
+    backend->WriteValue(library, L"Package DPL Output", TPath::Combine(temp.GetPath(), L"Bpl"));
+    backend->WriteValue(library, L"Package DCP Output", TPath::Combine(temp.GetPath(), L"Dcp"));
+    backend->WriteValue(library, L"Search Path", L"C:\\Lib;" + ownedDir + L"\\Win32\\Release");
+    backend->WriteValue(knownPackages, ourBpl, L"ExpressCore");
+    backend->WriteValue(knownPackages, otherBpl, L"TMS");
+    backend->WriteValue(knownPackages64, ourBpl, L"ExpressCore");
+    backend->WriteValue(key + L"\\Environment Variables", L"DXVCL", installDir);
+
+    auto ide = std::make_shared<TIDEInfo>();
+    ide->Name = L"Self-test IDE";
+    ide->BDSVersion = L"37.0";
+    ide->RegistryKey = key;
+    ide->SetRegistryBackend(backend);
+
+    TInstallManifest manifest;
+    manifest.IDEName = ide->Name;
+    manifest.BDSVersion = ide->BDSVersion;
+    manifest.RegistryKey = key;
+    manifest.InstallFileDir = installDir;
+    manifest.DxBuildNumber = 20250101;
+    manifest.OwnedDirectories.push_back(ownedDir);
+    manifest.Files.push_back(ourBpl);
+    manifest.Files.push_back(ourDcp);
+    manifest.Files.push_back(TPath::Combine(temp.GetPath(), L"Bpl\\dxGone.bpl"));   // Already deleted
+    manifest.RegistryChanges.push_back(MakeChangeRecord(TRegistryChangeKind::SetValue, knownPackages, ourBpl, L"ExpressCore"));
+    manifest.RegistryChanges.push_back(MakeChangeRecord(TRegistryChangeKind::SetValue, knownPackages64, ourBpl, L"ExpressCore"));
+    manifest.RegistryChanges.push_back(MakeChangeRecord(TRegistryChangeKind::AddPathEntry, library, L"Search Path",
+                                                        ownedDir + L"\\Win32\\Release"));
+    manifest.RegistryChanges.push_back(MakeChangeRecord(TRegistryChangeKind::SetValue, key + L"\\Environment Variables",
+                                                        L"DXVCL", installDir));
+    manifest.Interfaces[L"win32\\dxcorers37"] = L"0123456789abcdef";
+
+    String manifestFile = TInstallManifest::GetFileName(installDir, ide);
+    test.Equal(L"manifest file", manifestFile, TPath::Combine(installDir, L"Library\\370.manifest"));
+    manifest.SaveToFile(manifestFile);
+
+    TInstallManifest loaded;
+    test.Check(L"manifest loads", TInstallManifest::LoadFromFile(manifestFile, loaded));
+    test.Check(L"manifest round trip", loaded.Files == manifest.Files &&
+               loaded.OwnedDirectories == manifest.OwnedDirectories &&
+               loaded.Interfaces == manifest.Interfaces && loaded.DxBuildNumber == manifest.DxBuildNumber);
+    test.Equal(L"manifest registry changes", static_cast<__int64>(loaded.RegistryChanges.size()),
+               static_cast<__int64>(manifest.RegistryChanges.size()));
+    test.Check(L"invalid manifest rejected", !TInstallManifest::FromJSON(L"{\"Files\": 1", loaded));
+    if (!FileExists(manifestFile))
+        return;   // Would fall back to the name-based cleanup of the real registry
+
+    // 32-bit IDE only: Known Packages x64 keeps its entry
+    TInstaller installer;
+    installer.SetRegistryBackend(backend);
+    TUninstallOptions options;
+    options.Uninstall32BitIDE = true;
+    options.Uninstall64BitIDE = false;
+    options.DeleteCompiledFiles = true;
+    std::vector<TIDEInfoPtr> ides(1, ide);
+    installer.Uninstall(ides, options);
+
+    test.Check(L"listed files deleted", !FileExists(ourBpl) && !FileExists(ourDcp));
+    test.Check(L"unlisted DevExpress file kept", FileExists(oldBpl));
+    test.Check(L"foreign file kept", FileExists(otherBpl));
+    test.Check(L"owned directory deleted", !FileExists(ownedFile) && !DirectoryExists(ownedDir));
+    test.Check(L"sources kept", FileExists(source));
+    test.Check(L"manifest deleted", !FileExists(manifestFile));
+    test.Equal(L"package unregistered", ReadOrMissing(*backend, knownPackages, ourBpl), L"<missing>");
+    test.Equal(L"foreign package kept", ReadOrMissing(*backend, knownPackages, otherBpl), L"TMS");
+    test.Equal(L"x64 package kept", ReadOrMissing(*backend, knownPackages64, ourBpl), L"ExpressCore");
+    test.Equal(L"path entry removed", ReadOrMissing(*backend, library, L"Search Path"), L"C:\\Lib");
+    test.Equal(L"DXVCL removed", ReadOrMissing(*backend, key + L"\\Environment Variables", L"DXVCL"),
+               L"<missing>");
+}
+
+//---------------------------------------------------------------------------
+// source-archive: a zipped source drop read in place (TSourceArchive)
+//---------------------------------------------------------------------------
+static void ZipText(TZipFile* zip, const String& name, const String& text, bool bom)
+{
+    TBytes bytes = TEncoding::UTF8->GetBytes(text);
+    if (bom)
+    {
+        TBytes preamble = TEncoding::UTF8->GetPreamble();
+        TBytes withBom;
+        withBom.Length = preamble.Length + bytes.Length;
+        std::memcpy(&withBom[0], &preamble[0], preamble.Length);
+        if (bytes.Length > 0)
+            std::memcpy(&withBom[preamble.Length], &bytes[0], bytes.Length);
+        bytes = withBom;
+    }
+    zip->Add(bytes, name);
+}
+
+static String UnitName(int i)
+{
+    return Format(L"unit%.3d", ARRAYOFCONST((i)));
+}
+
+static void CheckSourceArchive(TSelfTest& test)
+{
+    TTempDir temp;
+    const int unitCount = 150;     // Several extraction batches
+    const String packageText = L"package dxCoreRS37;\r\nrequires rtl;\r\n// Gr\u00FC\u00DFe\r\n";
+
+    // Everything below one wrapping folder, with directory entries
+    String zipFile = TPath::Combine(temp.GetPath(), L"DevExpressVCL.zip");
+    {
+        std::unique_ptr<TZipFile> zip(new TZipFile());
+        zip->Open(zipFile, zmWrite);
+        zip->Add(TBytes(), L"DevExpressVCL/");
+        zip->Add(TBytes(), L"DevExpressVCL/ExpressCore Library/");
+        ZipText(zip.get(), L"DevExpressVCL/ExpressCore Library/Packages/dxCoreRS37.dpk", packageText, true);
+        for (int i = 0; i < unitCount; i++)
+        {
+            ZipText(zip.get(), L"DevExpressVCL/ExpressCore Library/Sources/" + UnitName(i) + L".pas",
+                    L"unit " + UnitName(i) + L";", false);
+        }
+        zip->Close();
+    }
+
+    const String root = TPath::Combine(temp.GetPath(), L"Install");
+    const String sources = root + L"\\ExpressCore Library\\Sources\\";
+    TSourceArchive archive;
+    archive.Open(zipFile, root + L"\\");
+    test.Equal(L"root", archive.GetRoot(), root);
+    test.Equal(L"directory entries skipped", static_cast<__int64>(archive.GetFileCount()), unitCount + 1);
+    test.Check(L"wrapper folder skipped", archive.Contains(sources + L"unit007.pas") &&
+               !archive.Contains(root + L"\\DevExpressVCL\\ExpressCore Library\\Sources\\unit007.pas"));
+    test.Check(L"case-insensitive", archive.Contains(root.UpperCase() + L"\\expresscore library\\SOURCES\\UNIT007.PAS"));
+    test.Check(L"outside root", !archive.Contains(temp.GetPath() + L"\\ExpressCore Library\\Sources\\unit007.pas") &&
+               !archive.Contains(root + L"Old\\ExpressCore Library\\Sources\\unit007.pas"));
+    test.Check(L"nothing unpacked", !DirectoryExists(root));
+
+    // The listing stands in for the directory scan
+    std::vector<TFileIndexEntry> listing = archive.GetListing();
+    test.Equal(L"listing", static_cast<__int64>(listing.size()), unitCount + 1);
+    TFileIndex index;
+    index.Build(root, listing);
+    test.Check(L"index file", index.FileExists(sources + L"unit149.pas"));
+    test.Check(L"index directory", index.DirectoryExists(root + L"\\ExpressCore Library\\Packages"));
+    const TFileIndexEntry* unit = index.Find(sources + L"unit010.pas");
+    test.Equal(L"index size", unit ? unit->Size : -1, (L"unit " + UnitName(10) + L";").Length());
+
+    // Package files are read in memory
+    std::unique_ptr<TStringList> lines(new TStringList());
+    test.Check(L"read package", archive.ReadLines(root + L"\\ExpressCore Library\\Packages\\dxCoreRS37.dpk", lines.get()));
+    test.Equal(L"BOM decoded", lines->Count > 2 ? lines->Strings[2] : String(), L"// Gr\u00FC\u00DFe");
+    test.Check(L"missing entry", !archive.ReadLines(sources + L"missing.pas", lines.get()));
+
+    // Archive copies are extracted, the others are handed back
+    const String outDir = TPath::Combine(temp.GetPath(), L"Out");
+    std::vector<TFileCopy> copies;
+    for (int i = 0; i < unitCount; i++)
+        copies.push_back({ sources + UnitName(i) + L".pas", outDir + L"\\" + UnitName(i) + L".pas" });
+    copies.push_back({ sources + L"unit001.pas", outDir + L"\\Same.pas" });
+    copies.push_back({ sources + L"unit002.pas", outDir + L"\\same.pas" });     // Later copy wins
+    String onDisk = temp.WriteFile(L"Disk\\dxDisk.pas", L"unit dxDisk;");
+    copies.push_back({ onDisk, outDir + L"\\dxDisk.pas" });
+
+    std::atomic<bool> stopped(true);
+    archive.Extract(copies, &stopped);
+    test.Check(L"stopped extracts nothing", !FileExists(outDir + L"\\unit000.pas"));
+
+    std::vector<TFileCopy> others = archive.Extract(copies);
+    test.Check(L"others handed back", others.size() == 1 && others[0].Source == onDisk);
+    test.Check(L"not copied", !FileExists(outDir + L"\\dxDisk.pas"));
+    String mismatch;
+    for (int i = 0; i < unitCount && mismatch.IsEmpty(); i++)
+    {
+        String fileName = outDir + L"\\" + UnitName(i) + L".pas";
+        if (!FileExists(fileName) || TFile::ReadAllText(fileName) != L"unit " + UnitName(i) + L";")
+            mismatch = fileName;
+    }
+    test.Check(L"extracted", mismatch.IsEmpty(), mismatch);
+    test.Equal(L"duplicate destination", TFile::ReadAllText(outDir + L"\\Same.pas"), L"unit unit002;");
+}
+
+//---------------------------------------------------------------------------
+// component-lists: per-IDE component lists built on demand (TInstaller)
+//---------------------------------------------------------------------------
+static TIDEInfoPtr MakeTestIDE(const String& bdsVersion)
+{
+    auto ide = std::make_shared<TIDEInfo>();
+    ide->Name = L"Self-test IDE " + bdsVersion;
+    ide->BDSVersion = bdsVersion;
+    ide->RegistryKey = L"Software\\Embarcadero\\BDS\\" + bdsVersion;
+    ide->SetRegistryBackend(std::make_shared<TMemoryRegistryBackend>());
+    return ide;
+}
+
+static void CheckComponentLists(TSelfTest& test)
+{
+    // CompB requires CompA's package, CompC has no directory, CompD no
+    // package for the IDE
+    TTempDir temp;
+    temp.WriteFile(L"CompA\\Packages\\dxARS37.dpk", L"package dxARS37;\r\nrequires\r\n  rtl;\r\nend.\r\n");
+    temp.WriteFile(L"CompB\\Packages\\dxBRS37.dpk", L"package dxBRS37;\r\nrequires\r\n  rtl,\r\n  dxARS37;\r\nend.\r\n");
+    temp.WriteFile(L"CompD\\Sources\\dxD.pas", L"unit dxD;");
+
+    TInstaller installer;
+    installer.GetProfile()->LoadFromText(L"[CompA]\r\nRequiredPackages = dxA\r\n"
+                                         L"[CompB]\r\nRequiredPackages = dxB\r\n"
+                                         L"[CompC]\r\nRequiredPackages = dxC\r\n"
+                                         L"[CompD]\r\nRequiredPackages = dxD\r\n");
+    TIDEInfoPtr ide = MakeTestIDE(L"37.0");
+    TIDEInfoPtr other = MakeTestIDE(L"36.0");
+    test.Check(L"no directory, no list", installer.GetComponents(ide).empty());
+
+    installer.SetInstallFileDir(temp.GetPath());
+    test.Check(L"not built by setting the directory", !installer.IsComponentListReady(ide));
+
+    const TComponentList& list = installer.GetComponents(ide);
+    test.Check(L"built on first use", installer.IsComponentListReady(ide) && !installer.IsComponentListReady(other));
+    test.Equal(L"components", static_cast<__int64>(list.size()), 4);
+    if (list.size() != 4)
+        return;
+    test.Equal(L"states", StateString(list), L"IIFS");
+    test.Check(L"dependency", list[1]->ParentComponents.size() == 1 && list[1]->ParentComponents[0] == list[0].get());
+    test.Check(L"graph attached", list[0]->Graph && list[0]->Graph->GetInstallCount() == 2);
+    test.Check(L"cached", &installer.GetComponents(ide) == &list);
+
+    // Threads asking for the same list at once get one list
+    const TComponentList* lists[4] = {};
+    {
+        std::vector<std::thread> threads;
+        for (int i = 0; i < 4; i++)
+            threads.emplace_back([&installer, &lists, other, i]() { lists[i] = &installer.GetComponents(other); });
+        for (auto& thread : threads)
+            thread.join();
+    }
+    test.Check(L"one list per IDE", lists[0] == lists[1] && lists[1] == lists[2] && lists[2] == lists[3] &&
+               lists[0] != &list);
+    test.Equal(L"other IDE states", StateString(*lists[0]), L"SSFS");
+
+    // Setting the directory again drops the lists
+    temp.WriteFile(L"CompC\\Packages\\dxCRS37.dpk", L"package dxCRS37;\r\nrequires\r\n  rtl;\r\nend.\r\n");
+    installer.SetInstallFileDir(temp.GetPath());
+    test.Check(L"dropped", !installer.IsComponentListReady(ide) && !installer.IsComponentListReady(other));
+    test.Equal(L"rebuilt", StateString(installer.GetComponents(ide)), L"IIIS");
+}
+
+//---------------------------------------------------------------------------
+// startup: background initialization (TInstaller::InitializeAsync). Reads
+// the IDE registration of this machine, like every CLI command.
+//---------------------------------------------------------------------------
+static void CheckStartup(TSelfTest& test)
+{
+    {
+        TInstaller installer;
+        installer.WaitReady();      // Never started: returns at once
+        test.Check(L"not ready before initialize", !installer.IsReady());
+    }
+
+    {
+        TInstaller installer;
+        installer.InitializeAsync(nullptr);
+        installer.WaitReady();
+        test.Check(L"ready", installer.IsReady());
+        test.Check(L"profile loaded", !installer.GetProfile()->GetComponents().empty());
+
+        const TStartupTimings& timings = installer.GetStartupTimings();
+        test.Check(L"phases timed", timings.Total > 0 && timings.DetectIDEs >= 0 && timings.LoadProfile > 0 &&
+                   timings.ThirdParty >= 0, FormatFloat(L"0.0", timings.Total));
+        test.Check(L"phases within total", timings.DetectIDEs <= timings.Total &&
+                   timings.LoadProfile <= timings.Total && timings.ThirdParty <= timings.Total);
+
+        // Same result as the synchronous Initialize the CLI uses
+        TInstaller sync;
+        sync.Initialize();
+        test.Equal(L"IDEs", static_cast<__int64>(installer.GetIDEDetector()->GetCount()),
+                   static_cast<__int64>(sync.GetIDEDetector()->GetCount()));
+        for (int i = 0; i < installer.GetIDEDetector()->GetCount() && i < sync.GetIDEDetector()->GetCount(); i++)
+        {
+            TIDEInfoPtr ide = installer.GetIDEDetector()->GetIDE(i);
+            TIDEInfoPtr syncIDE = sync.GetIDEDetector()->GetIDE(i);
+            test.Check(L"third-party components " + ide->BDSVersion, ide->BDSVersion == syncIDE->BDSVersion &&
+                       installer.GetThirdPartyComponents(ide) == sync.GetThirdPartyComponents(syncIDE));
+        }
+    }
+
+    // Destroyed while initializing: the destructor waits for the task
+    // instead of leaving it a dangling installer
+    {
+        TInstaller installer;
+        installer.InitializeAsync(nullptr);
+    }
+}
+
+//---------------------------------------------------------------------------
+// background-mode: compiler priority and the copy throttle
+//---------------------------------------------------------------------------
+// I/O priority of a process (ntdll ProcessIoPriority), -1 if unavailable
+static int GetIoPriority(HANDLE process)
+{
+    typedef LONG (NTAPI *TNtQueryInformationProcess)(HANDLE, ULONG, PVOID, ULONG, PULONG);
+    static const TNtQueryInformationProcess queryInformation = reinterpret_cast<TNtQueryInformationProcess>(
+        GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtQueryInformationProcess"));
+    ULONG ioPriority = 0;
+    if (!queryInformation || queryInformation(process, 33, &ioPriority, sizeof(ioPriority), nullptr) < 0)
+        return -1;
+    return (int)ioPriority;
+}
+
+static void CheckBackgroundMode(TSelfTest& test)
+{
+    TTempDir dir;
+
+    // A background compiler: below normal, low I/O, on the given CPU
+    DWORD_PTR processMask = 0, systemMask = 0;
+    GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+    DWORD_PTR cpu = processMask & (~processMask + 1);     // Lowest CPU we may use
+    TProcessPriority background;
+    background.Background = true;
+    background.AffinityMask = cpu;
+
+    TCompilerProcess process;
+    process.SetPriority(background);
+    String errorMessage;
+    bool started = process.Start(ParamStr(0), L"self-test stub-compiler Bg 2 0 500", dir.GetPath(), errorMessage);
+    test.Check(L"background start", started, errorMessage);
+    if (started)
+    {
+        HANDLE handle = process.GetProcessHandle();
+        test.Equal(L"priority class", static_cast<__int64>(GetPriorityClass(handle)), BELOW_NORMAL_PRIORITY_CLASS);
+        DWORD_PTR childMask = 0;
+        GetProcessAffinityMask(handle, &childMask, &systemMask);
+        test.Equal(L"affinity", static_cast<__int64>(childMask), static_cast<__int64>(cpu));
+        int ioPriority = GetIoPriority(handle);
+        test.Check(L"low I/O priority", ioPriority == 1 || ioPriority == -1, String(ioPriority));
+        process.ReadToEnd();
+        WaitForSingleObject(handle, 30000);
+        TCompileResult result = process.Finish();
+        test.Check(L"background run", result.Success && result.Output.Pos(L"Bg: done") > 0, result.ErrorMessage);
+    }
+
+    // Without background mode the child keeps our priority
+    if (GetPriorityClass(GetCurrentProcess()) == NORMAL_PRIORITY_CLASS)
+    {
+        TCompilerProcess normal;
+        if (normal.Start(ParamStr(0), L"self-test stub-compiler Fg 1 0 0", dir.GetPath(), errorMessage))
+        {
+            test.Equal(L"normal priority class", static_cast<__int64>(GetPriorityClass(normal.GetProcessHandle())),
+                       NORMAL_PRIORITY_CLASS);
+            normal.ReadToEnd();
+            WaitForSingleObject(normal.GetProcessHandle(), 30000);
+            normal.Finish();
+        }
+    }
+
+    // Token bucket: 4 MB/s, 2 MB in 256 KB pieces takes about half a second
+    const __int64 mb = 1024 * 1024;
+    TIOThrottle throttle;
+    test.Check(L"unlimited", !throttle.IsLimited() && throttle.Consume(100 * mb));
+    throttle.SetRate(4 * mb);
+    ULONGLONG start = GetTickCount64();
+    for (int i = 0; i < 8; i++)
+        throttle.Consume(mb / 4);
+    ULONGLONG elapsed = GetTickCount64() - start;
+    test.Check(L"rate kept", elapsed >= 400 && elapsed < 2000, String((__int64)elapsed) + L" ms");
+
+    std::atomic<bool> stopped(true);
+    start = GetTickCount64();
+    test.Check(L"stop ends the wait", !throttle.Consume(40 * mb, &stopped));
+    test.Check(L"stopped at once", GetTickCount64() - start < 1000);
+
+    // Staging copies go through the shared throttle
+    std::vector<uint8_t> data = MakeNoise((size_t)mb);
+    std::vector<TFileCopy> copies;
+    for (int i = 0; i < 4; i++)
+    {
+        String source = WriteBinaryFile(dir, L"copy" + String(i) + L".bin", data.data(), data.size());
+        copies.push_back({ source, TPath::Combine(dir.GetPath(), L"Out\\copy" + String(i) + L".bin") });
+    }
+    TIOThrottle& shared = TIOThrottle::Shared();
+    __int64 sharedRate = shared.GetRate();
+    shared.SetRate(8 * mb);
+    start = GetTickCount64();
+    int copied = TFileOps::CopyFiles(copies);
+    elapsed = GetTickCount64() - start;
+    shared.SetRate(sharedRate);
+    test.Equal(L"throttled copies", copied, 4);
+    test.Check(L"copies paced", elapsed >= 350, String((__int64)elapsed) + L" ms");
+    String mismatch;
+    for (const auto& copy : copies)
+    {
+        TBytes bytes = FileExists(copy.Dest) ? TFile::ReadAllBytes(copy.Dest) : TBytes();
+        if (bytes.Length != (int)data.size() || std::memcmp(&bytes[0], data.data(), data.size()) != 0)
+            mismatch = copy.Dest;
+    }
+    test.Check(L"copied bytes", mismatch.IsEmpty(), mismatch);
+}
+
+//---------------------------------------------------------------------------
+// prefetcher: compile inputs read ahead in job order, within the window
+//---------------------------------------------------------------------------
+// Jobs whose inputs the prefetcher asked for, in order
+class TPrefetchLog
+{
+private:
+    std::mutex FLock;
+    std::condition_variable FChanged;
+    std::vector<size_t> FRequested;
+
+public:
+    void Add(size_t index)
+    {
+        {
+            std::lock_guard<std::mutex> guard(FLock);
+            FRequested.push_back(index);
+        }
+        FChanged.notify_all();
+    }
+
+    // Waits until count jobs were asked for, then a little longer so that
+    // a prefetcher reading too far shows up
+    String Settle(size_t count)
+    {
+        std::unique_lock<std::mutex> lock(FLock);
+        FChanged.wait_for(lock, std::chrono::seconds(10), [&]() { return FRequested.size() >= count; });
+        lock.unlock();
+        Sleep(300);
+        lock.lock();
+        String result;
+        for (size_t index : FRequested)
+            result += (result.IsEmpty() ? L"" : L",") + String((int)index);
+        return result;
+    }
+};
+
+static void CheckPrefetcher(TSelfTest& test)
+{
+    // Six jobs of 100 KB each, the last one also with a missing input
+    TTempDir dir;
+    const int jobCount = 6;
+    const size_t fileSize = 100 * 1024;
+    std::vector<uint8_t> data = MakeNoise(fileSize);
+    std::vector<std::vector<String>> inputs(jobCount);
+    for (int i = 0; i < jobCount; i++)
+        inputs[i].push_back(WriteBinaryFile(dir, L"unit" + String(i) + L".pas", data.data(), data.size()));
+    inputs[jobCount - 1].push_back(TPath::Combine(dir.GetPath(), L"missing.pas"));
+
+    // 150 KB window: the first pending job plus one more
+    {
+        TPrefetchLog log;
+        TPrefetcher prefetcher(jobCount, [&](size_t index) { log.Add(index); return inputs[index]; }, 150 * 1024);
+        test.Equal(L"held by the window", log.Settle(2), L"0,1");
+        prefetcher.JobStarted(0);
+        test.Equal(L"moves on with the jobs", log.Settle(3), L"0,1,2");
+        prefetcher.JobStarted(5);   // Started before it was read
+        prefetcher.JobStarted(1);
+        prefetcher.JobStarted(2);
+        test.Equal(L"started job skipped", log.Settle(5), L"0,1,2,3,4");
+        test.Equal(L"files read", prefetcher.GetTotalFiles(), 5);
+        test.Equal(L"bytes read", prefetcher.GetTotalBytes(), static_cast<__int64>(5 * fileSize));
+    }
+
+    // The next job to start is read whatever the window; a missing input
+    // is skipped
+    {
+        TPrefetchLog log;
+        std::vector<std::vector<String>> single(1, inputs[jobCount - 1]);
+        TPrefetcher prefetcher(1, [&](size_t index) { log.Add(index); return single[index]; }, 1);
+        test.Equal(L"next job always read", log.Settle(1), L"0");
+        test.Equal(L"missing input skipped", prefetcher.GetTotalFiles(), 1);
+    }
+
+    // Stopped: nothing is read, and destroying a waiting prefetcher returns
+    {
+        TPrefetchLog log;
+        std::atomic<bool> stopped(true);
+        TPrefetcher prefetcher(jobCount, [&](size_t index) { log.Add(index); return inputs[index]; }, 1, &stopped);
+        test.Equal(L"stopped reads nothing", log.Settle(0), L"");
+    }
+    ULONGLONG start = GetTickCount64();
+    {
+        TPrefetchLog log;
+        TPrefetcher prefetcher(jobCount, [&](size_t index) { log.Add(index); return inputs[index]; }, 1);
+        log.Settle(1);
+    }
+    test.Check(L"destroyed while waiting", GetTickCount64() - start < 5000);
+}
+
+//---------------------------------------------------------------------------
+// Areas
+//---------------------------------------------------------------------------
+struct TSelfTestArea
+{
+    const wchar_t* Name;
+    void (*Run)(TSelfTest& test);
+};
+
+static const TSelfTestArea Areas[] = {
+    { L"package-names", CheckPackageNames },
+    { L"profile", CheckProfile },
+    { L"ide-paths", CheckIDEPaths },
+    { L"path-list", CheckPathList },
+    { L"registry", CheckRegistry },
+    { L"compile-scheduler", CheckCompileGraph },
+    { L"source-diff", CheckSourceDiff },
+    { L"binary-pack", CheckBinaryPack },
+    { L"pipe-multiplexer", CheckPipeMultiplexer },
+    { L"scratch-dir", CheckScratchDir },
+    { L"task-pool", CheckTaskPool },
+    { L"content-hash", CheckContentHash },
+    { L"interface-hash", CheckInterfaceHash },
+    { L"package-rules", CheckPackageRules },
+    { L"component-graph", CheckComponentGraph },
+    { L"install-manifest", CheckInstallManifest },
+    { L"source-archive", CheckSourceArchive },
+    { L"component-lists", CheckComponentLists },
+    { L"startup", CheckStartup },
+    { L"background-mode", CheckBackgroundMode },
+    { L"prefetcher", CheckPrefetcher }
+};
+
+//---------------------------------------------------------------------------
+// TSelfTest implementation
+//---------------------------------------------------------------------------
+TSelfTest::TSelfTest(TSelfCheckEvent onCheck)
+    : FOnCheck(onCheck),
+      FChecks(0),
+      FFailures(0)
+{
+}
+
+std::vector<String> TSelfTest::GetAreas()
+{
+    std::vector<String> names;
+    for (const auto& area : Areas)
+        names.push_back(area.Name);
+    return names;
+}
+
+bool TSelfTest::Run(const String& area)
+{
+    for (const auto& entry : Areas)
+    {
+        if (SameText(area, entry.Name))
+        {
+            FArea = entry.Name;
+            try
+            {
+                entry.Run(*this);
+            }
+            catch (Exception& e)
+            {
+                Check(L"exception", false, e.Message);
+            }
+            return true;
+        }
+    }
+    return false;
+}
+
+void TSelfTest::Check(const String& name, bool passed, const String& detail)
+{
+    FChecks++;
+    if (!passed)
+        FFailures++;
+
+    TSelfCheck check;
+    check.Area = FArea;
+    check.Name = name;
+    check.Passed = passed;
+    if (!passed)
+        check.Detail = detail;
+    if (FOnCheck)
+        FOnCheck(check);
+}
+
+void TSelfTest::Equal(const String& name, const String& actual, const String& expected)
+{
+    Check(name, actual == expected, L"\"" + actual + L"\", expected \"" + expected + L"\"");
+}
+
+void TSelfTest::Equal(const String& name, __int64 actual, __int64 expected)
+{
+    Check(name, actual == expected, String(actual) + L", expected " + String(expected));
+}
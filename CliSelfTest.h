@@ -0,0 +1,68 @@
+//---------------------------------------------------------------------------
+// CliSelfTest - Self-checks of the Core modules for DxAutoInstallerCli
+//
+// Every area exercises one module on synthetic data, in memory or below a
+// temporary directory, and reports each check it makes. No area touches
+// the registry, an IDE installation or the network, so 'self-test' runs on
+// any machine, including build agents without RAD Studio.
+//
+// pipe-multiplexer starts the CLI itself as a stand-in compiler (see
+// RunStubCompiler) to drive real child processes through the scheduler.
+//---------------------------------------------------------------------------
+#ifndef CliSelfTestH
+#define CliSelfTestH
+
+#include <System.hpp>
+#include <vector>
+#include <functional>
+
+//---------------------------------------------------------------------------
+// One check
+//---------------------------------------------------------------------------
+struct TSelfCheck
+{
+    String Area;
+    String Name;
+    bool Passed;
+    String Detail;            // Actual vs expected when it failed
+
+    TSelfCheck() : Passed(false) {}
+};
+
+typedef std::function<void(const TSelfCheck& check)> TSelfCheckEvent;
+
+//---------------------------------------------------------------------------
+// Self-test runner
+//---------------------------------------------------------------------------
+class TSelfTest
+{
+private:
+    TSelfCheckEvent FOnCheck;
+    String FArea;
+    int FChecks;
+    int FFailures;
+
+public:
+    explicit TSelfTest(TSelfCheckEvent onCheck);
+
+    // Area names, in the order 'all' runs them
+    static std::vector<String> GetAreas();
+
+    // Runs one area; false if there is no such area
+    bool Run(const String& area);
+
+    // The compiler the pipe-multiplexer area starts: this CLI, run as
+    // 'self-test stub-compiler <tag> <lines> <exitCode> <delayMs>'. Writes
+    // tagged lines to stdout in split writes, waits, and exits with exitCode.
+    static int RunStubCompiler(const String& tag, int lines, int exitCode, int delayMs);
+
+    // Used by the areas
+    void Check(const String& name, bool passed, const String& detail = String());
+    void Equal(const String& name, const String& actual, const String& expected);
+    void Equal(const String& name, __int64 actual, __int64 expected);
+
+    int GetChecks() const { return FChecks; }
+    int GetFailures() const { return FFailures; }
+};
+
+#endif
@@ -0,0 +1,460 @@
+//---------------------------------------------------------------------------
+// BinaryPack implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "BinaryPack.h"
+#include "TaskPool.h"
+#include "StringHash.h"
+#include <System.Zip.hpp>
+#include <System.JSON.hpp>
+#include <System.StrUtils.hpp>
+#include <IOUtils.hpp>
+#include <DateUtils.hpp>
+#include <Winapi.Windows.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <memory>
+
+namespace DxCore
+{
+
+const wchar_t* const TBinaryPack::ManifestEntryName = L"DxBinaryPack.json";
+
+// Files per extraction task - every task opens the archive on its own
+static const size_t EXTRACT_MIN_BATCH = 64;
+static const size_t EXTRACT_BATCHES = 32;
+
+//---------------------------------------------------------------------------
+// Helpers
+//---------------------------------------------------------------------------
+static String EntryName(const String& path)
+{
+    return StringReplace(path, L"\\", L"/", TReplaceFlags() << rfReplaceAll);
+}
+
+static String ChangeKindToString(TRegistryChangeKind kind)
+{
+    switch (kind)
+    {
+        case TRegistryChangeKind::DeleteValue: return L"delete";
+        case TRegistryChangeKind::AddPathEntry: return L"addPath";
+        case TRegistryChangeKind::RemovePathEntry: return L"removePath";
+        default: return L"set";
+    }
+}
+
+static TRegistryChangeKind ChangeKindFromString(const String& value)
+{
+    if (SameText(value, L"delete"))
+        return TRegistryChangeKind::DeleteValue;
+    if (SameText(value, L"addPath"))
+        return TRegistryChangeKind::AddPathEntry;
+    if (SameText(value, L"removePath"))
+        return TRegistryChangeKind::RemovePathEntry;
+    return TRegistryChangeKind::SetValue;
+}
+
+static String ReadString(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    return value ? value->Value() : String();
+}
+
+static __int64 ReadInt64(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    if (TJSONNumber* number = dynamic_cast<TJSONNumber*>(value))
+        return number->AsInt64;
+    return value ? StrToInt64Def(value->Value(), 0) : 0;
+}
+
+static bool IsPathBoundary(const String& text, int index)
+{
+    return index < 1 || index > text.Length() ||
+           text[index] == L'\\' || text[index] == L';' || text[index] == L'"';
+}
+
+//---------------------------------------------------------------------------
+// TPathMacros implementation
+//---------------------------------------------------------------------------
+TPathMacros TPathMacros::ForIDE(const TIDEInfoPtr& ide, const String& installFileDir)
+{
+    TPathMacros macros;
+    macros.Add(L"$(DX)", installFileDir);
+
+    const TIDEPlatform platforms[] = { TIDEPlatform::Win32, TIDEPlatform::Win64, TIDEPlatform::Win64Modern };
+    const wchar_t* const names[] = { PlatformNames::Win32, PlatformNames::Win64, PlatformNames::Win64Modern };
+    for (int i = 0; i < 3; i++)
+    {
+        macros.Add(L"$(BPL." + String(names[i]) + L")", ide->GetBPLOutputPath(platforms[i]));
+        macros.Add(L"$(DCP." + String(names[i]) + L")", ide->GetDCPOutputPath(platforms[i]));
+        macros.Add(L"$(HPP." + String(names[i]) + L")", ide->GetHPPOutputPath(platforms[i]));
+    }
+    return macros;
+}
+
+void TPathMacros::Add(const String& name, const String& path)
+{
+    String dir = ExcludeTrailingPathDelimiter(path);
+    if (dir.IsEmpty())
+        return;
+    for (const auto& macro : FMacros)
+    {
+        if (SameText(macro.second, dir))
+            return;
+    }
+
+    FMacros.push_back(std::make_pair(name, dir));
+    std::stable_sort(FMacros.begin(), FMacros.end(),
+                     [](const std::pair<String, String>& a, const std::pair<String, String>& b) {
+        return a.second.Length() > b.second.Length();
+    });
+}
+
+String TPathMacros::GetPath(const String& name) const
+{
+    for (const auto& macro : FMacros)
+    {
+        if (SameText(macro.first, name))
+            return macro.second;
+    }
+    return L"";
+}
+
+String TPathMacros::Collapse(const String& text) const
+{
+    String result = text;
+    for (const auto& macro : FMacros)
+    {
+        String lower = result.LowerCase();
+        String needle = macro.second.LowerCase();
+        String collapsed;
+        int last = 1;
+        int pos = 1;
+        while ((pos = PosEx(needle, lower, pos)) > 0)
+        {
+            int after = pos + needle.Length();
+            if (IsPathBoundary(result, pos - 1) && IsPathBoundary(result, after))
+            {
+                collapsed += result.SubString(last, pos - last) + macro.first;
+                last = after;
+                pos = after;
+            }
+            else
+                pos++;
+        }
+        result = collapsed + result.SubString(last, result.Length() - last + 1);
+    }
+    return result;
+}
+
+String TPathMacros::Expand(const String& text) const
+{
+    String result = text;
+    for (const auto& macro : FMacros)
+        result = StringReplace(result, macro.first, macro.second, TReplaceFlags() << rfReplaceAll << rfIgnoreCase);
+    return result;
+}
+
+void TPathMacros::FindMacros(const String& text, std::vector<String>& names)
+{
+    int pos = 1;
+    while ((pos = PosEx(L"$(", text, pos)) > 0)
+    {
+        int end = PosEx(L")", text, pos);
+        if (end == 0)
+            break;
+        names.push_back(text.SubString(pos, end - pos + 1));
+        pos = end + 1;
+    }
+}
+
+//---------------------------------------------------------------------------
+// TBinaryPackManifest implementation
+//---------------------------------------------------------------------------
+String TBinaryPackManifest::ToJSON() const
+{
+    std::unique_ptr<TJSONObject> root(new TJSONObject());
+
+    root->AddPair(L"formatVersion", new TJSONNumber(FormatVersion));
+    root->AddPair(L"ideName", IDEName);
+    root->AddPair(L"bdsVersion", BDSVersion);
+    root->AddPair(L"productVersion", ProductVersion);
+    root->AddPair(L"ideFileVersion", IDEFileVersion);
+    root->AddPair(L"packageSuffix", PackageSuffix);
+    root->AddPair(L"dxBuildNumber", new TJSONNumber((__int64)DxBuildNumber));
+    root->AddPair(L"createdAt", DateToISO8601(CreatedAt, false));
+
+    TJSONArray* files = new TJSONArray();
+    for (const auto& file : Files)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"path", file.Path);
+        obj->AddPair(L"size", new TJSONNumber(file.Size));
+        obj->AddPair(L"writeTime", new TJSONNumber(file.WriteTime));
+        obj->AddPair(L"hash", file.Hash.ToString());
+        files->AddElement(obj);
+    }
+    root->AddPair(L"files", files);
+
+    TJSONArray* changes = new TJSONArray();
+    for (const auto& change : RegistryChanges)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"key", change.Key);
+        obj->AddPair(L"name", change.Name);
+        obj->AddPair(L"kind", ChangeKindToString(change.Kind));
+        obj->AddPair(L"data", change.Data);
+        changes->AddElement(obj);
+    }
+    root->AddPair(L"registryChanges", changes);
+
+    return root->Format(2);
+}
+
+bool TBinaryPackManifest::FromJSON(const String& json, TBinaryPackManifest& manifest)
+{
+    std::unique_ptr<TJSONValue> parsed(TJSONObject::ParseJSONValue(json));
+    TJSONObject* root = dynamic_cast<TJSONObject*>(parsed.get());
+    if (!root || ReadInt64(root, L"formatVersion") != FormatVersion)
+        return false;
+
+    TBinaryPackManifest result;
+    result.IDEName = ReadString(root, L"ideName");
+    result.BDSVersion = ReadString(root, L"bdsVersion");
+    result.ProductVersion = ReadString(root, L"productVersion");
+    result.IDEFileVersion = ReadString(root, L"ideFileVersion");
+    result.PackageSuffix = ReadString(root, L"packageSuffix");
+    result.DxBuildNumber = (unsigned int)ReadInt64(root, L"dxBuildNumber");
+    result.CreatedAt = ISO8601ToDate(ReadString(root, L"createdAt"), false);
+
+    TJSONArray* files = dynamic_cast<TJSONArray*>(root->GetValue(L"files"));
+    if (!files)
+        return false;
+    for (int i = 0; i < files->Count; i++)
+    {
+        TJSONObject* obj = dynamic_cast<TJSONObject*>(files->Items[i]);
+        if (!obj)
+            return false;
+        TBinaryPackFile file;
+        file.Path = ReadString(obj, L"path");
+        file.Size = ReadInt64(obj, L"size");
+        file.WriteTime = ReadInt64(obj, L"writeTime");
+        if (file.Path.IsEmpty() || !THash128::FromString(ReadString(obj, L"hash"), file.Hash))
+            return false;
+        result.Files.push_back(file);
+    }
+
+    if (TJSONArray* changes = dynamic_cast<TJSONArray*>(root->GetValue(L"registryChanges")))
+    {
+        for (int i = 0; i < changes->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(changes->Items[i]);
+            if (!obj)
+                return false;
+            TRegistryChangeRecord change;
+            change.Key = ReadString(obj, L"key");
+            change.Name = ReadString(obj, L"name");
+            change.Kind = ChangeKindFromString(ReadString(obj, L"kind"));
+            change.Data = ReadString(obj, L"data");
+            result.RegistryChanges.push_back(change);
+        }
+    }
+
+    manifest = result;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// TBinaryPack implementation
+//---------------------------------------------------------------------------
+String TBinaryPack::GetIDEFileVersion(const TIDEInfoPtr& ide)
+{
+    Cardinal major = 0, minor = 0, build = 0;
+    if (!GetProductVersion(TPath::Combine(ide->BinDir, L"bds.exe"), major, minor, build))
+        return L"";
+    return String(major) + L"." + String(minor) + L"." + String(build);
+}
+
+void TBinaryPack::Write(const String& packFile,
+                        TBinaryPackManifest& manifest,
+                        const std::vector<String>& files,
+                        const TPathMacros& macros,
+                        const std::atomic<bool>* stopped)
+{
+    manifest.Files.clear();
+    manifest.Files.resize(files.size());
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        manifest.Files[i].Path = macros.Collapse(files[i]);
+        if (!manifest.Files[i].Path.StartsWith(L"$("))
+            throw Exception(L"Not below a known directory: " + files[i]);
+    }
+
+    // Size, write time and hash of every file
+    {
+        TTaskGroup group(stopped);
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            group.RunIO([&, i]() {
+                TBinaryPackFile& file = manifest.Files[i];
+                WIN32_FILE_ATTRIBUTE_DATA data;
+                if (!GetFileAttributesExW(files[i].c_str(), GetFileExInfoStandard, &data) ||
+                    !TContentHash::HashFile(files[i], file.Hash, stopped))
+                    throw Exception(L"Cannot read " + files[i]);
+                file.Size = ((__int64)data.nFileSizeHigh << 32) | data.nFileSizeLow;
+                file.WriteTime = ((__int64)data.ftLastWriteTime.dwHighDateTime << 32) |
+                                 data.ftLastWriteTime.dwLowDateTime;
+            });
+        }
+        if (!group.Wait())
+            throw EAbort(L"Operation cancelled by user");
+    }
+
+    // The manifest goes first, so a reader sees it before any file
+    std::unique_ptr<TZipFile> zip(new TZipFile());
+    zip->Open(packFile, zmWrite);
+    try
+    {
+        zip->Add(TEncoding::UTF8->GetBytes(manifest.ToJSON()), ManifestEntryName, zcDeflate);
+        for (size_t i = 0; i < files.size(); i++)
+        {
+            if (stopped && stopped->load())
+                throw EAbort(L"Operation cancelled by user");
+            zip->Add(files[i], EntryName(manifest.Files[i].Path), zcDeflate);
+        }
+        zip->Close();
+    }
+    catch (...)
+    {
+        zip->Close();
+        DeleteFile(packFile.c_str());
+        throw;
+    }
+}
+
+bool TBinaryPack::ReadManifest(const String& packFile, TBinaryPackManifest& manifest)
+{
+    if (!FileExists(packFile))
+        return false;
+
+    try
+    {
+        std::unique_ptr<TFileStream> stream(new TFileStream(packFile, fmOpenRead | fmShareDenyWrite));
+        std::unique_ptr<TZipFile> zip(new TZipFile());
+        zip->Open(stream.get(), zmRead);
+        int index = zip->IndexOf(ManifestEntryName);
+        if (index < 0)
+            return false;
+
+        TBytes bytes;
+        zip->Read(index, bytes);
+        zip->Close();
+        return TBinaryPackManifest::FromJSON(TEncoding::UTF8->GetString(bytes), manifest);
+    }
+    catch (Exception&)
+    {
+        return false;
+    }
+}
+
+std::vector<String> TBinaryPack::GetMissingMacros(const TBinaryPackManifest& manifest,
+                                                  const TPathMacros& macros)
+{
+    std::vector<String> names;
+    for (const auto& file : manifest.Files)
+        TPathMacros::FindMacros(file.Path, names);
+    for (const auto& change : manifest.RegistryChanges)
+    {
+        TPathMacros::FindMacros(change.Name, names);
+        TPathMacros::FindMacros(change.Data, names);
+    }
+
+    std::vector<String> missing;
+    for (const auto& name : names)
+    {
+        if (macros.GetPath(name).IsEmpty() &&
+            std::find_if(missing.begin(), missing.end(), [&](const String& m) { return SameText(m, name); }) == missing.end())
+            missing.push_back(name);
+    }
+    return missing;
+}
+
+bool TBinaryPack::Extract(const String& packFile,
+                          const TBinaryPackManifest& manifest,
+                          const TPathMacros& macros,
+                          std::vector<String>& written,
+                          const std::atomic<bool>* stopped)
+{
+    size_t count = manifest.Files.size();
+
+    // Entry index of every file, from one pass over the central directory
+    std::vector<int> indexes(count);
+    {
+        std::unique_ptr<TFileStream> stream(new TFileStream(packFile, fmOpenRead | fmShareDenyWrite));
+        std::unique_ptr<TZipFile> zip(new TZipFile());
+        zip->Open(stream.get(), zmRead);
+
+        std::unordered_map<String, int, TStringHash> byName;
+        for (int i = 0; i < zip->FileCount; i++)
+            byName[zip->FileName[i].LowerCase()] = i;
+        zip->Close();
+
+        for (size_t i = 0; i < count; i++)
+        {
+            auto it = byName.find(EntryName(manifest.Files[i].Path).LowerCase());
+            if (it == byName.end())
+                throw Exception(L"Pack is incomplete, missing " + manifest.Files[i].Path);
+            indexes[i] = it->second;
+        }
+    }
+
+    written.resize(count);
+    for (size_t i = 0; i < count; i++)
+        written[i] = macros.Expand(manifest.Files[i].Path);
+
+    size_t batch = std::max(EXTRACT_MIN_BATCH, count / EXTRACT_BATCHES + 1);
+    TTaskGroup group(stopped);
+    for (size_t first = 0; first < count; first += batch)
+    {
+        group.RunIO([&, first]() {
+            size_t last = std::min(count, first + batch);
+            std::unique_ptr<TFileStream> stream(new TFileStream(packFile, fmOpenRead | fmShareDenyWrite));
+            std::unique_ptr<TZipFile> zip(new TZipFile());
+            zip->Open(stream.get(), zmRead);
+
+            String createdDir;
+            for (size_t i = first; i < last && !group.IsCancelled(); i++)
+            {
+                const TBinaryPackFile& file = manifest.Files[i];
+                TBytes bytes;
+                zip->Read(indexes[i], bytes);
+                const void* data = bytes.Length > 0 ? &bytes[0] : nullptr;
+                if (bytes.Length != file.Size || TContentHash::HashContent(data, bytes.Length) != file.Hash)
+                    throw Exception(L"Pack entry is corrupt: " + file.Path);
+
+                String dir = ExtractFileDir(written[i]);
+                if (!SameText(dir, createdDir))
+                {
+                    ForceDirectories(dir);
+                    createdDir = dir;
+                }
+
+                std::unique_ptr<TFileStream> out(new TFileStream(written[i], fmCreate));
+                if (bytes.Length > 0)
+                    out->WriteBuffer(&bytes[0], bytes.Length);
+
+                // Keep the build's time stamps - the compiler compares them
+                FILETIME writeTime;
+                writeTime.dwLowDateTime = (DWORD)(file.WriteTime & 0xFFFFFFFF);
+                writeTime.dwHighDateTime = (DWORD)(file.WriteTime >> 32);
+                SetFileTime((HANDLE)out->Handle, nullptr, nullptr, &writeTime);
+            }
+            zip->Close();
+        });
+    }
+
+    return group.Wait();
+}
+
+} // namespace DxCore
@@ -0,0 +1,130 @@
+//---------------------------------------------------------------------------
+// BinaryPack - Prebuilt install output, exported from one machine and
+// imported on others with the same IDE and DevExpress version
+//
+// A pack is a zip archive. Its first entry, DxBinaryPack.json, describes
+// the IDE it was built for and lists every file with size, write time and
+// content hash, followed by the registry values the install wrote. The
+// files are the ones the install manifest owns (Library\{suffix}, BPL/DCP/
+// HPP files) plus Library\Sources.
+//
+// Paths are stored with macros - $(DX) for the DevExpress directory,
+// $(BPL.Win32), $(DCP.Win64), ... for the IDE output directories - so the
+// pack does not depend on the user profile or drive of the machine that
+// built it. Import resolves them against the local IDE and fails if one is
+// undefined there.
+//---------------------------------------------------------------------------
+#ifndef BinaryPackH
+#define BinaryPackH
+
+#include <System.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <atomic>
+#include <utility>
+#include "IDEDetector.h"
+#include "RegistryChangeSet.h"
+#include "ContentHash.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Path macros of one machine
+//---------------------------------------------------------------------------
+class TPathMacros
+{
+private:
+    std::vector<std::pair<String, String>> FMacros;   // Name, path; longest path first
+
+public:
+    // $(DX) = installFileDir, $(BPL|DCP|HPP.<platform>) = the IDE's output dirs
+    static TPathMacros ForIDE(const TIDEInfoPtr& ide, const String& installFileDir);
+
+    void Add(const String& name, const String& path);   // Ignores empty and known paths
+    String GetPath(const String& name) const;           // Empty if undefined
+
+    // Replaces paths by macros / macros by paths. Collapse only replaces
+    // whole path components.
+    String Collapse(const String& text) const;
+    String Expand(const String& text) const;
+
+    // Macro names ("$(DX)") found in text
+    static void FindMacros(const String& text, std::vector<String>& names);
+};
+
+//---------------------------------------------------------------------------
+// One file of a pack
+//---------------------------------------------------------------------------
+struct TBinaryPackFile
+{
+    String Path;              // With macros
+    __int64 Size;
+    __int64 WriteTime;        // UTC FILETIME ticks, restored on import
+    THash128 Hash;
+
+    TBinaryPackFile() : Size(0), WriteTime(0) {}
+};
+
+//---------------------------------------------------------------------------
+// Pack manifest
+//---------------------------------------------------------------------------
+struct TBinaryPackManifest
+{
+    static const int FormatVersion = 1;
+
+    String IDEName;
+    String BDSVersion;
+    String ProductVersion;
+    String IDEFileVersion;    // bds.exe, "major.minor.build"
+    String PackageSuffix;
+    unsigned int DxBuildNumber;
+    TDateTime CreatedAt;
+
+    std::vector<TBinaryPackFile> Files;
+    std::vector<TRegistryChangeRecord> RegistryChanges;   // Names and data with macros
+
+    TBinaryPackManifest() : DxBuildNumber(0), CreatedAt(0) {}
+
+    String ToJSON() const;
+    static bool FromJSON(const String& json, TBinaryPackManifest& manifest);
+};
+
+//---------------------------------------------------------------------------
+// Binary pack
+//---------------------------------------------------------------------------
+class TBinaryPack
+{
+public:
+    static const wchar_t* const ManifestEntryName;    // "DxBinaryPack.json"
+
+    static String GetIDEFileVersion(const TIDEInfoPtr& ide);
+
+    // Hashes the files in parallel and writes the archive. manifest gets
+    // the file list; every file must be below a macro. Throws on error.
+    static void Write(const String& packFile,
+                      TBinaryPackManifest& manifest,
+                      const std::vector<String>& files,
+                      const TPathMacros& macros,
+                      const std::atomic<bool>* stopped = nullptr);
+
+    // Returns false if packFile is not a binary pack
+    static bool ReadManifest(const String& packFile, TBinaryPackManifest& manifest);
+
+    // Macros the pack uses that are undefined in macros
+    static std::vector<String> GetMissingMacros(const TBinaryPackManifest& manifest,
+                                                const TPathMacros& macros);
+
+    // Unpacks with parallel writes, checking every file against its hash.
+    // written receives the local paths. Throws on error; returns false if
+    // the stop flag was set.
+    static bool Extract(const String& packFile,
+                        const TBinaryPackManifest& manifest,
+                        const TPathMacros& macros,
+                        std::vector<String>& written,
+                        const std::atomic<bool>* stopped = nullptr);
+};
+
+} // namespace DxCore
+
+#endif
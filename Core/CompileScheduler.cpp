@@ -0,0 +1,292 @@
+//---------------------------------------------------------------------------
+// CompileScheduler implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "CompileScheduler.h"
+#include <map>
+
+namespace DxCore
+{
+
+// How long the loop waits when no compiler has anything to report; bounds
+// the reaction time to the stop flag and to slots freed by other IDEs
+static const DWORD POLL_INTERVAL_MS = 50;
+
+//---------------------------------------------------------------------------
+// TCompileScheduler implementation
+//---------------------------------------------------------------------------
+TCompileScheduler::TCompileScheduler(const std::vector<TPlanCompileJob>& jobs,
+                                     TWorkerBudget& budget,
+                                     const std::atomic<bool>* stopped)
+    : FBudget(budget),
+      FStopped(stopped)
+{
+    std::map<int, size_t> byId;
+    FJobs.resize(jobs.size());
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        FJobs[i].Job = &jobs[i];
+        FJobs[i].State = TJobState::Waiting;
+        FJobs[i].PendingDependencies = 0;
+        FJobs[i].ReuseChecked = false;
+        byId[jobs[i].Id] = i;
+    }
+
+    for (size_t i = 0; i < jobs.size(); i++)
+    {
+        for (int id : jobs[i].DependsOn)
+        {
+            // A missing job or the job itself never completes the dependency
+            auto it = byId.find(id);
+            if (it != byId.end() && it->second != i)
+                FJobs[it->second].Dependents.push_back(i);
+            FJobs[i].PendingDependencies++;
+        }
+    }
+}
+
+TCompileScheduler::~TCompileScheduler()
+{
+    TerminateAll();
+}
+
+bool TCompileScheduler::StartJob(size_t index)
+{
+    TJobSlot& slot = FJobs[index];
+    const TPlanCompileJob& job = *slot.Job;
+
+    if (OnStart)
+        OnStart(job);
+
+    slot.State = TJobState::Running;
+    slot.Process.reset(new TCompilerProcess([this, &job](const String& line) {
+        if (OnOutput)
+            OnOutput(job, line);
+    }));
+    slot.Process->SetPriority(FPriority);
+
+    String errorMessage;
+    if (!FileExists(job.Compiler))
+        errorMessage = L"Compiler not found: " + job.Compiler;
+    else
+        slot.Process->Start(job.Compiler, job.CommandLine, job.WorkDir, errorMessage, &FMultiplexer);
+
+    if (!slot.Process->IsRunning())
+    {
+        TCompileResult result;
+        result.Success = false;
+        result.ErrorMessage = errorMessage;
+        CompleteJob(index, result);
+        return false;
+    }
+    return true;
+}
+
+void TCompileScheduler::ReuseJob(size_t index)
+{
+    TJobSlot& slot = FJobs[index];
+    slot.State = TJobState::Succeeded;
+    for (size_t dependent : slot.Dependents)
+        FJobs[dependent].PendingDependencies--;
+}
+
+void TCompileScheduler::CompleteJob(size_t index, const TCompileResult& result)
+{
+    TJobSlot& slot = FJobs[index];
+    slot.Process.reset();
+    slot.State = result.Success ? TJobState::Succeeded : TJobState::Failed;
+    FBudget.Release();
+
+    if (OnFinished)
+        OnFinished(*slot.Job, result);
+
+    if (!result.Success)
+    {
+        SkipDependents(index);
+        return;
+    }
+
+    for (size_t dependent : slot.Dependents)
+        FJobs[dependent].PendingDependencies--;
+}
+
+void TCompileScheduler::SkipDependents(size_t failed)
+{
+    std::vector<size_t> pending(FJobs[failed].Dependents);
+    while (!pending.empty())
+    {
+        size_t index = pending.back();
+        pending.pop_back();
+
+        TJobSlot& slot = FJobs[index];
+        if (slot.State != TJobState::Waiting)
+            continue;
+
+        slot.State = TJobState::Skipped;
+        if (OnSkipped)
+            OnSkipped(*slot.Job, *FJobs[failed].Job);
+        pending.insert(pending.end(), slot.Dependents.begin(), slot.Dependents.end());
+    }
+}
+
+void TCompileScheduler::FailUnsatisfiable()
+{
+    std::map<int, size_t> byId;
+    for (size_t i = 0; i < FJobs.size(); i++)
+        byId[FJobs[i].Job->Id] = i;
+
+    // Name what each job waits for - jobs in the cycle, or missing ids -
+    // before any state changes
+    std::vector<std::pair<size_t, String>> failed;
+    for (size_t i = 0; i < FJobs.size(); i++)
+    {
+        if (FJobs[i].State != TJobState::Waiting)
+            continue;
+
+        String blockers;
+        for (int id : FJobs[i].Job->DependsOn)
+        {
+            auto it = byId.find(id);
+            String name;
+            if (it == byId.end())
+                name = L"job " + String(id) + L" (not in the plan)";
+            else if (FJobs[it->second].State == TJobState::Waiting)
+                name = FJobs[it->second].Job->PackageName;
+            else
+                continue;
+            blockers = blockers + (blockers.IsEmpty() ? L"" : L", ") + name;
+        }
+        failed.push_back(std::make_pair(i, blockers));
+    }
+
+    for (const auto& entry : failed)
+    {
+        TJobSlot& slot = FJobs[entry.first];
+        slot.State = TJobState::Failed;
+        TCompileResult result;
+        result.Success = false;
+        result.ErrorMessage = L"Unsatisfiable dependencies (cycle or missing job): " + entry.second;
+        if (OnFinished)
+            OnFinished(*slot.Job, result);
+    }
+}
+
+void TCompileScheduler::TerminateAll()
+{
+    for (auto& slot : FJobs)
+    {
+        if (slot.State != TJobState::Running)
+            continue;
+        slot.Process.reset();       // Terminates the compiler
+        slot.State = TJobState::Failed;
+        FBudget.Release();
+    }
+}
+
+bool TCompileScheduler::Run()
+{
+    for (;;)
+    {
+        if (IsStopped())
+        {
+            TerminateAll();
+            return false;
+        }
+
+        // Start ready jobs in plan order while slots are free
+        std::vector<size_t> running;
+        for (size_t i = 0; i < FJobs.size(); i++)
+        {
+            if (FJobs[i].State == TJobState::Running)
+                running.push_back(i);
+        }
+        for (size_t i = 0; i < FJobs.size(); i++)
+        {
+            if (FJobs[i].State != TJobState::Waiting || FJobs[i].PendingDependencies > 0)
+                continue;
+            if (!FJobs[i].ReuseChecked)
+            {
+                // Dependents later in plan order become ready in this pass
+                FJobs[i].ReuseChecked = true;
+                if (CanReuse && CanReuse(*FJobs[i].Job))
+                {
+                    ReuseJob(i);
+                    continue;
+                }
+            }
+            if (!FBudget.TryAcquire())
+                break;
+            if (StartJob(i))
+                running.push_back(i);
+        }
+
+        if (running.empty())
+        {
+            // Done - or every ready job waits for a slot held by another IDE.
+            // Waiting jobs with none ready and none running wait forever.
+            bool waiting = false;
+            bool ready = false;
+            for (const auto& slot : FJobs)
+            {
+                if (slot.State != TJobState::Waiting)
+                    continue;
+                waiting = true;
+                if (slot.PendingDependencies == 0)
+                    ready = true;
+            }
+            if (!waiting)
+                return true;
+            if (!ready)
+            {
+                FailUnsatisfiable();
+                return true;
+            }
+            Sleep(POLL_INTERVAL_MS);
+            continue;
+        }
+
+        // Output is passed on from inside Pump
+        FMultiplexer.Pump(POLL_INTERVAL_MS);
+
+        for (size_t index : running)
+        {
+            TCompilerProcess& process = *FJobs[index].Process;
+            if (process.IsDone())
+                CompleteJob(index, process.Finish());
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// TEarlyCutoff implementation
+//---------------------------------------------------------------------------
+TEarlyCutoff::TEarlyCutoff(const std::vector<TPlanCompileJob>& jobs)
+    : FJobs(jobs),
+      FChanged(jobs.size(), true)
+{
+    for (size_t i = 0; i < jobs.size(); i++)
+        FById[jobs[i].Id] = i;
+}
+
+bool TEarlyCutoff::DependenciesUnchanged(const TPlanCompileJob& job) const
+{
+    for (int id : job.DependsOn)
+    {
+        auto dep = FById.find(id);
+        if (dep != FById.end() && FChanged[dep->second])
+            return false;
+    }
+    return true;
+}
+
+void TEarlyCutoff::SetChanged(const TPlanCompileJob& job, bool changed)
+{
+    FChanged[&job - FJobs.data()] = changed;
+}
+
+bool TEarlyCutoff::IsChanged(const TPlanCompileJob& job) const
+{
+    return FChanged[&job - FJobs.data()];
+}
+
+} // namespace DxCore
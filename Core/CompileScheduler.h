@@ -0,0 +1,124 @@
+//---------------------------------------------------------------------------
+// CompileScheduler - Runs the compile jobs of an install plan as a graph
+//
+// A job may start as soon as the jobs it depends on (TPlanCompileJob::
+// DependsOn) have succeeded and the shared TWorkerBudget has a free slot.
+// All running compilers are driven from the calling thread through one
+// TPipeMultiplexer: their output and their exits arrive on a single I/O
+// completion port, so N compilers cost one thread rather than N blocked
+// ones, and output is passed on as soon as it is written.
+//
+// Every loop iteration is a cancellation point: once the stop flag is set,
+// running compilers are terminated and no new ones are started. Jobs that
+// depend on a failed job are skipped.
+//
+// CanReuse is asked once for every job that is ready to start: a job it
+// accepts keeps its previous build and counts as succeeded without a
+// compiler (early cutoff of an incremental install).
+//
+// A dependency that can never be met - a cycle, or an id no job has - is
+// detected once nothing runs and nothing is ready: the jobs still waiting
+// fail with "Unsatisfiable dependencies" through OnFinished.
+//---------------------------------------------------------------------------
+#ifndef CompileSchedulerH
+#define CompileSchedulerH
+
+#include <System.hpp>
+#include <vector>
+#include <map>
+#include <memory>
+#include <atomic>
+#include <functional>
+#include "InstallPlan.h"
+#include "PackageCompiler.h"
+#include "WorkerBudget.h"
+#include "PipeMultiplexer.h"
+
+namespace DxCore
+{
+
+typedef std::function<void(const TPlanCompileJob& job)> TCompileJobEvent;
+typedef std::function<void(const TPlanCompileJob& job, const String& line)> TCompileOutputEvent;
+typedef std::function<void(const TPlanCompileJob& job, const TCompileResult& result)> TCompileFinishedEvent;
+typedef std::function<void(const TPlanCompileJob& job, const TPlanCompileJob& failed)> TCompileSkippedEvent;
+typedef std::function<bool(const TPlanCompileJob& job)> TCompileReuseEvent;
+
+//---------------------------------------------------------------------------
+// Compile scheduler
+//---------------------------------------------------------------------------
+class TCompileScheduler
+{
+private:
+    enum class TJobState { Waiting, Running, Succeeded, Failed, Skipped };
+
+    struct TJobSlot
+    {
+        const TPlanCompileJob* Job;
+        TJobState State;
+        int PendingDependencies;
+        bool ReuseChecked;
+        std::vector<size_t> Dependents;
+        std::unique_ptr<TCompilerProcess> Process;
+    };
+
+    TPipeMultiplexer FMultiplexer;    // Outlives the processes in FJobs
+    std::vector<TJobSlot> FJobs;
+    TWorkerBudget& FBudget;
+    const std::atomic<bool>* FStopped;
+    TProcessPriority FPriority;
+
+    bool IsStopped() const { return FStopped && FStopped->load(); }
+    bool StartJob(size_t index);
+    void ReuseJob(size_t index);
+    void CompleteJob(size_t index, const TCompileResult& result);
+    void SkipDependents(size_t failed);
+    void FailUnsatisfiable();
+    void TerminateAll();
+
+public:
+    // Called on the thread that runs the scheduler
+    TCompileJobEvent OnStart;
+    TCompileOutputEvent OnOutput;
+    TCompileFinishedEvent OnFinished;
+    TCompileSkippedEvent OnSkipped;
+    TCompileReuseEvent CanReuse;
+
+    TCompileScheduler(const std::vector<TPlanCompileJob>& jobs,
+                      TWorkerBudget& budget,
+                      const std::atomic<bool>* stopped = nullptr);
+    ~TCompileScheduler();
+
+    // Priority of the compilers started by Run
+    void SetPriority(const TProcessPriority& value) { FPriority = value; }
+
+    // Returns when every job has finished, failed or was skipped (true), or
+    // when the stop flag was set (false)
+    bool Run();
+};
+
+//---------------------------------------------------------------------------
+// Early cutoff - which Reusable jobs may keep their previous build
+//
+// A job may be kept when none of the jobs it depends on changed the
+// interface fingerprint of its package. A job counts as changed until it
+// was kept, or built with the fingerprint it had before.
+//---------------------------------------------------------------------------
+class TEarlyCutoff
+{
+private:
+    const std::vector<TPlanCompileJob>& FJobs;
+    std::map<int, size_t> FById;
+    std::vector<bool> FChanged;
+
+public:
+    explicit TEarlyCutoff(const std::vector<TPlanCompileJob>& jobs);
+
+    // job is an element of the jobs vector (as the scheduler hands them out)
+    bool DependenciesUnchanged(const TPlanCompileJob& job) const;
+    void SetChanged(const TPlanCompileJob& job, bool changed);
+    bool IsChanged(const TPlanCompileJob& job) const;
+};
+
+} // namespace DxCore
+
+#endif
@@ -3,6 +3,8 @@
 //---------------------------------------------------------------------------
 #pragma hdrstop
 #include "Component.h"
+#include "PackageRules.h"
+#include "ComponentGraph.h"
 #include <IOUtils.hpp>
 
 namespace DxCore
@@ -15,25 +17,29 @@ const String DPK_DESCRIPTION_IDENT = L"{$DESCRIPTION '";
 const String DPK_DESIGNTIME_ONLY = L"{$DESIGNONLY";
 const String DPK_RUNTIME_ONLY = L"{$RUNONLY";
 const String DPK_REQUIRES_IDENT = L"requires";
+const String DPK_CONTAINS_IDENT = L"contains";
 
 //---------------------------------------------------------------------------
 // TPackage implementation
 //---------------------------------------------------------------------------
 TPackage::TPackage(const String& fullFileName)
+    : TPackage(fullFileName, FileExists(fullFileName))
+{
+}
+
+TPackage::TPackage(const String& fullFileName, bool exists)
     : FullFileName(fullFileName),
       Category(TPackageCategory::Normal),
       Usage(TPackageUsage::DesigntimeAndRuntime),
-      Exists(false),
+      Exists(exists),
       Required(true)
 {
     Requires = new TStringList();
+    Contains = new TStringList();
     
     // Extract name without extension
     Name = TPath::GetFileNameWithoutExtension(fullFileName);
     
-    // Check if file exists
-    Exists = FileExists(fullFileName);
-    
     // Detect category from name
     DetectCategory();
     
@@ -42,25 +48,22 @@ TPackage::TPackage(const String& fullFileName)
         ParseDPKFile();
 }
 
+TPackage::TPackage(const String& fullFileName, TStrings* dpk)
+    : TPackage(fullFileName, false)
+{
+    Exists = true;
+    ParseDPK(dpk);
+}
+
 TPackage::~TPackage()
 {
     delete Requires;
+    delete Contains;
 }
 
 void TPackage::DetectCategory()
 {
-    String upperName = Name.UpperCase();
-    
-    if (upperName.Pos(L"IBX") > 0)
-        Category = TPackageCategory::IBX;
-    else if (upperName.Pos(L"TEECHART") > 0)
-        Category = TPackageCategory::TeeChart;
-    else if (upperName.Pos(L"FIREDAC") > 0)
-        Category = TPackageCategory::FireDAC;
-    else if (upperName.Pos(L"BDE") > 0)
-        Category = TPackageCategory::BDE;
-    else
-        Category = TPackageCategory::Normal;
+    Category = TPackageClassifier::GetShared()->GetCategory(Name);
 }
 
 void TPackage::ParseDPKFile()
@@ -70,8 +73,16 @@ void TPackage::ParseDPKFile()
         
     std::unique_ptr<TStringList> dpk(new TStringList());
     dpk->LoadFromFile(FullFileName);
+    ParseDPK(dpk.get());
+}
+
+void TPackage::ParseDPK(TStrings* dpk)
+{
+    Requires->Clear();
+    Contains->Clear();
     
     bool inRequiresPart = false;
+    bool inContainsPart = false;
     
     for (int i = 0; i < dpk->Count; i++)
     {
@@ -90,8 +101,28 @@ void TPackage::ParseDPKFile()
             {
                 String pkg = StringReplace(line, L";", L"", TReplaceFlags());
                 Requires->Add(pkg.Trim());
-                break;  // End of requires section
+                inRequiresPart = false;  // End of requires section
+            }
+        }
+        else if (inContainsPart)
+        {
+            // Parse contains section: "unitName in 'path\unitName.pas',"
+            bool last = line.Pos(L";") > 0;
+            std::unique_ptr<TStringList> items(new TStringList());
+            items->StrictDelimiter = true;
+            items->Delimiter = L',';
+            items->DelimitedText = StringReplace(line, L";", L"", TReplaceFlags());
+            for (int j = 0; j < items->Count; j++)
+            {
+                String unit = items->Strings[j].Trim();
+                int inPos = unit.LowerCase().Pos(L" in ");
+                if (inPos > 0)
+                    unit = unit.SubString(1, inPos - 1).Trim();
+                if (!unit.IsEmpty())
+                    Contains->Add(unit);
             }
+            if (last)
+                break;  // End of contains section
         }
         else
         {
@@ -117,6 +148,10 @@ void TPackage::ParseDPKFile()
             {
                 inRequiresPart = true;
             }
+            else if (line.LowerCase() == DPK_CONTAINS_IDENT)
+            {
+                inContainsPart = true;
+            }
         }
     }
 }
@@ -132,16 +167,6 @@ void TPackage::ReadOptions()
 TComponentProfile::TComponentProfile()
     : IsBase(false)
 {
-    RequiredPackages = new TStringList();
-    OptionalPackages = new TStringList();
-    OutdatedPackages = new TStringList();
-}
-
-TComponentProfile::~TComponentProfile()
-{
-    delete RequiredPackages;
-    delete OptionalPackages;
-    delete OutdatedPackages;
 }
 
 //---------------------------------------------------------------------------
@@ -149,7 +174,8 @@ TComponentProfile::~TComponentProfile()
 //---------------------------------------------------------------------------
 TComponent::TComponent(TComponentProfilePtr profile)
     : Profile(profile),
-      State(TComponentState::Install)
+      State(TComponentState::Install),
+      Index(-1)
 {
 }
 
@@ -183,6 +209,13 @@ bool TComponent::IsMissingDependents() const
 
 void TComponent::SetState(TComponentState value)
 {
+    // Precomputed closures when the list has a graph
+    if (Graph)
+    {
+        Graph->SetState(Index, value);
+        return;
+    }
+    
     if (State == value)
         return;
         
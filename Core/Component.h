@@ -61,10 +61,13 @@ public:
     TPackageCategory Category;
     TPackageUsage Usage;
     TStringList* Requires;    // Required packages
+    TStringList* Contains;    // Contained units (names without extension)
     bool Exists;              // File exists
     bool Required;            // Is required package (not optional)
     
     TPackage(const String& fullFileName);
+    TPackage(const String& fullFileName, bool exists);  // Existence already known (file index)
+    TPackage(const String& fullFileName, TStrings* dpk);  // Already read (source archive)
     ~TPackage();
     
     void ReadOptions();       // Parse .dpk file
@@ -72,33 +75,36 @@ public:
 private:
     void DetectCategory();
     void ParseDPKFile();
+    void ParseDPK(TStrings* dpk);
 };
 
 typedef std::shared_ptr<TPackage> TPackagePtr;
 typedef std::vector<TPackagePtr> TPackageList;
 
 //---------------------------------------------------------------------------
-// Component profile (from INI)
+// Component profile (from INI). Read-only once loaded; package names are
+// interned in the profile manager's string pool.
 //---------------------------------------------------------------------------
 class TComponentProfile
 {
 public:
     String ComponentName;
-    TStringList* RequiredPackages;
-    TStringList* OptionalPackages;
-    TStringList* OutdatedPackages;
+    std::vector<String> RequiredPackages;
+    std::vector<String> OptionalPackages;
+    std::vector<String> OutdatedPackages;
     bool IsBase;              // Base component (always needed)
     
     TComponentProfile();
-    ~TComponentProfile();
 };
 
-typedef std::shared_ptr<TComponentProfile> TComponentProfilePtr;
+typedef std::shared_ptr<const TComponentProfile> TComponentProfilePtr;
 typedef std::vector<TComponentProfilePtr> TComponentProfileList;
 
 //---------------------------------------------------------------------------
 // Component (runtime representation)
 //---------------------------------------------------------------------------
+class TComponentGraph;
+
 class TComponent
 {
 public:
@@ -110,6 +116,11 @@ public:
     std::vector<TComponent*> ParentComponents;  // Components this depends on
     std::vector<TComponent*> SubComponents;     // Components that depend on this
     
+    // Set by TComponentGraph::Attach: position in the list and the graph
+    // SetState goes through
+    int Index;
+    std::shared_ptr<TComponentGraph> Graph;
+    
     TComponent(TComponentProfilePtr profile);
     ~TComponent();
     
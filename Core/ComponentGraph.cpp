@@ -0,0 +1,192 @@
+//---------------------------------------------------------------------------
+// ComponentGraph implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "ComponentGraph.h"
+#include <algorithm>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// TBitSet implementation
+//---------------------------------------------------------------------------
+void TBitSet::Clear()
+{
+    std::fill(FWords.begin(), FWords.end(), 0);
+}
+
+void TBitSet::Union(const TBitSet& other)
+{
+    for (size_t w = 0; w < FWords.size(); w++)
+        FWords[w] |= other.FWords[w];
+}
+
+void TBitSet::Subtract(const TBitSet& other)
+{
+    for (size_t w = 0; w < FWords.size(); w++)
+        FWords[w] &= ~other.FWords[w];
+}
+
+void TBitSet::Intersect(const TBitSet& other)
+{
+    for (size_t w = 0; w < FWords.size(); w++)
+        FWords[w] &= other.FWords[w];
+}
+
+TBitSet TBitSet::SymmetricDifference(const TBitSet& a, const TBitSet& b)
+{
+    TBitSet result(a.FSize);
+    for (size_t w = 0; w < result.FWords.size(); w++)
+        result.FWords[w] = a.FWords[w] ^ b.FWords[w];
+    return result;
+}
+
+int TBitSet::Count() const
+{
+    int count = 0;
+    for (uint64_t word : FWords)
+        count += __builtin_popcountll(word);
+    return count;
+}
+
+bool TBitSet::IsEmpty() const
+{
+    for (uint64_t word : FWords)
+    {
+        if (word != 0)
+            return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// TComponentGraph construction
+//---------------------------------------------------------------------------
+TComponentGraph::TComponentGraph(const TComponentList& list)
+    : FSelectable((int)list.size()),
+      FInstall((int)list.size())
+{
+    FComponents.reserve(list.size());
+    for (size_t i = 0; i < list.size(); i++)
+    {
+        list[i]->Index = (int)i;
+        FComponents.push_back(list[i].get());
+    }
+
+    for (int i = 0; i < GetCount(); i++)
+    {
+        TComponentState state = FComponents[i]->State;
+        if (state == TComponentState::Install || state == TComponentState::NotInstall)
+            FSelectable.Add(i);
+        if (state == TComponentState::Install)
+            FInstall.Add(i);
+    }
+
+    BuildClosures();
+}
+
+void TComponentGraph::Attach(const TComponentList& list)
+{
+    // A component whose parent cannot be installed cannot be installed
+    // either, and neither can the components that depend on it
+    bool changed = true;
+    while (changed)
+    {
+        changed = false;
+        for (const auto& comp : list)
+        {
+            if (comp->State == TComponentState::Install && comp->IsMissingDependents())
+            {
+                comp->State = TComponentState::Missing;
+                changed = true;
+            }
+        }
+    }
+
+    auto graph = std::make_shared<TComponentGraph>(list);
+    for (const auto& comp : list)
+        comp->Graph = graph;
+}
+
+void TComponentGraph::BuildClosures()
+{
+    FAncestors.clear();
+    FDescendants.clear();
+    FAncestors.reserve(FComponents.size());
+    FDescendants.reserve(FComponents.size());
+    for (int i = 0; i < GetCount(); i++)
+    {
+        FAncestors.push_back(Reach(i, true));
+        FDescendants.push_back(Reach(i, false));
+    }
+}
+
+// Components reachable from index through selectable ones only; the old
+// recursive SetState stopped at a component it could not change
+TBitSet TComponentGraph::Reach(int index, bool up) const
+{
+    TBitSet reached(GetCount());
+    std::vector<int> pending(1, index);
+    while (!pending.empty())
+    {
+        const TComponent* comp = FComponents[pending.back()];
+        pending.pop_back();
+
+        const std::vector<TComponent*>& next = up ? comp->ParentComponents : comp->SubComponents;
+        for (const TComponent* other : next)
+        {
+            int j = other->Index;
+            if (j < 0 || j >= GetCount() || FComponents[j] != other)
+                continue;   // Not in this list
+            if (!FSelectable.Contains(j) || reached.Contains(j))
+                continue;
+            reached.Add(j);
+            pending.push_back(j);
+        }
+    }
+    reached.Remove(index);   // Dependency cycles lead back
+    return reached;
+}
+
+//---------------------------------------------------------------------------
+// Selection
+//---------------------------------------------------------------------------
+TBitSet TComponentGraph::SetState(int index, TComponentState value)
+{
+    TBitSet changed(GetCount());
+    TComponent* comp = FComponents[index];
+    if (comp->State == value || !FSelectable.Contains(index))
+        return changed;
+
+    if (value != TComponentState::Install && value != TComponentState::NotInstall)
+    {
+        // No longer selectable: paths through it are cut
+        comp->State = value;
+        changed.Add(index);
+        FSelectable.Remove(index);
+        FInstall.Remove(index);
+        BuildClosures();
+        return changed;
+    }
+
+    TBitSet before = FInstall;
+    if (value == TComponentState::Install)
+    {
+        FInstall.Add(index);
+        FInstall.Union(FAncestors[index]);
+    }
+    else
+    {
+        FInstall.Remove(index);
+        FInstall.Subtract(FDescendants[index]);
+    }
+
+    changed = TBitSet::SymmetricDifference(before, FInstall);
+    changed.ForEach([this](int i) {
+        FComponents[i]->State = FInstall.Contains(i) ? TComponentState::Install : TComponentState::NotInstall;
+    });
+    return changed;
+}
+
+} // namespace DxCore
@@ -0,0 +1,111 @@
+//---------------------------------------------------------------------------
+// ComponentGraph - Component dependencies as precomputed bit sets
+//
+// TInstaller attaches a graph to every component list it builds. For each
+// component it holds the transitive closure of ParentComponents
+// (ancestors) and SubComponents (descendants), limited - like the
+// recursion of TComponent::SetState used to be - to paths through
+// selectable components (Install / NotInstall). Selecting a component is
+// then one OR of its ancestors into the install set, deselecting one
+// AND-NOT of its descendants; the install count is a popcount. SetState
+// returns the components whose state changed, so a UI only has to update
+// those.
+//
+// Bit i is the component with TComponent::Index i, its position in the
+// list.
+//---------------------------------------------------------------------------
+#ifndef ComponentGraphH
+#define ComponentGraphH
+
+#include <System.hpp>
+#include <vector>
+#include <memory>
+#include <cstdint>
+#include "Component.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Fixed-size bit set
+//---------------------------------------------------------------------------
+class TBitSet
+{
+private:
+    std::vector<uint64_t> FWords;
+    int FSize;
+
+public:
+    explicit TBitSet(int size = 0) : FWords((size + 63) / 64, 0), FSize(size) {}
+
+    int GetSize() const { return FSize; }
+    bool Contains(int i) const { return (FWords[i >> 6] >> (i & 63)) & 1; }
+    void Add(int i) { FWords[i >> 6] |= uint64_t(1) << (i & 63); }
+    void Remove(int i) { FWords[i >> 6] &= ~(uint64_t(1) << (i & 63)); }
+    void Clear();
+
+    // Same size required
+    void Union(const TBitSet& other);
+    void Subtract(const TBitSet& other);
+    void Intersect(const TBitSet& other);
+    static TBitSet SymmetricDifference(const TBitSet& a, const TBitSet& b);   // a ^ b
+
+    int Count() const;
+    bool IsEmpty() const;
+
+    template <typename F> void ForEach(F f) const
+    {
+        for (size_t w = 0; w < FWords.size(); w++)
+        {
+            uint64_t bits = FWords[w];
+            while (bits != 0)
+            {
+                f((int)(w * 64) + __builtin_ctzll(bits));
+                bits &= bits - 1;
+            }
+        }
+    }
+
+    bool operator==(const TBitSet& other) const { return FWords == other.FWords; }
+    bool operator!=(const TBitSet& other) const { return FWords != other.FWords; }
+};
+
+//---------------------------------------------------------------------------
+// Component graph
+//---------------------------------------------------------------------------
+class TComponentGraph
+{
+private:
+    std::vector<TComponent*> FComponents;
+    std::vector<TBitSet> FAncestors;      // Excluding the component itself
+    std::vector<TBitSet> FDescendants;
+    TBitSet FSelectable;
+    TBitSet FInstall;
+
+    void BuildClosures();
+    TBitSet Reach(int index, bool up) const;
+
+public:
+    explicit TComponentGraph(const TComponentList& list);
+
+    // Numbers the components, marks those with an unavailable ancestor as
+    // Missing (transitively) and gives every component the shared graph
+    static void Attach(const TComponentList& list);
+
+    int GetCount() const { return (int)FComponents.size(); }
+    TComponent* GetComponent(int index) const { return FComponents[index]; }
+    const TBitSet& GetAncestors(int index) const { return FAncestors[index]; }
+    const TBitSet& GetDescendants(int index) const { return FDescendants[index]; }
+
+    const TBitSet& GetInstallSet() const { return FInstall; }
+    int GetInstallCount() const { return FInstall.Count(); }
+
+    // Install also selects the ancestors, NotInstall deselects the
+    // descendants; other states apply to the component alone. Returns the
+    // components whose state changed.
+    TBitSet SetState(int index, TComponentState value);
+};
+
+} // namespace DxCore
+
+#endif
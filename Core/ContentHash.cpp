@@ -0,0 +1,745 @@
+//---------------------------------------------------------------------------
+// ContentHash implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "ContentHash.h"
+#include "FileOps.h"
+#include "TaskPool.h"
+#include <System.StrUtils.hpp>
+#include <IOUtils.hpp>
+#include <Winapi.Windows.hpp>
+#include <algorithm>
+#include <set>
+#include <cstring>
+
+#if defined(__x86_64__) || defined(__i386__) || defined(_M_X64) || defined(_M_IX86)
+#define DX_HASH_X86 1
+#include <immintrin.h>
+#include <cpuid.h>
+#else
+#define DX_HASH_X86 0
+#endif
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Hash core
+//---------------------------------------------------------------------------
+static const size_t STRIPE_LEN = 64;            // Bytes per stripe
+static const int LANES = 8;                     // 64-bit accumulators
+static const size_t STRIPES_PER_BLOCK = 16;     // Scrambled after each block
+static const int SECRET_WORDS = 24;
+static const int SCRAMBLE_OFFSET = 16;          // Secret words used by Scramble
+static const int TAIL_OFFSET = 7;               // Secret words used by the last stripe
+
+static const uint64_t PRIME32_1 = 0x9E3779B1U;
+static const uint64_t PRIME32_2 = 0x85EBCA77U;
+static const uint64_t PRIME32_3 = 0xC2B2AE3DU;
+static const uint64_t PRIME64_1 = 0x9E3779B185EBCA87ULL;
+static const uint64_t PRIME64_2 = 0xC2B2AE3D27D4EB4FULL;
+static const uint64_t PRIME64_3 = 0x165667B19E3779F9ULL;
+static const uint64_t PRIME64_4 = 0x85EBCA77C2B2AE63ULL;
+static const uint64_t PRIME64_5 = 0x27D4EB2F165667C5ULL;
+
+// Key material, expanded from a fixed seed with splitmix64. Changing the
+// seed changes every hash and invalidates all caches.
+struct THashSecret
+{
+    uint64_t Words[SECRET_WORDS];
+
+    THashSecret()
+    {
+        uint64_t x = 0x44784175746F496EULL;     // "DxAutoIn"
+        for (int i = 0; i < SECRET_WORDS; i++)
+        {
+            x += 0x9E3779B97F4A7C15ULL;
+            uint64_t z = x;
+            z = (z ^ (z >> 30)) * 0xBF58476D1CE4E5B9ULL;
+            z = (z ^ (z >> 27)) * 0x94D049BB133111EBULL;
+            Words[i] = z ^ (z >> 31);
+        }
+    }
+};
+
+static const THashSecret& GetSecret()
+{
+    static const THashSecret secret;
+    return secret;
+}
+
+static inline uint64_t Read64(const uint8_t* p)
+{
+    uint64_t value;
+    memcpy(&value, p, sizeof(value));
+    return value;
+}
+
+static inline uint64_t Mul128Fold64(uint64_t a, uint64_t b)
+{
+#if defined(__SIZEOF_INT128__)
+    unsigned __int128 product = (unsigned __int128)a * b;
+    return (uint64_t)product ^ (uint64_t)(product >> 64);
+#else
+    uint64_t ll = (a & 0xFFFFFFFFULL) * (b & 0xFFFFFFFFULL);
+    uint64_t hl = (a >> 32) * (b & 0xFFFFFFFFULL);
+    uint64_t lh = (a & 0xFFFFFFFFULL) * (b >> 32);
+    uint64_t hh = (a >> 32) * (b >> 32);
+    uint64_t cross = (ll >> 32) + (hl & 0xFFFFFFFFULL) + lh;
+    uint64_t high = (hl >> 32) + (cross >> 32) + hh;
+    uint64_t low = (cross << 32) | (ll & 0xFFFFFFFFULL);
+    return low ^ high;
+#endif
+}
+
+static inline uint64_t Avalanche(uint64_t h)
+{
+    h ^= h >> 37;
+    h *= 0x165667919E3779F9ULL;
+    h ^= h >> 32;
+    return h;
+}
+
+// Per stripe and lane i: acc[i ^ 1] += data, acc[i] += lo32(data ^ key) * hi32(data ^ key).
+// The key slides by one word per stripe.
+typedef void (*TAccumulateProc)(uint64_t* acc, const uint8_t* data, size_t stripes, const uint64_t* secret);
+// Per lane: acc ^= acc >> 47, acc ^= key, acc *= PRIME32_1
+typedef void (*TScrambleProc)(uint64_t* acc, const uint64_t* secret);
+
+static void AccumulateScalar(uint64_t* acc, const uint8_t* data, size_t stripes, const uint64_t* secret)
+{
+    for (size_t s = 0; s < stripes; s++)
+    {
+        const uint8_t* p = data + s * STRIPE_LEN;
+        const uint64_t* key = secret + s;
+        for (int i = 0; i < LANES; i++)
+        {
+            uint64_t d = Read64(p + i * 8);
+            uint64_t dk = d ^ key[i];
+            acc[i ^ 1] += d;
+            acc[i] += (dk & 0xFFFFFFFFULL) * (dk >> 32);
+        }
+    }
+}
+
+static void ScrambleScalar(uint64_t* acc, const uint64_t* secret)
+{
+    for (int i = 0; i < LANES; i++)
+    {
+        uint64_t a = acc[i];
+        a ^= a >> 47;
+        a ^= secret[i];
+        a *= PRIME32_1;
+        acc[i] = a;
+    }
+}
+
+#if DX_HASH_X86
+__attribute__((target("sse2")))
+static void AccumulateSSE2(uint64_t* acc, const uint8_t* data, size_t stripes, const uint64_t* secret)
+{
+    __m128i a[4];
+    for (int i = 0; i < 4; i++)
+        a[i] = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+
+    for (size_t s = 0; s < stripes; s++)
+    {
+        const __m128i* p = reinterpret_cast<const __m128i*>(data + s * STRIPE_LEN);
+        const __m128i* key = reinterpret_cast<const __m128i*>(secret + s);
+        for (int i = 0; i < 4; i++)
+        {
+            __m128i d = _mm_loadu_si128(p + i);
+            __m128i dk = _mm_xor_si128(d, _mm_loadu_si128(key + i));
+            __m128i product = _mm_mul_epu32(dk, _mm_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m128i swapped = _mm_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm_add_epi64(a[i], _mm_add_epi64(product, swapped));
+        }
+    }
+
+    for (int i = 0; i < 4; i++)
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, a[i]);
+}
+
+__attribute__((target("sse2")))
+static void ScrambleSSE2(uint64_t* acc, const uint64_t* secret)
+{
+    const __m128i prime = _mm_set1_epi32((int)PRIME32_1);
+    for (int i = 0; i < 4; i++)
+    {
+        __m128i a = _mm_loadu_si128(reinterpret_cast<const __m128i*>(acc) + i);
+        a = _mm_xor_si128(a, _mm_srli_epi64(a, 47));
+        a = _mm_xor_si128(a, _mm_loadu_si128(reinterpret_cast<const __m128i*>(secret) + i));
+        __m128i low = _mm_mul_epu32(a, prime);
+        __m128i high = _mm_mul_epu32(_mm_srli_epi64(a, 32), prime);
+        a = _mm_add_epi64(low, _mm_slli_epi64(high, 32));
+        _mm_storeu_si128(reinterpret_cast<__m128i*>(acc) + i, a);
+    }
+}
+
+__attribute__((target("avx2")))
+static void AccumulateAVX2(uint64_t* acc, const uint8_t* data, size_t stripes, const uint64_t* secret)
+{
+    __m256i a[2];
+    for (int i = 0; i < 2; i++)
+        a[i] = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+
+    for (size_t s = 0; s < stripes; s++)
+    {
+        const __m256i* p = reinterpret_cast<const __m256i*>(data + s * STRIPE_LEN);
+        const __m256i* key = reinterpret_cast<const __m256i*>(secret + s);
+        for (int i = 0; i < 2; i++)
+        {
+            __m256i d = _mm256_loadu_si256(p + i);
+            __m256i dk = _mm256_xor_si256(d, _mm256_loadu_si256(key + i));
+            __m256i product = _mm256_mul_epu32(dk, _mm256_shuffle_epi32(dk, _MM_SHUFFLE(0, 3, 0, 1)));
+            __m256i swapped = _mm256_shuffle_epi32(d, _MM_SHUFFLE(1, 0, 3, 2));
+            a[i] = _mm256_add_epi64(a[i], _mm256_add_epi64(product, swapped));
+        }
+    }
+
+    for (int i = 0; i < 2; i++)
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, a[i]);
+}
+
+__attribute__((target("avx2")))
+static void ScrambleAVX2(uint64_t* acc, const uint64_t* secret)
+{
+    const __m256i prime = _mm256_set1_epi32((int)PRIME32_1);
+    for (int i = 0; i < 2; i++)
+    {
+        __m256i a = _mm256_loadu_si256(reinterpret_cast<const __m256i*>(acc) + i);
+        a = _mm256_xor_si256(a, _mm256_srli_epi64(a, 47));
+        a = _mm256_xor_si256(a, _mm256_loadu_si256(reinterpret_cast<const __m256i*>(secret) + i));
+        __m256i low = _mm256_mul_epu32(a, prime);
+        __m256i high = _mm256_mul_epu32(_mm256_srli_epi64(a, 32), prime);
+        a = _mm256_add_epi64(low, _mm256_slli_epi64(high, 32));
+        _mm256_storeu_si256(reinterpret_cast<__m256i*>(acc) + i, a);
+    }
+}
+
+__attribute__((target("avx512f")))
+static void AccumulateAVX512(uint64_t* acc, const uint8_t* data, size_t stripes, const uint64_t* secret)
+{
+    __m512i a = _mm512_loadu_si512(acc);
+
+    for (size_t s = 0; s < stripes; s++)
+    {
+        __m512i d = _mm512_loadu_si512(data + s * STRIPE_LEN);
+        __m512i dk = _mm512_xor_si512(d, _mm512_loadu_si512(secret + s));
+        __m512i product = _mm512_mul_epu32(dk, _mm512_shuffle_epi32(dk, (_MM_PERM_ENUM)_MM_SHUFFLE(0, 3, 0, 1)));
+        __m512i swapped = _mm512_shuffle_epi32(d, (_MM_PERM_ENUM)_MM_SHUFFLE(1, 0, 3, 2));
+        a = _mm512_add_epi64(a, _mm512_add_epi64(product, swapped));
+    }
+
+    _mm512_storeu_si512(acc, a);
+}
+
+__attribute__((target("avx512f")))
+static void ScrambleAVX512(uint64_t* acc, const uint64_t* secret)
+{
+    const __m512i prime = _mm512_set1_epi32((int)PRIME32_1);
+    __m512i a = _mm512_loadu_si512(acc);
+    a = _mm512_xor_si512(a, _mm512_srli_epi64(a, 47));
+    a = _mm512_xor_si512(a, _mm512_loadu_si512(secret));
+    __m512i low = _mm512_mul_epu32(a, prime);
+    __m512i high = _mm512_mul_epu32(_mm512_srli_epi64(a, 32), prime);
+    a = _mm512_add_epi64(low, _mm512_slli_epi64(high, 32));
+    _mm512_storeu_si512(acc, a);
+}
+
+static uint64_t ReadXCR0()
+{
+    uint32_t low, high;
+    __asm__ volatile("xgetbv" : "=a"(low), "=d"(high) : "c"(0));
+    return ((uint64_t)high << 32) | low;
+}
+#endif
+
+//---------------------------------------------------------------------------
+// Runtime dispatch
+//---------------------------------------------------------------------------
+struct THashKernels
+{
+    TAccumulateProc Accumulate;
+    TScrambleProc Scramble;
+};
+
+static bool DetectIsa(THashIsa isa)
+{
+    if (isa == THashIsa::Scalar)
+        return true;
+
+#if DX_HASH_X86
+    unsigned int eax, ebx, ecx, edx;
+    if (!__get_cpuid(1, &eax, &ebx, &ecx, &edx))
+        return false;
+
+    bool sse2 = (edx & (1u << 26)) != 0;
+    if (isa == THashIsa::SSE2)
+        return sse2;
+
+    // Wider registers also need the OS to save them on context switches
+    bool osxsave = (ecx & (1u << 27)) != 0;
+    uint64_t xcr0 = osxsave ? ReadXCR0() : 0;
+    if (__get_cpuid_max(0, nullptr) < 7)
+        return false;
+
+    __cpuid_count(7, 0, eax, ebx, ecx, edx);
+    if (isa == THashIsa::AVX2)
+        return (ebx & (1u << 5)) != 0 && (xcr0 & 0x06) == 0x06;
+    if (isa == THashIsa::AVX512)
+        return (ebx & (1u << 16)) != 0 && (xcr0 & 0xE6) == 0xE6;
+#endif
+
+    return false;
+}
+
+static bool IsIsaAvailable(THashIsa isa)
+{
+    // Detected once; the CPU does not change
+    static const bool available[] = {
+        DetectIsa(THashIsa::Scalar),
+        DetectIsa(THashIsa::SSE2),
+        DetectIsa(THashIsa::AVX2),
+        DetectIsa(THashIsa::AVX512)
+    };
+    return available[(int)isa];
+}
+
+static THashIsa DetectBestIsa()
+{
+    const THashIsa order[] = { THashIsa::AVX512, THashIsa::AVX2, THashIsa::SSE2 };
+    for (THashIsa isa : order)
+    {
+        if (IsIsaAvailable(isa))
+            return isa;
+    }
+    return THashIsa::Scalar;
+}
+
+static std::atomic<int> g_Isa{-1};
+
+static THashKernels GetKernels()
+{
+    THashKernels kernels = { AccumulateScalar, ScrambleScalar };
+#if DX_HASH_X86
+    switch (TContentHash::GetIsa())
+    {
+        case THashIsa::SSE2: kernels = { AccumulateSSE2, ScrambleSSE2 }; break;
+        case THashIsa::AVX2: kernels = { AccumulateAVX2, ScrambleAVX2 }; break;
+        case THashIsa::AVX512: kernels = { AccumulateAVX512, ScrambleAVX512 }; break;
+        default: break;
+    }
+#endif
+    return kernels;
+}
+
+//---------------------------------------------------------------------------
+// THash128 implementation
+//---------------------------------------------------------------------------
+String THash128::ToString() const
+{
+    return IntToHex((__int64)High, 16) + IntToHex((__int64)Low, 16);
+}
+
+bool THash128::FromString(const String& text, THash128& hash)
+{
+    if (text.Length() != 32)
+        return false;
+
+    uint64_t words[2] = { 0, 0 };
+    for (int i = 1; i <= 32; i++)
+    {
+        wchar_t c = text[i];
+        uint64_t digit;
+        if (c >= L'0' && c <= L'9')
+            digit = c - L'0';
+        else if (c >= L'A' && c <= L'F')
+            digit = c - L'A' + 10;
+        else if (c >= L'a' && c <= L'f')
+            digit = c - L'a' + 10;
+        else
+            return false;
+
+        uint64_t& word = words[i <= 16 ? 0 : 1];
+        word = (word << 4) | digit;
+    }
+
+    hash.High = words[0];
+    hash.Low = words[1];
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// TContentHash implementation
+//---------------------------------------------------------------------------
+THashIsa TContentHash::GetBestIsa()
+{
+    return DetectBestIsa();
+}
+
+bool TContentHash::IsIsaSupported(THashIsa isa)
+{
+    return IsIsaAvailable(isa);
+}
+
+THashIsa TContentHash::GetIsa()
+{
+    int isa = g_Isa.load();
+    if (isa < 0)
+    {
+        isa = (int)DetectBestIsa();
+        g_Isa.store(isa);
+    }
+    return (THashIsa)isa;
+}
+
+bool TContentHash::SetIsa(THashIsa isa)
+{
+    if (!IsIsaAvailable(isa))
+        return false;
+    g_Isa.store((int)isa);
+    return true;
+}
+
+String TContentHash::GetIsaName(THashIsa isa)
+{
+    switch (isa)
+    {
+        case THashIsa::SSE2: return L"SSE2";
+        case THashIsa::AVX2: return L"AVX2";
+        case THashIsa::AVX512: return L"AVX-512";
+        default: return L"Scalar";
+    }
+}
+
+THash128 TContentHash::HashBuffer(const void* data, size_t size)
+{
+    const THashKernels kernels = GetKernels();
+    const uint64_t* secret = GetSecret().Words;
+    const uint8_t* p = static_cast<const uint8_t*>(data);
+
+    uint64_t acc[LANES] = {
+        PRIME32_3, PRIME64_1, PRIME64_2, PRIME64_3,
+        PRIME64_4, PRIME32_2, PRIME64_5, PRIME32_1
+    };
+
+    const size_t blockLen = STRIPES_PER_BLOCK * STRIPE_LEN;
+    size_t blocks = size / blockLen;
+    for (size_t b = 0; b < blocks; b++)
+    {
+        kernels.Accumulate(acc, p + b * blockLen, STRIPES_PER_BLOCK, secret);
+        kernels.Scramble(acc, secret + SCRAMBLE_OFFSET);
+    }
+
+    const uint8_t* rest = p + blocks * blockLen;
+    size_t restLen = size - blocks * blockLen;
+    size_t stripes = restLen / STRIPE_LEN;
+    kernels.Accumulate(acc, rest, stripes, secret);
+
+    // Last partial stripe, zero padded; the length is mixed in below
+    size_t tailLen = restLen - stripes * STRIPE_LEN;
+    if (tailLen > 0)
+    {
+        uint8_t tail[STRIPE_LEN] = { 0 };
+        memcpy(tail, rest + stripes * STRIPE_LEN, tailLen);
+        AccumulateScalar(acc, tail, 1, secret + TAIL_OFFSET);
+    }
+
+    uint64_t low = (uint64_t)size * PRIME64_1;
+    uint64_t high = ~((uint64_t)size * PRIME64_2);
+    for (int i = 0; i < LANES / 2; i++)
+    {
+        low += Mul128Fold64(acc[2 * i] ^ secret[2 * i], acc[2 * i + 1] ^ secret[2 * i + 1]);
+        high += Mul128Fold64(acc[2 * i] ^ secret[8 + 2 * i + 1], acc[2 * i + 1] ^ secret[8 + 2 * i]);
+    }
+
+    return THash128(Avalanche(low), Avalanche(high));
+}
+
+THash128 TContentHash::CombineChunks(const std::vector<THash128>& parts, __int64 total)
+{
+    // Hash of the chunk hashes and the total size
+    std::vector<uint64_t> words;
+    for (const auto& part : parts)
+    {
+        words.push_back(part.Low);
+        words.push_back(part.High);
+    }
+    words.push_back((uint64_t)total);
+    return HashBuffer(words.data(), words.size() * sizeof(uint64_t));
+}
+
+THash128 TContentHash::HashContent(const void* data, size_t size)
+{
+    if ((__int64)size <= ChunkSize)
+        return HashBuffer(data, size);
+
+    std::vector<THash128> parts;
+    const uint8_t* bytes = static_cast<const uint8_t*>(data);
+    for (size_t offset = 0; offset < size; offset += (size_t)ChunkSize)
+        parts.push_back(HashBuffer(bytes + offset, std::min<size_t>((size_t)ChunkSize, size - offset)));
+    return CombineChunks(parts, (__int64)size);
+}
+
+bool TContentHash::HashFile(const String& fileName, THash128& hash, const std::atomic<bool>* stopped)
+{
+    HANDLE file = CreateFileW(fileName.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return false;
+
+    LARGE_INTEGER fileSize;
+    if (!GetFileSizeEx(file, &fileSize))
+    {
+        CloseHandle(file);
+        return false;
+    }
+
+    __int64 total = fileSize.QuadPart;
+    if (total == 0)
+    {
+        CloseHandle(file);
+        hash = HashBuffer(nullptr, 0);
+        return true;
+    }
+
+    // The mapping keeps the file open
+    HANDLE mapping = CreateFileMappingW(file, nullptr, PAGE_READONLY, 0, 0, nullptr);
+    CloseHandle(file);
+    if (!mapping)
+        return false;
+
+    auto hashChunk = [mapping, total](__int64 offset, THash128& out) -> bool {
+        size_t length = (size_t)std::min<__int64>(ChunkSize, total - offset);
+        void* view = MapViewOfFile(mapping, FILE_MAP_READ,
+                                   (DWORD)(offset >> 32), (DWORD)(offset & 0xFFFFFFFF), length);
+        if (!view)
+            return false;
+        out = HashBuffer(view, length);
+        UnmapViewOfFile(view);
+        return true;
+    };
+
+    bool ok;
+    if (total <= ChunkSize)
+    {
+        ok = hashChunk(0, hash);
+    }
+    else if (TTaskPool::Shared().GetCurrentWorker() >= 0)
+    {
+        // A nested group would only have this worker wait for others
+        size_t count = (size_t)((total + ChunkSize - 1) / ChunkSize);
+        std::vector<THash128> parts(count);
+        ok = true;
+        for (size_t i = 0; ok && i < count; i++)
+        {
+            if (stopped && stopped->load())
+                ok = false;
+            else
+                ok = hashChunk((__int64)i * ChunkSize, parts[i]);
+        }
+        if (ok)
+            hash = CombineChunks(parts, total);
+    }
+    else
+    {
+        size_t count = (size_t)((total + ChunkSize - 1) / ChunkSize);
+        std::vector<THash128> parts(count);
+        std::atomic<bool> failed{false};
+
+        TTaskGroup group(stopped);
+        for (size_t i = 0; i < count; i++)
+        {
+            group.Run([&hashChunk, &parts, &failed, i]() {
+                if (!hashChunk((__int64)i * ChunkSize, parts[i]))
+                    failed.store(true);
+            });
+        }
+
+        ok = group.Wait() && !failed.load();
+        if (ok)
+            hash = CombineChunks(parts, total);
+    }
+
+    CloseHandle(mapping);
+    return ok;
+}
+
+bool TContentHash::HashTree(const String& root,
+                            std::vector<TFileHash>& result,
+                            THashCache* cache,
+                            const std::vector<String>& extensions,
+                            const std::atomic<bool>* stopped)
+{
+    result.clear();
+
+    String base = ExcludeTrailingPathDelimiter(root);
+    std::set<String> extensionSet;
+    for (const auto& ext : extensions)
+        extensionSet.insert(ext.LowerCase());
+
+    std::mutex lock;
+    std::vector<TWalkEntry> files;
+    bool completed = TFileOps::Walk(base, true, [&](const TWalkEntry& entry) {
+        if (!extensionSet.empty() && extensionSet.count(ExtractFileExt(entry.Name).LowerCase()) == 0)
+            return;
+        std::lock_guard<std::mutex> guard(lock);
+        files.push_back(entry);
+    }, stopped);
+
+    if (!completed)
+        return false;
+
+    result.resize(files.size());
+    std::atomic<bool> failed{false};
+
+    TTaskGroup group(stopped);
+    for (size_t i = 0; i < files.size(); i++)
+    {
+        group.RunIO([&, i]() {
+            const TWalkEntry& entry = files[i];
+            TFileHash& out = result[i];
+            out.Path = entry.FullPath.SubString(base.Length() + 2, entry.FullPath.Length() - base.Length() - 1);
+            out.Size = entry.Size;
+
+            if (cache && cache->Lookup(entry.FullPath, entry.Size, entry.WriteTime, out.Hash))
+            {
+                out.Cached = true;
+                return;
+            }
+
+            if (!HashFile(entry.FullPath, out.Hash, stopped))
+            {
+                failed.store(true);
+                return;
+            }
+
+            if (cache)
+                cache->Store(entry.FullPath, entry.Size, entry.WriteTime, out.Hash);
+        });
+    }
+
+    if (!group.Wait())
+        return false;
+
+    std::sort(result.begin(), result.end(), [](const TFileHash& a, const TFileHash& b) {
+        return CompareText(a.Path, b.Path) < 0;
+    });
+
+    return !failed.load();
+}
+
+//---------------------------------------------------------------------------
+// THashCache implementation
+//---------------------------------------------------------------------------
+THashCache::THashCache()
+    : FModified(false)
+{
+}
+
+bool THashCache::Lookup(const String& fileName, __int64 size, __int64 writeTime, THash128& hash) const
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    auto it = FEntries.find(fileName.LowerCase());
+    if (it == FEntries.end() || it->second.Size != size || it->second.WriteTime != writeTime)
+        return false;
+
+    hash = it->second.Hash;
+    return true;
+}
+
+void THashCache::Store(const String& fileName, __int64 size, __int64 writeTime, const THash128& hash)
+{
+    TEntry entry;
+    entry.Size = size;
+    entry.WriteTime = writeTime;
+    entry.Hash = hash;
+
+    std::lock_guard<std::mutex> lock(FLock);
+    FEntries[fileName.LowerCase()] = entry;
+    FModified = true;
+}
+
+int THashCache::GetCount() const
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    return (int)FEntries.size();
+}
+
+bool THashCache::IsModified() const
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    return FModified;
+}
+
+void THashCache::Clear()
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    FEntries.clear();
+    FModified = false;
+}
+
+bool THashCache::LoadFromFile(const String& fileName)
+{
+    Clear();
+    if (!FileExists(fileName))
+        return false;
+
+    std::unique_ptr<TStringList> lines(new TStringList());
+    try
+    {
+        lines->LoadFromFile(fileName, TEncoding::UTF8);
+    }
+    catch (Exception&)
+    {
+        return false;
+    }
+
+    // Header: "DxHashCache<TAB>version"
+    if (lines->Count == 0 || lines->Strings[0] != L"DxHashCache\t" + String(FormatVersion))
+        return false;
+
+    std::lock_guard<std::mutex> lock(FLock);
+    for (int i = 1; i < lines->Count; i++)
+    {
+        // hash, size, write time, path
+        TStringDynArray fields = SplitString(lines->Strings[i], L"\t");
+        if (fields.Length != 4)
+            continue;
+
+        TEntry entry;
+        if (!THash128::FromString(fields[0], entry.Hash))
+            continue;
+        entry.Size = StrToInt64Def(fields[1], -1);
+        entry.WriteTime = StrToInt64Def(fields[2], -1);
+        if (entry.Size < 0 || entry.WriteTime < 0)
+            continue;
+
+        FEntries[fields[3].LowerCase()] = entry;
+    }
+
+    FModified = false;
+    return true;
+}
+
+void THashCache::SaveToFile(const String& fileName)
+{
+    std::unique_ptr<TStringList> lines(new TStringList());
+    lines->Add(L"DxHashCache\t" + String(FormatVersion));
+
+    {
+        std::lock_guard<std::mutex> lock(FLock);
+        for (const auto& it : FEntries)
+        {
+            lines->Add(it.second.Hash.ToString() + L"\t" + IntToStr(it.second.Size) + L"\t" +
+                       IntToStr(it.second.WriteTime) + L"\t" + it.first);
+        }
+        FModified = false;
+    }
+
+    ForceDirectories(ExtractFileDir(fileName));
+    lines->SaveToFile(fileName, TEncoding::UTF8);
+}
+
+} // namespace DxCore
@@ -0,0 +1,156 @@
+//---------------------------------------------------------------------------
+// ContentHash - Fast 128-bit content hashing for build-cache keys
+//
+// The hash is non-cryptographic: an XXH3-style accumulator with eight
+// 64-bit lanes over 64-byte stripes. The inner loop has scalar, SSE2,
+// AVX2 and AVX-512 implementations that produce identical results; the
+// best one the CPU supports is picked at startup.
+//
+// Files are read through memory mapping. Files larger than one chunk are
+// hashed chunk by chunk on the shared TTaskPool and the chunk hashes are
+// hashed again, so the result does not depend on the number of threads.
+// Called from a pool task (HashTree, binary packs), HashFile hashes the
+// chunks itself: the files already run in parallel there.
+//
+// THashCache remembers (path, size, last write time) -> hash between runs,
+// so unchanged files are never read again.
+//---------------------------------------------------------------------------
+#ifndef ContentHashH
+#define ContentHashH
+
+#include <System.hpp>
+#include <System.Classes.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <unordered_map>
+#include <mutex>
+#include <atomic>
+#include <cstdint>
+#include "StringHash.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// 128-bit hash value
+//---------------------------------------------------------------------------
+struct THash128
+{
+    uint64_t Low;
+    uint64_t High;
+
+    THash128() : Low(0), High(0) {}
+    THash128(uint64_t low, uint64_t high) : Low(low), High(high) {}
+
+    bool operator==(const THash128& other) const { return Low == other.Low && High == other.High; }
+    bool operator!=(const THash128& other) const { return !(*this == other); }
+    bool operator<(const THash128& other) const
+    {
+        return High != other.High ? High < other.High : Low < other.Low;
+    }
+
+    String ToString() const;                        // 32 hex digits
+    static bool FromString(const String& text, THash128& hash);
+};
+
+//---------------------------------------------------------------------------
+// Instruction set used for the inner loop
+//---------------------------------------------------------------------------
+enum class THashIsa
+{
+    Scalar,
+    SSE2,
+    AVX2,
+    AVX512
+};
+
+//---------------------------------------------------------------------------
+// One hashed file
+//---------------------------------------------------------------------------
+struct TFileHash
+{
+    String Path;              // Relative to the hashed root
+    __int64 Size;
+    THash128 Hash;
+    bool Cached;              // Taken from THashCache without reading the file
+
+    TFileHash() : Size(0), Cached(false) {}
+};
+
+class THashCache;
+
+//---------------------------------------------------------------------------
+// Content hash
+//---------------------------------------------------------------------------
+class TContentHash
+{
+private:
+    static THash128 CombineChunks(const std::vector<THash128>& parts, __int64 total);
+
+public:
+    // Files up to this size are hashed in one piece (multiple of 64 KB,
+    // the mapping granularity)
+    static const __int64 ChunkSize = 4 * 1024 * 1024;
+
+    static THash128 HashBuffer(const void* data, size_t size);
+    // Same value HashFile gives for a file with this content
+    static THash128 HashContent(const void* data, size_t size);
+
+    // Returns false if the file cannot be read
+    static bool HashFile(const String& fileName, THash128& hash,
+                         const std::atomic<bool>* stopped = nullptr);
+
+    // Hashes every file below root (relative paths, sorted). Files whose
+    // size and write time match the cache are not read. extensions (like
+    // ".pas") limits the files; empty means all.
+    static bool HashTree(const String& root,
+                         std::vector<TFileHash>& result,
+                         THashCache* cache = nullptr,
+                         const std::vector<String>& extensions = std::vector<String>(),
+                         const std::atomic<bool>* stopped = nullptr);
+
+    // Runtime dispatch. SetIsa fails for instruction sets the CPU lacks.
+    static THashIsa GetBestIsa();
+    static bool IsIsaSupported(THashIsa isa);
+    static THashIsa GetIsa();
+    static bool SetIsa(THashIsa isa);
+    static String GetIsaName(THashIsa isa);
+};
+
+//---------------------------------------------------------------------------
+// Persistent (path, size, write time) -> hash cache
+//---------------------------------------------------------------------------
+class THashCache
+{
+private:
+    struct TEntry
+    {
+        __int64 Size;
+        __int64 WriteTime;
+        THash128 Hash;
+    };
+
+    static const int FormatVersion = 1;
+
+    std::unordered_map<String, TEntry, TStringHash> FEntries;   // Key = lower-case full path
+    mutable std::mutex FLock;
+    bool FModified;
+
+public:
+    THashCache();
+
+    bool Lookup(const String& fileName, __int64 size, __int64 writeTime, THash128& hash) const;
+    void Store(const String& fileName, __int64 size, __int64 writeTime, const THash128& hash);
+
+    int GetCount() const;
+    bool IsModified() const;
+    void Clear();
+
+    // A missing or outdated file leaves the cache empty
+    bool LoadFromFile(const String& fileName);
+    void SaveToFile(const String& fileName);
+};
+
+} // namespace DxCore
+
+#endif
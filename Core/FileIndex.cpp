@@ -0,0 +1,276 @@
+//---------------------------------------------------------------------------
+// FileIndex implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "FileIndex.h"
+#include "FileOps.h"
+#include <IOUtils.hpp>
+#include <mutex>
+#include <map>
+#include <algorithm>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// TFileIndex implementation
+//---------------------------------------------------------------------------
+TFileIndex::TFileIndex()
+{
+}
+
+TFileIndex::~TFileIndex()
+{
+}
+
+void TFileIndex::Clear()
+{
+    FRoot = L"";
+    FEntries.clear();
+    FChildren.clear();
+    FByName.clear();
+}
+
+void TFileIndex::AddEntry(const String& key, const TFileIndexEntry& entry)
+{
+    auto inserted = FEntries.insert(std::make_pair(key, entry));
+    const TFileIndexEntry* stored = &inserted.first->second;
+
+    // Parent directory key is everything before the last delimiter
+    int sep = key.LastDelimiter(L"\\");
+    String parentKey = sep > 0 ? key.SubString(1, sep - 1) : String();
+    FChildren[parentKey].push_back(stored);
+
+    if (!entry.IsDirectory)
+        FByName[entry.Name.LowerCase()].push_back(stored);
+}
+
+void TFileIndex::Build(const String& root)
+{
+    Clear();
+
+    if (root.IsEmpty())
+        return;
+
+    FRoot = ExcludeTrailingPathDelimiter(root);
+    if (!System::Sysutils::DirectoryExists(FRoot))
+        return;
+
+    // Root entry, so DirectoryExists(root) is answered too
+    TFileIndexEntry rootEntry;
+    rootEntry.FullPath = FRoot;
+    rootEntry.Name = ExtractFileName(FRoot);
+    rootEntry.IsDirectory = true;
+    FEntries.insert(std::make_pair(String(), rootEntry));
+
+    // The whole tree is walked on the shared task pool, one task per
+    // directory; entries are sorted afterwards so the index (and plans
+    // built from it) do not depend on thread timing
+    std::mutex lock;
+    std::vector<std::pair<String, TFileIndexEntry>> found;
+    int rootLen = FRoot.Length();
+
+    TFileOps::Walk(FRoot, true, [&](const TWalkEntry& walked) {
+        TFileIndexEntry entry;
+        entry.FullPath = walked.FullPath;
+        entry.Name = walked.Name;
+        entry.IsDirectory = walked.IsDirectory;
+        entry.Size = walked.Size;
+        entry.TimeStamp = walked.TimeStamp;
+
+        String key = walked.FullPath.SubString(rootLen + 2, walked.FullPath.Length() - rootLen - 1).LowerCase();
+
+        std::lock_guard<std::mutex> guard(lock);
+        found.push_back(std::make_pair(key, entry));
+    }, nullptr, true);
+
+    std::sort(found.begin(), found.end(),
+        [](const std::pair<String, TFileIndexEntry>& a, const std::pair<String, TFileIndexEntry>& b) {
+            return a.first < b.first;
+        });
+
+    for (const auto& entry : found)
+        AddEntry(entry.first, entry.second);
+}
+
+void TFileIndex::Build(const String& root, const std::vector<TFileIndexEntry>& listing)
+{
+    Clear();
+
+    if (root.IsEmpty())
+        return;
+
+    FRoot = ExcludeTrailingPathDelimiter(root);
+
+    TFileIndexEntry rootEntry;
+    rootEntry.FullPath = FRoot;
+    rootEntry.Name = ExtractFileName(FRoot);
+    rootEntry.IsDirectory = true;
+    FEntries.insert(std::make_pair(String(), rootEntry));
+
+    // Sorted by key, as after a scan; every parent directory gets an entry
+    std::map<String, TFileIndexEntry> found;
+    int rootLen = FRoot.Length();
+    for (const auto& entry : listing)
+    {
+        String key = MakeKey(entry.FullPath);
+        if (key == L"?" || key.IsEmpty())
+            continue;
+        found[key] = entry;
+
+        String relative = entry.FullPath.SubString(rootLen + 2, entry.FullPath.Length() - rootLen - 1);
+        for (int sep = key.LastDelimiter(L"\\"); sep > 0; sep = key.LastDelimiter(L"\\"))
+        {
+            key = key.SubString(1, sep - 1);
+            if (found.count(key) > 0)
+                break;
+
+            TFileIndexEntry dir;
+            dir.FullPath = FRoot + L"\\" + relative.SubString(1, sep - 1);
+            dir.Name = ExtractFileName(dir.FullPath);
+            dir.IsDirectory = true;
+            found[key] = dir;
+        }
+    }
+
+    for (const auto& entry : found)
+        AddEntry(entry.first, entry.second);
+}
+
+int TFileIndex::GetFileCount() const
+{
+    int count = 0;
+    for (const auto& it : FEntries)
+    {
+        if (!it.second.IsDirectory)
+            count++;
+    }
+    return count;
+}
+
+String TFileIndex::MakeKey(const String& path) const
+{
+    if (FRoot.IsEmpty() || path.IsEmpty())
+        return L"?";
+
+    String p = StringReplace(path, L"/", L"\\", TReplaceFlags() << rfReplaceAll);
+    p = ExcludeTrailingPathDelimiter(p);
+
+    // Absolute path - must be under root
+    if (p.Length() >= 2 && (p[2] == L':' || p.SubString(1, 2) == L"\\\\"))
+    {
+        int rootLen = FRoot.Length();
+        if (p.Length() < rootLen || !SameText(p.SubString(1, rootLen), FRoot))
+            return L"?";
+        if (p.Length() == rootLen)
+            return L"";
+        if (p[rootLen + 1] != L'\\')
+            return L"?";
+        p = p.SubString(rootLen + 2, p.Length() - rootLen - 1);
+    }
+
+    return p.LowerCase();
+}
+
+bool TFileIndex::Contains(const String& path) const
+{
+    return MakeKey(path) != L"?";
+}
+
+const TFileIndexEntry* TFileIndex::Find(const String& path) const
+{
+    String key = MakeKey(path);
+    if (key == L"?")
+        return nullptr;
+
+    auto it = FEntries.find(key);
+    if (it == FEntries.end())
+        return nullptr;
+    return &it->second;
+}
+
+bool TFileIndex::FileExists(const String& path) const
+{
+    const TFileIndexEntry* entry = Find(path);
+    return entry != nullptr && !entry->IsDirectory;
+}
+
+bool TFileIndex::DirectoryExists(const String& path) const
+{
+    const TFileIndexEntry* entry = Find(path);
+    return entry != nullptr && entry->IsDirectory;
+}
+
+TFileIndexEntryList TFileIndex::GetFiles(const String& dir, const String& ext) const
+{
+    TFileIndexEntryList result;
+
+    String key = MakeKey(dir);
+    if (key == L"?")
+        return result;
+
+    auto it = FChildren.find(key);
+    if (it == FChildren.end())
+        return result;
+
+    for (const auto* entry : it->second)
+    {
+        if (entry->IsDirectory)
+            continue;
+        if (!ext.IsEmpty() && !SameText(ExtractFileExt(entry->Name), ext))
+            continue;
+        result.push_back(entry);
+    }
+
+    return result;
+}
+
+TFileIndexEntryList TFileIndex::FindByName(const String& fileName) const
+{
+    auto it = FByName.find(fileName.LowerCase());
+    if (it == FByName.end())
+        return TFileIndexEntryList();
+    return it->second;
+}
+
+void TFileIndex::ForEachFile(const TFileIndexCallback& callback) const
+{
+    for (const auto& it : FEntries)
+    {
+        if (!it.second.IsDirectory)
+            callback(it.second);
+    }
+}
+
+String TFileIndex::FindPackageFile(const String& packagesDir,
+                                   const String& pkgBaseName,
+                                   const String& ideSuffix) const
+{
+    if (!DirectoryExists(packagesDir))
+        return L"";
+
+    // DevExpress package naming conventions:
+    // New style (25.1+): dxCore370.dpk (suffix = "370" for RS13)
+    // Old style: dxCoreRS37.dpk (RS + major version)
+    // Delphi-only: dxCoreD37.dpk
+    // {$LIBSUFFIX AUTO}: plain name (e.g., SynEditDR.dpk)
+    String rsNum = ideSuffix.SubString(1, ideSuffix.Length() - 1);  // "290" -> "29"
+
+    const String candidates[] = {
+        pkgBaseName + ideSuffix + L".dpk",
+        pkgBaseName + L"RS" + rsNum + L".dpk",
+        pkgBaseName + L"D" + rsNum + L".dpk",
+        pkgBaseName + L".dpk"
+    };
+
+    for (const auto& name : candidates)
+    {
+        const TFileIndexEntry* entry = Find(TPath::Combine(packagesDir, name));
+        if (entry != nullptr && !entry->IsDirectory)
+            return entry->FullPath;
+    }
+
+    return L"";
+}
+
+} // namespace DxCore
@@ -0,0 +1,100 @@
+//---------------------------------------------------------------------------
+// FileIndex - In-memory index of the DevExpress install tree
+//
+// The install directory is scanned once (in parallel, on the shared
+// TTaskPool) and every later existence check, package lookup and directory
+// listing is answered from memory. This matters on network shares, where
+// each FileExists/DirectoryExists probe is a network round trip.
+//
+// Lookups are case-insensitive, like the Windows file system.
+//---------------------------------------------------------------------------
+#ifndef FileIndexH
+#define FileIndexH
+
+#include <System.hpp>
+#include <System.Classes.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <unordered_map>
+#include <functional>
+#include "StringHash.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Index entry - one file or directory found during the scan
+//---------------------------------------------------------------------------
+struct TFileIndexEntry
+{
+    String FullPath;          // Full path with original case
+    String Name;              // File name with original case
+    __int64 Size;             // File size in bytes (0 for directories)
+    TDateTime TimeStamp;      // Last write time
+    bool IsDirectory;
+
+    TFileIndexEntry() : Size(0), TimeStamp(0), IsDirectory(false) {}
+};
+
+typedef std::vector<const TFileIndexEntry*> TFileIndexEntryList;
+typedef std::function<void(const TFileIndexEntry&)> TFileIndexCallback;
+
+//---------------------------------------------------------------------------
+// File index
+//---------------------------------------------------------------------------
+class TFileIndex
+{
+private:
+    String FRoot;             // Root directory without trailing delimiter
+
+    // Key = lowercase path relative to root ("" is the root itself)
+    std::unordered_map<String, TFileIndexEntry, TStringHash> FEntries;
+    // Key = lowercase relative directory, value = direct children
+    std::unordered_map<String, TFileIndexEntryList, TStringHash> FChildren;
+    // Key = lowercase file name, value = all files with that name
+    std::unordered_map<String, TFileIndexEntryList, TStringHash> FByName;
+
+    void AddEntry(const String& key, const TFileIndexEntry& entry);
+    String MakeKey(const String& path) const;
+
+public:
+    TFileIndex();
+    ~TFileIndex();
+
+    // Scan root recursively and rebuild the index
+    void Build(const String& root);
+    // Rebuild from a listing made elsewhere (a source archive). Files must be
+    // below root; their directories need not be listed.
+    void Build(const String& root, const std::vector<TFileIndexEntry>& listing);
+    void Clear();
+
+    const String& GetRoot() const { return FRoot; }
+    bool IsEmpty() const { return FEntries.empty(); }
+    int GetFileCount() const;
+
+    // Lookups - path may be absolute (under root) or relative to root.
+    // Paths outside of the indexed root are never found.
+    bool Contains(const String& path) const;
+    const TFileIndexEntry* Find(const String& path) const;
+    bool FileExists(const String& path) const;
+    bool DirectoryExists(const String& path) const;
+
+    // Direct children of a directory (files only); ext filter like ".dpk"
+    TFileIndexEntryList GetFiles(const String& dir, const String& ext = L"") const;
+
+    // All files with the given name, anywhere in the tree
+    TFileIndexEntryList FindByName(const String& fileName) const;
+
+    // Visit every file in the index (unordered)
+    void ForEachFile(const TFileIndexCallback& callback) const;
+
+    // Resolve a DevExpress package file by base name and IDE suffix
+    // (same naming rules as the former FileExists probing)
+    String FindPackageFile(const String& packagesDir,
+                           const String& pkgBaseName,
+                           const String& ideSuffix) const;
+};
+
+} // namespace DxCore
+
+#endif
@@ -0,0 +1,277 @@
+//---------------------------------------------------------------------------
+// FileOps implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "FileOps.h"
+#include "TaskPool.h"
+#include <Winapi.Windows.hpp>
+#include <map>
+#include <mutex>
+#include <algorithm>
+
+namespace DxCore
+{
+
+// Files per task - single small-file operations are too short to be
+// worth a task each
+static const size_t FILE_BATCH_SIZE = 32;
+
+// Longest sleep between checks of the stop flag while throttled
+static const DWORD THROTTLE_SLICE_MS = 100;
+
+//---------------------------------------------------------------------------
+// TIOThrottle implementation
+//---------------------------------------------------------------------------
+TIOThrottle::TIOThrottle()
+    : FRate(0),
+      FTokens(0),
+      FLastTick(GetTickCount64())
+{
+}
+
+TIOThrottle& TIOThrottle::Shared()
+{
+    static TIOThrottle throttle;
+    return throttle;
+}
+
+void TIOThrottle::SetRate(__int64 bytesPerSecond)
+{
+    std::lock_guard<std::mutex> guard(FLock);
+    FRate.store(std::max<__int64>(bytesPerSecond, 0));
+    FTokens = 0;
+    FLastTick = GetTickCount64();
+}
+
+bool TIOThrottle::Consume(__int64 bytes, const std::atomic<bool>* stopped)
+{
+    DWORD waitMs;
+    {
+        std::lock_guard<std::mutex> guard(FLock);
+        __int64 rate = FRate.load();
+        if (rate <= 0)
+            return true;
+
+        unsigned __int64 now = GetTickCount64();
+        FTokens = std::min((double)rate, FTokens + (double)(now - FLastTick) * rate / 1000.0);
+        FLastTick = now;
+        FTokens -= (double)bytes;
+        if (FTokens >= 0)
+            return true;
+        waitMs = (DWORD)(-FTokens * 1000.0 / rate);
+    }
+
+    // Writers that queue up behind a debt wait for all of it
+    while (waitMs > 0)
+    {
+        if (stopped && stopped->load())
+            return false;
+        DWORD slice = std::min(waitMs, THROTTLE_SLICE_MS);
+        Sleep(slice);
+        waitMs -= slice;
+    }
+    return true;
+}
+
+// Throttled copies report every chunk that CopyFileEx has written
+struct TThrottledCopy
+{
+    TIOThrottle* Throttle;
+    const std::atomic<bool>* Stopped;
+    __int64 Reported;
+};
+
+static DWORD CALLBACK ThrottleCopyProgress(LARGE_INTEGER totalSize, LARGE_INTEGER transferred,
+                                           LARGE_INTEGER streamSize, LARGE_INTEGER streamTransferred,
+                                           DWORD streamNumber, DWORD reason,
+                                           HANDLE source, HANDLE dest, LPVOID data)
+{
+    TThrottledCopy* copy = static_cast<TThrottledCopy*>(data);
+    __int64 chunk = transferred.QuadPart - copy->Reported;
+    copy->Reported = transferred.QuadPart;
+    if (chunk > 0 && !copy->Throttle->Consume(chunk, copy->Stopped))
+        return PROGRESS_CANCEL;
+    return PROGRESS_CONTINUE;
+}
+
+static bool CopyOneFile(const TFileCopy& copy, const std::atomic<bool>* stopped)
+{
+    TIOThrottle& throttle = TIOThrottle::Shared();
+    if (!throttle.IsLimited())
+        return CopyFile(copy.Source.c_str(), copy.Dest.c_str(), FALSE);
+
+    TThrottledCopy progress = { &throttle, stopped, 0 };
+    return CopyFileExW(copy.Source.c_str(), copy.Dest.c_str(), ThrottleCopyProgress,
+                       &progress, nullptr, 0);
+}
+
+//---------------------------------------------------------------------------
+// TFileOps implementation
+//---------------------------------------------------------------------------
+bool TFileOps::Walk(const String& root, bool recursive, const TWalkCallback& callback,
+                    const std::atomic<bool>* stopped, bool withDirs)
+{
+    String start = ExcludeTrailingPathDelimiter(root);
+    if (start.IsEmpty() || !DirectoryExists(start))
+        return true;
+
+    TTaskGroup group(stopped);
+
+    std::function<void(const String&)> scan;
+    scan = [&](const String& dir) {
+        TSearchRec sr;
+        if (FindFirst(dir + L"\\*.*", faAnyFile, sr) != 0)
+            return;
+
+        do
+        {
+            if (sr.Name == L"." || sr.Name == L"..")
+                continue;
+
+            TWalkEntry entry;
+            entry.Dir = dir;
+            entry.Name = sr.Name;
+            entry.FullPath = dir + L"\\" + sr.Name;
+            entry.IsDirectory = (sr.Attr & faDirectory) != 0;
+            entry.Size = entry.IsDirectory ? 0 : sr.Size;
+            entry.TimeStamp = sr.TimeStamp;
+            entry.WriteTime = ((__int64)sr.FindData.ftLastWriteTime.dwHighDateTime << 32) |
+                              sr.FindData.ftLastWriteTime.dwLowDateTime;
+
+            if (!entry.IsDirectory)
+            {
+                callback(entry);
+                continue;
+            }
+
+            if (withDirs)
+                callback(entry);
+
+            // Junctions are reported but never followed
+            if (recursive && (sr.Attr & faSymLink) == 0)
+            {
+                String sub = entry.FullPath;
+                group.RunIO([&scan, sub]() { scan(sub); });
+            }
+        } while (!group.IsCancelled() && FindNext(sr) == 0);
+
+        FindClose(sr);
+    };
+
+    group.RunIO([&scan, start]() { scan(start); });
+    return group.Wait();
+}
+
+int TFileOps::DeleteFiles(const std::vector<String>& files, const std::atomic<bool>* stopped)
+{
+    std::atomic<int> deleted{0};
+    TTaskGroup group(stopped);
+
+    for (size_t first = 0; first < files.size(); first += FILE_BATCH_SIZE)
+    {
+        size_t last = std::min(first + FILE_BATCH_SIZE, files.size());
+        group.RunIO([&files, &deleted, &group, first, last]() {
+            for (size_t i = first; i < last && !group.IsCancelled(); i++)
+            {
+                if (DeleteFile(files[i].c_str()))
+                    deleted++;
+            }
+        });
+    }
+
+    group.Wait();
+    return deleted.load();
+}
+
+int TFileOps::CopyFiles(const std::vector<TFileCopy>& copies, const std::atomic<bool>* stopped)
+{
+    // Parallel copies have no order, so duplicates are resolved up front
+    std::map<String, size_t> lastByDest;
+    for (size_t i = 0; i < copies.size(); i++)
+        lastByDest[copies[i].Dest.LowerCase()] = i;
+
+    std::vector<size_t> order;
+    std::map<String, String> dirs;      // lower-case -> path
+    for (size_t i = 0; i < copies.size(); i++)
+    {
+        if (lastByDest[copies[i].Dest.LowerCase()] != i)
+            continue;
+        order.push_back(i);
+        String dir = ExtractFileDir(copies[i].Dest);
+        dirs[dir.LowerCase()] = dir;
+    }
+
+    for (const auto& it : dirs)
+    {
+        if (!it.second.IsEmpty())
+            ForceDirectories(it.second);
+    }
+
+    std::atomic<int> copied{0};
+    TTaskGroup group(stopped);
+
+    for (size_t first = 0; first < order.size(); first += FILE_BATCH_SIZE)
+    {
+        size_t last = std::min(first + FILE_BATCH_SIZE, order.size());
+        group.RunIO([&copies, &order, &copied, &group, stopped, first, last]() {
+            for (size_t i = first; i < last && !group.IsCancelled(); i++)
+            {
+                if (CopyOneFile(copies[order[i]], stopped))
+                    copied++;
+            }
+        });
+    }
+
+    group.Wait();
+    return copied.load();
+}
+
+bool TFileOps::DeleteTree(const String& dir, const std::atomic<bool>* stopped)
+{
+    String root = ExcludeTrailingPathDelimiter(dir);
+    if (root.IsEmpty() || !DirectoryExists(root))
+        return true;
+
+    std::mutex lock;
+    std::vector<String> dirs;
+    std::atomic<bool> failed{false};
+
+    bool completed = Walk(root, true, [&](const TWalkEntry& entry) {
+        if (entry.IsDirectory)
+        {
+            std::lock_guard<std::mutex> guard(lock);
+            dirs.push_back(entry.FullPath);
+            return;
+        }
+
+        if (DeleteFile(entry.FullPath.c_str()))
+            return;
+
+        // Read-only files can only be deleted once the attribute is cleared
+        SetFileAttributes(entry.FullPath.c_str(), FILE_ATTRIBUTE_NORMAL);
+        if (!DeleteFile(entry.FullPath.c_str()))
+            failed.store(true);
+    }, stopped, true);
+
+    if (!completed)
+        return false;
+
+    // Children before parents: a longer path is never an ancestor
+    std::sort(dirs.begin(), dirs.end(), [](const String& a, const String& b) {
+        return a.Length() > b.Length();
+    });
+    dirs.push_back(root);
+
+    for (const auto& path : dirs)
+    {
+        if (RemoveDirectory(path.c_str()))
+            continue;
+        SetFileAttributes(path.c_str(), FILE_ATTRIBUTE_NORMAL);
+        if (!RemoveDirectory(path.c_str()))
+            failed.store(true);
+    }
+
+    return !failed.load();
+}
+
+} // namespace DxCore
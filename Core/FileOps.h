@@ -0,0 +1,105 @@
+//---------------------------------------------------------------------------
+// FileOps - Parallel directory walking, copying and deleting
+//
+// All operations run on the shared TTaskPool, limited by its I/O budget,
+// and stop early once *stopped becomes true. Directory walks submit every
+// subdirectory as a task of its own. Callbacks are invoked concurrently
+// from pool threads.
+//
+// Copies count against TIOThrottle::Shared(), which is unlimited unless
+// the installer runs in background mode.
+//---------------------------------------------------------------------------
+#ifndef FileOpsH
+#define FileOpsH
+
+#include <System.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <atomic>
+#include <mutex>
+#include <functional>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// One file found by a walk
+//---------------------------------------------------------------------------
+struct TWalkEntry
+{
+    String Dir;               // Containing directory, no trailing delimiter
+    String Name;
+    String FullPath;
+    __int64 Size;
+    TDateTime TimeStamp;
+    __int64 WriteTime;        // Last write time as UTC FILETIME ticks
+    bool IsDirectory;
+
+    TWalkEntry() : Size(0), TimeStamp(0), WriteTime(0), IsDirectory(false) {}
+};
+
+typedef std::function<void(const TWalkEntry&)> TWalkCallback;
+
+//---------------------------------------------------------------------------
+// One file copy
+//---------------------------------------------------------------------------
+struct TFileCopy
+{
+    String Source;
+    String Dest;
+};
+
+//---------------------------------------------------------------------------
+// I/O throttle - a token bucket shared by all writers. Bytes beyond the
+// rate become a debt that the writer pays by sleeping; up to one second
+// of unused rate may be spent in a burst.
+//---------------------------------------------------------------------------
+class TIOThrottle
+{
+private:
+    std::mutex FLock;
+    std::atomic<__int64> FRate;      // Bytes per second, 0 = unlimited
+    double FTokens;
+    unsigned __int64 FLastTick;
+
+public:
+    TIOThrottle();
+
+    static TIOThrottle& Shared();
+
+    __int64 GetRate() const { return FRate.load(); }
+    void SetRate(__int64 bytesPerSecond);
+    bool IsLimited() const { return FRate.load() > 0; }
+
+    // Blocks until bytes fit the rate. Returns false if *stopped was set
+    // while waiting.
+    bool Consume(__int64 bytes, const std::atomic<bool>* stopped = nullptr);
+};
+
+//---------------------------------------------------------------------------
+// File operations
+//---------------------------------------------------------------------------
+class TFileOps
+{
+public:
+    // Visits files (and, if withDirs, directories) below root.
+    // Returns false if cancelled.
+    static bool Walk(const String& root, bool recursive, const TWalkCallback& callback,
+                     const std::atomic<bool>* stopped = nullptr, bool withDirs = false);
+
+    // Returns the number of files deleted/copied
+    static int DeleteFiles(const std::vector<String>& files,
+                           const std::atomic<bool>* stopped = nullptr);
+    // Destination directories are created first; later entries for the
+    // same destination win, as with sequential copying
+    static int CopyFiles(const std::vector<TFileCopy>& copies,
+                         const std::atomic<bool>* stopped = nullptr);
+
+    // Deletes a directory with everything in it (read-only files too).
+    // Returns false if anything is left behind.
+    static bool DeleteTree(const String& dir, const std::atomic<bool>* stopped = nullptr);
+};
+
+} // namespace DxCore
+
+#endif
@@ -18,7 +18,8 @@ TIDEInfo::TIDEInfo()
       SupportsWin64(false),
       SupportsWin64Modern(false),
       Personality(TIDEPersonality::Both),
-      IDEBitness(TIDEBitness::IDE32)
+      IDEBitness(TIDEBitness::IDE32),
+      FResolved(false)
 {
 }
 
@@ -80,53 +81,22 @@ static String ExpandIDEMacros(const String& path, const String& bdsVersion, cons
     return result;
 }
 
-String TIDEInfo::GetBPLOutputPath(TIDEPlatform platform) const
+static int PlatformIndex(TIDEPlatform platform)
 {
-    // Determine platform name for macro expansion and subfolder
-    String platformName;
-    String platformKey;
     switch (platform)
     {
-        case TIDEPlatform::Win64:
-            platformKey = L"Win64";
-            platformName = L"Win64";
-            break;
-        case TIDEPlatform::Win64Modern:
-            platformKey = L"Win64x";
-            platformName = L"Win64x";
-            break;
-        default:
-            platformKey = L"Win32";
-            platformName = L"Win32";
-    }
-    
-    // Try to read from registry
-    if (!RegistryKey.IsEmpty())
-    {
-        String keyPath = RegistryKey + L"\\Library\\" + platformKey;
-        
-        std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ));
-        reg->RootKey = HKEY_CURRENT_USER;
-        
-        if (reg->OpenKeyReadOnly(keyPath))
-        {
-            if (reg->ValueExists(L"Package DPL Output"))
-            {
-                String path = reg->ReadString(L"Package DPL Output");
-                reg->CloseKey();
-                if (!path.IsEmpty())
-                {
-                    // Expand macros like $(BDSCOMMONDIR) and $(Platform)
-                    path = ExpandIDEMacros(path, BDSVersion, platformName);
-                    if (!path.IsEmpty() && path.Pos(L"$") == 0)  // No unexpanded macros
-                        return path;
-                }
-            }
-            reg->CloseKey();
-        }
+        case TIDEPlatform::Win64: return 1;
+        case TIDEPlatform::Win64Modern: return 2;
+        default: return 0;
     }
-    
-    // Fallback to Public Documents path
+}
+
+static const wchar_t* const PlatformDirNames[] = {
+    PlatformNames::Win32, PlatformNames::Win64, PlatformNames::Win64Modern
+};
+
+static String GetPublicStudioDir()
+{
     String publicDocs = L"C:\\Users\\Public\\Documents\\Embarcadero\\Studio";
     
     wchar_t publicPath[MAX_PATH];
@@ -134,106 +104,144 @@ String TIDEInfo::GetBPLOutputPath(TIDEPlatform platform) const
     {
         publicDocs = String(publicPath) + L"\\Documents\\Embarcadero\\Studio";
     }
-    
-    String bdsVer = BDSVersion.IsEmpty() ? L"23.0" : BDSVersion;
-    String result = publicDocs + L"\\" + bdsVer + L"\\Bpl";
-    
-    // For Win64, add subfolder
-    if (platform == TIDEPlatform::Win64)
-        result = result + L"\\Win64";
-    else if (platform == TIDEPlatform::Win64Modern)
-        result = result + L"\\Win64x";
-    
-    return result;
+    return publicDocs;
 }
 
-String TIDEInfo::GetDCPOutputPath(TIDEPlatform platform) const
+void TIDEInfo::EnsureResolved() const
 {
-    // Determine platform name for macro expansion and subfolder
-    String platformName;
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64:
-            platformKey = L"Win64";
-            platformName = L"Win64";
-            break;
-        case TIDEPlatform::Win64Modern:
-            platformKey = L"Win64x";
-            platformName = L"Win64x";
-            break;
-        default:
-            platformKey = L"Win32";
-            platformName = L"Win32";
-    }
+    std::lock_guard<std::mutex> lock(FCacheLock);
+    if (!FResolved)
+        ResolveUnlocked();
+}
+
+void TIDEInfo::Refresh()
+{
+    std::lock_guard<std::mutex> lock(FCacheLock);
+    ResolveUnlocked();
+}
+
+void TIDEInfo::SetRegistryBackend(TRegistryBackendPtr backend)
+{
+    std::lock_guard<std::mutex> lock(FCacheLock);
+    FRegistry = backend;
+}
+
+TRegistryBackend* TIDEInfo::GetRegistryUnlocked() const
+{
+    if (!FRegistry)
+        FRegistry = std::make_shared<TWinRegistryBackend>(HKEY_CURRENT_USER, true);
+    return FRegistry.get();
+}
+
+String TIDEInfo::GetPackageSuffixForVersion(const String& bdsVersion)
+{
+    // Package suffix mapping (BDS version -> Package suffix)
+    // RAD Studio 12 Athens: BDS 23.0 -> suffix 290
+    // RAD Studio 13 Florence: BDS 37.0 -> suffix 370
+    if (bdsVersion == L"23.0")
+        return L"290";
+    if (bdsVersion == L"37.0")
+        return L"370";
+    
+    // Future versions - use BDS * 10 + 60 as approximation
+    int dotPos = bdsVersion.Pos(L".");
+    int bdsNum = dotPos > 0 ? StrToIntDef(bdsVersion.SubString(1, dotPos - 1), 0) : 0;
+    return bdsNum > 0 ? String(bdsNum * 10 + 60) : String(L"290");
+}
+
+void TIDEInfo::ResolveUnlocked() const
+{
+    FPackageSuffix = GetPackageSuffixForVersion(BDSVersion);
     
-    // Try to read from registry
-    if (!RegistryKey.IsEmpty())
+    // Fallback root: Public Documents
+    String bdsVer = BDSVersion.IsEmpty() ? L"23.0" : BDSVersion;
+    String studioDir = GetPublicStudioDir() + L"\\" + bdsVer;
+    
+    const TIDEPlatform platforms[PLATFORM_COUNT] = {
+        TIDEPlatform::Win32, TIDEPlatform::Win64, TIDEPlatform::Win64Modern
+    };
+    // The backend keeps each Library\{Platform} key open for both values
+    TRegistryBackend* reg = GetRegistryUnlocked();
+    
+    for (int i = 0; i < PLATFORM_COUNT; i++)
     {
-        String keyPath = RegistryKey + L"\\Library\\" + platformKey;
+        String platformName = PlatformDirNames[i];
+        String subFolder = (platforms[i] == TIDEPlatform::Win32) ? String() : L"\\" + platformName;
         
-        std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ));
-        reg->RootKey = HKEY_CURRENT_USER;
+        String bplPath = studioDir + L"\\Bpl" + subFolder;
+        String dcpPath = studioDir + L"\\Dcp" + subFolder;
         
-        if (reg->OpenKeyReadOnly(keyPath))
+        if (!RegistryKey.IsEmpty())
         {
-            if (reg->ValueExists(L"Package DCP Output"))
+            // Expand macros like $(BDSCOMMONDIR) and $(Platform);
+            // keep the fallback if anything stays unexpanded
+            String libraryKey = RegistryKey + L"\\Library\\" + platformName;
+            String value;
+            if (reg->ReadValue(libraryKey, L"Package DPL Output", value))
             {
-                String path = reg->ReadString(L"Package DCP Output");
-                reg->CloseKey();
-                if (!path.IsEmpty())
-                {
-                    // Expand macros like $(BDSCOMMONDIR) and $(Platform)
-                    path = ExpandIDEMacros(path, BDSVersion, platformName);
-                    if (!path.IsEmpty() && path.Pos(L"$") == 0)  // No unexpanded macros
-                        return path;
-                }
+                String path = ExpandIDEMacros(value, BDSVersion, platformName);
+                if (!path.IsEmpty() && path.Pos(L"$") == 0)
+                    bplPath = path;
+            }
+            if (reg->ReadValue(libraryKey, L"Package DCP Output", value))
+            {
+                String path = ExpandIDEMacros(value, BDSVersion, platformName);
+                if (!path.IsEmpty() && path.Pos(L"$") == 0)
+                    dcpPath = path;
             }
-            reg->CloseKey();
         }
+        
+        FBPLOutputPaths[i] = bplPath;
+        FDCPOutputPaths[i] = dcpPath;
+        
+        // HPP files go to the hpp folder in Public Documents
+        FHPPOutputPaths[i] = studioDir + L"\\hpp" + subFolder;
     }
     
-    // Fallback to Public Documents path
-    String publicDocs = L"C:\\Users\\Public\\Documents\\Embarcadero\\Studio";
-    
-    wchar_t publicPath[MAX_PATH];
-    if (GetEnvironmentVariableW(L"PUBLIC", publicPath, MAX_PATH) > 0)
-    {
-        publicDocs = String(publicPath) + L"\\Documents\\Embarcadero\\Studio";
-    }
-    
-    String bdsVer = BDSVersion.IsEmpty() ? L"23.0" : BDSVersion;
-    String result = publicDocs + L"\\" + bdsVer + L"\\Dcp";
-    
-    // For Win64, add subfolder
-    if (platform == TIDEPlatform::Win64)
-        result = result + L"\\Win64";
-    else if (platform == TIDEPlatform::Win64Modern)
-        result = result + L"\\Win64x";
-    
-    return result;
+    FLibraryInstallDir = L"";   // Built from the suffix
+    FResolved = true;
 }
+
+String TIDEInfo::GetBPLOutputPath(TIDEPlatform platform) const
+{
+    EnsureResolved();
+    return FBPLOutputPaths[PlatformIndex(platform)];
+}
+
+String TIDEInfo::GetDCPOutputPath(TIDEPlatform platform) const
+{
+    EnsureResolved();
+    return FDCPOutputPaths[PlatformIndex(platform)];
+}
+
 String TIDEInfo::GetHPPOutputPath(TIDEPlatform platform) const
 {
-    // HPP files go to the hpp folder in Public Documents
-    String publicDocs = L"C:\\Users\\Public\\Documents\\Embarcadero\\Studio";
+    EnsureResolved();
+    return FHPPOutputPaths[PlatformIndex(platform)];
+}
+
+String TIDEInfo::GetPackageSuffix() const
+{
+    EnsureResolved();
+    return FPackageSuffix;
+}
+
+String TIDEInfo::GetInstallLibraryDir(const String& installFileDir, TIDEPlatform platform) const
+{
+    std::lock_guard<std::mutex> lock(FCacheLock);
+    if (!FResolved)
+        ResolveUnlocked();
     
-    wchar_t publicPath[MAX_PATH];
-    if (GetEnvironmentVariableW(L"PUBLIC", publicPath, MAX_PATH) > 0)
+    if (installFileDir != FLibraryInstallDir)
     {
-        publicDocs = String(publicPath) + L"\\Documents\\Embarcadero\\Studio";
+        String root = installFileDir + L"\\Library";
+        if (!FPackageSuffix.IsEmpty())
+            root += L"\\" + FPackageSuffix;
+        for (int i = 0; i < PLATFORM_COUNT; i++)
+            FLibraryDirs[i] = root + L"\\" + PlatformDirNames[i];
+        FLibraryInstallDir = installFileDir;
     }
-    
-    String bdsVer = BDSVersion.IsEmpty() ? L"23.0" : BDSVersion;
-    String result = publicDocs + L"\\" + bdsVer + L"\\hpp";
-    
-    // For Win64, add subfolder
-    if (platform == TIDEPlatform::Win64)
-        result = result + L"\\Win64";
-    else if (platform == TIDEPlatform::Win64Modern)
-        result = result + L"\\Win64x";
-    
-    return result;
+    return FLibraryDirs[PlatformIndex(platform)];
 }
 
 String TIDEInfo::GetDesignTimeBPLPath() const
@@ -255,7 +263,7 @@ TIDEPlatform TIDEInfo::GetDesignTimePlatform() const
         return TIDEPlatform::Win32;
 }
 
-String TIDEInfo::GetLibrarySearchPath(TIDEPlatform platform) const
+String TIDEInfo::ReadLibraryValue(TIDEPlatform platform, const String& valueName) const
 {
     String platformKey;
     switch (platform)
@@ -270,47 +278,23 @@ String TIDEInfo::GetLibrarySearchPath(TIDEPlatform platform) const
             platformKey = L"Win32";
     }
     
-    String keyPath = RegistryKey + L"\\Library\\" + platformKey;
-    
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKeyReadOnly(keyPath))
-    {
-        if (reg->ValueExists(L"Search Path"))
-            return reg->ReadString(L"Search Path");
-    }
-    
-    return L"";
+    // Not memoized - the installer changes these values
+    std::lock_guard<std::mutex> lock(FCacheLock);
+    String value;
+    if (RegistryKey.IsEmpty() ||
+        !GetRegistryUnlocked()->ReadValue(RegistryKey + L"\\Library\\" + platformKey, valueName, value))
+        return L"";
+    return value;
+}
+
+String TIDEInfo::GetLibrarySearchPath(TIDEPlatform platform) const
+{
+    return ReadLibraryValue(platform, L"Search Path");
 }
 
 String TIDEInfo::GetLibraryBrowsingPath(TIDEPlatform platform) const
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64:
-            platformKey = L"Win64";
-            break;
-        case TIDEPlatform::Win64Modern:
-            platformKey = L"Win64x";
-            break;
-        default:
-            platformKey = L"Win32";
-    }
-    
-    String keyPath = RegistryKey + L"\\Library\\" + platformKey;
-    
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKeyReadOnly(keyPath))
-    {
-        if (reg->ValueExists(L"Browsing Path"))
-            return reg->ReadString(L"Browsing Path");
-    }
-    
-    return L"";
+    return ReadLibraryValue(platform, L"Browsing Path");
 }
 
 bool TIDEInfo::IsRunning() const
@@ -476,6 +460,9 @@ TIDEInfoPtr TIDEDetector::ParseIDEFromRegistry(const String& bdsVersion)
     else if (bdsNum >= 20)
         ide->ProductVersion = String(bdsNum - 7) + L".0";
     
+    // Resolve output paths and package suffix once, at detection time
+    ide->Refresh();
+    
     return ide;
 }
 
@@ -14,7 +14,9 @@
 #include <System.Generics.Collections.hpp>
 #include <vector>
 #include <memory>
+#include <mutex>
 #include <set>
+#include "RegistryChangeSet.h"
 
 namespace DxCore
 {
@@ -89,11 +91,28 @@ public:
     String GetDCC64XPath() const;  // Modern compiler
     String GetMkExpPath() const;   // mkexp.exe for generating import library from .bpl (use -p flag)
     
-    // Output paths - for compiled packages
+    // Output paths - for compiled packages.
+    // Resolved once (registry + macro expansion) and memoized; call
+    // Refresh() after the IDE library settings may have changed.
     String GetBPLOutputPath(TIDEPlatform platform) const;
     String GetDCPOutputPath(TIDEPlatform platform) const;
     String GetHPPOutputPath(TIDEPlatform platform) const;  // For C++Builder
     
+    // Package suffix for this IDE ("290" for RS12, "370" for RS13)
+    String GetPackageSuffix() const;
+    static String GetPackageSuffixForVersion(const String& bdsVersion);
+    
+    // <installFileDir>\Library\{suffix}\{platform}, the unit output dir of
+    // an install; memoized for the last installFileDir asked for
+    String GetInstallLibraryDir(const String& installFileDir, TIDEPlatform platform) const;
+    
+    // Drop memoized paths/suffix and resolve them again
+    void Refresh();
+    
+    // Where the Library keys are read from; HKEY_CURRENT_USER (read-only)
+    // unless set. Takes effect at the next Refresh().
+    void SetRegistryBackend(TRegistryBackendPtr backend);
+    
     // Design-time BPL path - depends on IDE bitness!
     // For 64-bit IDE, design-time packages go to Win64 BPL folder
     String GetDesignTimeBPLPath() const;
@@ -107,6 +126,26 @@ public:
     bool IsRunning() const;
     
     TIDEInfo();
+    
+private:
+    static const int PLATFORM_COUNT = 3;
+    
+    // Memoized values - guarded by FCacheLock, the installer reads them
+    // from background threads
+    mutable std::mutex FCacheLock;
+    mutable bool FResolved;
+    mutable String FBPLOutputPaths[PLATFORM_COUNT];
+    mutable String FDCPOutputPaths[PLATFORM_COUNT];
+    mutable String FHPPOutputPaths[PLATFORM_COUNT];
+    mutable String FPackageSuffix;
+    mutable String FLibraryInstallDir;       // Key of FLibraryDirs
+    mutable String FLibraryDirs[PLATFORM_COUNT];
+    mutable TRegistryBackendPtr FRegistry;   // Guarded by FCacheLock as well
+    
+    TRegistryBackend* GetRegistryUnlocked() const;
+    String ReadLibraryValue(TIDEPlatform platform, const String& valueName) const;
+    void EnsureResolved() const;
+    void ResolveUnlocked() const;
 };
 
 typedef std::shared_ptr<TIDEInfo> TIDEInfoPtr;
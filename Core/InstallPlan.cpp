@@ -0,0 +1,443 @@
+//---------------------------------------------------------------------------
+// InstallPlan implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "InstallPlan.h"
+#include <System.JSON.hpp>
+#include <IOUtils.hpp>
+#include <DateUtils.hpp>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Enum names used in the JSON form
+//---------------------------------------------------------------------------
+static String PlatformToString(TIDEPlatform platform)
+{
+    switch (platform)
+    {
+        case TIDEPlatform::Win64: return PlatformNames::Win64;
+        case TIDEPlatform::Win64Modern: return PlatformNames::Win64Modern;
+        default: return PlatformNames::Win32;
+    }
+}
+
+static TIDEPlatform PlatformFromString(const String& value)
+{
+    if (SameText(value, PlatformNames::Win64))
+        return TIDEPlatform::Win64;
+    if (SameText(value, PlatformNames::Win64Modern))
+        return TIDEPlatform::Win64Modern;
+    return TIDEPlatform::Win32;
+}
+
+static String ChangeKindToString(TRegistryChangeKind kind)
+{
+    switch (kind)
+    {
+        case TRegistryChangeKind::DeleteValue: return L"delete";
+        case TRegistryChangeKind::AddPathEntry: return L"addPath";
+        case TRegistryChangeKind::RemovePathEntry: return L"removePath";
+        default: return L"set";
+    }
+}
+
+static TRegistryChangeKind ChangeKindFromString(const String& value)
+{
+    if (SameText(value, L"delete"))
+        return TRegistryChangeKind::DeleteValue;
+    if (SameText(value, L"addPath"))
+        return TRegistryChangeKind::AddPathEntry;
+    if (SameText(value, L"removePath"))
+        return TRegistryChangeKind::RemovePathEntry;
+    return TRegistryChangeKind::SetValue;
+}
+
+//---------------------------------------------------------------------------
+// JSON read helpers - missing members read as empty/zero/false
+//---------------------------------------------------------------------------
+static String ReadString(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    return value ? value->Value() : String();
+}
+
+static int ReadInt(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    if (TJSONNumber* number = dynamic_cast<TJSONNumber*>(value))
+        return number->AsInt;
+    return value ? StrToIntDef(value->Value(), 0) : 0;
+}
+
+static bool ReadBool(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    if (TJSONBool* flag = dynamic_cast<TJSONBool*>(value))
+        return flag->AsBoolean;
+    return value ? SameText(value->Value(), L"true") : false;
+}
+
+static TJSONArray* ReadArray(TJSONObject* obj, const String& name)
+{
+    return dynamic_cast<TJSONArray*>(obj->GetValue(name));
+}
+
+//---------------------------------------------------------------------------
+// Shared members of plans and manifests
+//---------------------------------------------------------------------------
+static TJSONArray* WriteStrings(const std::vector<String>& values)
+{
+    TJSONArray* array = new TJSONArray();
+    for (const auto& value : values)
+        array->Add(value);
+    return array;
+}
+
+static void ReadStrings(TJSONObject* obj, const String& name, std::vector<String>& values)
+{
+    if (TJSONArray* array = ReadArray(obj, name))
+    {
+        for (int i = 0; i < array->Count; i++)
+            values.push_back(array->Items[i]->Value());
+    }
+}
+
+static TJSONObject* WriteStringMap(const std::map<String, String>& values)
+{
+    TJSONObject* obj = new TJSONObject();
+    for (const auto& it : values)
+        obj->AddPair(it.first, it.second);
+    return obj;
+}
+
+static void ReadStringMap(TJSONObject* obj, const String& name, std::map<String, String>& values)
+{
+    if (TJSONObject* pairs = dynamic_cast<TJSONObject*>(obj->GetValue(name)))
+    {
+        for (int i = 0; i < pairs->Count; i++)
+            values[pairs->Pairs[i]->JsonString->Value()] = pairs->Pairs[i]->JsonValue->Value();
+    }
+}
+
+static TJSONArray* WriteRegistryChanges(const std::vector<TRegistryChangeRecord>& records)
+{
+    TJSONArray* changes = new TJSONArray();
+    for (const auto& change : records)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"op", ChangeKindToString(change.Kind));
+        obj->AddPair(L"key", change.Key);
+        obj->AddPair(L"name", change.Name);
+        obj->AddPair(L"data", change.Data);
+        changes->AddElement(obj);
+    }
+    return changes;
+}
+
+static bool ReadRegistryChanges(TJSONObject* root, std::vector<TRegistryChangeRecord>& records)
+{
+    if (TJSONArray* changes = ReadArray(root, L"registryChanges"))
+    {
+        for (int i = 0; i < changes->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(changes->Items[i]);
+            if (!obj)
+                return false;
+
+            TRegistryChangeRecord change;
+            change.Kind = ChangeKindFromString(ReadString(obj, L"op"));
+            change.Key = ReadString(obj, L"key");
+            change.Name = ReadString(obj, L"name");
+            change.Data = ReadString(obj, L"data");
+            records.push_back(change);
+        }
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// TInstallPlan implementation
+//---------------------------------------------------------------------------
+String TInstallPlan::ToJSON() const
+{
+    std::unique_ptr<TJSONObject> root(new TJSONObject());
+
+    root->AddPair(L"formatVersion", new TJSONNumber(FormatVersion));
+    root->AddPair(L"ideName", IDEName);
+    root->AddPair(L"bdsVersion", BDSVersion);
+    root->AddPair(L"registryKey", RegistryKey);
+    root->AddPair(L"installFileDir", InstallFileDir);
+    if (!SourceArchive.IsEmpty())
+        root->AddPair(L"sourceArchive", SourceArchive);
+    root->AddPair(L"dxBuildNumber", new TJSONNumber((__int64)DxBuildNumber));
+    root->AddPair(L"cleanupCompiledFiles", new TJSONBool(CleanupCompiledFiles));
+
+    root->AddPair(L"directories", WriteStrings(Directories));
+
+    TJSONArray* copies = new TJSONArray();
+    for (const auto& item : Copies)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"source", item.Source);
+        obj->AddPair(L"dest", item.Dest);
+        obj->AddPair(L"component", item.ComponentName);
+        copies->AddElement(obj);
+    }
+    root->AddPair(L"copies", copies);
+
+    TJSONArray* jobs = new TJSONArray();
+    for (const auto& job : CompileJobs)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"id", new TJSONNumber(job.Id));
+        obj->AddPair(L"package", job.PackageName);
+        obj->AddPair(L"component", job.ComponentName);
+        obj->AddPair(L"platform", PlatformToString(job.Platform));
+        obj->AddPair(L"required", new TJSONBool(job.Required));
+        obj->AddPair(L"compiler", job.Compiler);
+        obj->AddPair(L"commandLine", job.CommandLine);
+        obj->AddPair(L"workDir", job.WorkDir);
+        obj->AddPair(L"bplOutputDir", job.BPLOutputDir);
+        obj->AddPair(L"dcpOutputDir", job.DCPOutputDir);
+        obj->AddPair(L"unitOutputDir", job.UnitOutputDir);
+        obj->AddPair(L"copyBplToLibrary", new TJSONBool(job.CopyBplToLibrary));
+        obj->AddPair(L"reusable", new TJSONBool(job.Reusable));
+
+        TJSONArray* deps = new TJSONArray();
+        for (int dep : job.DependsOn)
+            deps->AddElement(new TJSONNumber(dep));
+        obj->AddPair(L"dependsOn", deps);
+
+        jobs->AddElement(obj);
+    }
+    root->AddPair(L"compileJobs", jobs);
+
+    TJSONArray* skipped = new TJSONArray();
+    for (const auto& skip : Skipped)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"package", skip.PackageName);
+        obj->AddPair(L"platform", PlatformToString(skip.Platform));
+        obj->AddPair(L"reason", skip.Reason);
+        obj->AddPair(L"unchanged", new TJSONBool(skip.Unchanged));
+        skipped->AddElement(obj);
+    }
+    root->AddPair(L"skipped", skipped);
+
+    TJSONArray* registrations = new TJSONArray();
+    for (const auto& reg : Registrations)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"bplPath", reg.BplPath);
+        obj->AddPair(L"description", reg.Description);
+        obj->AddPair(L"is64BitIDE", new TJSONBool(reg.Is64BitIDE));
+        registrations->AddElement(obj);
+    }
+    root->AddPair(L"registrations", registrations);
+
+    root->AddPair(L"registryChanges", WriteRegistryChanges(RegistryChanges));
+
+    return root->Format(2);
+}
+
+bool TInstallPlan::FromJSON(const String& json, TInstallPlan& plan)
+{
+    std::unique_ptr<TJSONValue> parsed(TJSONObject::ParseJSONValue(json));
+    TJSONObject* root = dynamic_cast<TJSONObject*>(parsed.get());
+    if (!root || ReadInt(root, L"formatVersion") != FormatVersion)
+        return false;
+
+    TInstallPlan result;
+    result.IDEName = ReadString(root, L"ideName");
+    result.BDSVersion = ReadString(root, L"bdsVersion");
+    result.RegistryKey = ReadString(root, L"registryKey");
+    result.InstallFileDir = ReadString(root, L"installFileDir");
+    result.SourceArchive = ReadString(root, L"sourceArchive");
+    result.DxBuildNumber = (unsigned int)ReadInt(root, L"dxBuildNumber");
+    result.CleanupCompiledFiles = ReadBool(root, L"cleanupCompiledFiles");
+
+    ReadStrings(root, L"directories", result.Directories);
+
+    if (TJSONArray* copies = ReadArray(root, L"copies"))
+    {
+        for (int i = 0; i < copies->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(copies->Items[i]);
+            if (!obj)
+                return false;
+
+            TPlanCopyItem item;
+            item.Source = ReadString(obj, L"source");
+            item.Dest = ReadString(obj, L"dest");
+            item.ComponentName = ReadString(obj, L"component");
+            result.Copies.push_back(item);
+        }
+    }
+
+    if (TJSONArray* jobs = ReadArray(root, L"compileJobs"))
+    {
+        for (int i = 0; i < jobs->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(jobs->Items[i]);
+            if (!obj)
+                return false;
+
+            TPlanCompileJob job;
+            job.Id = ReadInt(obj, L"id");
+            job.PackageName = ReadString(obj, L"package");
+            job.ComponentName = ReadString(obj, L"component");
+            job.Platform = PlatformFromString(ReadString(obj, L"platform"));
+            job.Required = ReadBool(obj, L"required");
+            job.Compiler = ReadString(obj, L"compiler");
+            job.CommandLine = ReadString(obj, L"commandLine");
+            job.WorkDir = ReadString(obj, L"workDir");
+            job.BPLOutputDir = ReadString(obj, L"bplOutputDir");
+            job.DCPOutputDir = ReadString(obj, L"dcpOutputDir");
+            job.UnitOutputDir = ReadString(obj, L"unitOutputDir");
+            job.CopyBplToLibrary = ReadBool(obj, L"copyBplToLibrary");
+            job.Reusable = ReadBool(obj, L"reusable");
+
+            if (TJSONArray* deps = ReadArray(obj, L"dependsOn"))
+            {
+                for (int d = 0; d < deps->Count; d++)
+                    job.DependsOn.push_back(StrToIntDef(deps->Items[d]->Value(), -1));
+            }
+
+            // Ids are indices; dependencies must point to earlier jobs
+            if (job.Id != (int)result.CompileJobs.size())
+                return false;
+            for (int dep : job.DependsOn)
+            {
+                if (dep < 0 || dep >= job.Id)
+                    return false;
+            }
+
+            result.CompileJobs.push_back(job);
+        }
+    }
+
+    if (TJSONArray* skipped = ReadArray(root, L"skipped"))
+    {
+        for (int i = 0; i < skipped->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(skipped->Items[i]);
+            if (!obj)
+                return false;
+
+            TPlanSkippedPackage skip;
+            skip.PackageName = ReadString(obj, L"package");
+            skip.Platform = PlatformFromString(ReadString(obj, L"platform"));
+            skip.Reason = ReadString(obj, L"reason");
+            skip.Unchanged = ReadBool(obj, L"unchanged");
+            result.Skipped.push_back(skip);
+        }
+    }
+
+    if (TJSONArray* registrations = ReadArray(root, L"registrations"))
+    {
+        for (int i = 0; i < registrations->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(registrations->Items[i]);
+            if (!obj)
+                return false;
+
+            TPlanRegistration reg;
+            reg.BplPath = ReadString(obj, L"bplPath");
+            reg.Description = ReadString(obj, L"description");
+            reg.Is64BitIDE = ReadBool(obj, L"is64BitIDE");
+            result.Registrations.push_back(reg);
+        }
+    }
+
+    if (!ReadRegistryChanges(root, result.RegistryChanges))
+        return false;
+
+    plan = result;
+    return true;
+}
+
+void TInstallPlan::SaveToFile(const String& fileName) const
+{
+    TFile::WriteAllText(fileName, ToJSON(), TEncoding::UTF8);
+}
+
+bool TInstallPlan::LoadFromFile(const String& fileName, TInstallPlan& plan)
+{
+    if (!FileExists(fileName))
+        return false;
+    return FromJSON(TFile::ReadAllText(fileName, TEncoding::UTF8), plan);
+}
+
+//---------------------------------------------------------------------------
+// TInstallManifest implementation
+//---------------------------------------------------------------------------
+String TInstallManifest::ToJSON() const
+{
+    std::unique_ptr<TJSONObject> root(new TJSONObject());
+
+    root->AddPair(L"formatVersion", new TJSONNumber(FormatVersion));
+    root->AddPair(L"ideName", IDEName);
+    root->AddPair(L"bdsVersion", BDSVersion);
+    root->AddPair(L"registryKey", RegistryKey);
+    root->AddPair(L"installFileDir", InstallFileDir);
+    root->AddPair(L"dxBuildNumber", new TJSONNumber((__int64)DxBuildNumber));
+    root->AddPair(L"installedAt", DateToISO8601(InstalledAt, false));
+    root->AddPair(L"ownedDirectories", WriteStrings(OwnedDirectories));
+    root->AddPair(L"files", WriteStrings(Files));
+    root->AddPair(L"registryChanges", WriteRegistryChanges(RegistryChanges));
+    root->AddPair(L"interfaces", WriteStringMap(Interfaces));
+
+    return root->Format(2);
+}
+
+bool TInstallManifest::FromJSON(const String& json, TInstallManifest& manifest)
+{
+    std::unique_ptr<TJSONValue> parsed(TJSONObject::ParseJSONValue(json));
+    TJSONObject* root = dynamic_cast<TJSONObject*>(parsed.get());
+    if (!root || ReadInt(root, L"formatVersion") != FormatVersion)
+        return false;
+
+    TInstallManifest result;
+    result.IDEName = ReadString(root, L"ideName");
+    result.BDSVersion = ReadString(root, L"bdsVersion");
+    result.RegistryKey = ReadString(root, L"registryKey");
+    result.InstallFileDir = ReadString(root, L"installFileDir");
+    result.DxBuildNumber = (unsigned int)ReadInt(root, L"dxBuildNumber");
+
+    TDateTime installedAt;
+    if (TryISO8601ToDate(ReadString(root, L"installedAt"), installedAt, false))
+        result.InstalledAt = installedAt;
+
+    ReadStrings(root, L"ownedDirectories", result.OwnedDirectories);
+    ReadStrings(root, L"files", result.Files);
+    if (!ReadRegistryChanges(root, result.RegistryChanges))
+        return false;
+    ReadStringMap(root, L"interfaces", result.Interfaces);   // Missing in older manifests
+
+    manifest = result;
+    return true;
+}
+
+void TInstallManifest::SaveToFile(const String& fileName) const
+{
+    ForceDirectories(ExtractFileDir(fileName));
+    TFile::WriteAllText(fileName, ToJSON(), TEncoding::UTF8);
+}
+
+bool TInstallManifest::LoadFromFile(const String& fileName, TInstallManifest& manifest)
+{
+    if (fileName.IsEmpty() || !FileExists(fileName))
+        return false;
+    return FromJSON(TFile::ReadAllText(fileName, TEncoding::UTF8), manifest);
+}
+
+String TInstallManifest::GetFileName(const String& installFileDir, const TIDEInfoPtr& ide)
+{
+    if (installFileDir.IsEmpty() || !ide)
+        return L"";
+    return TPath::Combine(installFileDir, L"Library\\" + ide->GetPackageSuffix() + L".manifest");
+}
+
+} // namespace DxCore
@@ -0,0 +1,163 @@
+//---------------------------------------------------------------------------
+// InstallPlan - Complete description of one IDE installation
+//
+// TInstaller::BuildInstallPlan() works out everything an install will do
+// (options, the 18.2+ fix, third-party/platform skips, output paths) and
+// records it here. TInstaller::ExecuteInstallPlan() then only runs it.
+// A plan is plain data and round-trips through JSON, so plans can be
+// diffed between machines or produced ahead of time.
+//
+// After a plan ran, TInstallManifest records what it actually left behind
+// (files, directories, registry values) so uninstall can undo exactly that.
+//---------------------------------------------------------------------------
+#ifndef InstallPlanH
+#define InstallPlanH
+
+#include <System.hpp>
+#include <System.Classes.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <memory>
+#include <map>
+#include "IDEDetector.h"
+#include "RegistryChangeSet.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// File copy (one file; later entries with the same destination win)
+//---------------------------------------------------------------------------
+struct TPlanCopyItem
+{
+    String Source;
+    String Dest;
+    String ComponentName;     // For progress reporting
+};
+
+//---------------------------------------------------------------------------
+// Compiler invocation
+//---------------------------------------------------------------------------
+struct TPlanCompileJob
+{
+    int Id;                   // Index in TInstallPlan::CompileJobs
+    String PackageName;
+    String ComponentName;
+    TIDEPlatform Platform;
+    bool Required;
+    String Compiler;          // Full path to dcc32/dcc64
+    String CommandLine;       // Arguments, as passed to the compiler
+    String WorkDir;
+    String BPLOutputDir;
+    String DCPOutputDir;
+    String UnitOutputDir;
+    bool CopyBplToLibrary;    // dxSkinXxx.bpl also goes to the library dir
+    bool Reusable;            // Rebuilt only for 'requires' - may keep the previous build
+    std::vector<int> DependsOn;   // Jobs building packages from 'requires'
+
+    TPlanCompileJob() : Id(0), Platform(TIDEPlatform::Win32), Required(true), CopyBplToLibrary(false), Reusable(false) {}
+};
+
+//---------------------------------------------------------------------------
+// Package that is not compiled for a platform, and why
+//---------------------------------------------------------------------------
+struct TPlanSkippedPackage
+{
+    String PackageName;
+    TIDEPlatform Platform;
+    String Reason;
+    bool Unchanged;           // Incremental install: the previous build is kept
+
+    TPlanSkippedPackage() : Platform(TIDEPlatform::Win32), Unchanged(false) {}
+};
+
+//---------------------------------------------------------------------------
+// Design-time package registration (applied only if the BPL was built)
+//---------------------------------------------------------------------------
+struct TPlanRegistration
+{
+    String BplPath;
+    String Description;
+    bool Is64BitIDE;
+
+    TPlanRegistration() : Is64BitIDE(false) {}
+};
+
+//---------------------------------------------------------------------------
+// Install plan
+//---------------------------------------------------------------------------
+struct TInstallPlan
+{
+    static const int FormatVersion = 1;
+
+    // Target
+    String IDEName;
+    String BDSVersion;
+    String RegistryKey;
+    String InstallFileDir;
+    String SourceArchive;     // Zip the sources come from (empty: InstallFileDir)
+    unsigned int DxBuildNumber;
+
+    // Steps, in execution order
+    bool CleanupCompiledFiles;                  // Delete previous build output first
+    std::vector<String> Directories;            // Created before copying/compiling
+    std::vector<TPlanCopyItem> Copies;
+    std::vector<TPlanCompileJob> CompileJobs;
+    std::vector<TPlanSkippedPackage> Skipped;
+    std::vector<TPlanRegistration> Registrations;
+    std::vector<TRegistryChangeRecord> RegistryChanges;
+
+    TInstallPlan() : DxBuildNumber(0), CleanupCompiledFiles(true) {}
+
+    String ToJSON() const;
+    // Returns false (and leaves plan unchanged) if json is not a valid plan
+    static bool FromJSON(const String& json, TInstallPlan& plan);
+
+    void SaveToFile(const String& fileName) const;
+    static bool LoadFromFile(const String& fileName, TInstallPlan& plan);
+};
+
+typedef std::shared_ptr<TInstallPlan> TInstallPlanPtr;
+
+//---------------------------------------------------------------------------
+// Install manifest - written after a successful install, one per IDE
+//---------------------------------------------------------------------------
+struct TInstallManifest
+{
+    static const int FormatVersion = 1;
+
+    // Source of the install
+    String IDEName;
+    String BDSVersion;
+    String RegistryKey;
+    String InstallFileDir;
+    unsigned int DxBuildNumber;
+    TDateTime InstalledAt;
+
+    // What the install created
+    std::vector<String> OwnedDirectories;       // Only ours (Library\{suffix}); deleted recursively
+    std::vector<String> Files;                  // Ours in shared dirs (BPL, DCP, HPP)
+    std::vector<TRegistryChangeRecord> RegistryChanges;   // As applied
+
+    // Interface fingerprints of the built packages (TInterfaceHash), for
+    // the early cutoff of the next incremental install.
+    // Key = lower-case "<platform>\<package>".
+    std::map<String, String> Interfaces;
+
+    TInstallManifest() : DxBuildNumber(0), InstalledAt(0) {}
+
+    String ToJSON() const;
+    static bool FromJSON(const String& json, TInstallManifest& manifest);
+
+    void SaveToFile(const String& fileName) const;
+    static bool LoadFromFile(const String& fileName, TInstallManifest& manifest);
+
+    // <installFileDir>\Library\{suffix}.manifest - outside the owned directory
+    static String GetFileName(const String& installFileDir, const TIDEInfoPtr& ide);
+};
+
+typedef std::shared_ptr<TInstallManifest> TInstallManifestPtr;
+
+} // namespace DxCore
+
+#endif
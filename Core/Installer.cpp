@@ -3,29 +3,52 @@
 //---------------------------------------------------------------------------
 #pragma hdrstop
 #include "Installer.h"
+#include "CompileScheduler.h"
+#include "Prefetcher.h"
+#include "InterfaceHash.h"
+#include "BinaryPack.h"
+#include "TaskPool.h"
 #include <Registry.hpp>
 #include <IOUtils.hpp>
-#include <Vcl.Forms.hpp>
 #include <DateUtils.hpp>
 #include <System.Threading.hpp>
+#include <System.Diagnostics.hpp>
 #include <fstream>
 #include <vector>
+#include <unordered_map>
+#include <unordered_set>
+#include <algorithm>
 
 namespace DxCore
 {
 
 const wchar_t* const TInstaller::DX_ENV_VARIABLE = L"DXVCL";
 
+// RAM build mode: estimated unit output (.dcu, .hpp) per byte of .pas
+// source and platform, and the memory left to the compilers
+static const double SCRATCH_BYTES_PER_SOURCE_BYTE = 1.5;
+static const __int64 SCRATCH_MEMORY_RESERVE = 1024LL * 1024 * 1024;
+static const __int64 SCRATCH_MEMORY_PER_COMPILER = 256LL * 1024 * 1024;
+
+// How far compile inputs are read ahead of the jobs that have started
+static const __int64 PREFETCH_WINDOW_BYTES = 64LL * 1024 * 1024;
+
+// Staging copy rate in background mode when none is set - well below what
+// a disk sustains, so other programs' I/O keeps priority
+static const __int64 BACKGROUND_COPY_RATE = 32 * 1024 * 1024;
+
 // Log file - created next to the executable with timestamp name
 static std::wofstream g_LogFile;
 static String g_LogFileName;
+static std::recursive_mutex g_LogLock;   // Concurrent IDE pipelines log from several threads
 
 static String GetLogFileName()
 {
+    std::lock_guard<std::recursive_mutex> lock(g_LogLock);
     if (g_LogFileName.IsEmpty())
     {
         // Get executable directory
-        String exePath = ExtractFilePath(Application->ExeName);
+        String exePath = ExtractFilePath(ParamStr(0));
         
         // Create filename with timestamp: DD_MM_YYYY_HH_MM.log
         TDateTime now = Now();
@@ -41,6 +64,7 @@ static String GetLogFileName()
 
 static void LogToFile(const String& msg)
 {
+    std::lock_guard<std::recursive_mutex> lock(g_LogLock);
     if (!g_LogFile.is_open())
     {
         String fileName = GetLogFileName();
@@ -63,35 +87,138 @@ static void LogToFile(const String& msg)
 // TInstaller implementation
 //---------------------------------------------------------------------------
 TInstaller::TInstaller()
-    : FState(TInstallerState::Normal),
+    : FInitializing(false),
+      FDxBuildNumber(0),
+      FState(TInstallerState::Normal),
+      FComponentsGeneration(0),
+      FComponentTasks(0),
+      FEarlyCutoff(true),
+      FRegistryDryRun(false),
+      FConcurrentIDEs(false),
+      FCopyRateLimit(0),
       FOnProgress(nullptr),
       FOnProgressState(nullptr)
 {
     FIDEDetector = std::make_unique<TIDEDetector>();
     FProfile = std::make_unique<TProfileManager>();
     FCompiler = std::make_unique<TPackageCompiler>();
+    FFileIndex = std::make_unique<TFileIndex>();
     
     LogToFile(L"=== DxAutoInstaller Started (BUILD: 2025-12-24 v16 - mkexp for Win64x) ===");
 }
 
 TInstaller::~TInstaller()
 {
+    WaitReady();
+    DropComponentLists();
 }
 
 void TInstaller::Initialize()
 {
-    FIDEDetector->Detect();
-    FProfile->LoadFromResource();
+    TStopwatch total = TStopwatch::StartNew();
+    TStartupTimings timings;
+    
+    // The registry scan and the profile load (which may export Profile.ini
+    // on first run) are independent
+    {
+        TTaskGroup group;
+        group.Run([this, &timings]() {
+            TStopwatch watch = TStopwatch::StartNew();
+            FIDEDetector->Detect();
+            timings.DetectIDEs = watch.Elapsed.TotalMilliseconds;
+        });
+    
+        TStopwatch watch = TStopwatch::StartNew();
+        FProfile->LoadFromResource();
+        ApplyPackageRules();
+        timings.LoadProfile = watch.Elapsed.TotalMilliseconds;
+        group.Wait();
+    }
     
     // Setup compiler output callback
     FCompiler->SetOnOutput([this](const String& line) {
         this->UpdateProgressState(line);
     });
     
-    for (int i = 0; i < FIDEDetector->GetCount(); i++)
+    // One registry key per IDE, read side by side
+    TStopwatch thirdParty = TStopwatch::StartNew();
+    int count = FIDEDetector->GetCount();
+    std::vector<TThirdPartyComponentSet> found(count);
+    {
+        TTaskGroup group;
+        for (int i = 0; i < count; i++)
+        {
+            group.Run([this, &found, i]() {
+                found[i] = DetectThirdPartyComponents(FIDEDetector->GetIDE(i));
+            });
+        }
+        group.Wait();
+    }
+    for (int i = 0; i < count; i++)
+        FThirdPartyComponents[FIDEDetector->GetIDE(i)->BDSVersion] = found[i];
+    timings.ThirdParty = thirdParty.Elapsed.TotalMilliseconds;
+    
+    timings.Total = total.Elapsed.TotalMilliseconds;
+    FStartupTimings = timings;
+    LogToFile(L"Startup: " + String(count) + L" IDEs, detect " + FormatFloat(L"0.0", timings.DetectIDEs) +
+              L" ms, profile " + FormatFloat(L"0.0", timings.LoadProfile) +
+              L" ms, third-party " + FormatFloat(L"0.0", timings.ThirdParty) +
+              L" ms, total " + FormatFloat(L"0.0", timings.Total) + L" ms");
+    
+    std::lock_guard<std::mutex> lock(FReadyLock);
+    FReady.store(true);
+    FReadyChanged.notify_all();
+}
+
+void TInstaller::ApplyPackageRules()
+{
+    // Profile rules first, so they can override the built-in ones
+    TPackageRuleList rules = TPackageClassifier::WithBuiltInRules(FProfile->GetPackageRules());
+    TPackageClassifier::SetShared(std::make_shared<TPackageClassifier>(rules));
+    
+    if (!FProfile->GetPackageRules().empty())
+        LogToFile(L"Package rules: " + String((int)FProfile->GetPackageRules().size()) + L" from profile");
+}
+
+void TInstaller::InitializeAsync(TCompletionCallback onReady)
+{
     {
-        DetectThirdPartyComponents(FIDEDetector->GetIDE(i));
+        std::lock_guard<std::mutex> lock(FReadyLock);
+        FInitializing = true;
     }
+    
+    TTask::Run([this, onReady]() {
+        bool success = true;
+        String errorMessage;
+        try
+        {
+            Initialize();
+        }
+        catch (Exception& e)
+        {
+            LogToFile(L"Initialize EXCEPTION: " + e.Message);
+            success = false;
+            errorMessage = e.Message;
+        }
+    
+        {
+            std::lock_guard<std::mutex> lock(FReadyLock);
+            FInitializing = false;
+            FReadyChanged.notify_all();
+        }
+    
+        TThread::Queue(nullptr, [onReady, success, errorMessage]() {
+            if (onReady)
+                onReady(success, errorMessage);
+        });
+    });
+}
+
+void TInstaller::WaitReady()
+{
+    // Returns at once if Initialize never started or has failed
+    std::unique_lock<std::mutex> lock(FReadyLock);
+    FReadyChanged.wait(lock, [this]() { return FReady.load() || !FInitializing; });
 }
 
 void TInstaller::OnCompilerOutput(const String& line)
@@ -106,54 +233,95 @@ String TInstaller::FindPackageFile(const String& packagesDir,
                                     const String& pkgBaseName, 
                                     const String& ideSuffix)
 {
-    if (!DirectoryExists(packagesDir))
-        return L"";
-    
-    // DevExpress package naming conventions:
-    // New style (25.1+): dxCore370.dpk (suffix = "370" for RS13)
-    // Old style: dxCoreRS37.dpk (RS + major version)
-    
-    // Try new style first: pkgBaseName + ideSuffix + .dpk
-    // For RS12: suffix = "290", for RS13: suffix = "370"
-    String exactPath = TPath::Combine(packagesDir, pkgBaseName + ideSuffix + L".dpk");
-    if (FileExists(exactPath))
-        return exactPath;
-    
-    // Try with "RS" prefix for older naming convention
-    // RS12 = RS29, RS13 = RS37
-    String rsNum = ideSuffix.SubString(1, ideSuffix.Length() - 1);  // "290" -> "29", "370" -> "37"
-    String rsPath = TPath::Combine(packagesDir, pkgBaseName + L"RS" + rsNum + L".dpk");
-    if (FileExists(rsPath))
-        return rsPath;
-    
-    // Try with "D" suffix for Delphi-only packages (older convention)
-    // dxCoreD29.dpk
-    String dPath = TPath::Combine(packagesDir, pkgBaseName + L"D" + rsNum + L".dpk");
-    if (FileExists(dPath))
-        return dPath;
-    
-    // Try plain name for packages using {$LIBSUFFIX AUTO} (e.g., SynEditDR.dpk)
-    String plainPath = TPath::Combine(packagesDir, pkgBaseName + L".dpk");
-    if (FileExists(plainPath))
-        return plainPath;
-    
-    // No match found
-    return L"";
+    // Served from the in-memory index - no file system probes
+    return FFileIndex->FindPackageFile(packagesDir, pkgBaseName, ideSuffix);
 }
 
 void TInstaller::SetInstallFileDir(const String& value)
 {
+    DropComponentLists();
+    FSourceArchive.reset();
     DoSetInstallFileDir(value);
 }
 
+void TInstaller::SetInstallArchive(const String& archiveFile, const String& installFileDir)
+{
+    LogToFile(L"Source archive: [" + archiveFile + L"] -> [" + installFileDir + L"]");
+    
+    std::unique_ptr<TSourceArchive> archive(new TSourceArchive());
+    archive->Open(archiveFile, ExcludeTrailingPathDelimiter(installFileDir));
+    DropComponentLists();
+    FSourceArchive = std::move(archive);
+    DoSetInstallFileDir(installFileDir);
+}
+
+String TInstaller::GetInstallArchive() const
+{
+    return FSourceArchive ? FSourceArchive->GetArchiveFile() : String();
+}
+
+void TInstaller::SetBackgroundMode(bool value)
+{
+    FProcessPriority.Background = value;
+    ApplyBackgroundMode();
+}
+
+void TInstaller::SetCompilerAffinity(DWORD_PTR mask)
+{
+    FProcessPriority.AffinityMask = mask;
+    ApplyBackgroundMode();
+}
+
+void TInstaller::SetCopyRateLimit(__int64 bytesPerSecond)
+{
+    FCopyRateLimit = std::max<__int64>(bytesPerSecond, 0);
+    ApplyBackgroundMode();
+}
+
+void TInstaller::ApplyBackgroundMode()
+{
+    FCompiler->SetPriority(FProcessPriority);
+    
+    __int64 rate = FCopyRateLimit;
+    if (rate == 0 && FProcessPriority.Background)
+        rate = BACKGROUND_COPY_RATE;
+    TIOThrottle::Shared().SetRate(rate);
+}
+
 void TInstaller::DoSetInstallFileDir(const String& value)
 {
     FInstallFileDir = value;
     
+    // One recursive scan of the install tree (of a source archive: its
+    // central directory); every later lookup (package files, component
+    // dirs, new package search) uses it. Component lists are not built
+    // here - GetComponents builds each one on first use.
+    TDateTime scanStart = Now();
+    if (FSourceArchive)
+        FFileIndex->Build(value, FSourceArchive->GetListing());
+    else
+        FFileIndex->Build(value);
+    LogToFile(L"File index: " + String(FFileIndex->GetFileCount()) + L" files in " +
+              String(MilliSecondsBetween(Now(), scanStart)) + L" ms");
+    
+    // dxCore.pas is only read when the index says it exists
+    FDxBuildNumber = 0;
+    String dxCoreFile = TPath::Combine(value, L"ExpressCore Library\\Sources\\dxCore.pas");
+    if (FFileIndex->FileExists(dxCoreFile))
+    {
+        if (FSourceArchive)
+        {
+            std::unique_ptr<TStringList> lines(new TStringList());
+            if (FSourceArchive->ReadLines(dxCoreFile, lines.get()))
+                FDxBuildNumber = TProfileManager::GetDxBuildNumber(lines.get());
+        }
+        else
+            FDxBuildNumber = TProfileManager::GetDxBuildNumber(value);
+    }
+    
     for (int i = 0; i < FIDEDetector->GetCount(); i++)
     {
         auto ide = FIDEDetector->GetIDE(i);
-        BuildComponentList(ide);
         
         // Set default options based on IDE capabilities
         TInstallOptionSet opts;
@@ -181,7 +349,7 @@ void TInstaller::DoSetInstallFileDir(const String& value)
     }
 }
 
-void TInstaller::DetectThirdPartyComponents(const TIDEInfoPtr& ide)
+TThirdPartyComponentSet TInstaller::DetectThirdPartyComponents(const TIDEInfoPtr& ide)
 {
     TThirdPartyComponentSet components;
     
@@ -195,29 +363,34 @@ void TInstaller::DetectThirdPartyComponents(const TIDEInfoPtr& ide)
         std::unique_ptr<TStringList> values(new TStringList());
         reg->GetValueNames(values.get());
         
+        TPackageClassifierPtr classifier = TPackageClassifier::GetShared();
         for (int i = 0; i < values->Count; i++)
         {
-            String fileName = values->Strings[i].LowerCase();
-            
-            if (fileName.Pos(L"dclib") > 0)
-                components.insert(TThirdPartyComponent::IBX);
-            else if (fileName.Pos(L"dcltee") > 0)
-                components.insert(TThirdPartyComponent::TeeChart);
-            else if (fileName.Pos(L"dclfiredac") > 0 || fileName.Pos(L"anydac_") > 0)
-                components.insert(TThirdPartyComponent::FireDAC);
-            else if (fileName.Pos(L"dclbde") > 0)
-                components.insert(TThirdPartyComponent::BDE);
+            TThirdPartyComponent component;
+            if (classifier->GetInstalledComponent(values->Strings[i], component))
+                components.insert(component);
         }
         
         reg->CloseKey();
     }
     
-    FThirdPartyComponents[ide->BDSVersion] = components;
+    return components;
 }
 
-void TInstaller::BuildComponentList(const TIDEInfoPtr& ide)
+TPackagePtr TInstaller::LoadPackage(const String& fullPath)
+{
+    // Package files of an archive are parsed without extracting them
+    if (FSourceArchive)
+    {
+        std::unique_ptr<TStringList> dpk(new TStringList());
+        if (FSourceArchive->ReadLines(fullPath, dpk.get()))
+            return std::make_shared<TPackage>(fullPath, dpk.get());
+    }
+    return std::make_shared<TPackage>(fullPath, true);
+}
+
+void TInstaller::BuildComponentList(const TIDEInfoPtr& ide, TComponentList& list)
 {
-    TComponentList& list = FComponents[ide->BDSVersion];
     list.clear();
 
     String ideSuffix = TProfileManager::GetIDEVersionNumberStr(ide);
@@ -232,28 +405,26 @@ void TInstaller::BuildComponentList(const TIDEInfoPtr& ide)
             FInstallFileDir, profile->ComponentName);
 
         // Create required packages
-        for (int i = 0; i < profile->RequiredPackages->Count; i++)
+        for (const auto& pkgBaseName : profile->RequiredPackages)
         {
-            String pkgBaseName = profile->RequiredPackages->Strings[i];
             String fullPath = FindPackageFile(packagesDir, pkgBaseName, ideSuffix);
 
-            if (!fullPath.IsEmpty() && FileExists(fullPath))
+            if (!fullPath.IsEmpty())
             {
-                auto pkg = std::make_shared<TPackage>(fullPath);
+                auto pkg = LoadPackage(fullPath);
                 pkg->Required = true;
                 component->Packages.push_back(pkg);
             }
         }
 
         // Create optional packages
-        for (int i = 0; i < profile->OptionalPackages->Count; i++)
+        for (const auto& pkgBaseName : profile->OptionalPackages)
         {
-            String pkgBaseName = profile->OptionalPackages->Strings[i];
             String fullPath = FindPackageFile(packagesDir, pkgBaseName, ideSuffix);
 
-            if (!fullPath.IsEmpty() && FileExists(fullPath))
+            if (!fullPath.IsEmpty())
             {
-                auto pkg = std::make_shared<TPackage>(fullPath);
+                auto pkg = LoadPackage(fullPath);
                 pkg->Required = false;
                 component->Packages.push_back(pkg);
             }
@@ -261,7 +432,7 @@ void TInstaller::BuildComponentList(const TIDEInfoPtr& ide)
 
         // Set component state
         String compDir = TProfileManager::GetComponentDir(FInstallFileDir, profile->ComponentName);
-        if (!DirectoryExists(compDir))
+        if (!FFileIndex->DirectoryExists(compDir))
             component->State = TComponentState::NotFound;
         else if (component->GetExistsPackageCount() == 0)
             component->State = TComponentState::NotSupported;
@@ -328,53 +499,162 @@ void TInstaller::BuildComponentList(const TIDEInfoPtr& ide)
         LogToFile(L"WARNING: Auto-dependency resolution reached max iterations!");
     }
 
-    // Phase 4: Build dependencies between components
-    for (auto& comp : list)
+    // Phase 4: Build dependencies between components. Package names
+    // compare case-insensitively, as with TStringList::IndexOf.
+    std::unordered_map<String, std::vector<int>, TStringHash> packageOwners;
+    for (int c = 0; c < (int)list.size(); c++)
     {
-        for (auto& pkg : comp->Packages)
+        for (auto& pkg : list[c]->Packages)
+            packageOwners[pkg->Name.LowerCase()].push_back(c);
+    }
+
+    for (int c = 0; c < (int)list.size(); c++)
+    {
+        TBitSet parents((int)list.size());
+        for (auto& pkg : list[c]->Packages)
         {
-            for (auto& otherComp : list)
+            if (!pkg->Required)
+                continue;
+
+            for (int i = 0; i < pkg->Requires->Count; i++)
             {
-                if (otherComp.get() == comp.get())
+                auto it = packageOwners.find(pkg->Requires->Strings[i].LowerCase());
+                if (it == packageOwners.end())
                     continue;
-
-                for (auto& otherPkg : otherComp->Packages)
+                for (int owner : it->second)
                 {
-                    if (pkg->Requires->IndexOf(otherPkg->Name) >= 0)
-                    {
-                        if (pkg->Required)
-                        {
-                            auto it = std::find(comp->ParentComponents.begin(),
-                                               comp->ParentComponents.end(),
-                                               otherComp.get());
-                            if (it == comp->ParentComponents.end())
-                            {
-                                comp->ParentComponents.push_back(otherComp.get());
-                                otherComp->SubComponents.push_back(comp.get());
-                            }
-                        }
-                        break;
-                    }
+                    if (owner != c)
+                        parents.Add(owner);
                 }
             }
         }
+
+        parents.ForEach([&](int parent) {
+            list[c]->ParentComponents.push_back(list[parent].get());
+            list[parent]->SubComponents.push_back(list[c].get());
+        });
     }
 
-    // Phase 5: Update missing state
-    for (auto& comp : list)
+    // Phase 5: Missing state (transitively) and the dependency closures
+    TComponentGraph::Attach(list);
+}
+
+//---------------------------------------------------------------------------
+// Component lists - built on demand, cached per source directory
+//---------------------------------------------------------------------------
+const TComponentList* TInstaller::EnsureComponentList(const TIDEInfoPtr& ide, int generation)
+{
+    String key = ide->BDSVersion;
+    std::unique_lock<std::mutex> lock(FComponentsLock);
+    if (generation < 0)
+        generation = FComponentsGeneration;
+    
+    // Another thread is building this list - wait instead of parsing twice
+    FComponentsChanged.wait(lock, [&]() { return FComponentsBuilding.count(key) == 0; });
+    if (generation != FComponentsGeneration || FInstallFileDir.IsEmpty())
+        return nullptr;
+    
+    auto it = FComponents.find(key);
+    if (it != FComponents.end())
+        return &it->second;
+    
+    FComponentsBuilding.insert(key);
+    lock.unlock();
+    
+    TComponentList list;
+    String error;
+    try
     {
-        if (comp->State == TComponentState::Install && comp->IsMissingDependents())
-            comp->State = TComponentState::Missing;
+        TDateTime start = Now();
+        BuildComponentList(ide, list);
+        LogToFile(L"Component list for " + ide->Name + L": " + String((int)list.size()) +
+                  L" components in " + String(MilliSecondsBetween(Now(), start)) + L" ms");
     }
+    catch (Exception& e)
+    {
+        error = e.Message;
+    }
+    
+    lock.lock();
+    FComponentsBuilding.erase(key);
+    FComponentsChanged.notify_all();
+    if (!error.IsEmpty())
+        throw Exception(error);
+    
+    // The source directory changed meanwhile - the list is stale
+    if (generation != FComponentsGeneration)
+        return nullptr;
+    return &FComponents.insert(std::make_pair(key, std::move(list))).first->second;
+}
+
+void TInstaller::DropComponentLists()
+{
+    // Background builds read the file index and the source archive, so
+    // they have to finish before either is replaced; their lists are stale
+    std::unique_lock<std::mutex> lock(FComponentsLock);
+    FComponentsGeneration++;
+    FComponentsChanged.wait(lock, [this]() {
+        return FComponentsBuilding.empty() && FComponentTasks == 0;
+    });
+    FComponents.clear();
 }
 
-const TComponentList& TInstaller::GetComponents(const TIDEInfoPtr& ide) const
+const TComponentList& TInstaller::GetComponents(const TIDEInfoPtr& ide)
 {
     static TComponentList empty;
-    auto it = FComponents.find(ide->BDSVersion);
-    if (it != FComponents.end())
-        return it->second;
-    return empty;
+    const TComponentList* list = EnsureComponentList(ide, -1);
+    return list != nullptr ? *list : empty;
+}
+
+bool TInstaller::IsComponentListReady(const TIDEInfoPtr& ide)
+{
+    std::lock_guard<std::mutex> lock(FComponentsLock);
+    return FComponents.count(ide->BDSVersion) > 0;
+}
+
+void TInstaller::PrefetchComponentLists(TComponentListCallback onReady)
+{
+    int generation;
+    {
+        std::lock_guard<std::mutex> lock(FComponentsLock);
+        if (FInstallFileDir.IsEmpty())
+            return;
+        generation = FComponentsGeneration;
+    }
+    
+    // One task per IDE; GetComponents of the IDE the user picks meanwhile
+    // either finds the list or waits for its task
+    for (int i = 0; i < FIDEDetector->GetCount(); i++)
+    {
+        TIDEInfoPtr ide = FIDEDetector->GetIDE(i);
+        if (IsComponentListReady(ide))
+            continue;
+    
+        {
+            std::lock_guard<std::mutex> lock(FComponentsLock);
+            FComponentTasks++;
+        }
+    
+        TTask::Run([this, ide, generation, onReady]() {
+            try
+            {
+                if (EnsureComponentList(ide, generation) != nullptr && onReady)
+                {
+                    TThread::Queue(nullptr, [onReady, ide]() {
+                        onReady(ide);
+                    });
+                }
+            }
+            catch (Exception& e)
+            {
+                LogToFile(L"Component list for " + ide->Name + L" failed: " + e.Message);
+            }
+    
+            std::lock_guard<std::mutex> lock(FComponentsLock);
+            FComponentTasks--;
+            FComponentsChanged.notify_all();
+        });
+    }
 }
 
 TInstallOptionSet TInstaller::GetOptions(const TIDEInfoPtr& ide) const
@@ -401,6 +681,44 @@ void TInstaller::SetOptions(const TIDEInfoPtr& ide, const TInstallOptionSet& opt
     FOptions[ide->BDSVersion] = opts;
 }
 
+bool TInstaller::HasRebuildPackages(const TIDEInfoPtr& ide) const
+{
+    return FRebuildPackages.count(ide->BDSVersion) > 0;
+}
+
+std::set<String> TInstaller::GetRebuildPackages(const TIDEInfoPtr& ide) const
+{
+    auto it = FRebuildPackages.find(ide->BDSVersion);
+    if (it != FRebuildPackages.end())
+        return it->second;
+    return std::set<String>();
+}
+
+void TInstaller::SetRebuildPackages(const TIDEInfoPtr& ide, const std::set<String>& packages)
+{
+    SetRebuildPackages(ide, packages, packages);
+}
+
+void TInstaller::SetRebuildPackages(const TIDEInfoPtr& ide, const std::set<String>& packages,
+                                    const std::set<String>& changed)
+{
+    std::set<String> names;
+    for (const auto& name : packages)
+        names.insert(name.LowerCase());
+    FRebuildPackages[ide->BDSVersion] = names;
+    
+    names.clear();
+    for (const auto& name : changed)
+        names.insert(name.LowerCase());
+    FChangedPackages[ide->BDSVersion] = names;
+}
+
+void TInstaller::ClearRebuildPackages(const TIDEInfoPtr& ide)
+{
+    FRebuildPackages.erase(ide->BDSVersion);
+    FChangedPackages.erase(ide->BDSVersion);
+}
+
 TThirdPartyComponentSet TInstaller::GetThirdPartyComponents(const TIDEInfoPtr& ide) const
 {
     auto it = FThirdPartyComponents.find(ide->BDSVersion);
@@ -414,8 +732,15 @@ void TInstaller::SetThirdPartyComponents(const TIDEInfoPtr& ide, const TThirdPar
     FThirdPartyComponents[ide->BDSVersion] = components;
 }
 
+TInstallerState TInstaller::GetState() const
+{
+    std::lock_guard<std::recursive_mutex> lock(FStateLock);
+    return FState;
+}
+
 void TInstaller::SetState(TInstallerState value)
 {
+    std::lock_guard<std::recursive_mutex> lock(FStateLock);
     if (FState == value)
         return;
     if (value == TInstallerState::Stopped && FState == TInstallerState::Normal)
@@ -493,30 +818,12 @@ String TInstaller::GetInstallLibraryDir(const String& installFileDir,
     if (installFileDir.IsEmpty())
         return L"";
     
-    String result = installFileDir + L"\\Library";
-    
+    // Every platform has its own subfolder; memoized per IDE, since the
+    // plan asks for it once per package
     if (ide != nullptr)
-    {
-        String ideSuffix = TProfileManager::GetIDEVersionNumberStr(ide);
-        if (!ideSuffix.IsEmpty())
-            result = result + L"\\" + ideSuffix;
-        
-        // All platforms now have their own subfolder
-        switch (platform)
-        {
-            case TIDEPlatform::Win32:
-                result = result + L"\\" + PlatformNames::Win32;
-                break;
-            case TIDEPlatform::Win64:
-                result = result + L"\\" + PlatformNames::Win64;
-                break;
-            case TIDEPlatform::Win64Modern:
-                result = result + L"\\" + PlatformNames::Win64Modern;
-                break;
-        }
-    }
+        return ide->GetInstallLibraryDir(installFileDir, platform);
     
-    return result;
+    return installFileDir + L"\\Library";
 }
 
 String TInstaller::GetInstallSourcesDir(const String& installFileDir)
@@ -538,7 +845,10 @@ void TInstaller::CopySourceFilesFiltered(const String& sourceDir, const String&
 {
     LogToFile(L"CopySourceFilesFiltered: src=[" + sourceDir + L"] dst=[" + destDir + L"]");
     
-    if (!DirectoryExists(sourceDir))
+    // Sources inside the install tree are listed from the file index
+    bool indexed = FFileIndex->Contains(sourceDir);
+    bool exists = indexed ? FFileIndex->DirectoryExists(sourceDir) : DirectoryExists(sourceDir);
+    if (!exists)
     {
         LogToFile(L"  Source dir does not exist, skipping");
         return;
@@ -564,40 +874,50 @@ void TInstaller::CopySourceFilesFiltered(const String& sourceDir, const String&
         throw;
     }
     
-    TSearchRec sr;
-    if (FindFirst(sourceDir + L"\\*.*", faAnyFile, sr) == 0)
+    // Only the files directly in sourceDir - subdirectories like "Icon Library"
+    // remain in their original location and are added to browsing path instead
+    std::vector<TFileCopy> copies;
+    auto addCopy = [&](const String& name, const String& srcPath) {
+        // If extensions set is empty, copy all files
+        if (!extensions.empty() && extensions.count(ExtractFileExt(name).LowerCase()) == 0)
+            return;
+    
+        TFileCopy copy;
+        copy.Source = srcPath;
+        copy.Dest = destDir + L"\\" + name;
+        copies.push_back(copy);
+    };
+    
+    if (indexed)
     {
-        do
-        {
-            if (sr.Name == L"." || sr.Name == L"..")
-                continue;
-                
-            String srcPath = sourceDir + L"\\" + sr.Name;
-            String dstPath = destDir + L"\\" + sr.Name;
-            
-            // Skip directories - don't copy subdirectories like "Icon Library"
-            // They remain in original location and are added to browsing path instead
-            if ((sr.Attr & faDirectory) != 0)
-                continue;
-            
-            // If extensions set is empty, copy all files
-            // Otherwise, only copy files with matching extensions
-            if (extensions.empty())
-            {
-                CopyFile(srcPath.c_str(), dstPath.c_str(), FALSE);
-            }
-            else
-            {
-                String ext = ExtractFileExt(sr.Name).LowerCase();
-                if (extensions.count(ext) > 0)
-                {
-                    CopyFile(srcPath.c_str(), dstPath.c_str(), FALSE);
-                }
-            }
-        } while (FindNext(sr) == 0);
-        
-        FindClose(sr);
+        for (const auto* entry : FFileIndex->GetFiles(sourceDir))
+            addCopy(entry->Name, entry->FullPath);
+    }
+    else
+    {
+        std::mutex lock;
+        TFileOps::Walk(sourceDir, false, [&](const TWalkEntry& entry) {
+            std::lock_guard<std::mutex> guard(lock);
+            addCopy(entry.Name, entry.FullPath);
+        }, &FStopped);
+    }
+    
+    CopyInstallFiles(copies);
+    CheckStoppedState();
+}
+
+void TInstaller::CopyInstallFiles(const std::vector<TFileCopy>& copies)
+{
+    // Files of a source archive are extracted straight to their destination
+    if (!FSourceArchive)
+    {
+        TFileOps::CopyFiles(copies, &FStopped);
+        return;
     }
+    
+    std::vector<TFileCopy> others = FSourceArchive->Extract(copies, &FStopped);
+    if (!others.empty())
+        TFileOps::CopyFiles(others, &FStopped);
 }
 
 void TInstaller::DeleteCompiledFiles(const String& dir, const std::set<String>& extensions)
@@ -607,34 +927,17 @@ void TInstaller::DeleteCompiledFiles(const String& dir, const std::set<String>&
     if (!DirectoryExists(dir))
         return;
     
-    TSearchRec sr;
-    if (FindFirst(dir + L"\\*.*", faAnyFile, sr) == 0)
-    {
-        do
-        {
-            if (sr.Name == L"." || sr.Name == L"..")
-                continue;
-                
-            String fullPath = dir + L"\\" + sr.Name;
-            
-            if ((sr.Attr & faDirectory) != 0)
-            {
-                // Recurse into subdirectories
-                DeleteCompiledFiles(fullPath, extensions);
-            }
-            else
-            {
-                String ext = ExtractFileExt(sr.Name).LowerCase();
-                if (extensions.count(ext) > 0)
-                {
-                    LogToFile(L"  Deleting: " + fullPath);
-                    DeleteFile(fullPath.c_str());
-                }
-            }
-        } while (FindNext(sr) == 0);
-        
-        FindClose(sr);
-    }
+    // Subdirectories are walked as tasks of their own; files are deleted
+    // by whichever pool thread found them
+    TFileOps::Walk(dir, true, [&](const TWalkEntry& entry) {
+        if (extensions.count(ExtractFileExt(entry.Name).LowerCase()) == 0)
+            return;
+    
+        LogToFile(L"  Deleting: " + entry.FullPath);
+        DeleteFile(entry.FullPath.c_str());
+    }, &FStopped);
+    
+    CheckStoppedState();
 }
 
 void TInstaller::CleanupLibraryDir(const TIDEInfoPtr& ide, TIDEPlatform platform)
@@ -677,16 +980,12 @@ void TInstaller::CleanupAllCompiledFiles(const TIDEInfoPtr& ide)
             LogToFile(L"Deleting entire library directory: " + libVerDir);
             UpdateProgressState(L"Deleting: " + libVerDir);
             
-            // Use TDirectory::Delete with recursive flag
-            try
-            {
-                TDirectory::Delete(libVerDir, true);
+            // Files are deleted in parallel, directories bottom-up afterwards
+            if (TFileOps::DeleteTree(libVerDir, &FStopped))
                 LogToFile(L"  Successfully deleted: " + libVerDir);
-            }
-            catch (Exception& e)
-            {
-                LogToFile(L"  Failed to delete: " + e.Message);
-            }
+            else
+                LogToFile(L"  Failed to delete: " + libVerDir);
+            CheckStoppedState();
         }
         else
         {
@@ -779,60 +1078,39 @@ void TInstaller::DeleteDevExpressFilesFromDir(const String& dir, const std::set<
         LogToFile(L"    " + ext);
     }
     
-    int deletedCount = 0;
+    // The directory is listed first; the deletes then run in parallel
+    std::mutex lock;
+    std::vector<String> toDelete;
     int skippedCount = 0;
+    TPackageClassifierPtr classifier = TPackageClassifier::GetShared();
     
-    TSearchRec sr;
-    if (FindFirst(dir + L"\\*.*", faAnyFile, sr) == 0)
-    {
-        do
+    TFileOps::Walk(dir, false, [&](const TWalkEntry& entry) {
+        // DevExpress files by name (dx, cx, dcldx, dclcx and profile rules)
+        if (!classifier->IsDevExpress(entry.Name))
+            return;
+    
+        String ext = ExtractFileExt(entry.Name).LowerCase();
+    
+        std::lock_guard<std::mutex> guard(lock);
+        if (extensions.count(ext) > 0)
         {
-            if (sr.Name == L"." || sr.Name == L"..")
-                continue;
-            
-            if ((sr.Attr & faDirectory) != 0)
-                continue;  // Skip directories
-                
-            String lowerName = sr.Name.LowerCase();
-            String ext = ExtractFileExt(sr.Name).LowerCase();
-            
-            // Check if this is a DevExpress file by prefix
-            // DevExpress packages start with: dx, cx, dcldx, dclcx
-            bool isDevExpress = 
-                lowerName.Pos(L"dx") == 1 ||      // dxCore, dxBar, etc.
-                lowerName.Pos(L"cx") == 1 ||      // cxGrid, cxEdit, etc.
-                lowerName.Pos(L"dcldx") == 1 ||   // design-time packages (dcldxCore)
-                lowerName.Pos(L"dclcx") == 1;     // design-time packages (dclcxGrid)
-            
-            if (isDevExpress)
-            {
-                if (extensions.count(ext) > 0)
-                {
-                    String fullPath = dir + L"\\" + sr.Name;
-                    LogToFile(L"  Deleting: " + fullPath);
-                    if (DeleteFile(fullPath.c_str()))
-                    {
-                        deletedCount++;
-                    }
-                    else
-                    {
-                        LogToFile(L"    FAILED to delete: " + fullPath);
-                    }
-                }
-                else
-                {
-                    LogToFile(L"  Skipping (wrong ext): " + sr.Name + L" [ext=" + ext + L"]");
-                    skippedCount++;
-                }
-            }
-        } while (FindNext(sr) == 0);
-        
-        FindClose(sr);
-    }
-    else
-    {
-        LogToFile(L"  FindFirst failed or directory is empty");
-    }
+            toDelete.push_back(entry.FullPath);
+        }
+        else
+        {
+            LogToFile(L"  Skipping (wrong ext): " + entry.Name + L" [ext=" + ext + L"]");
+            skippedCount++;
+        }
+    }, &FStopped);
+    
+    for (const auto& path : toDelete)
+        LogToFile(L"  Deleting: " + path);
+    
+    int deletedCount = TFileOps::DeleteFiles(toDelete, &FStopped);
+    if (deletedCount < (int)toDelete.size())
+        LogToFile(L"    FAILED to delete " + String((int)toDelete.size() - deletedCount) + L" files");
+    
+    CheckStoppedState();
     
     LogToFile(L"  Deleted: " + String(deletedCount) + L" files, Skipped: " + String(skippedCount) + L" files");
 }
@@ -841,32 +1119,28 @@ void TInstaller::Install(const std::vector<TIDEInfoPtr>& ides)
 {
     LogToFile(L"=== Install started (sync) ===");
     FStopped.store(false);  // Reset stop flag
+    FFailedJobCount.store(0);
     SetState(TInstallerState::Running);
     
     bool success = true;
     String errorMessage;
     
-    for (const auto& ide : ides)
+    try
     {
-        try
-        {
-            CheckStoppedState();
-            InstallIDE(ide);
-        }
-        catch (const EAbort&)
-        {
-            LogToFile(L"EAbort exception caught");
-            success = false;
-            errorMessage = L"Operation cancelled by user";
-            break;
-        }
-        catch (Exception& e)
-        {
-            LogToFile(L"EXCEPTION: " + e.Message);
-            success = false;
-            errorMessage = e.Message;
-            throw;
-        }
+        InstallIDEs(ides);
+    }
+    catch (const EAbort&)
+    {
+        LogToFile(L"EAbort exception caught");
+        success = false;
+        errorMessage = L"Operation cancelled by user";
+    }
+    catch (Exception& e)
+    {
+        LogToFile(L"EXCEPTION: " + e.Message);
+        success = false;
+        errorMessage = e.Message;
+        throw;
     }
     
     LogToFile(L"=== Install completed ===");
@@ -885,6 +1159,7 @@ void TInstaller::InstallAsync(const std::vector<TIDEInfoPtr>& ides)
 {
     LogToFile(L"=== InstallAsync started ===");
     FStopped.store(false);  // Reset stop flag
+    FFailedJobCount.store(0);
     SetState(TInstallerState::Running);
     
     // Run installation in background thread
@@ -894,11 +1169,7 @@ void TInstaller::InstallAsync(const std::vector<TIDEInfoPtr>& ides)
         
         try
         {
-            for (const auto& ide : ides)
-            {
-                CheckStoppedState();
-                InstallIDE(ide);
-            }
+            InstallIDEs(ides);
             LogToFile(L"=== InstallAsync completed successfully ===");
         }
         catch (const EAbort&)
@@ -1015,38 +1286,282 @@ void TInstaller::UninstallAsync(const std::vector<TIDEInfoPtr>& ides, const TUni
     });
 }
 
+//---------------------------------------------------------------------------
+// Registry change sets
+//---------------------------------------------------------------------------
+TRegistryChangeSetPtr TInstaller::GetRegistryChanges(const TIDEInfoPtr& ide)
+{
+    std::lock_guard<std::mutex> lock(FRegistryChangesLock);
+    
+    TRegistryChangeSetPtr& changes = FRegistryChanges[ide->RegistryKey];
+    if (!changes)
+        changes = std::make_shared<TRegistryChangeSet>(FRegistryBackend ? FRegistryBackend :
+                                                       std::make_shared<TWinRegistryBackend>());
+    return changes;
+}
+
+bool TInstaller::HasRegistryChanges(const TIDEInfoPtr& ide)
+{
+    std::lock_guard<std::mutex> lock(FRegistryChangesLock);
+    return FRegistryChanges.find(ide->RegistryKey) != FRegistryChanges.end();
+}
+
+bool TInstaller::CommitRegistryChanges(const TIDEInfoPtr& ide)
+{
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    bool success = true;
+    
+    LogToFile(L"=== Registry changes for " + ide->Name + L": " + 
+              String(changes->GetChangeCount()) + L" recorded, " + 
+              String(changes->GetValueCount()) + L" values ===");
+    
+    if (FRegistryDryRun)
+    {
+        std::unique_ptr<TStringList> diff(new TStringList());
+        changes->Diff(diff.get());
+        for (int i = 0; i < diff->Count; i++)
+            LogToFile(L"  [dry run] " + diff->Strings[i]);
+        changes->Discard();
+    }
+    else
+    {
+        int written = 0;
+        if (changes->Apply(&written))
+        {
+            LogToFile(L"  Written: " + String(written) + L" values");
+        }
+        else
+        {
+            LogToFile(L"  ERROR: Registry write failed, changes rolled back");
+            UpdateProgressState(L"ERROR: Registry write failed for " + ide->Name);
+            success = false;
+        }
+    }
+    
+    std::lock_guard<std::mutex> lock(FRegistryChangesLock);
+    FRegistryChanges.erase(ide->RegistryKey);
+    return success;
+}
+
+TRegistryChangeSetPtr TInstaller::TakeRegistryChanges(const TIDEInfoPtr& ide)
+{
+    std::lock_guard<std::mutex> lock(FRegistryChangesLock);
+    
+    TRegistryChangeSetPtr changes;
+    auto it = FRegistryChanges.find(ide->RegistryKey);
+    if (it != FRegistryChanges.end())
+    {
+        changes = it->second;
+        FRegistryChanges.erase(it);
+    }
+    return changes;
+}
+
+void TInstaller::DiscardRegistryChanges(const TIDEInfoPtr& ide)
+{
+    std::lock_guard<std::mutex> lock(FRegistryChangesLock);
+    
+    auto it = FRegistryChanges.find(ide->RegistryKey);
+    if (it == FRegistryChanges.end())
+        return;
+    
+    LogToFile(L"Registry changes discarded for " + ide->Name + L": " + 
+              String(it->second->GetChangeCount()) + L" recorded");
+    FRegistryChanges.erase(it);
+}
+
 void TInstaller::InstallIDE(const TIDEInfoPtr& ide)
 {
-    // Debug output to file
-    LogToFile(L"=== Starting installation for " + ide->Name + L" ===");
-    LogToFile(L"InstallFileDir: [" + FInstallFileDir + L"]");
-    LogToFile(L"IDE RegistryKey: [" + ide->RegistryKey + L"]");
-    LogToFile(L"IDE BDSVersion: [" + ide->BDSVersion + L"]");
-    LogToFile(L"IDE RootDir: [" + ide->RootDir + L"]");
+    TInstallPlanPtr plan = BuildInstallPlan(ide);
+    ExecuteInstallPlan(ide, *plan);
+}
+
+void TInstaller::InstallIDEs(const std::vector<TIDEInfoPtr>& ides)
+{
+    if (FProcessPriority.Background || FProcessPriority.AffinityMask != 0 || TIOThrottle::Shared().IsLimited())
+    {
+        LogToFile(L"Background mode: " + String(FProcessPriority.Background ? L"low priority" : L"normal priority") +
+                  L", affinity 0x" + IntToHex((__int64)FProcessPriority.AffinityMask, 1) +
+                  L", copy rate " + String(TIOThrottle::Shared().GetRate() / 1024) + L" KB/s");
+    }
     
-    // Debug output to UI
-    UpdateProgressState(L"=== Starting installation for " + ide->Name + L" ===");
-    UpdateProgressState(L"InstallFileDir: " + FInstallFileDir);
-    UpdateProgressState(L"IDE RegistryKey: " + ide->RegistryKey);
-    UpdateProgressState(L"IDE BDSVersion: " + ide->BDSVersion);
+    if (FConcurrentIDEs && ides.size() > 1)
+    {
+        InstallIDEsConcurrently(ides);
+        return;
+    }
+    
+    for (const auto& ide : ides)
+    {
+        CheckStoppedState();
+        InstallIDE(ide);
+    }
+}
+
+void TInstaller::InstallIDEsConcurrently(const std::vector<TIDEInfoPtr>& ides)
+{
+    LogToFile(L"=== Concurrent install: " + String((int)ides.size()) + L" IDEs, " +
+              String(FCompileBudget.GetCapacity()) + L" compile workers ===");
+    
+    // Plans only read the registry and the file index - build them up front
+    std::vector<TInstallPlanPtr> plans;
+    for (const auto& ide : ides)
+    {
+        CheckStoppedState();
+        plans.push_back(BuildInstallPlan(ide));
+    }
+    
+    // Library\Sources is identical for every IDE - copy it once
+    StageSharedSources(plans);
+    
+    // One pipeline per IDE. Registry keys, BPL/DCP dirs and Library\{suffix}
+    // are disjoint between IDEs; compiler processes share FCompileBudget.
+    std::vector<String> errors(ides.size());
+    std::atomic<bool> aborted{false};
+    std::vector<_di_ITask> tasks;
+    
+    for (size_t i = 0; i < ides.size(); i++)
+    {
+        TIDEInfoPtr ide = ides[i];
+        TInstallPlanPtr plan = plans[i];
+        String* error = &errors[i];
+    
+        tasks.push_back(TTask::Run([this, ide, plan, error, &aborted]() {
+            try
+            {
+                ExecuteInstallPlan(ide, *plan);
+            }
+            catch (const EAbort&)
+            {
+                aborted.store(true);
+            }
+            catch (Exception& e)
+            {
+                LogToFile(L"EXCEPTION in " + ide->Name + L": " + e.Message);
+                *error = ide->Name + L": " + e.Message;
+            }
+        }));
+    }
+    
+    for (auto& task : tasks)
+        task->Wait();
+    
+    if (aborted.load())
+        throw EAbort(L"Operation cancelled by user");
+    
+    // A failed IDE does not stop the others; report all failures together
+    String message;
+    for (const auto& error : errors)
+    {
+        if (error.IsEmpty())
+            continue;
+        if (!message.IsEmpty())
+            message += L"\n";
+        message += error;
+    }
+    if (!message.IsEmpty())
+        throw Exception(message);
+}
+
+void TInstaller::StageSharedSources(std::vector<TInstallPlanPtr>& plans)
+{
+    String sourcesDir = IncludeTrailingPathDelimiter(GetInstallSourcesDir(FInstallFileDir)).LowerCase();
+    
+    // Move Library\Sources copies (and the package dirs of an archive
+    // install, extracted in place) out of the plans; like within one plan,
+    // a later entry for the same destination wins
+    std::map<String, TPlanCopyItem> staged;
+    std::vector<String> order;
+    for (auto& plan : plans)
+    {
+        std::vector<TPlanCopyItem> remaining;
+        for (const auto& item : plan->Copies)
+        {
+            String key = item.Dest.LowerCase();
+            if (!key.StartsWith(sourcesDir) && !SameText(item.Source, item.Dest))
+            {
+                remaining.push_back(item);
+                continue;
+            }
+            if (staged.find(key) == staged.end())
+                order.push_back(key);
+            staged[key] = item;
+        }
+        plan->Copies.swap(remaining);
+    }
+    
+    LogToFile(L"Staging " + String((int)order.size()) + L" shared source files to " + sourcesDir);
+    
+    std::map<String, TComponentProfilePtr> profiles;
+    for (const auto& profile : FProfile->GetComponents())
+        profiles[profile->ComponentName] = profile;
+    
+    std::vector<TPlanCopyItem> items;
+    for (const auto& key : order)
+        items.push_back(staged[key]);
+    
+    ExecuteCopyItems(nullptr, items, profiles, L"Staging");
+}
+
+void TInstaller::ExecuteCopyItems(const TIDEInfoPtr& ide,
+                                  const std::vector<TPlanCopyItem>& items,
+                                  std::map<String, TComponentProfilePtr>& profiles,
+                                  const String& stateText)
+{
+    // One parallel batch per component, so progress still moves per component
+    size_t first = 0;
+    while (first < items.size())
+    {
+        CheckStoppedState();
+    
+        const String& component = items[first].ComponentName;
+        UpdateProgress(ide, profiles[component], stateText, L"Source Files");
+    
+        std::vector<TFileCopy> copies;
+        size_t last = first;
+        for (; last < items.size() && items[last].ComponentName == component; last++)
+        {
+            TFileCopy copy;
+            copy.Source = items[last].Source;
+            copy.Dest = items[last].Dest;
+            copies.push_back(copy);
+        }
+    
+        CopyInstallFiles(copies);
+        first = last;
+    }
+    
+    CheckStoppedState();
+}
+
+//---------------------------------------------------------------------------
+// Install planning
+//---------------------------------------------------------------------------
+TInstallPlanPtr TInstaller::BuildInstallPlan(const TIDEInfoPtr& ide)
+{
+    LogToFile(L"=== Planning installation for " + ide->Name + L" ===");
+    
+    TInstallPlanPtr plan = std::make_shared<TInstallPlan>();
+    plan->IDEName = ide->Name;
+    plan->BDSVersion = ide->BDSVersion;
+    plan->RegistryKey = ide->RegistryKey;
+    plan->InstallFileDir = FInstallFileDir;
+    plan->SourceArchive = GetInstallArchive();
+    plan->DxBuildNumber = FDxBuildNumber;
     
     // First uninstall existing - clean both 32 and 64-bit registrations
-    LogToFile(L"Calling UninstallIDE (cleanup)...");
+    // and delete the previous build output (kept by an incremental install)
     TUninstallOptions cleanupOpts;
     cleanupOpts.Uninstall32BitIDE = true;
     cleanupOpts.Uninstall64BitIDE = true;
-    cleanupOpts.DeleteCompiledFiles = true;
-    UninstallIDE(ide, cleanupOpts);
-    LogToFile(L"UninstallIDE completed");
+    cleanupOpts.DeleteCompiledFiles = !HasRebuildPackages(ide);
+    plan->CleanupCompiledFiles = cleanupOpts.DeleteCompiledFiles;
     
     TInstallOptionSet opts = GetOptions(ide);
     String installSourcesDir = GetInstallSourcesDir(FInstallFileDir);
     
-    LogToFile(L"InstallSourcesDir: [" + installSourcesDir + L"]");
-    UpdateProgressState(L"InstallSourcesDir: " + installSourcesDir);
-    
     // Get DevExpress build number for version-specific fixes
-    unsigned int dxBuildNumber = TProfileManager::GetDxBuildNumber(FInstallFileDir);
+    unsigned int dxBuildNumber = FDxBuildNumber;
     
     const TComponentList& components = GetComponents(ide);
     
@@ -1056,7 +1571,7 @@ void TInstaller::InstallIDE(const TIDEInfoPtr& ide)
     bool compileWin32 = opts.count(TInstallOption::CompileWin32Runtime) > 0;
     bool compileWin64 = opts.count(TInstallOption::CompileWin64Runtime) > 0 && ide->SupportsWin64;
     bool compileWin64x = opts.count(TInstallOption::CompileWin64xRuntime) > 0 && ide->SupportsWin64Modern;
-    bool generateCppFiles = opts.count(TInstallOption::GenerateCppFiles) > 0 && 
+    bool generateCppFiles = opts.count(TInstallOption::GenerateCppFiles) > 0 &&
                             ide->Personality != TIDEPersonality::Delphi;
     
     // Win32 must be compiled for 32-bit IDE design-time packages
@@ -1077,9 +1592,13 @@ void TInstaller::InstallIDE(const TIDEInfoPtr& ide)
     LogToFile(L"generateCppFiles: " + String(generateCppFiles ? L"true" : L"false"));
     LogToFile(L"IDE SupportsWin64: " + String(ide->SupportsWin64 ? L"true" : L"false"));
     LogToFile(L"IDE SupportsWin64Modern: " + String(ide->SupportsWin64Modern ? L"true" : L"false"));
-    LogToFile(L"IDE Personality: " + String(ide->Personality == TIDEPersonality::Delphi ? L"Delphi" : 
+    LogToFile(L"IDE Personality: " + String(ide->Personality == TIDEPersonality::Delphi ? L"Delphi" :
                                             (ide->Personality == TIDEPersonality::CppBuilder ? L"CppBuilder" : L"RADStudio")));
     
+    String libDir32 = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win32);
+    String libDir64 = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64);
+    String libDir64x = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64Modern);
+    
     // ========================================
     // Phase 1: Copy source files to Library\Sources
     // ========================================
@@ -1099,240 +1618,307 @@ void TInstaller::InstallIDE(const TIDEInfoPtr& ide)
     std::set<String> resourceExtensions;
     resourceExtensions.insert(L".res");
     
+    // Win64x is compiled separately and needs .dfm/.res next to its output
+    std::set<String> resourceExtensions64x;
+    resourceExtensions64x.insert(L".dfm");
+    resourceExtensions64x.insert(L".res");
+    
     for (const auto& comp : components)
     {
         if (comp->State != TComponentState::Install)
             continue;
-            
-        String sourcesDir = TProfileManager::GetComponentSourcesDir(
-            FInstallFileDir, comp->Profile->ComponentName);
-            
-        UpdateProgress(ide, comp->Profile, L"Copying", L"Source Files");
-        UpdateProgressState(L"Copying sources: " + sourcesDir);
-        
+    
+        const String& compName = comp->Profile->ComponentName;
+        String sourcesDir = TProfileManager::GetComponentSourcesDir(FInstallFileDir, compName);
+    
         // Copy ALL source files to Library\Sources (one location for all)
-        CopySourceFilesFiltered(sourcesDir, installSourcesDir, sourceExtensions);
-        
+        PlanCopy(*plan, sourcesDir, installSourcesDir, sourceExtensions, compName);
+    
         // Copy resource files to platform-specific library dirs
         if (compileWin32)
-        {
-            String libDir32 = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win32);
-            CopySourceFilesFiltered(sourcesDir, libDir32, resourceExtensions);
-        }
-        
+            PlanCopy(*plan, sourcesDir, libDir32, resourceExtensions, compName);
+    
         if (compileWin64)
-        {
-            String libDir64 = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64);
-            CopySourceFilesFiltered(sourcesDir, libDir64, resourceExtensions);
-        }
-        
+            PlanCopy(*plan, sourcesDir, libDir64, resourceExtensions, compName);
+    
         // For Win64x - create directory for compiled files
         if (compileWin64x)
-        {
-            String libDir64x = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64Modern);
-            ForceDirectories(libDir64x);
-        }
-        
+            plan->Directories.push_back(libDir64x);
+    
         // Fix for DevExpress version >= 18.2.x
-        if (dxBuildNumber >= 20180200 && comp->Profile->ComponentName == L"ExpressLibrary")
+        if (dxBuildNumber >= 20180200 && compName == L"ExpressLibrary")
         {
-            String libDir32 = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win32);
             for (const auto& profile : FProfile->GetComponents())
             {
                 String compSourcesDir = TProfileManager::GetComponentSourcesDir(
                     FInstallFileDir, profile->ComponentName);
                 String compPackagesDir = TProfileManager::GetComponentPackagesDir(
                     FInstallFileDir, profile->ComponentName);
-                    
-                if (DirectoryExists(compSourcesDir) && !DirectoryExists(compPackagesDir))
+    
+                if (FFileIndex->DirectoryExists(compSourcesDir) && !FFileIndex->DirectoryExists(compPackagesDir))
                 {
-                    UpdateProgressState(L"Copying (18.2+ fix): " + compSourcesDir);
-                    CopySourceFilesFiltered(compSourcesDir, installSourcesDir, sourceExtensions);
+                    PlanCopy(*plan, compSourcesDir, installSourcesDir, sourceExtensions, compName);
                     if (compileWin32)
-                        CopySourceFilesFiltered(compSourcesDir, libDir32, resourceExtensions);
+                        PlanCopy(*plan, compSourcesDir, libDir32, resourceExtensions, compName);
                     if (compileWin64)
-                        CopySourceFilesFiltered(compSourcesDir, GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64), resourceExtensions);
+                        PlanCopy(*plan, compSourcesDir, libDir64, resourceExtensions, compName);
                 }
             }
-            
+    
             String pageControlDir = TProfileManager::GetComponentSourcesDir(FInstallFileDir, L"ExpressPageControl");
-            if (DirectoryExists(pageControlDir))
+            if (FFileIndex->DirectoryExists(pageControlDir))
             {
-                CopySourceFilesFiltered(pageControlDir, installSourcesDir, sourceExtensions);
+                PlanCopy(*plan, pageControlDir, installSourcesDir, sourceExtensions, compName);
                 if (compileWin32)
-                    CopySourceFilesFiltered(pageControlDir, libDir32, resourceExtensions);
+                    PlanCopy(*plan, pageControlDir, libDir32, resourceExtensions, compName);
                 if (compileWin64)
-                    CopySourceFilesFiltered(pageControlDir, GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64), resourceExtensions);
+                    PlanCopy(*plan, pageControlDir, libDir64, resourceExtensions, compName);
             }
         }
     }
     
-    // ========================================
-    // Phase 2: Compile REQUIRED packages
-    // ========================================
-    for (const auto& comp : components)
+    if (compileWin64x && generateCppFiles)
     {
-        if (comp->State != TComponentState::Install)
-            continue;
-            
-        for (const auto& pkg : comp->Packages)
+        for (const auto& comp : components)
         {
-            if (!pkg->Required)
+            if (comp->State != TComponentState::Install)
                 continue;
-                
-            if (compileWin32)
-                CompilePackage(ide, TIDEPlatform::Win32, comp, pkg);
-            
-            if (compileWin64)
-                CompilePackage(ide, TIDEPlatform::Win64, comp, pkg);
-            
-            // Win64x (Modern) - generate COFF .lib from Win64 .bpl using mkexp
-            // This is done after Win64 compilation, not as separate compilation
+    
+            String compSourcesDir = TProfileManager::GetComponentSourcesDir(
+                FInstallFileDir, comp->Profile->ComponentName);
+            PlanCopy(*plan, compSourcesDir, libDir64x, resourceExtensions64x, comp->Profile->ComponentName);
         }
     }
     
-    // ========================================
-    // Phase 3: Compile OPTIONAL packages
-    // ========================================
-    for (const auto& comp : components)
+    // Later copies to the same destination overwrite earlier ones - keep the last
     {
-        if (comp->State != TComponentState::Install)
-            continue;
-            
-        for (const auto& pkg : comp->Packages)
+        std::unordered_map<String, size_t, TStringHash> lastByDest;
+        for (size_t i = 0; i < plan->Copies.size(); i++)
+            lastByDest[plan->Copies[i].Dest.LowerCase()] = i;
+    
+        std::vector<TPlanCopyItem> copies;
+        copies.reserve(lastByDest.size());
+        for (size_t i = 0; i < plan->Copies.size(); i++)
         {
-            if (pkg->Required)
-                continue;
-                
-            if (compileWin32)
-                CompilePackage(ide, TIDEPlatform::Win32, comp, pkg);
-            
-            if (compileWin64)
-                CompilePackage(ide, TIDEPlatform::Win64, comp, pkg);
-            
-            // Win64x (Modern) - generate COFF .lib from Win64 .bpl using mkexp
-            // This is done after Win64 compilation, not as separate compilation
+            if (lastByDest[plan->Copies[i].Dest.LowerCase()] == i)
+                copies.push_back(plan->Copies[i]);
         }
+        plan->Copies.swap(copies);
     }
     
     // ========================================
-    // Phase 3.5: Compile Win64x (Modern) packages
+    // Phase 2/3: Compile REQUIRED, then OPTIONAL packages
+    // Phase 3.5: Win64x (Modern) packages, compiled separately with
+    // -JL -jf:coffi -DDX_WIN64_MODERN (COFF .lib for bcc64x/ld.lld)
     // ========================================
-    // Win64x is compiled separately with -JL -jf:coffi -DDX_WIN64_MODERN flags
-    // This generates COFF .lib files compatible with bcc64x/ld.lld linker
-    if (compileWin64x && generateCppFiles)
+    std::vector<TIDEPlatform> passes;
+    if (compileWin32)
+        passes.push_back(TIDEPlatform::Win32);
+    if (compileWin64)
+        passes.push_back(TIDEPlatform::Win64);
+    
+    for (int required = 1; required >= 0; required--)
     {
-        LogToFile(L"=== Compiling Win64x (Modern) packages ===");
-        
-        // Copy resource files to Win64x library directory
-        String libDir64x = GetInstallLibraryDir(FInstallFileDir, ide, TIDEPlatform::Win64Modern);
-        ForceDirectories(libDir64x);
-        
-        std::set<String> resourceExtensions;
-        resourceExtensions.insert(L".dfm");
-        resourceExtensions.insert(L".res");
-        
-        for (const auto& comp : components)
-        {
-            if (comp->State != TComponentState::Install)
-                continue;
-                
-            String compSourcesDir = TProfileManager::GetComponentSourcesDir(
-                FInstallFileDir, comp->Profile->ComponentName);
-            if (DirectoryExists(compSourcesDir))
-                CopySourceFilesFiltered(compSourcesDir, libDir64x, resourceExtensions);
-        }
-        
-        // Compile REQUIRED packages for Win64x
         for (const auto& comp : components)
         {
             if (comp->State != TComponentState::Install)
                 continue;
-                
+    
             for (const auto& pkg : comp->Packages)
             {
-                if (!pkg->Required)
+                if (pkg->Required != (required == 1))
                     continue;
-                    
-                CompilePackage(ide, TIDEPlatform::Win64Modern, comp, pkg);
+    
+                for (TIDEPlatform platform : passes)
+                    PlanCompileJob(*plan, ide, platform, comp, pkg);
             }
         }
-        
-        // Compile OPTIONAL packages for Win64x
-        for (const auto& comp : components)
+    }
+    
+    if (compileWin64x && generateCppFiles)
+    {
+        for (int required = 1; required >= 0; required--)
         {
-            if (comp->State != TComponentState::Install)
-                continue;
-                
-            for (const auto& pkg : comp->Packages)
+            for (const auto& comp : components)
             {
-                if (pkg->Required)
+                if (comp->State != TComponentState::Install)
                     continue;
-                    
-                CompilePackage(ide, TIDEPlatform::Win64Modern, comp, pkg);
-            }
-        }
-        
-        LogToFile(L"=== Win64x compilation completed ===");
+    
+                for (const auto& pkg : comp->Packages)
+                {
+                    if (pkg->Required != (required == 1))
+                        continue;
+    
+                    PlanCompileJob(*plan, ide, TIDEPlatform::Win64Modern, comp, pkg);
+                }
+            }
+        }
+    }
+    
+    // The compiler runs in the package dirs, which an archive install
+    // does not have on disk yet - they are extracted in place
+    if (FSourceArchive)
+    {
+        std::set<String> packageDirs;
+        for (const auto& job : plan->CompileJobs)
+        {
+            if (packageDirs.insert(job.WorkDir.LowerCase()).second)
+                PlanCopy(*plan, job.WorkDir, job.WorkDir, std::set<String>(), job.ComponentName);
+        }
     }
     
     // ========================================
     // Phase 4: Register design-time packages
     // ========================================
-    RegisterDesignTimePackages(ide, TIDEPlatform::Win32, registerFor32BitIDE, false);
+    if (registerFor32BitIDE)
+        PlanRegistrations(*plan, ide, TIDEPlatform::Win32, false);
     if (registerFor64BitIDE && compileWin64)
-        RegisterDesignTimePackages(ide, TIDEPlatform::Win64, false, registerFor64BitIDE);
+        PlanRegistrations(*plan, ide, TIDEPlatform::Win64, true);
     
     // ========================================
-    // Phase 5: Add library paths
+    // Phase 5: Registry - cleanup of the previous install, library paths
+    // and the environment variable, recorded against the current registry
     // ========================================
-    String iconLibraryDir = FInstallFileDir + L"\\ExpressLibrary\\Sources\\Icon Library";
-    bool hasIconLibrary = DirectoryExists(iconLibraryDir);
+    GetRegistryChanges(ide);
+    try
+    {
+        TInstallManifestPtr manifest = LoadInstallManifest(GetInstallManifestFileName(ide));
+        UninstallRegistry(ide, cleanupOpts, manifest.get());
     
-    if (compileWin32)
-        AddLibraryPaths(ide, TIDEPlatform::Win32);
+        if (compileWin32)
+            AddLibraryPaths(ide, TIDEPlatform::Win32);
     
-    if (compileWin64)
-        AddLibraryPaths(ide, TIDEPlatform::Win64);
+        if (compileWin64)
+            AddLibraryPaths(ide, TIDEPlatform::Win64);
+    
+        if (compileWin64x)
+            AddLibraryPaths(ide, TIDEPlatform::Win64Modern);
+    
+        SetEnvironmentVariable(ide, DX_ENV_VARIABLE, FInstallFileDir);
+    }
+    catch (...)
+    {
+        TakeRegistryChanges(ide);
+        throw;
+    }
+    plan->RegistryChanges = TakeRegistryChanges(ide)->GetRecords();
     
-    if (compileWin64x)
-        AddLibraryPaths(ide, TIDEPlatform::Win64Modern);
+    // Output directories of all compile jobs
+    std::set<String> dirs(plan->Directories.begin(), plan->Directories.end());
+    plan->Directories.clear();
+    for (const auto& job : plan->CompileJobs)
+    {
+        dirs.insert(job.BPLOutputDir);
+        dirs.insert(job.DCPOutputDir);
+        dirs.insert(job.UnitOutputDir);
+    }
+    plan->Directories.assign(dirs.begin(), dirs.end());
     
-    // Set environment variable
-    SetEnvironmentVariable(ide, DX_ENV_VARIABLE, FInstallFileDir);
+    LogToFile(L"Plan: " + String((int)plan->Copies.size()) + L" copies, " +
+              String((int)plan->CompileJobs.size()) + L" compile jobs, " +
+              String((int)plan->Skipped.size()) + L" skipped, " +
+              String((int)plan->Registrations.size()) + L" registrations, " +
+              String((int)plan->RegistryChanges.size()) + L" registry changes");
     
-    LogToFile(L"=== Installation completed for " + ide->Name + L" ===");
+    return plan;
 }
-void TInstaller::CompilePackage(const TIDEInfoPtr& ide,
-                                 TIDEPlatform platform,
-                                 const TComponentPtr& component,
-                                 const TPackagePtr& package)
+
+void TInstaller::PlanCopy(TInstallPlan& plan, const String& sourceDir, const String& destDir,
+                          const std::set<String>& extensions, const String& componentName)
 {
-    CheckStoppedState();
+    if (destDir.IsEmpty())
+        return;
     
-    if (!package->Exists)
+    // Sources inside the install tree are listed from the file index
+    if (FFileIndex->Contains(sourceDir))
+    {
+        if (!FFileIndex->DirectoryExists(sourceDir))
+            return;
+    
+        plan.Directories.push_back(destDir);
+    
+        // Subdirectories are not listed by GetFiles - they stay in place
+        for (const auto* entry : FFileIndex->GetFiles(sourceDir))
+        {
+            if (!extensions.empty() && extensions.count(ExtractFileExt(entry->Name).LowerCase()) == 0)
+                continue;
+    
+            TPlanCopyItem item;
+            item.Source = entry->FullPath;
+            item.Dest = destDir + L"\\" + entry->Name;
+            item.ComponentName = componentName;
+            plan.Copies.push_back(item);
+        }
+        return;
+    }
+    
+    if (!DirectoryExists(sourceDir))
         return;
+    
+    plan.Directories.push_back(destDir);
+    
+    TSearchRec sr;
+    if (FindFirst(sourceDir + L"\\*.*", faAnyFile, sr) == 0)
+    {
+        do
+        {
+            if ((sr.Attr & faDirectory) != 0)
+                continue;
+    
+            if (!extensions.empty() && extensions.count(ExtractFileExt(sr.Name).LowerCase()) == 0)
+                continue;
+    
+            TPlanCopyItem item;
+            item.Source = sourceDir + L"\\" + sr.Name;
+            item.Dest = destDir + L"\\" + sr.Name;
+            item.ComponentName = componentName;
+            plan.Copies.push_back(item);
+        } while (FindNext(sr) == 0);
+    
+        FindClose(sr);
+    }
+}
 
+void TInstaller::PlanCompileJob(TInstallPlan& plan,
+                                const TIDEInfoPtr& ide,
+                                TIDEPlatform platform,
+                                const TComponentPtr& component,
+                                const TPackagePtr& package)
+{
+    if (!package->Exists)
+        return;
+    
+    auto skip = [&](const String& reason) {
+        TPlanSkippedPackage skipped;
+        skipped.PackageName = package->Name;
+        skipped.Platform = platform;
+        skipped.Reason = reason;
+        plan.Skipped.push_back(skipped);
+    };
+    
     // Win64x (Modern) only needs runtime packages - no design-time IDE exists for Win64x
     if (platform == TIDEPlatform::Win64Modern && package->Usage == TPackageUsage::DesigntimeOnly)
+    {
+        skip(L"Design-time package (no Win64x IDE)");
         return;
-
+    }
+    
     // Check third-party dependencies
     TThirdPartyComponentSet tpc = GetThirdPartyComponents(ide);
     switch (package->Category)
     {
         case TPackageCategory::IBX:
-            if (tpc.count(TThirdPartyComponent::IBX) == 0) return;
+            if (tpc.count(TThirdPartyComponent::IBX) == 0) { skip(L"IBX not installed"); return; }
             break;
         case TPackageCategory::TeeChart:
-            if (tpc.count(TThirdPartyComponent::TeeChart) == 0) return;
+            if (tpc.count(TThirdPartyComponent::TeeChart) == 0) { skip(L"TeeChart not installed"); return; }
             break;
         case TPackageCategory::FireDAC:
-            if (tpc.count(TThirdPartyComponent::FireDAC) == 0) return;
+            if (tpc.count(TThirdPartyComponent::FireDAC) == 0) { skip(L"FireDAC not installed"); return; }
             break;
         case TPackageCategory::BDE:
-            if (tpc.count(TThirdPartyComponent::BDE) == 0) return;
-            if (platform != TIDEPlatform::Win32) return;  // BDE only for Win32
+            if (tpc.count(TThirdPartyComponent::BDE) == 0) { skip(L"BDE not installed"); return; }
+            if (platform != TIDEPlatform::Win32) { skip(L"BDE is Win32 only"); return; }
             break;
         default:
             break;
@@ -1340,32 +1926,19 @@ void TInstaller::CompilePackage(const TIDEInfoPtr& ide,
     
     // Check platform support
     if (!TPackageCompiler::IsPlatformSupported(ide, platform))
-        return;
-    
-    // Check if optional package dependencies are satisfied
-    if (!package->Required)
     {
-        // TODO: Check DependentComponents if needed
+        skip(L"Platform not supported by IDE");
+        return;
     }
     
-    String platformName;
-    switch (platform)
+    // Incremental install: the previous build of an unchanged package stays
+    if (HasRebuildPackages(ide) && GetRebuildPackages(ide).count(package->Name.LowerCase()) == 0)
     {
-        case TIDEPlatform::Win32: platformName = L"Win32"; break;
-        case TIDEPlatform::Win64: platformName = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformName = L"Win64x"; break;
-        default: platformName = L"Unknown"; break;
+        skip(L"Unchanged since the previous install");
+        plan.Skipped.back().Unchanged = true;
+        return;
     }
     
-    LogToFile(L"InstallPackage: " + platformName + L" > " + package->Name);
-    LogToFile(L"  Package Usage: " + String(package->Usage == TPackageUsage::RuntimeOnly ? L"RuntimeOnly" : 
-                                            (package->Usage == TPackageUsage::DesigntimeOnly ? L"DesigntimeOnly" : L"DesigntimeAndRuntime")));
-    LogToFile(L"  Package Description: [" + package->Description + L"]");
-    
-    UpdateProgress(ide, component->Profile, 
-        L"Install Package",
-        platformName + L" > " + package->Name);
-    
     // Setup compile options
     TCompileOptions options;
     options.PackagePath = package->FullFileName;
@@ -1373,16 +1946,10 @@ void TInstaller::CompilePackage(const TIDEInfoPtr& ide,
     options.DCPOutputDir = ide->GetDCPOutputPath(platform);
     options.UnitOutputDir = GetInstallLibraryDir(FInstallFileDir, ide, platform);
     
-    // Log paths to file only (not UI - reduces overhead)
-    LogToFile(L"  BPL: " + options.BPLOutputDir);
-    LogToFile(L"  DCP: " + options.DCPOutputDir);
-    LogToFile(L"  DCU: " + options.UnitOutputDir);
-
     // Safety check - all paths must be valid
     if (options.BPLOutputDir.IsEmpty() || options.DCPOutputDir.IsEmpty() || options.UnitOutputDir.IsEmpty())
     {
-        UpdateProgressState(L"ERROR: Invalid output paths for " + package->Name);
-        UpdateProgressState(L"FInstallFileDir = " + FInstallFileDir);
+        skip(L"Invalid output paths");
         return;
     }
     
@@ -1395,94 +1962,596 @@ void TInstaller::CompilePackage(const TIDEInfoPtr& ide,
     options.NativeLookAndFeel = instOpts.count(TInstallOption::NativeLookAndFeel) > 0;
     options.GenerateCppFiles = instOpts.count(TInstallOption::GenerateCppFiles) > 0;
     
-    // Ensure output directories exist
-    if (!options.BPLOutputDir.IsEmpty())
-        ForceDirectories(options.BPLOutputDir);
-    if (!options.DCPOutputDir.IsEmpty())
-        ForceDirectories(options.DCPOutputDir);
-    if (!options.UnitOutputDir.IsEmpty())
-        ForceDirectories(options.UnitOutputDir);
+    TPlanCompileJob job;
+    job.Id = (int)plan.CompileJobs.size();
+    job.PackageName = package->Name;
+    job.ComponentName = component->Profile->ComponentName;
+    job.Platform = platform;
+    job.Required = package->Required;
+    job.Compiler = TPackageCompiler::GetCompilerPath(ide, platform);
+    job.CommandLine = FCompiler->BuildCommandLine(ide, platform, options);
+    job.WorkDir = TPath::GetDirectoryName(options.PackagePath);
+    job.BPLOutputDir = options.BPLOutputDir;
+    job.DCPOutputDir = options.DCPOutputDir;
+    job.UnitOutputDir = options.UnitOutputDir;
+    
+    // Fix for DevExpress 18.2.x: dxSkinXxxxx.bpl should be placed in library install directory
+    job.CopyBplToLibrary = package->Name.SubString(1, 6) == L"dxSkin" && package->Name.Length() > 6 &&
+                           package->Name[7] >= L'A' && package->Name[7] <= L'Z';
+    
+    // Dependencies: jobs already planned for this platform that build a required package
+    for (int i = 0; i < package->Requires->Count; i++)
+    {
+        for (const auto& other : plan.CompileJobs)
+        {
+            if (other.Platform == platform && SameText(other.PackageName, package->Requires->Strings[i]))
+            {
+                job.DependsOn.push_back(other.Id);
+                break;
+            }
+        }
+    }
     
-    // Compile - use actual platform (dcc64x for Win64Modern)
-    TCompileResult result = FCompiler->Compile(ide, platform, options);
+    // Rebuilt only because a required package is - early cutoff may keep it
+    if (HasRebuildPackages(ide) && FEarlyCutoff)
+    {
+        auto changed = FChangedPackages.find(ide->BDSVersion);
+        job.Reusable = changed != FChangedPackages.end() && changed->second.count(package->Name.LowerCase()) == 0;
+    }
     
-    if (result.Success)
+    plan.CompileJobs.push_back(job);
+}
+
+void TInstaller::PlanRegistrations(TInstallPlan& plan,
+                                   const TIDEInfoPtr& ide,
+                                   TIDEPlatform platform,
+                                   bool is64BitIDE)
+{
+    String bplDir = ide->GetBPLOutputPath(platform);
+    
+    // Packages built now, and those an incremental install keeps
+    std::vector<String> packageNames;
+    for (const auto& job : plan.CompileJobs)
+    {
+        if (job.Platform == platform)
+            packageNames.push_back(job.PackageName);
+    }
+    for (const auto& skipped : plan.Skipped)
+    {
+        if (skipped.Unchanged && skipped.Platform == platform)
+            packageNames.push_back(skipped.PackageName);
+    }
+    
+    for (const auto& packageName : packageNames)
     {
-        // Fix for DevExpress 18.2.x: dxSkinXxxxx.bpl should be placed in library install directory
-        if (package->Name.SubString(1, 6) == L"dxSkin" && package->Name.Length() > 6)
+        // Runtime-only packages are not registered in the IDE
+        const TPackage* pkg = nullptr;
+        for (const auto& comp : GetComponents(ide))
         {
-            wchar_t ch = package->Name[7];
-            if (ch >= L'A' && ch <= L'Z')
+            for (const auto& p : comp->Packages)
             {
-                String srcBpl = TPath::Combine(options.BPLOutputDir, package->Name + L".bpl");
-                String dstBpl = TPath::Combine(options.UnitOutputDir, package->Name + L".bpl");
-                if (FileExists(srcBpl))
-                    CopyFile(srcBpl.c_str(), dstBpl.c_str(), FALSE);
+                if (p->Name == packageName)
+                {
+                    pkg = p.get();
+                    break;
+                }
             }
+            if (pkg)
+                break;
         }
-        
-        // Log what was generated
-        String libPath = TPath::Combine(options.DCPOutputDir, package->Name + L".lib");
-        String aPath = TPath::Combine(options.DCPOutputDir, package->Name + L".a");
-        LogToFile(L"  .lib exists: " + String(FileExists(libPath) ? L"yes" : L"no"));
-        LogToFile(L"  .a exists: " + String(FileExists(aPath) ? L"yes" : L"no"));
-        
-        LogToFile(L"  Compilation successful");
+    
+        if (!pkg || pkg->Usage == TPackageUsage::RuntimeOnly)
+            continue;
+    
+        TPlanRegistration reg;
+        reg.BplPath = TPath::Combine(bplDir, pkg->Name + L".bpl");
+        reg.Description = pkg->Description;
+        reg.Is64BitIDE = is64BitIDE;
+        plan.Registrations.push_back(reg);
     }
-    else
+}
+
+//---------------------------------------------------------------------------
+// Install plan execution
+//---------------------------------------------------------------------------
+void TInstaller::ExecuteInstallPlan(const TIDEInfoPtr& ide, const TInstallPlan& plan)
+{
+    if (!SameText(plan.BDSVersion, ide->BDSVersion))
+        throw Exception(L"Install plan is for BDS " + plan.BDSVersion + L", not " + ide->BDSVersion);
+    
+    // Registry is written once, after everything else succeeded
+    GetRegistryChanges(ide);
+    TInstallManifest manifest;
+    try
     {
-        UpdateProgressState(L"COMPILE ERROR: " + package->Name);
-        if (!result.ErrorMessage.IsEmpty())
-            UpdateProgressState(result.ErrorMessage);
-        SetState(TInstallerState::Error);
+        DoExecuteInstallPlan(ide, plan, manifest);
+    }
+    catch (...)
+    {
+        DiscardRegistryChanges(ide);
+        throw;
+    }
+    
+    // Only what this install adds; removals of the previous install are not undone later
+    for (const auto& change : GetRegistryChanges(ide)->GetRecords())
+    {
+        if (change.Kind == TRegistryChangeKind::SetValue || change.Kind == TRegistryChangeKind::AddPathEntry)
+            manifest.RegistryChanges.push_back(change);
+    }
+    
+    if (CommitRegistryChanges(ide) && !FRegistryDryRun)
+    {
+        String manifestFile = TInstallManifest::GetFileName(plan.InstallFileDir, ide);
+        manifest.SaveToFile(manifestFile);
+        LogToFile(L"Install manifest: " + manifestFile + L" (" +
+                  String((int)manifest.Files.size()) + L" files, " +
+                  String((int)manifest.OwnedDirectories.size()) + L" directories, " +
+                  String((int)manifest.RegistryChanges.size()) + L" registry changes)");
     }
 }
 
 //---------------------------------------------------------------------------
-// Register design-time packages
+// Files of a directory (not recursive) with their last write time - taken
+// before and after compiling to find what the compiler wrote to shared dirs
 //---------------------------------------------------------------------------
-void TInstaller::RegisterDesignTimePackages(const TIDEInfoPtr& ide,
-                                             TIDEPlatform platform,
-                                             bool for32BitIDE,
-                                             bool for64BitIDE)
+typedef std::map<String, TDateTime> TDirSnapshot;
+
+static void SnapshotDir(const String& dir, TDirSnapshot& snapshot)
 {
-    if (!for32BitIDE && !for64BitIDE)
+    TSearchRec sr;
+    if (FindFirst(TPath::Combine(dir, L"*"), faAnyFile, sr) != 0)
         return;
     
-    LogToFile(L"=== Registering design-time packages ===");
-    LogToFile(L"  Platform: " + String(platform == TIDEPlatform::Win64 ? L"Win64" : L"Win32"));
-    LogToFile(L"  for32BitIDE: " + String(for32BitIDE ? L"true" : L"false"));
-    LogToFile(L"  for64BitIDE: " + String(for64BitIDE ? L"true" : L"false"));
+    do
+    {
+        if (!(sr.Attr & faDirectory))
+            snapshot[TPath::Combine(dir, sr.Name)] = sr.TimeStamp;
+    }
+    while (FindNext(sr) == 0);
     
-    String bplDir = ide->GetBPLOutputPath(platform);
-    const TComponentList& components = GetComponents(ide);
+    FindClose(sr);
+}
+
+static String GetPlatformKey(TIDEPlatform platform)
+{
+    switch (platform)
+    {
+        case TIDEPlatform::Win64: return L"Win64";
+        case TIDEPlatform::Win64Modern: return L"Win64x";
+        default: return L"Win32";
+    }
+}
+
+static bool IsInDir(const String& path, const String& dir)
+{
+    return path.LowerCase().StartsWith(IncludeTrailingPathDelimiter(dir).LowerCase());
+}
+
+void TInstaller::DoExecuteInstallPlan(const TIDEInfoPtr& ide,
+                                      const TInstallPlan& plan,
+                                      TInstallManifest& manifest)
+{
+    // Debug output to file
+    LogToFile(L"=== Starting installation for " + ide->Name + L" ===");
+    LogToFile(L"InstallFileDir: [" + plan.InstallFileDir + L"]");
+    LogToFile(L"IDE RegistryKey: [" + ide->RegistryKey + L"]");
+    LogToFile(L"IDE BDSVersion: [" + ide->BDSVersion + L"]");
+    LogToFile(L"IDE RootDir: [" + ide->RootDir + L"]");
     
-    for (const auto& comp : components)
+    // Debug output to UI
+    UpdateProgressState(L"=== Starting installation for " + ide->Name + L" ===");
+    UpdateProgressState(L"InstallFileDir: " + plan.InstallFileDir);
+    UpdateProgressState(L"IDE RegistryKey: " + ide->RegistryKey);
+    UpdateProgressState(L"IDE BDSVersion: " + ide->BDSVersion);
+    
+    // Component name -> profile, for progress reporting
+    std::map<String, TComponentProfilePtr> profiles;
+    for (const auto& profile : FProfile->GetComponents())
+        profiles[profile->ComponentName] = profile;
+    
+    // Cleanup of the previous build output. An incremental install keeps
+    // it, so the new manifest has to list the previous files as well.
+    std::vector<String> previousFiles;
+    std::map<String, String> previousInterfaces;
+    if (plan.CleanupCompiledFiles)
+    {
+        LogToFile(L"Deleting previous build output...");
+        TUninstallOptions cleanupOpts;
+        String previousFile = GetInstallManifestFileName(ide);
+        TInstallManifestPtr previous = LoadInstallManifest(previousFile);
+        UninstallFiles(ide, cleanupOpts, previous.get());
+        if (previous)
+            DeleteFile(previousFile.c_str());
+    }
+    else
     {
-        if (comp->State != TComponentState::Install)
+        LogToFile(L"Keeping previous build output (incremental install)");
+        TInstallManifestPtr previous = LoadInstallManifest(GetInstallManifestFileName(ide));
+        if (previous)
+        {
+            previousFiles = previous->Files;
+            previousInterfaces = previous->Interfaces;
+        }
+    }
+    
+    manifest.IDEName = ide->Name;
+    manifest.BDSVersion = ide->BDSVersion;
+    manifest.RegistryKey = ide->RegistryKey;
+    manifest.InstallFileDir = plan.InstallFileDir;
+    manifest.DxBuildNumber = plan.DxBuildNumber;
+    manifest.InstalledAt = Now();
+    manifest.Files = previousFiles;
+    manifest.Interfaces = previousInterfaces;
+    
+    // Library\{suffix} belongs to this IDE alone; Library\Sources is shared
+    // by all IDEs and is left in place, as before
+    String ownedDir = ExtractFileDir(GetInstallLibraryDir(plan.InstallFileDir, ide, TIDEPlatform::Win32));
+    String sourcesDir = GetInstallSourcesDir(plan.InstallFileDir);
+    manifest.OwnedDirectories.push_back(ownedDir);
+    
+    // Shared output dirs (BPL, DCP, HPP) are compared before/after compiling
+    std::map<String, String> sharedDirs;    // lower-case -> path
+    for (const auto& job : plan.CompileJobs)
+    {
+        String dirs[] = { job.BPLOutputDir, job.DCPOutputDir, ide->GetHPPOutputPath(job.Platform) };
+        for (const auto& dir : dirs)
+        {
+            if (!dir.IsEmpty() && !IsInDir(dir, ownedDir))
+                sharedDirs[ExcludeTrailingPathDelimiter(dir).LowerCase()] = ExcludeTrailingPathDelimiter(dir);
+        }
+    }
+    
+    TDirSnapshot before;
+    for (const auto& it : sharedDirs)
+        SnapshotDir(it.second, before);
+    
+    // Registry changes are collected now and written at the very end
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    for (const auto& change : plan.RegistryChanges)
+        changes->AddRecord(change);
+    
+    // RAM build: unit output dirs - and the copies into them - go to the
+    // scratch dir until everything is compiled
+    std::unique_ptr<TScratchDir> scratch = CreateScratchDir(plan);
+    std::vector<TPlanCopyItem> copies = plan.Copies;
+    std::vector<TPlanCompileJob> jobs = plan.CompileJobs;
+    if (scratch)
+    {
+        for (auto& job : jobs)
+            scratch->Map(job.UnitOutputDir);
+        for (auto& job : jobs)
+        {
+            job.CommandLine = scratch->MapCommandLine(job.CommandLine);
+            job.UnitOutputDir = scratch->MapPath(job.UnitOutputDir);
+        }
+        for (auto& item : copies)
+        {
+            if (!SameText(item.Source, item.Dest))
+                item.Dest = scratch->MapPath(item.Dest);
+        }
+    }
+    
+    // Copy
+    for (const auto& dir : plan.Directories)
+        ForceDirectories(dir);
+    
+    ExecuteCopyItems(ide, copies, profiles, L"Copying");
+    
+    for (const auto& item : plan.Copies)
+    {
+        // In-place extractions are sources, not install output
+        if (!IsInDir(item.Dest, ownedDir) && !IsInDir(item.Dest, sourcesDir) &&
+            !SameText(item.Source, item.Dest))
+            manifest.Files.push_back(item.Dest);
+    }
+    
+    // Compile
+    ExecuteCompileJobs(ide, jobs, sourcesDir, profiles, manifest.Interfaces);
+    
+    if (scratch)
+    {
+        UpdateProgressState(L"Copying build output from " + scratch->GetDir());
+        TStopwatch watch = TStopwatch::StartNew();
+        int persisted = scratch->Persist(&FStopped);
+        CheckStoppedState();
+        if (persisted < 0)
+            throw Exception(L"Could not copy the build output from " + scratch->GetDir());
+        LogToFile(L"RAM build: " + String(persisted) + L" files persisted in " +
+                  String((int)watch.ElapsedMilliseconds) + L" ms");
+        scratch.reset();
+    }
+    
+    // New or rewritten files in the shared dirs are ours
+    TDirSnapshot after;
+    for (const auto& it : sharedDirs)
+        SnapshotDir(it.second, after);
+    for (const auto& it : after)
+    {
+        auto prev = before.find(it.first);
+        if (prev == before.end() || prev->second != it.second)
+            manifest.Files.push_back(it.first);
+    }
+    
+    // Each file once - an incremental install may rewrite a previous one
+    {
+        std::set<String> seen;
+        std::vector<String> files;
+        for (const auto& file : manifest.Files)
+        {
+            if (seen.insert(file.LowerCase()).second)
+                files.push_back(file);
+        }
+        manifest.Files.swap(files);
+    }
+    
+    // Register design-time packages that were built
+    CheckStoppedState();
+    for (const auto& reg : plan.Registrations)
+    {
+        if (!FileExists(reg.BplPath))
             continue;
+    
+        LogToFile(L"  Registering for " + String(reg.Is64BitIDE ? L"64" : L"32") +
+                  L"-bit IDE: " + ExtractFileName(reg.BplPath));
+        RegisterPackage(ide, reg.BplPath, reg.Description, reg.Is64BitIDE);
+    }
+    
+    LogToFile(L"=== Installation completed for " + ide->Name + L" ===");
+}
+
+std::unique_ptr<TScratchDir> TInstaller::CreateScratchDir(const TInstallPlan& plan)
+{
+    if (FScratchRoot.IsEmpty() || plan.CompileJobs.empty())
+        return nullptr;
+    
+    // Incremental installs compile against the output they keep in place
+    if (!plan.CleanupCompiledFiles)
+    {
+        LogToFile(L"RAM build: not used for an incremental install");
+        return nullptr;
+    }
+    
+    std::set<String> unitDirs;
+    for (const auto& job : plan.CompileJobs)
+        unitDirs.insert(ExcludeTrailingPathDelimiter(job.UnitOutputDir).LowerCase());
+    
+    // Sources outside Library\ (which holds staged copies of the same files)
+    String libraryDir = IncludeTrailingPathDelimiter(plan.InstallFileDir + L"\\Library").LowerCase();
+    __int64 sourceBytes = 0;
+    FFileIndex->ForEachFile([&](const TFileIndexEntry& entry) {
+        if (SameText(ExtractFileExt(entry.Name), L".pas") && !entry.FullPath.LowerCase().StartsWith(libraryDir))
+            sourceBytes += entry.Size;
+    });
+    __int64 needed = (__int64)(sourceBytes * SCRATCH_BYTES_PER_SOURCE_BYTE) * (__int64)unitDirs.size();
+    __int64 reserve = SCRATCH_MEMORY_RESERVE + SCRATCH_MEMORY_PER_COMPILER * FCompileBudget.GetCapacity();
+    
+    String reason;
+    if (!ForceDirectories(FScratchRoot) || !TScratchDir::CheckCapacity(FScratchRoot, needed, reserve, reason))
+    {
+        if (reason.IsEmpty())
+            reason = L"Cannot create " + FScratchRoot;
+        LogToFile(L"RAM build: building in place - " + reason);
+        UpdateProgressState(L"RAM build not possible, building in place: " + reason);
+        return nullptr;
+    }
+    
+    std::unique_ptr<TScratchDir> scratch(new TScratchDir(FScratchRoot));
+    LogToFile(L"RAM build: " + scratch->GetDir() + L" (about " + String(needed >> 20) + L" MB)");
+    return scratch;
+}
+
+void TInstaller::ExecuteCompileJobs(const TIDEInfoPtr& ide,
+                                    const std::vector<TPlanCompileJob>& jobs,
+                                    const String& sourcesDir,
+                                    std::map<String, TComponentProfilePtr>& profiles,
+                                    std::map<String, String>& interfaces)
+{
+    // Global budget: concurrent IDE pipelines never exceed it together.
+    // With more than one compiler at a time, output lines are tagged.
+    bool tagOutput = FCompileBudget.GetCapacity() > 1;
+    
+    // Destroyed after the scheduler, which refers to it
+    TPrefetcher prefetcher(jobs.size(), [&](size_t index) {
+        return GetCompileInputs(ide, jobs[index], sourcesDir);
+    }, PREFETCH_WINDOW_BYTES, &FStopped);
+    
+    // Early cutoff: jobs that do not depend on an interface change keep
+    // the previous build
+    TEarlyCutoff cutoff(jobs);
+    int keptCount = 0;
+    
+    TCompileScheduler scheduler(jobs, FCompileBudget, &FStopped);
+    scheduler.SetPriority(FProcessPriority);
+    scheduler.CanReuse = [&](const TPlanCompileJob& job) {
+        String key = (GetPlatformKey(job.Platform) + L"\\" + job.PackageName).LowerCase();
+        if (!job.Reusable || interfaces.count(key) == 0 ||
+            !FileExists(TPath::Combine(job.BPLOutputDir, job.PackageName + L".bpl")) ||
+            !FileExists(TPath::Combine(job.DCPOutputDir, job.PackageName + L".dcp")) ||
+            !cutoff.DependenciesUnchanged(job))
+            return false;
         
-        for (const auto& pkg : comp->Packages)
+        cutoff.SetChanged(job, false);
+        prefetcher.JobStarted(&job - jobs.data());   // No compiler will read its inputs
+        keptCount++;
+        LogToFile(L"  Kept " + job.PackageName + L": the interfaces it requires are unchanged");
+        UpdateProgressState(L"Unchanged: " + job.PackageName + L" (previous build kept)");
+        return true;
+    };
+    scheduler.OnStart = [&](const TPlanCompileJob& job) {
+        prefetcher.JobStarted(&job - jobs.data());   // The scheduler hands out elements of jobs
+        BeginCompileJob(ide, job, profiles[job.ComponentName]);
+    };
+    scheduler.OnOutput = [this, tagOutput](const TPlanCompileJob& job, const String& line) {
+        UpdateProgressState(tagOutput ? job.PackageName + L": " + line : line);
+    };
+    scheduler.OnFinished = [&](const TPlanCompileJob& job, const TCompileResult& result) {
+        FinishCompileJob(ide, job, result);
+        if (result.Success)
+            cutoff.SetChanged(job, UpdateInterfaceFingerprint(job, sourcesDir, interfaces));
+    };
+    scheduler.OnSkipped = [this](const TPlanCompileJob& job, const TPlanCompileJob& failed) {
+        LogToFile(L"  Skipped " + job.PackageName + L": requires " + failed.PackageName);
+        FFailedJobCount++;
+        UpdateProgressState(L"SKIPPED: " + job.PackageName + L" (requires " + failed.PackageName + L")");
+    };
+    
+    scheduler.Run();
+    LogToFile(L"Prefetched " + String(prefetcher.GetTotalFiles()) + L" files, " +
+              String(prefetcher.GetTotalBytes() >> 20) + L" MB");
+    if (keptCount > 0)
+        LogToFile(L"Early cutoff: " + String(keptCount) + L" of " + String((int)jobs.size()) +
+                  L" packages kept their previous build");
+    CheckStoppedState();
+}
+
+// Stores the fingerprint of the package job built: its units, then the
+// fingerprints of the packages it requires, so a change anywhere below
+// shows up in every package above. Returns whether it differs from the
+// stored one; a package that cannot be fingerprinted counts as changed.
+bool TInstaller::UpdateInterfaceFingerprint(const TPlanCompileJob& job,
+                                            const String& sourcesDir,
+                                            std::map<String, String>& interfaces)
+{
+    String platformKey = GetPlatformKey(job.Platform);
+    String key = (platformKey + L"\\" + job.PackageName).LowerCase();
+    
+    std::vector<THash128> parts;
+    TPackage package(TPath::Combine(job.WorkDir, job.PackageName + L".dpk"));
+    bool valid = package.Exists;
+    for (int i = 0; valid && i < package.Contains->Count; i++)
+    {
+        // -NH writes the .hpp next to the .dcu
+        String unit = package.Contains->Strings[i];
+        THash128 hash;
+        valid = TInterfaceHash::HashUnit(TPath::Combine(sourcesDir, unit + L".pas"),
+                                         TPath::Combine(job.UnitOutputDir, unit + L".hpp"), hash);
+        parts.push_back(hash);
+    }
+    for (int i = 0; valid && i < package.Requires->Count; i++)
+    {
+        // Packages outside the install (rtl, vcl) have no fingerprint
+        auto it = interfaces.find((platformKey + L"\\" + package.Requires->Strings[i]).LowerCase());
+        THash128 hash;
+        if (it != interfaces.end() && THash128::FromString(it->second, hash))
+            parts.push_back(hash);
+    }
+    
+    auto previous = interfaces.find(key);
+    if (!valid)
+    {
+        LogToFile(L"  No interface fingerprint for " + job.PackageName);
+        if (previous != interfaces.end())
+            interfaces.erase(previous);
+        return true;
+    }
+    
+    String fingerprint = TInterfaceHash::Combine(parts).ToString();
+    bool changed = previous == interfaces.end() || previous->second != fingerprint;
+    interfaces[key] = fingerprint;
+    return changed;
+}
+
+// Files dcc reads for job: the .dpk, the units it contains (and their
+// forms), the .dcp files of its requires - ours or the IDE's - and, for
+// the first job, the shared .inc files. Missing candidates are skipped by
+// the prefetcher.
+std::vector<String> TInstaller::GetCompileInputs(const TIDEInfoPtr& ide,
+                                                 const TPlanCompileJob& job,
+                                                 const String& sourcesDir)
+{
+    std::vector<String> files;
+    String dpkFile = TPath::Combine(job.WorkDir, job.PackageName + L".dpk");
+    TPackage package(dpkFile);
+    if (!package.Exists)
+        return files;
+    files.push_back(dpkFile);
+    
+    if (job.Id == 0)
+    {
+        TSearchRec sr;
+        if (FindFirst(sourcesDir + L"\\*.inc", faAnyFile, sr) == 0)
         {
-            if (pkg->Usage == TPackageUsage::RuntimeOnly)
-                continue;
-            
-            String bplPath = TPath::Combine(bplDir, pkg->Name + L".bpl");
-            if (!FileExists(bplPath))
-                continue;
-            
-            if (for32BitIDE)
-            {
-                LogToFile(L"  Registering for 32-bit IDE: " + pkg->Name);
-                RegisterPackage(ide, bplPath, pkg->Description, false);
-            }
-            
-            if (for64BitIDE)
-            {
-                LogToFile(L"  Registering for 64-bit IDE: " + pkg->Name);
-                RegisterPackage(ide, bplPath, pkg->Description, true);
-            }
+            do
+                files.push_back(sourcesDir + L"\\" + sr.Name);
+            while (FindNext(sr) == 0);
+            FindClose(sr);
+        }
+    }
+    
+    for (int i = 0; i < package.Contains->Count; i++)
+    {
+        String unit = sourcesDir + L"\\" + package.Contains->Strings[i];
+        files.push_back(unit + L".pas");
+        files.push_back(unit + L".dfm");
+    }
+    
+    String ideDcpDir = ide->RootDir + L"\\lib\\" + GetPlatformKey(job.Platform) + L"\\release";
+    for (int i = 0; i < package.Requires->Count; i++)
+    {
+        String dcp = package.Requires->Strings[i] + L".dcp";
+        files.push_back(TPath::Combine(job.DCPOutputDir, dcp));
+        files.push_back(TPath::Combine(ideDcpDir, dcp));
+    }
+    return files;
+}
+
+void TInstaller::BeginCompileJob(const TIDEInfoPtr& ide,
+                                 const TPlanCompileJob& job,
+                                 const TComponentProfilePtr& component)
+{
+    String platformName;
+    switch (job.Platform)
+    {
+        case TIDEPlatform::Win32: platformName = L"Win32"; break;
+        case TIDEPlatform::Win64: platformName = L"Win64"; break;
+        case TIDEPlatform::Win64Modern: platformName = L"Win64x"; break;
+        default: platformName = L"Unknown"; break;
+    }
+    
+    LogToFile(L"InstallPackage: " + platformName + L" > " + job.PackageName);
+    
+    UpdateProgress(ide, component,
+        L"Install Package",
+        platformName + L" > " + job.PackageName);
+    
+    // Log paths to file only (not UI - reduces overhead)
+    LogToFile(L"  BPL: " + job.BPLOutputDir);
+    LogToFile(L"  DCP: " + job.DCPOutputDir);
+    LogToFile(L"  DCU: " + job.UnitOutputDir);
+    
+    UpdateProgressState(L"Compiling: " + job.PackageName + L".dpk");
+}
+
+void TInstaller::FinishCompileJob(const TIDEInfoPtr& ide,
+                                  const TPlanCompileJob& job,
+                                  const TCompileResult& result)
+{
+    if (result.Success)
+    {
+        if (job.CopyBplToLibrary)
+        {
+            String srcBpl = TPath::Combine(job.BPLOutputDir, job.PackageName + L".bpl");
+            String dstBpl = TPath::Combine(job.UnitOutputDir, job.PackageName + L".bpl");
+            if (FileExists(srcBpl))
+                CopyFile(srcBpl.c_str(), dstBpl.c_str(), FALSE);
         }
+    
+        // Log what was generated
+        String libPath = TPath::Combine(job.DCPOutputDir, job.PackageName + L".lib");
+        String aPath = TPath::Combine(job.DCPOutputDir, job.PackageName + L".a");
+        LogToFile(L"  " + job.PackageName + L".lib exists: " + String(FileExists(libPath) ? L"yes" : L"no"));
+        LogToFile(L"  " + job.PackageName + L".a exists: " + String(FileExists(aPath) ? L"yes" : L"no"));
+    
+        LogToFile(L"  Compilation successful: " + job.PackageName);
+    }
+    else
+    {
+        LogToFile(L"  Compilation failed: " + job.PackageName + L" - " + result.ErrorMessage);
+        FFailedJobCount++;
+        UpdateProgressState(L"COMPILE ERROR: " + job.PackageName);
+        if (!result.ErrorMessage.IsEmpty())
+            UpdateProgressState(result.ErrorMessage);
+        SetState(TInstallerState::Error);
     }
 }
 
@@ -1495,7 +2564,9 @@ void TInstaller::AddLibraryPaths(const TIDEInfoPtr& ide, TIDEPlatform platform)
     String installSourcesDir = GetInstallSourcesDir(FInstallFileDir);
     String libDir = GetInstallLibraryDir(FInstallFileDir, ide, platform);
     String iconLibraryDir = FInstallFileDir + L"\\ExpressLibrary\\Sources\\Icon Library";
-    bool hasIconLibrary = DirectoryExists(iconLibraryDir);
+    // Subdirectories of an archive are not extracted - only use it if on disk
+    bool hasIconLibrary = FSourceArchive ? DirectoryExists(iconLibraryDir) :
+                                           FFileIndex->DirectoryExists(iconLibraryDir);
     bool generateCppFiles = opts.count(TInstallOption::GenerateCppFiles) > 0 && 
                             ide->Personality != TIDEPersonality::Delphi;
     
@@ -1605,10 +2676,179 @@ void TInstaller::RemoveLibraryPaths(const TIDEInfoPtr& ide, TIDEPlatform platfor
     }
 }
 
+//---------------------------------------------------------------------------
+// Binary packs
+//---------------------------------------------------------------------------
+void TInstaller::ExportBinaryPack(const TIDEInfoPtr& ide, const String& packFile)
+{
+    LogToFile(L"=== Exporting binary pack for " + ide->Name + L" ===");
+    
+    TInstallManifestPtr manifest = LoadInstallManifest(GetInstallManifestFileName(ide));
+    if (!manifest)
+        throw Exception(L"No install manifest for " + ide->Name + L" - install it first");
+    String installFileDir = ExcludeTrailingPathDelimiter(manifest->InstallFileDir);
+    
+    // Library\Sources, the owned directories and the files in shared dirs
+    std::vector<String> files;
+    std::mutex lock;
+    std::vector<String> roots(manifest->OwnedDirectories);
+    roots.push_back(GetInstallSourcesDir(installFileDir));
+    for (const auto& root : roots)
+    {
+        if (!DirectoryExists(root))
+            continue;
+        TFileOps::Walk(root, true, [&](const TWalkEntry& entry) {
+            std::lock_guard<std::mutex> guard(lock);
+            files.push_back(entry.FullPath);
+        }, &FStopped);
+        CheckStoppedState();
+    }
+    for (const auto& file : manifest->Files)
+    {
+        if (FileExists(file))
+            files.push_back(file);
+    }
+    std::sort(files.begin(), files.end(), [](const String& a, const String& b) {
+        return CompareText(a, b) < 0;
+    });
+    
+    TPathMacros macros = TPathMacros::ForIDE(ide, installFileDir);
+    TBinaryPackManifest pack;
+    pack.IDEName = ide->Name;
+    pack.BDSVersion = ide->BDSVersion;
+    pack.ProductVersion = ide->ProductVersion;
+    pack.IDEFileVersion = TBinaryPack::GetIDEFileVersion(ide);
+    pack.PackageSuffix = ide->GetPackageSuffix();
+    pack.DxBuildNumber = manifest->DxBuildNumber;
+    pack.CreatedAt = Now();
+    for (const auto& change : manifest->RegistryChanges)
+    {
+        TRegistryChangeRecord record = change;
+        record.Name = macros.Collapse(change.Name);
+        record.Data = macros.Collapse(change.Data);
+        pack.RegistryChanges.push_back(record);
+    }
+    
+    UpdateProgressState(L"Packing " + String((int)files.size()) + L" files into " + packFile);
+    TBinaryPack::Write(packFile, pack, files, macros, &FStopped);
+    
+    LogToFile(L"Binary pack: " + packFile + L" (" + String((int)pack.Files.size()) + L" files, " +
+              String((int)pack.RegistryChanges.size()) + L" registry changes)");
+}
+
+void TInstaller::ImportBinaryPack(const TIDEInfoPtr& ide, const String& packFile, const String& installFileDir)
+{
+    LogToFile(L"=== Importing binary pack for " + ide->Name + L" ===");
+    
+    TBinaryPackManifest pack;
+    if (!TBinaryPack::ReadManifest(packFile, pack))
+        throw Exception(L"Not a binary pack: " + packFile);
+    
+    // Packages only load into the IDE version that compiled them
+    if (!SameText(pack.BDSVersion, ide->BDSVersion) || !SameText(pack.PackageSuffix, ide->GetPackageSuffix()))
+        throw Exception(L"Binary pack is for " + pack.IDEName + L" (BDS " + pack.BDSVersion + L"), not " + ide->Name);
+    String fileVersion = TBinaryPack::GetIDEFileVersion(ide);
+    if (!pack.IDEFileVersion.IsEmpty() && !fileVersion.IsEmpty() && pack.IDEFileVersion != fileVersion)
+    {
+        LogToFile(L"  IDE build differs: pack " + pack.IDEFileVersion + L", local " + fileVersion);
+        UpdateProgressState(L"Warning: pack was built with IDE " + pack.IDEFileVersion +
+                            L", this IDE is " + fileVersion);
+    }
+    
+    String targetDir = ExcludeTrailingPathDelimiter(installFileDir);
+    TPathMacros macros = TPathMacros::ForIDE(ide, targetDir);
+    std::vector<String> missing = TBinaryPack::GetMissingMacros(pack, macros);
+    if (!missing.empty())
+    {
+        String names;
+        for (const auto& name : missing)
+            names += (names.IsEmpty() ? L"" : L", ") + name;
+        throw Exception(L"Binary pack needs directories " + ide->Name + L" does not define: " + names);
+    }
+    
+    // Registry is written once, after everything else succeeded
+    GetRegistryChanges(ide);
+    TInstallManifest manifest;
+    try
+    {
+        // The previous install goes, as with a regular install
+        TUninstallOptions cleanupOpts;
+        cleanupOpts.Uninstall64BitIDE = true;
+        String previousFile = GetInstallManifestFileName(ide);
+        TInstallManifestPtr previous = LoadInstallManifest(previousFile);
+        UninstallRegistry(ide, cleanupOpts, previous.get());
+        UninstallFiles(ide, cleanupOpts, previous.get());
+        if (previous)
+            DeleteFile(previousFile.c_str());
+    
+        UpdateProgressState(L"Unpacking " + String((int)pack.Files.size()) + L" files");
+        std::vector<String> written;
+        TBinaryPack::Extract(packFile, pack, macros, written, &FStopped);
+        CheckStoppedState();
+    
+        TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+        for (const auto& change : pack.RegistryChanges)
+        {
+            TRegistryChangeRecord record = change;
+            record.Name = macros.Expand(change.Name);
+            record.Data = macros.Expand(change.Data);
+            changes->AddRecord(record);
+            manifest.RegistryChanges.push_back(record);
+        }
+    
+        manifest.IDEName = ide->Name;
+        manifest.BDSVersion = ide->BDSVersion;
+        manifest.RegistryKey = ide->RegistryKey;
+        manifest.InstallFileDir = targetDir;
+        manifest.DxBuildNumber = pack.DxBuildNumber;
+        manifest.InstalledAt = Now();
+    
+        String ownedDir = ExtractFileDir(GetInstallLibraryDir(targetDir, ide, TIDEPlatform::Win32));
+        String sourcesDir = GetInstallSourcesDir(targetDir);
+        manifest.OwnedDirectories.push_back(ownedDir);
+        for (const auto& file : written)
+        {
+            if (!IsInDir(file, ownedDir) && !IsInDir(file, sourcesDir))
+                manifest.Files.push_back(file);
+        }
+    }
+    catch (...)
+    {
+        DiscardRegistryChanges(ide);
+        throw;
+    }
+    
+    if (CommitRegistryChanges(ide) && !FRegistryDryRun)
+    {
+        String manifestFile = TInstallManifest::GetFileName(targetDir, ide);
+        manifest.SaveToFile(manifestFile);
+        LogToFile(L"Install manifest: " + manifestFile + L" (" +
+                  String((int)manifest.Files.size()) + L" files, " +
+                  String((int)manifest.RegistryChanges.size()) + L" registry changes)");
+    }
+    
+    LogToFile(L"=== Binary pack imported for " + ide->Name + L" ===");
+}
+
 //---------------------------------------------------------------------------
 // Uninstall IDE
 //---------------------------------------------------------------------------
 void TInstaller::UninstallIDE(const TIDEInfoPtr& ide, const TUninstallOptions& uninstallOpts)
+{
+    GetRegistryChanges(ide);
+    try
+    {
+        DoUninstallIDE(ide, uninstallOpts);
+    }
+    catch (...)
+    {
+        DiscardRegistryChanges(ide);
+        throw;
+    }
+    CommitRegistryChanges(ide);
+}
+
+void TInstaller::DoUninstallIDE(const TIDEInfoPtr& ide, const TUninstallOptions& uninstallOpts)
 {
     LogToFile(L"=== UninstallIDE: " + ide->Name + L" ===");
     LogToFile(L"  Uninstall32BitIDE: " + String(uninstallOpts.Uninstall32BitIDE ? L"true" : L"false"));
@@ -1617,6 +2857,57 @@ void TInstaller::UninstallIDE(const TIDEInfoPtr& ide, const TUninstallOptions& u
     
     UpdateProgressState(L"Uninstalling from " + ide->Name);
     
+    // Read before UninstallRegistry records the removal of DXVCL
+    String manifestFile = GetInstallManifestFileName(ide);
+    TInstallManifestPtr manifest = LoadInstallManifest(manifestFile);
+    if (manifest)
+        LogToFile(L"  Using install manifest: " + manifestFile);
+    else
+        LogToFile(L"  No install manifest, using name-based cleanup");
+    
+    UninstallRegistry(ide, uninstallOpts, manifest.get());
+    UninstallFiles(ide, uninstallOpts, manifest.get());
+    
+    // Without the files the manifest has nothing left to describe
+    if (manifest && uninstallOpts.DeleteCompiledFiles && !FRegistryDryRun)
+        DeleteFile(manifestFile.c_str());
+    
+    LogToFile(L"=== UninstallIDE completed ===");
+}
+
+void TInstaller::UninstallRegistry(const TIDEInfoPtr& ide,
+                                   const TUninstallOptions& uninstallOpts,
+                                   const TInstallManifest* manifest)
+{
+    if (manifest)
+    {
+        // Undo exactly what the install recorded
+        TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+        String knownPackages32 = (ide->RegistryKey + L"\\Known Packages").LowerCase();
+        String knownPackages64 = (ide->RegistryKey + L"\\Known Packages x64").LowerCase();
+        int undone = 0;
+    
+        for (const auto& change : manifest->RegistryChanges)
+        {
+            String key = change.Key.LowerCase();
+            if (key == knownPackages32 && !uninstallOpts.Uninstall32BitIDE)
+                continue;
+            if (key == knownPackages64 && !uninstallOpts.Uninstall64BitIDE)
+                continue;
+    
+            if (change.Kind == TRegistryChangeKind::SetValue)
+                changes->DeleteValue(change.Key, change.Name);
+            else if (change.Kind == TRegistryChangeKind::AddPathEntry)
+                changes->RemovePathEntry(change.Key, change.Name, change.Data);
+            else
+                continue;
+            undone++;
+        }
+    
+        LogToFile(L"  Undoing " + String(undone) + L" registry changes from manifest");
+        return;
+    }
+    
     // Step 1: Unregister packages from registry
     if (uninstallOpts.Uninstall32BitIDE)
     {
@@ -1630,30 +2921,80 @@ void TInstaller::UninstallIDE(const TIDEInfoPtr& ide, const TUninstallOptions& u
         UnregisterAllDevExpressPackages(ide, true);
     }
     
-    // Step 2: Delete compiled files if requested
-    if (uninstallOpts.DeleteCompiledFiles)
-    {
-        LogToFile(L"  Deleting compiled files...");
-        
-        // Delete package files for all platforms
-        DeletePackageFiles(ide, TIDEPlatform::Win32);
-        DeletePackageFiles(ide, TIDEPlatform::Win64);
-        DeletePackageFiles(ide, TIDEPlatform::Win64Modern);
-        
-        // Cleanup library directories
-        CleanupAllCompiledFiles(ide);
-    }
-    
-    // Step 3: Remove library paths
+    // Step 2: Remove library paths
     RemoveLibraryPaths(ide, TIDEPlatform::Win32);
     if (ide->SupportsWin64)
         RemoveLibraryPaths(ide, TIDEPlatform::Win64);
     RemoveLibraryPaths(ide, TIDEPlatform::Win64Modern);
     
-    // Step 4: Clear environment variable
+    // Step 3: Clear environment variable
     SetEnvironmentVariable(ide, DX_ENV_VARIABLE, L"");
+}
+
+void TInstaller::UninstallFiles(const TIDEInfoPtr& ide,
+                                const TUninstallOptions& uninstallOpts,
+                                const TInstallManifest* manifest)
+{
+    // Delete compiled files if requested
+    if (!uninstallOpts.DeleteCompiledFiles)
+        return;
     
-    LogToFile(L"=== UninstallIDE completed ===");
+    if (manifest)
+    {
+        DeleteManifestFiles(*manifest);
+        return;
+    }
+    
+    LogToFile(L"  Deleting compiled files...");
+    
+    // Delete package files for all platforms
+    DeletePackageFiles(ide, TIDEPlatform::Win32);
+    DeletePackageFiles(ide, TIDEPlatform::Win64);
+    DeletePackageFiles(ide, TIDEPlatform::Win64Modern);
+    
+    // Cleanup library directories
+    CleanupAllCompiledFiles(ide);
+}
+
+void TInstaller::DeleteManifestFiles(const TInstallManifest& manifest)
+{
+    const std::vector<String>& files = manifest.Files;
+    LogToFile(L"  Deleting " + String((int)files.size()) + L" files listed in the manifest");
+    UpdateProgressState(L"Deleting " + String((int)files.size()) + L" installed files");
+    
+    int deleted = TFileOps::DeleteFiles(files, &FStopped);
+    CheckStoppedState();
+    
+    // Owned directories go as a whole
+    for (const auto& dir : manifest.OwnedDirectories)
+    {
+        if (!DirectoryExists(dir))
+            continue;
+        if (TFileOps::DeleteTree(dir, &FStopped))
+            LogToFile(L"  Deleted directory: " + dir);
+        else
+            LogToFile(L"  Failed to delete " + dir);
+        CheckStoppedState();
+    }
+    
+    LogToFile(L"  Deleted " + String(deleted) + L" of " + String((int)files.size()) + L" files");
+}
+
+String TInstaller::GetInstallManifestFileName(const TIDEInfoPtr& ide)
+{
+    // The manifest lives with the previous install, which DXVCL points to
+    String installDir = GetEnvironmentVariable(ide, DX_ENV_VARIABLE);
+    if (installDir.IsEmpty())
+        installDir = FInstallFileDir;
+    return TInstallManifest::GetFileName(installDir, ide);
+}
+
+TInstallManifestPtr TInstaller::LoadInstallManifest(const String& fileName)
+{
+    TInstallManifestPtr manifest = std::make_shared<TInstallManifest>();
+    if (!TInstallManifest::LoadFromFile(fileName, *manifest))
+        return nullptr;
+    return manifest;
 }
 
 //---------------------------------------------------------------------------
@@ -1682,17 +3023,17 @@ void TInstaller::DeletePackageFiles(const TIDEInfoPtr& ide, TIDEPlatform platfor
     for (const auto& profile : FProfile->GetComponents())
     {
         // Process all package lists
-        TStringList* packageLists[] = { 
-            profile->RequiredPackages, 
-            profile->OptionalPackages, 
-            profile->OutdatedPackages 
+        const std::vector<String>* packageLists[] = { 
+            &profile->RequiredPackages, 
+            &profile->OptionalPackages, 
+            &profile->OutdatedPackages 
         };
         
         for (auto* pkgList : packageLists)
         {
-            for (int i = 0; i < pkgList->Count; i++)
+            for (const auto& pkgBaseName : *pkgList)
             {
-                String packageName = TProfileManager::GetPackageName(pkgList->Strings[i], ide);
+                String packageName = TProfileManager::GetPackageName(pkgBaseName, ide);
                 
                 // Delete from BPL directory
                 String bplPath = TPath::Combine(bplDir, packageName + L".bpl");
@@ -1716,57 +3057,62 @@ void TInstaller::DeletePackageFiles(const TIDEInfoPtr& ide, TIDEPlatform platfor
     LogToFile(L"  Deleted " + String(deletedCount) + L" files from BPL/DCP directories");
 }
 
+//---------------------------------------------------------------------------
+// C++ path locations
+//
+// For Win32, paths go to BOTH Modern (Clang) and Classic compiler values.
+// All Win32 C++ paths are in the same registry key: C++\Paths\Win32
+// Win32 Modern (bcc32c): IncludePath_Clang32, LibraryPath_Clang32, BrowsingPath_Clang32
+// Win32 Classic (bcc32): IncludePath, LibraryPath, BrowsingPath
+// Win64/Win64x use: IncludePath / LibraryPath / BrowsingPath in C++\Paths\{Platform}
+//---------------------------------------------------------------------------
+struct TCppPathValue
+{
+    String KeyPath;
+    String ValueName;
+};
+
+static std::vector<TCppPathValue> GetCppPathValues(const TIDEInfoPtr& ide,
+                                                   TIDEPlatform platform,
+                                                   const String& baseValueName)
+{
+    std::vector<TCppPathValue> paths;
+    
+    if (platform == TIDEPlatform::Win32)
+    {
+        // Win32 Modern (Clang) - uses _Clang32 suffix in C++\Paths\Win32
+        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", baseValueName + L"_Clang32"});
+        // Win32 Classic - uses standard name (no suffix) in same C++\Paths\Win32 key
+        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", baseValueName});
+    }
+    else
+    {
+        // Win64 and Win64x use standard names
+        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\" + GetPlatformKey(platform), baseValueName});
+    }
+    
+    return paths;
+}
+
 void TInstaller::AddToLibraryPath(const TIDEInfoPtr& ide,
                                    TIDEPlatform platform,
                                    const String& path,
                                    bool isBrowsingPath)
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64: platformKey = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformKey = L"Win64x"; break;
-        default: platformKey = L"Win32"; break;
-    }
-    
+    String platformKey = GetPlatformKey(platform);
     String keyPath = ide->RegistryKey + L"\\Library\\" + platformKey;
     String valueName = isBrowsingPath ? L"Browsing Path" : L"Search Path";
     
-    LogToFile(L"AddToLibraryPath: [" + path + L"]");
-    LogToFile(L"  Platform: " + platformKey);
-    LogToFile(L"  Type: " + String(isBrowsingPath ? L"Browsing" : L"Search"));
-    LogToFile(L"  Registry: HKCU\\" + keyPath + L"\\" + valueName);
-    
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKey(keyPath, true))
-    {
-        String currentPath = reg->ReadString(valueName);
-        
-        if (currentPath.Pos(path) == 0)
-        {
-            if (!currentPath.IsEmpty() && !currentPath.EndsWith(L";"))
-                currentPath = currentPath + L";";
-            currentPath = currentPath + path;
-            reg->WriteString(valueName, currentPath);
-            LogToFile(L"  SUCCESS: Path added");
-        }
-        else
-        {
-            LogToFile(L"  SKIPPED: Path already exists");
-        }
-        
-        reg->CloseKey();
-    }
-    else
-    {
-        LogToFile(L"  ERROR: Failed to open registry key");
-    }
+    LogToFile(L"AddToLibraryPath: [" + path + L"]");
+    LogToFile(L"  Platform: " + platformKey);
+    LogToFile(L"  Type: " + String(isBrowsingPath ? L"Browsing" : L"Search"));
+    LogToFile(L"  Registry: HKCU\\" + keyPath + L"\\" + valueName);
+    
+    GetRegistryChanges(ide)->AddPathEntry(keyPath, valueName, path);
     
     // Also add to C++Builder paths if applicable
     TInstallOptionSet opts = GetOptions(ide);
-    if (opts.count(TInstallOption::GenerateCppFiles) > 0 && 
+    if (opts.count(TInstallOption::GenerateCppFiles) > 0 &&
         ide->Personality != TIDEPersonality::Delphi)
     {
         AddToCppPath(ide, platform, path, isBrowsingPath);
@@ -1778,76 +3124,17 @@ void TInstaller::AddToCppPath(const TIDEInfoPtr& ide,
                                const String& path,
                                bool isBrowsingPath)
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64: platformKey = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformKey = L"Win64x"; break;
-        default: platformKey = L"Win32"; break;
-    }
-    
     String baseValueName = isBrowsingPath ? L"BrowsingPath" : L"LibraryPath";
     
     LogToFile(L"AddToCppPath: [" + path + L"]");
-    LogToFile(L"  Platform: " + platformKey);
+    LogToFile(L"  Platform: " + GetPlatformKey(platform));
     LogToFile(L"  Type: " + baseValueName);
     
-    // For Win32, we need to add to BOTH Modern (Clang) and Classic compiler paths
-    // All Win32 C++ paths are in the same registry key: C++\Paths\Win32
-    // Win32 Modern (bcc32c): IncludePath_Clang32, LibraryPath_Clang32, BrowsingPath_Clang32
-    // Win32 Classic (bcc32): IncludePath, LibraryPath, BrowsingPath
-    // Win64/Win64x use: LibraryPath / BrowsingPath in C++\Paths\{Platform}
-    
-    struct PathInfo {
-        String keyPath;
-        String valueName;
-    };
-    
-    std::vector<PathInfo> paths;
-    
-    if (platform == TIDEPlatform::Win32)
-    {
-        // Win32 Modern (Clang) - uses _Clang32 suffix in C++\Paths\Win32
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", baseValueName + L"_Clang32"});
-        // Win32 Classic - uses standard name (no suffix) in same C++\Paths\Win32 key
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", baseValueName});
-    }
-    else
-    {
-        // Win64 and Win64x use standard names
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\" + platformKey, baseValueName});
-    }
-    
-    for (const auto& pathInfo : paths)
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    for (const auto& pathInfo : GetCppPathValues(ide, platform, baseValueName))
     {
-        LogToFile(L"  Registry: HKCU\\" + pathInfo.keyPath + L"\\" + pathInfo.valueName);
-        
-        std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-        reg->RootKey = HKEY_CURRENT_USER;
-        
-        if (reg->OpenKey(pathInfo.keyPath, true))
-        {
-            String currentPath = reg->ReadString(pathInfo.valueName);
-            
-            if (currentPath.Pos(path) == 0)
-            {
-                if (!currentPath.IsEmpty() && !currentPath.EndsWith(L";"))
-                    currentPath = currentPath + L";";
-                currentPath = currentPath + path;
-                reg->WriteString(pathInfo.valueName, currentPath);
-                LogToFile(L"    SUCCESS: Path added");
-            }
-            else
-            {
-                LogToFile(L"    SKIPPED: Path already exists");
-            }
-            
-            reg->CloseKey();
-        }
-        else
-        {
-            LogToFile(L"    WARNING: Could not open key");
-        }
+        LogToFile(L"  Registry: HKCU\\" + pathInfo.KeyPath + L"\\" + pathInfo.ValueName);
+        changes->AddPathEntry(pathInfo.KeyPath, pathInfo.ValueName, path);
     }
 }
 
@@ -1855,73 +3142,14 @@ void TInstaller::AddToCppIncludePath(const TIDEInfoPtr& ide,
                                       TIDEPlatform platform,
                                       const String& path)
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64: platformKey = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformKey = L"Win64x"; break;
-        default: platformKey = L"Win32"; break;
-    }
-    
     LogToFile(L"AddToCppIncludePath: [" + path + L"]");
-    LogToFile(L"  Platform: " + platformKey);
-    
-    // For Win32, we need to add to BOTH Modern (Clang) and Classic compiler paths
-    // All Win32 C++ paths are in the same registry key: C++\Paths\Win32
-    // Win32 Modern (bcc32c): IncludePath_Clang32
-    // Win32 Classic (bcc32): IncludePath
-    // Win64/Win64x use: IncludePath in C++\Paths\{Platform}
-    
-    struct PathInfo {
-        String keyPath;
-        String valueName;
-    };
+    LogToFile(L"  Platform: " + GetPlatformKey(platform));
     
-    std::vector<PathInfo> paths;
-    
-    if (platform == TIDEPlatform::Win32)
-    {
-        // Win32 Modern (Clang) - uses _Clang32 suffix in C++\Paths\Win32
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", L"IncludePath_Clang32"});
-        // Win32 Classic - uses standard name (no suffix) in same C++\Paths\Win32 key
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", L"IncludePath"});
-    }
-    else
-    {
-        // Win64 and Win64x use standard names
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\" + platformKey, L"IncludePath"});
-    }
-    
-    for (const auto& pathInfo : paths)
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    for (const auto& pathInfo : GetCppPathValues(ide, platform, L"IncludePath"))
     {
-        LogToFile(L"  Registry: HKCU\\" + pathInfo.keyPath + L"\\" + pathInfo.valueName);
-        
-        std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-        reg->RootKey = HKEY_CURRENT_USER;
-        
-        if (reg->OpenKey(pathInfo.keyPath, true))
-        {
-            String currentPath = reg->ReadString(pathInfo.valueName);
-            
-            if (currentPath.Pos(path) == 0)
-            {
-                if (!currentPath.IsEmpty() && !currentPath.EndsWith(L";"))
-                    currentPath = currentPath + L";";
-                currentPath = currentPath + path;
-                reg->WriteString(pathInfo.valueName, currentPath);
-                LogToFile(L"    SUCCESS: Path added");
-            }
-            else
-            {
-                LogToFile(L"    SKIPPED: Path already exists");
-            }
-            
-            reg->CloseKey();
-        }
-        else
-        {
-            LogToFile(L"    WARNING: Could not open key");
-        }
+        LogToFile(L"  Registry: HKCU\\" + pathInfo.KeyPath + L"\\" + pathInfo.ValueName);
+        changes->AddPathEntry(pathInfo.KeyPath, pathInfo.ValueName, path);
     }
 }
 
@@ -1929,54 +3157,12 @@ void TInstaller::RemoveFromCppIncludePath(const TIDEInfoPtr& ide,
                                            TIDEPlatform platform,
                                            const String& path)
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64: platformKey = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformKey = L"Win64x"; break;
-        default: platformKey = L"Win32"; break;
-    }
-    
     LogToFile(L"RemoveFromCppIncludePath: [" + path + L"]");
-    LogToFile(L"  Platform: " + platformKey);
-    
-    struct PathInfo {
-        String keyPath;
-        String valueName;
-    };
+    LogToFile(L"  Platform: " + GetPlatformKey(platform));
     
-    std::vector<PathInfo> paths;
-    
-    if (platform == TIDEPlatform::Win32)
-    {
-        // Win32 Modern (Clang) - uses _Clang32 suffix in C++\Paths\Win32
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", L"IncludePath_Clang32"});
-        // Win32 Classic - uses standard name (no suffix) in same C++\Paths\Win32 key
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", L"IncludePath"});
-    }
-    else
-    {
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\" + platformKey, L"IncludePath"});
-    }
-    
-    for (const auto& pathInfo : paths)
-    {
-        std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-        reg->RootKey = HKEY_CURRENT_USER;
-        
-        if (reg->OpenKey(pathInfo.keyPath, false))
-        {
-            String currentPath = reg->ReadString(pathInfo.valueName);
-            
-            currentPath = StringReplace(currentPath, path + L";", L"", TReplaceFlags() << rfReplaceAll);
-            currentPath = StringReplace(currentPath, L";" + path, L"", TReplaceFlags() << rfReplaceAll);
-            currentPath = StringReplace(currentPath, path, L"", TReplaceFlags() << rfReplaceAll);
-            
-            reg->WriteString(pathInfo.valueName, currentPath);
-            reg->CloseKey();
-            LogToFile(L"  Removed from " + pathInfo.keyPath);
-        }
-    }
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    for (const auto& pathInfo : GetCppPathValues(ide, platform, L"IncludePath"))
+        changes->RemovePathEntry(pathInfo.KeyPath, pathInfo.ValueName, path);
 }
 
 void TInstaller::RemoveFromLibraryPath(const TIDEInfoPtr& ide,
@@ -1984,31 +3170,10 @@ void TInstaller::RemoveFromLibraryPath(const TIDEInfoPtr& ide,
                                         const String& path,
                                         bool isBrowsingPath)
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64: platformKey = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformKey = L"Win64x"; break;
-        default: platformKey = L"Win32"; break;
-    }
-    
-    String keyPath = ide->RegistryKey + L"\\Library\\" + platformKey;
+    String keyPath = ide->RegistryKey + L"\\Library\\" + GetPlatformKey(platform);
     String valueName = isBrowsingPath ? L"Browsing Path" : L"Search Path";
     
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKey(keyPath, false))
-    {
-        String currentPath = reg->ReadString(valueName);
-        
-        currentPath = StringReplace(currentPath, path + L";", L"", TReplaceFlags() << rfReplaceAll);
-        currentPath = StringReplace(currentPath, L";" + path, L"", TReplaceFlags() << rfReplaceAll);
-        currentPath = StringReplace(currentPath, path, L"", TReplaceFlags() << rfReplaceAll);
-        
-        reg->WriteString(valueName, currentPath);
-        reg->CloseKey();
-    }
+    GetRegistryChanges(ide)->RemovePathEntry(keyPath, valueName, path);
     
     // Also remove from C++Builder paths
     if (ide->Personality != TIDEPersonality::Delphi)
@@ -2022,52 +3187,11 @@ void TInstaller::RemoveFromCppPath(const TIDEInfoPtr& ide,
                                     const String& path,
                                     bool isBrowsingPath)
 {
-    String platformKey;
-    switch (platform)
-    {
-        case TIDEPlatform::Win64: platformKey = L"Win64"; break;
-        case TIDEPlatform::Win64Modern: platformKey = L"Win64x"; break;
-        default: platformKey = L"Win32"; break;
-    }
-    
     String baseValueName = isBrowsingPath ? L"BrowsingPath" : L"LibraryPath";
     
-    struct PathInfo {
-        String keyPath;
-        String valueName;
-    };
-    
-    std::vector<PathInfo> paths;
-    
-    if (platform == TIDEPlatform::Win32)
-    {
-        // Win32 Modern (Clang) - uses _Clang32 suffix in C++\Paths\Win32
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", baseValueName + L"_Clang32"});
-        // Win32 Classic - uses standard name (no suffix) in same C++\Paths\Win32 key
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\Win32", baseValueName});
-    }
-    else
-    {
-        paths.push_back({ide->RegistryKey + L"\\C++\\Paths\\" + platformKey, baseValueName});
-    }
-    
-    for (const auto& pathInfo : paths)
-    {
-        std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-        reg->RootKey = HKEY_CURRENT_USER;
-        
-        if (reg->OpenKey(pathInfo.keyPath, false))
-        {
-            String currentPath = reg->ReadString(pathInfo.valueName);
-            
-            currentPath = StringReplace(currentPath, path + L";", L"", TReplaceFlags() << rfReplaceAll);
-            currentPath = StringReplace(currentPath, L";" + path, L"", TReplaceFlags() << rfReplaceAll);
-            currentPath = StringReplace(currentPath, path, L"", TReplaceFlags() << rfReplaceAll);
-            
-            reg->WriteString(pathInfo.valueName, currentPath);
-            reg->CloseKey();
-        }
-    }
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    for (const auto& pathInfo : GetCppPathValues(ide, platform, baseValueName))
+        changes->RemovePathEntry(pathInfo.KeyPath, pathInfo.ValueName, path);
 }
 
 bool TInstaller::RegisterPackage(const TIDEInfoPtr& ide,
@@ -2098,20 +3222,9 @@ bool TInstaller::RegisterPackage(const TIDEInfoPtr& ide,
     
     LogToFile(L"  Registry key: [HKCU\\" + keyPath + L"]");
     
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKey(keyPath, true))
-    {
-        reg->WriteString(bplPath, description);
-        reg->CloseKey();
-        LogToFile(L"  SUCCESS: Package registered");
-        UpdateProgressState(L"Registered: " + ExtractFileName(bplPath));
-        return true;
-    }
-    
-    LogToFile(L"  ERROR: Failed to open registry key");
-    return false;
+    GetRegistryChanges(ide)->SetValue(keyPath, bplPath, description);
+    UpdateProgressState(L"Registered: " + ExtractFileName(bplPath));
+    return true;
 }
 
 void TInstaller::UnregisterPackage(const TIDEInfoPtr& ide, const String& bplPath, bool is64BitIDE)
@@ -2123,15 +3236,7 @@ void TInstaller::UnregisterPackage(const TIDEInfoPtr& ide, const String& bplPath
     else
         keyPath = ide->RegistryKey + L"\\Known Packages";
     
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKey(keyPath, false))
-    {
-        if (reg->ValueExists(bplPath))
-            reg->DeleteValue(bplPath);
-        reg->CloseKey();
-    }
+    GetRegistryChanges(ide)->DeleteValue(keyPath, bplPath);
 }
 
 void TInstaller::UnregisterAllDevExpressPackages(const TIDEInfoPtr& ide, bool is64BitIDE)
@@ -2150,55 +3255,44 @@ void TInstaller::UnregisterAllDevExpressPackages(const TIDEInfoPtr& ide, bool is
     LogToFile(L"UnregisterAllDevExpressPackages: Cleaning up " + keyPath);
     LogToFile(L"  is64BitIDE: " + String(is64BitIDE ? L"true" : L"false"));
     
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-    reg->RootKey = HKEY_CURRENT_USER;
+    TRegistryChangeSetPtr changes = GetRegistryChanges(ide);
+    
+    std::unique_ptr<TStringList> values(new TStringList());
+    changes->GetValueNames(keyPath, values.get());
     
-    if (reg->OpenKey(keyPath, false))
+    int removedCount = 0;
+    TPackageClassifierPtr classifier = TPackageClassifier::GetShared();
+    
+    for (int i = 0; i < values->Count; i++)
     {
-        std::unique_ptr<TStringList> values(new TStringList());
-        reg->GetValueNames(values.get());
-        
-        // Collect DevExpress packages to remove
-        std::unique_ptr<TStringList> toRemove(new TStringList());
-        
-        for (int i = 0; i < values->Count; i++)
-        {
-            String valueName = values->Strings[i];
-            
-            // Check if this is a DevExpress package
-            // DevExpress packages start with: dx, cx, dcldx, dclcx
-            // We check for these prefixes in the filename part of the path
-            String fileName = ExtractFileName(valueName).LowerCase();
-            
-            bool isDevExpress = 
-                fileName.Pos(L"dx") == 1 ||       // dxCore, dxBar, etc.
-                fileName.Pos(L"cx") == 1 ||       // cxGrid, cxEdit, etc.
-                fileName.Pos(L"dcldx") == 1 ||    // design-time dx packages
-                fileName.Pos(L"dclcx") == 1;      // design-time cx packages
-            
-            if (isDevExpress)
-            {
-                toRemove->Add(valueName);
-            }
-        }
-        
-        // Remove collected packages
-        for (int i = 0; i < toRemove->Count; i++)
+        String valueName = values->Strings[i];
+    
+        // DevExpress packages by the file name part of the path
+        // (dx, cx, dcldx, dclcx and profile rules)
+        if (classifier->IsDevExpress(ExtractFileName(valueName)))
         {
-            LogToFile(L"  Removing: " + toRemove->Strings[i]);
-            reg->DeleteValue(toRemove->Strings[i]);
+            LogToFile(L"  Removing: " + valueName);
+            changes->DeleteValue(keyPath, valueName);
+            removedCount++;
         }
-        
-        LogToFile(L"  Removed " + String(toRemove->Count) + L" DevExpress package registrations");
-        
-        reg->CloseKey();
     }
+    
+    LogToFile(L"  Removed " + String(removedCount) + L" DevExpress package registrations");
 }
 
 String TInstaller::GetEnvironmentVariable(const TIDEInfoPtr& ide, const String& name)
 {
     String keyPath = ide->RegistryKey + L"\\Environment Variables";
     
+    // Pending changes of a running install are visible here
+    String value;
+    if (HasRegistryChanges(ide))
+    {
+        if (GetRegistryChanges(ide)->ReadValue(keyPath, name, value))
+            return value;
+        return L"";
+    }
+    
     std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ));
     reg->RootKey = HKEY_CURRENT_USER;
     
@@ -2215,22 +3309,10 @@ void TInstaller::SetEnvironmentVariable(const TIDEInfoPtr& ide, const String& na
 {
     String keyPath = ide->RegistryKey + L"\\Environment Variables";
     
-    std::unique_ptr<TRegistry> reg(new TRegistry(KEY_READ | KEY_WRITE));
-    reg->RootKey = HKEY_CURRENT_USER;
-    
-    if (reg->OpenKey(keyPath, true))
-    {
-        if (value.IsEmpty())
-        {
-            if (reg->ValueExists(name))
-                reg->DeleteValue(name);
-        }
-        else
-        {
-            reg->WriteString(name, value);
-        }
-        reg->CloseKey();
-    }
+    if (value.IsEmpty())
+        GetRegistryChanges(ide)->DeleteValue(keyPath, name);
+    else
+        GetRegistryChanges(ide)->SetValue(keyPath, name, value);
 }
 
 String TInstaller::GetCurrentLogFileName()
@@ -2245,53 +3327,203 @@ void TInstaller::AppendToLogFile(const String& msg)
 
 void TInstaller::CloseLogFile()
 {
+    std::lock_guard<std::recursive_mutex> lock(g_LogLock);
     if (g_LogFile.is_open())
         g_LogFile.close();
 }
 
-void TInstaller::SearchNewPackages(TStringList* list)
+//---------------------------------------------------------------------------
+// New package discovery
+//
+// Every .dpk in the install tree (the file index is already recursive, so
+// {Component}\Packages dirs are included) is normalized with the same suffix
+// rules as FindPackageFile and diffed against a hash set of profile names.
+//---------------------------------------------------------------------------
+static int PackageNameSimilarity(const String& a, const String& b)
 {
-    list->Clear();
+    String la = a.LowerCase();
+    String lb = b.LowerCase();
+    int n = std::min(la.Length(), lb.Length());
     
-    if (FInstallFileDir.IsEmpty())
-        return;
-        
-    std::unique_ptr<TStringList> knownPackages(new TStringList());
+    int prefix = 0;
+    while (prefix < n && la[prefix + 1] == lb[prefix + 1])
+        prefix++;
+    
+    int suffix = 0;
+    while (suffix < n - prefix && la[la.Length() - suffix] == lb[lb.Length() - suffix])
+        suffix++;
+    
+    return prefix + suffix;
+}
+
+TPackageDiscoveryResult TInstaller::DiscoverPackages() const
+{
+    TPackageDiscoveryResult result;
+    
+    if (FInstallFileDir.IsEmpty() || FFileIndex->IsEmpty())
+        return result;
+    
+    // Profile packages: lowercase name -> component. Outdated packages are
+    // known (never reported as new) but not expected on disk.
+    std::unordered_map<String, TDiscoveredPackage, TStringHash> profilePackages;
+    std::unordered_set<String, TStringHash> outdatedPackages;
     for (const auto& profile : FProfile->GetComponents())
     {
-        knownPackages->AddStrings(profile->RequiredPackages);
-        knownPackages->AddStrings(profile->OptionalPackages);
-        knownPackages->AddStrings(profile->OutdatedPackages);
+        const std::vector<String>* lists[] = { &profile->RequiredPackages, &profile->OptionalPackages };
+        for (auto* pkgList : lists)
+        {
+            for (const auto& name : *pkgList)
+            {
+                TDiscoveredPackage pkg;
+                pkg.Name = name.Trim();
+                pkg.ComponentName = profile->ComponentName;
+                profilePackages.insert(std::make_pair(pkg.Name.LowerCase(), pkg));
+            }
+        }
+        for (const auto& name : profile->OutdatedPackages)
+            outdatedPackages.insert(name.Trim().LowerCase());
     }
     
-    TSearchRec sr;
-    if (FindFirst(FInstallFileDir + L"\\*.dpk", faAnyFile, sr) == 0)
+    // Suffixes the installer generates: detected IDEs and supported versions
+    std::vector<String> suffixes;
+    for (int i = 0; i < FIDEDetector->GetCount(); i++)
+        suffixes.push_back(FIDEDetector->GetIDE(i)->GetPackageSuffix());
+    for (const auto& suffix : TProfileManager::GetKnownPackageSuffixes())
     {
-        do
+        if (std::find(suffixes.begin(), suffixes.end(), suffix) == suffixes.end())
+            suffixes.push_back(suffix);
+    }
+    
+    // Disk packages: lowercase base name -> first file found
+    std::unordered_map<String, TDiscoveredPackage, TStringHash> diskPackages;
+    String rootPrefix = IncludeTrailingPathDelimiter(FFileIndex->GetRoot());
+    FFileIndex->ForEachFile([&](const TFileIndexEntry& entry) {
+        if (!SameText(ExtractFileExt(entry.Name), L".dpk"))
+            return;
+        
+        // Component = first folder below the root ("" for top-level files)
+        String rel = entry.FullPath.SubString(rootPrefix.Length() + 1,
+                                              entry.FullPath.Length() - rootPrefix.Length());
+        int sep = rel.Pos(L"\\");
+        String component = sep > 0 ? rel.SubString(1, sep - 1) : String();
+        if (SameText(component, L"Library"))
+            return;  // Installer output, not a source package
+        
+        // The base name the profile knows, else the first naming rule that fits
+        std::vector<String> names = TProfileManager::GetPackageBaseNames(
+            TPath::GetFileNameWithoutExtension(entry.Name), suffixes);
+        TDiscoveredPackage pkg;
+        pkg.Name = names.front();
+        for (const auto& name : names)
+        {
+            String lowerName = name.LowerCase();
+            if (profilePackages.count(lowerName) > 0 || outdatedPackages.count(lowerName) > 0)
+            {
+                pkg.Name = name;
+                break;
+            }
+        }
+        pkg.FileName = entry.Name;
+        pkg.ComponentName = component;
+        
+        String key = pkg.Name.LowerCase();
+        auto it = diskPackages.find(key);
+        if (it == diskPackages.end() || CompareText(pkg.FileName, it->second.FileName) < 0)
+            diskPackages[key] = pkg;
+    });
+    
+    for (const auto& it : diskPackages)
+    {
+        if (profilePackages.count(it.first) == 0 && outdatedPackages.count(it.first) == 0)
+            result.NewPackages.push_back(it.second);
+    }
+    
+    // Only components present in this drop can have removed packages
+    for (const auto& it : profilePackages)
+    {
+        if (diskPackages.count(it.first) == 0 &&
+            FFileIndex->DirectoryExists(TProfileManager::GetComponentDir(FInstallFileDir, it.second.ComponentName)))
+        {
+            result.RemovedPackages.push_back(it.second);
+        }
+    }
+    
+    // Renames: a new and a removed package in the same component whose
+    // names share most of their characters (e.g. dxPSdxLC -> dxPSdxLayout)
+    for (auto removed = result.RemovedPackages.begin(); removed != result.RemovedPackages.end(); )
+    {
+        auto best = result.NewPackages.end();
+        int bestScore = 0;
+        for (auto added = result.NewPackages.begin(); added != result.NewPackages.end(); ++added)
         {
-            String baseName = TPath::GetFileNameWithoutExtension(sr.Name);
+            if (!SameText(added->ComponentName, removed->ComponentName))
+                continue;
             
-            int len = baseName.Length();
-            while (len > 0 && (baseName[len] >= L'0' && baseName[len] <= L'9'))
-                len--;
-                
-            if (len > 0)
+            int score = PackageNameSimilarity(removed->Name, added->Name);
+            int minLen = std::min(removed->Name.Length(), added->Name.Length());
+            if (score * 2 >= minLen && score > bestScore)
             {
-                wchar_t lastChar = baseName[len];
-                if (lastChar == L'D' || lastChar == L'd')
-                    baseName = baseName.SubString(1, len - 1);
-                else if (len >= 2 && baseName.SubString(len - 1, 2).UpperCase() == L"RS")
-                    baseName = baseName.SubString(1, len - 2);
-                else
-                    baseName = baseName.SubString(1, len);
+                best = added;
+                bestScore = score;
             }
-                
-            if (knownPackages->IndexOf(baseName) < 0)
-                list->Add(sr.Name);
-                
-        } while (FindNext(sr) == 0);
+        }
         
-        FindClose(sr);
+        if (best != result.NewPackages.end())
+        {
+            TPackageRename rename;
+            rename.OldName = removed->Name;
+            rename.NewName = best->Name;
+            rename.ComponentName = removed->ComponentName;
+            result.RenamedPackages.push_back(rename);
+            result.NewPackages.erase(best);
+            removed = result.RemovedPackages.erase(removed);
+        }
+        else
+        {
+            ++removed;
+        }
+    }
+    
+    auto byComponentAndName = [](const TDiscoveredPackage& a, const TDiscoveredPackage& b) {
+        int cmp = CompareText(a.ComponentName, b.ComponentName);
+        return cmp != 0 ? cmp < 0 : CompareText(a.Name, b.Name) < 0;
+    };
+    std::sort(result.NewPackages.begin(), result.NewPackages.end(), byComponentAndName);
+    std::sort(result.RemovedPackages.begin(), result.RemovedPackages.end(), byComponentAndName);
+    std::sort(result.RenamedPackages.begin(), result.RenamedPackages.end(),
+        [](const TPackageRename& a, const TPackageRename& b) {
+            int cmp = CompareText(a.ComponentName, b.ComponentName);
+            return cmp != 0 ? cmp < 0 : CompareText(a.OldName, b.OldName) < 0;
+        });
+    
+    return result;
+}
+
+void TInstaller::SearchNewPackages(TStringList* list)
+{
+    list->Clear();
+    
+    TPackageDiscoveryResult result = DiscoverPackages();
+    
+    if (!result.NewPackages.empty())
+    {
+        list->Add(L"New packages (" + String(static_cast<int>(result.NewPackages.size())) + L"):");
+        for (const auto& pkg : result.NewPackages)
+            list->Add(L"  [" + pkg.ComponentName + L"] " + pkg.Name + L"  (" + pkg.FileName + L")");
+    }
+    
+    if (!result.RenamedPackages.empty())
+    {
+        list->Add(L"Renamed packages (" + String(static_cast<int>(result.RenamedPackages.size())) + L"):");
+        for (const auto& rename : result.RenamedPackages)
+            list->Add(L"  [" + rename.ComponentName + L"] " + rename.OldName + L" -> " + rename.NewName);
+    }
+    
+    if (!result.RemovedPackages.empty())
+    {
+        list->Add(L"Removed packages (" + String(static_cast<int>(result.RemovedPackages.size())) + L"):");
+        for (const auto& pkg : result.RemovedPackages)
+            list->Add(L"  [" + pkg.ComponentName + L"] " + pkg.Name);
     }
 }
 
@@ -28,25 +28,80 @@
 //    - Win64: HKCU\...\Library\Win64
 //    - Win64x: HKCU\...\Library\Win64x (for C++Builder Modern)
 //
-// 5. Threading model:
+// 5. Registry writes:
+//    - All registry mutations of one IDE install/uninstall are collected in
+//      a TRegistryChangeSet, merged per value and applied once at the end
+//    - A cancelled or failed install discards them (registry is untouched)
+//
+// 6. Install manifest:
+//    - A successful install writes Library\{suffix}.manifest listing the
+//      files, directories and registry values it created
+//    - Uninstall (and the cleanup step of a reinstall) undoes exactly that,
+//      deleting files in parallel; without a manifest it falls back to the
+//      name-based heuristics (DeletePackageFiles, CleanupAllCompiledFiles)
+//    - An incremental install (SetRebuildPackages) skips the cleanup, compiles
+//      only the given packages and carries the previous manifest's files over
+//    - The manifest keeps an interface fingerprint per package; a package
+//      that is only rebuilt for 'requires' keeps its previous build when no
+//      package it requires changed its fingerprint (early cutoff)
+//    - ExportBinaryPack bundles what the manifest lists (plus Library\Sources
+//      and the registry values) into a pack; ImportBinaryPack installs such a
+//      pack on another machine without compiling (see BinaryPack.h)
+//
+// 7. Threading model:
 //    - Heavy work (compilation, file copying) runs in background thread
 //    - UI updates are synchronized via TThread::Queue
 //    - Stop flag is atomic for thread-safe cancellation
+//    - With SetConcurrentIDEs(true) each selected IDE runs its own pipeline
+//      on a task. Library\Sources is staged once for all of them and the
+//      compiler processes of all pipelines share one TWorkerBudget.
+//    - Within one IDE, compile jobs run as a dependency graph (TCompileScheduler):
+//      independent packages compile side by side, their output and exits
+//      read on the IDE's pipeline thread through one completion port
+//      (TPipeMultiplexer); Stop terminates running compilers
+//    - A TPrefetcher thread reads the inputs of the next jobs into the file
+//      cache ahead of the compilers, in planned order and within a window
+//    - Bulk file work (copying, cleanup, deleting) runs on the shared
+//      TTaskPool via TFileOps, with bounded I/O and the same stop flag
+//    - Component lists (DPK parsing, dependency resolution) are built per
+//      IDE on first use and cached; PrefetchComponentLists builds the other
+//      IDEs' lists on tasks while the UI shows the selected one
+//    - RAM build mode (SetScratchRoot) redirects the unit output dirs to a
+//      RAM-backed TScratchDir during compilation and persists them in one
+//      batch afterwards
+//    - Background mode (SetBackgroundMode) starts compilers at below-normal
+//      CPU and low I/O priority and throttles staging copies through
+//      TIOThrottle, so the machine stays usable during a rebuild
+//
+// 8. Source archive:
+//    - With SetInstallArchive the sources stay in the zip: the file index is
+//      built from its central directory, .dpk files are parsed from memory
+//      and copies become parallel extractions (see SourceArchive.h)
 //---------------------------------------------------------------------------
 #ifndef InstallerH
 #define InstallerH
 
 #include <System.hpp>
 #include <System.Classes.hpp>
-#include <Vcl.Forms.hpp>
 #include <set>
 #include <map>
+#include <vector>
 #include <atomic>
+#include <mutex>
+#include <condition_variable>
 #include <functional>
 #include "IDEDetector.h"
 #include "Component.h"
+#include "ComponentGraph.h"
 #include "ProfileManager.h"
 #include "PackageCompiler.h"
+#include "FileIndex.h"
+#include "RegistryChangeSet.h"
+#include "InstallPlan.h"
+#include "WorkerBudget.h"
+#include "FileOps.h"
+#include "SourceArchive.h"
+#include "ScratchDir.h"
 
 namespace DxCore
 {
@@ -105,6 +160,43 @@ struct TUninstallOptions
           DeleteCompiledFiles(true) {}
 };
 
+//---------------------------------------------------------------------------
+// New package discovery - difference between install tree and profile
+//---------------------------------------------------------------------------
+struct TDiscoveredPackage
+{
+    String Name;              // Normalized name (suffix stripped), as in Profile.ini
+    String FileName;          // .dpk file name on disk (empty for removed packages)
+    String ComponentName;     // Component folder / profile section
+};
+
+struct TPackageRename
+{
+    String OldName;           // Name in profile
+    String NewName;           // Name found on disk
+    String ComponentName;
+};
+
+struct TPackageDiscoveryResult
+{
+    std::vector<TDiscoveredPackage> NewPackages;      // On disk, not in profile
+    std::vector<TDiscoveredPackage> RemovedPackages;  // In profile, not on disk
+    std::vector<TPackageRename> RenamedPackages;      // Paired new/removed in one component
+};
+
+//---------------------------------------------------------------------------
+// Startup phase timings in milliseconds
+//---------------------------------------------------------------------------
+struct TStartupTimings
+{
+    double DetectIDEs;        // Registry scan
+    double LoadProfile;       // Resource or Profile.ini; overlaps DetectIDEs
+    double ThirdParty;        // Known Packages of every IDE, in parallel
+    double Total;             // Wall clock of Initialize
+
+    TStartupTimings() : DetectIDEs(0), LoadProfile(0), ThirdParty(0), Total(0) {}
+};
+
 //---------------------------------------------------------------------------
 // Installer state
 //---------------------------------------------------------------------------
@@ -128,6 +220,7 @@ typedef void __fastcall (__closure *TProgressCallback)(
 typedef void __fastcall (__closure *TProgressStateCallback)(const String& stateText);
 
 typedef std::function<void(bool success, const String& message)> TCompletionCallback;
+typedef std::function<void(const TIDEInfoPtr& ide)> TComponentListCallback;
 
 //---------------------------------------------------------------------------
 // Installer class
@@ -141,15 +234,52 @@ private:
     std::unique_ptr<TIDEDetector> FIDEDetector;
     std::unique_ptr<TProfileManager> FProfile;
     std::unique_ptr<TPackageCompiler> FCompiler;
+    std::unique_ptr<TFileIndex> FFileIndex;   // Index of FInstallFileDir
+    std::unique_ptr<TSourceArchive> FSourceArchive;   // Only when installing from a zip
+    
+    // Startup
+    std::atomic<bool> FReady{false};          // Initialize has finished
+    bool FInitializing;
+    std::mutex FReadyLock;
+    std::condition_variable FReadyChanged;
+    TStartupTimings FStartupTimings;
     
     String FInstallFileDir;
+    unsigned int FDxBuildNumber;              // Cached from dxCore.pas
     TInstallerState FState;
+    mutable std::recursive_mutex FStateLock;
     std::atomic<bool> FStopped{false};  // Thread-safe stop flag
+    std::atomic<int> FFailedJobCount{0};  // Compile jobs that failed in this run
     
     // Per-IDE data (key = BDS version string)
-    std::map<String, TComponentList> FComponents;
+    std::map<String, TComponentList> FComponents;          // Built on first use
+    std::set<String> FComponentsBuilding;                  // Lists being built right now
+    std::mutex FComponentsLock;
+    std::condition_variable FComponentsChanged;
+    int FComponentsGeneration;                             // Bumped when the source dir changes
+    int FComponentTasks;                                   // Background builds not finished yet
     std::map<String, TInstallOptionSet> FOptions;
     std::map<String, TThirdPartyComponentSet> FThirdPartyComponents;
+    std::map<String, std::set<String>> FRebuildPackages;   // Incremental installs only
+    std::map<String, std::set<String>> FChangedPackages;   // Part of the rebuild set with changed sources
+    bool FEarlyCutoff;
+    
+    // Pending registry changes per IDE (key = IDE registry key)
+    std::map<String, TRegistryChangeSetPtr> FRegistryChanges;
+    std::mutex FRegistryChangesLock;
+    bool FRegistryDryRun;                     // Log the diff instead of writing
+    TRegistryBackendPtr FRegistryBackend;     // Null = HKEY_CURRENT_USER
+    
+    // Concurrent multi-IDE install
+    bool FConcurrentIDEs;
+    TWorkerBudget FCompileBudget;             // Compiler processes across all IDEs
+    
+    // Background mode
+    TProcessPriority FProcessPriority;        // Of every compiler started
+    __int64 FCopyRateLimit;                   // Bytes per second, 0 = default
+    
+    // RAM build mode
+    String FScratchRoot;                      // Empty = build in place
     
     // Callbacks
     TProgressCallback FOnProgress;
@@ -158,28 +288,69 @@ private:
     
     // Internal methods - Setup
     void DoSetInstallFileDir(const String& value);
-    void DetectThirdPartyComponents(const TIDEInfoPtr& ide);
-    void BuildComponentList(const TIDEInfoPtr& ide);
+    TThirdPartyComponentSet DetectThirdPartyComponents(const TIDEInfoPtr& ide);
+    void BuildComponentList(const TIDEInfoPtr& ide, TComponentList& list);
+    const TComponentList* EnsureComponentList(const TIDEInfoPtr& ide, int generation);
+    void DropComponentLists();
+    void ApplyBackgroundMode();
+    TPackagePtr LoadPackage(const String& fullPath);
     String FindPackageFile(const String& packagesDir, 
                            const String& pkgBaseName, 
                            const String& ideSuffix);
     
     // Internal methods - Installation
     void InstallIDE(const TIDEInfoPtr& ide);
-    void CopyAllSourcesToLibrary();
-    void CopyResourcesToLibraryDir(const TIDEInfoPtr& ide, TIDEPlatform platform);
-    void CompileAllPackages(const TIDEInfoPtr& ide, TIDEPlatform platform);
-    void CompilePackage(const TIDEInfoPtr& ide, 
+    void InstallIDEs(const std::vector<TIDEInfoPtr>& ides);
+    void InstallIDEsConcurrently(const std::vector<TIDEInfoPtr>& ides);
+    void StageSharedSources(std::vector<TInstallPlanPtr>& plans);
+    void PlanCopy(TInstallPlan& plan,
+                  const String& sourceDir,
+                  const String& destDir,
+                  const std::set<String>& extensions,
+                  const String& componentName);
+    void PlanCompileJob(TInstallPlan& plan,
+                        const TIDEInfoPtr& ide, 
                         TIDEPlatform platform,
                         const TComponentPtr& component,
                         const TPackagePtr& package);
-    void RegisterDesignTimePackages(const TIDEInfoPtr& ide, 
-                                     TIDEPlatform platform,
-                                     bool for32BitIDE, 
-                                     bool for64BitIDE);
+    void PlanRegistrations(TInstallPlan& plan,
+                           const TIDEInfoPtr& ide,
+                           TIDEPlatform platform,
+                           bool is64BitIDE);
+    void DoExecuteInstallPlan(const TIDEInfoPtr& ide,
+                              const TInstallPlan& plan,
+                              TInstallManifest& manifest);
+    std::unique_ptr<TScratchDir> CreateScratchDir(const TInstallPlan& plan);
+    void ExecuteCompileJobs(const TIDEInfoPtr& ide,
+                            const std::vector<TPlanCompileJob>& jobs,
+                            const String& sourcesDir,
+                            std::map<String, TComponentProfilePtr>& profiles,
+                            std::map<String, String>& interfaces);
+    bool UpdateInterfaceFingerprint(const TPlanCompileJob& job,
+                                    const String& sourcesDir,
+                                    std::map<String, String>& interfaces);
+    std::vector<String> GetCompileInputs(const TIDEInfoPtr& ide,
+                                         const TPlanCompileJob& job,
+                                         const String& sourcesDir);
+    void BeginCompileJob(const TIDEInfoPtr& ide,
+                         const TPlanCompileJob& job,
+                         const TComponentProfilePtr& component);
+    void FinishCompileJob(const TIDEInfoPtr& ide,
+                          const TPlanCompileJob& job,
+                          const TCompileResult& result);
     
     // Internal methods - Uninstallation  
     void UninstallIDE(const TIDEInfoPtr& ide, const TUninstallOptions& opts);
+    void DoUninstallIDE(const TIDEInfoPtr& ide, const TUninstallOptions& opts);
+    void UninstallRegistry(const TIDEInfoPtr& ide,
+                           const TUninstallOptions& opts,
+                           const TInstallManifest* manifest);
+    void UninstallFiles(const TIDEInfoPtr& ide,
+                        const TUninstallOptions& opts,
+                        const TInstallManifest* manifest);
+    void DeleteManifestFiles(const TInstallManifest& manifest);
+    TInstallManifestPtr LoadInstallManifest(const String& fileName);
+    String GetInstallManifestFileName(const TIDEInfoPtr& ide);
     void DeletePackageFiles(const TIDEInfoPtr& ide, TIDEPlatform platform);
     void CleanupLibraryDir(const TIDEInfoPtr& ide, TIDEPlatform platform);
     void CleanupAllCompiledFiles(const TIDEInfoPtr& ide);
@@ -195,7 +366,14 @@ private:
     void CheckStoppedState();
     void SetState(TInstallerState value);
     
-    // Registry helpers
+    // Registry change sets
+    TRegistryChangeSetPtr GetRegistryChanges(const TIDEInfoPtr& ide);
+    bool HasRegistryChanges(const TIDEInfoPtr& ide);
+    bool CommitRegistryChanges(const TIDEInfoPtr& ide);   // false if the write was rolled back
+    void DiscardRegistryChanges(const TIDEInfoPtr& ide);
+    TRegistryChangeSetPtr TakeRegistryChanges(const TIDEInfoPtr& ide);
+    
+    // Registry helpers (record into the IDE's change set)
     void AddLibraryPaths(const TIDEInfoPtr& ide, TIDEPlatform platform);
     void RemoveLibraryPaths(const TIDEInfoPtr& ide, TIDEPlatform platform);
     void AddToLibraryPath(const TIDEInfoPtr& ide, 
@@ -234,32 +412,111 @@ private:
     void CopySourceFiles(const String& sourceDir, const String& destDir);
     void CopySourceFilesFiltered(const String& sourceDir, const String& destDir, 
                                   const std::set<String>& extensions);
+    void CopyInstallFiles(const std::vector<TFileCopy>& copies);
     void DeleteCompiledFiles(const String& dir, const std::set<String>& extensions);
     void DeleteDevExpressFilesFromDir(const String& dir, const std::set<String>& extensions);
+    void ExecuteCopyItems(const TIDEInfoPtr& ide,
+                          const std::vector<TPlanCopyItem>& items,
+                          std::map<String, TComponentProfilePtr>& profiles,
+                          const String& stateText);
     
 public:
     TInstaller();
     ~TInstaller();
     
-    // Initialize
+    // Initialize - IDE detection and the profile load run side by side,
+    // then the third-party scan of all IDEs. InitializeAsync runs it on a
+    // task and calls onReady on the main thread; until then only IsReady
+    // and WaitReady may be used.
     void Initialize();
+    void InitializeAsync(TCompletionCallback onReady);
+    bool IsReady() const { return FReady.load(); }
+    void WaitReady();
+    const TStartupTimings& GetStartupTimings() const { return FStartupTimings; }
     
     // Properties
     TIDEDetector* GetIDEDetector() const { return FIDEDetector.get(); }
     TProfileManager* GetProfile() const { return FProfile.get(); }
+    // Compiles the built-in package rules plus those of the loaded profile
+    // into the shared classifier (see PackageRules.h). Call after reloading
+    // the profile.
+    void ApplyPackageRules();
     
     String GetInstallFileDir() const { return FInstallFileDir; }
     void SetInstallFileDir(const String& value);
-    
-    TInstallerState GetState() const { return FState; }
-    
-    // Get components for IDE
-    const TComponentList& GetComponents(const TIDEInfoPtr& ide) const;
+    // Sources from a zip; installFileDir receives Library\ and the package dirs
+    void SetInstallArchive(const String& archiveFile, const String& installFileDir);
+    String GetInstallArchive() const;
+    const TFileIndex* GetFileIndex() const { return FFileIndex.get(); }
+    unsigned int GetDxBuildNumber() const { return FDxBuildNumber; }
+    
+    TInstallerState GetState() const;
+    int GetFailedJobCount() const { return FFailedJobCount.load(); }
+    
+    // Dry run: registry changes are logged as a diff, nothing is written
+    bool GetRegistryDryRun() const { return FRegistryDryRun; }
+    void SetRegistryDryRun(bool value) { FRegistryDryRun = value; }
+    
+    // Registry the change sets read and write (HKEY_CURRENT_USER unless
+    // set); the self-test runs uninstalls against an in-memory one
+    void SetRegistryBackend(TRegistryBackendPtr backend) { FRegistryBackend = backend; }
+    
+    // Concurrent mode: several selected IDEs are installed at the same time
+    bool GetConcurrentIDEs() const { return FConcurrentIDEs; }
+    void SetConcurrentIDEs(bool value) { FConcurrentIDEs = value; }
+    
+    // Compiler processes allowed at once across all IDEs (0 = number of CPUs)
+    int GetMaxParallelCompiles() const { return FCompileBudget.GetCapacity(); }
+    void SetMaxParallelCompiles(int value) { FCompileBudget.SetCapacity(value); }
+    
+    // Background mode: compilers run at below-normal CPU and low I/O
+    // priority and staging copies are limited to the copy rate (32 MB/s
+    // unless set); without it copies are limited only if a rate is set.
+    // An affinity mask (0 = all CPUs) keeps compilers off the other CPUs.
+    bool GetBackgroundMode() const { return FProcessPriority.Background; }
+    void SetBackgroundMode(bool value);
+    DWORD_PTR GetCompilerAffinity() const { return FProcessPriority.AffinityMask; }
+    void SetCompilerAffinity(DWORD_PTR mask);
+    __int64 GetCopyRateLimit() const { return FCopyRateLimit; }
+    void SetCopyRateLimit(__int64 bytesPerSecond);
+    
+    // RAM build mode: a full install compiles into a directory below root
+    // (a RAM disk) and copies the unit output to Library\{suffix} once all
+    // compilers are done. Falls back to building in place when the volume
+    // or the free memory is too small for the estimated output.
+    String GetScratchRoot() const { return FScratchRoot; }
+    void SetScratchRoot(const String& root) { FScratchRoot = root; }
+    
+    // Components for IDE. Lists are built on first use and cached until the
+    // source directory is set again; a list that is being built in the
+    // background is waited for.
+    const TComponentList& GetComponents(const TIDEInfoPtr& ide);
+    bool IsComponentListReady(const TIDEInfoPtr& ide);
+    // Builds the lists of all IDEs in the background; onReady is called on
+    // the main thread for each one (not for lists that were already built)
+    void PrefetchComponentLists(TComponentListCallback onReady);
     
     // Get/Set options for IDE
     TInstallOptionSet GetOptions(const TIDEInfoPtr& ide) const;
     void SetOptions(const TIDEInfoPtr& ide, const TInstallOptionSet& options);
     
+    // Incremental install: only these packages (lower-case names, see
+    // TSourceDiff) are compiled; the previous build of all others is kept.
+    // Without a rebuild set everything is cleaned and compiled.
+    // changed: the packages with changed sources. The others are in the set
+    // only for 'requires' and are skipped at compile time (early cutoff)
+    // when the interfaces they require turn out unchanged.
+    bool HasRebuildPackages(const TIDEInfoPtr& ide) const;
+    std::set<String> GetRebuildPackages(const TIDEInfoPtr& ide) const;
+    void SetRebuildPackages(const TIDEInfoPtr& ide, const std::set<String>& packages);
+    void SetRebuildPackages(const TIDEInfoPtr& ide, const std::set<String>& packages,
+                            const std::set<String>& changed);
+    void ClearRebuildPackages(const TIDEInfoPtr& ide);
+    
+    // Early cutoff of incremental installs (on by default)
+    bool GetEarlyCutoff() const { return FEarlyCutoff; }
+    void SetEarlyCutoff(bool value) { FEarlyCutoff = value; }
+    
     // Get/Set third-party components for IDE
     TThirdPartyComponentSet GetThirdPartyComponents(const TIDEInfoPtr& ide) const;
     void SetThirdPartyComponents(const TIDEInfoPtr& ide, const TThirdPartyComponentSet& components);
@@ -268,6 +525,16 @@ public:
     void Install(const std::vector<TIDEInfoPtr>& ides);
     void Uninstall(const std::vector<TIDEInfoPtr>& ides, const TUninstallOptions& uninstallOpts);
     
+    // Install plan: everything one IDE install will do, as data (see InstallPlan.h).
+    // InstallIDE = BuildInstallPlan + ExecuteInstallPlan.
+    TInstallPlanPtr BuildInstallPlan(const TIDEInfoPtr& ide);
+    void ExecuteInstallPlan(const TIDEInfoPtr& ide, const TInstallPlan& plan);
+    
+    // Binary pack: the output of a finished install, for machines with the
+    // same IDE. Import replaces the previous install like InstallIDE does.
+    void ExportBinaryPack(const TIDEInfoPtr& ide, const String& packFile);
+    void ImportBinaryPack(const TIDEInfoPtr& ide, const String& packFile, const String& installFileDir);
+    
     // Install/Uninstall (asynchronous - runs in background thread)
     void InstallAsync(const std::vector<TIDEInfoPtr>& ides);
     void UninstallAsync(const std::vector<TIDEInfoPtr>& ides, const TUninstallOptions& uninstallOpts);
@@ -277,6 +544,7 @@ public:
     
     // Search for new packages not in profile
     void SearchNewPackages(TStringList* list);
+    TPackageDiscoveryResult DiscoverPackages() const;
     
     // Path helpers
     static String GetInstallLibraryDir(const String& installFileDir, 
@@ -0,0 +1,263 @@
+//---------------------------------------------------------------------------
+// InterfaceHash implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "InterfaceHash.h"
+#include <IOUtils.hpp>
+#include <string>
+
+namespace DxCore
+{
+
+// Include files that include further ones
+static const int MAX_INCLUDE_DEPTH = 8;
+
+//---------------------------------------------------------------------------
+// Pascal tokens - enough of the lexer to drop comments and whitespace
+//---------------------------------------------------------------------------
+struct TPascalInclude
+{
+    String FileName;
+    size_t Position;          // Token index the directive appeared at
+};
+
+struct TPascalSource
+{
+    std::vector<std::string> Tokens;      // Lower-case except string literals
+    std::vector<TPascalInclude> Includes;
+    size_t InterfaceEnd;      // Index of 'implementation' (Tokens.size() if none)
+};
+
+static char LowerChar(char c)
+{
+    return c >= 'A' && c <= 'Z' ? (char)(c + ('a' - 'A')) : c;
+}
+
+static bool IsWordChar(char c)
+{
+    unsigned char u = (unsigned char)c;
+    return (u >= 'a' && u <= 'z') || (u >= 'A' && u <= 'Z') || (u >= '0' && u <= '9') ||
+           u == '_' || u == '$' || u == '#' || u >= 0x80;
+}
+
+static bool IsIdentifier(const std::string& token)
+{
+    return !token.empty() && IsWordChar(token[0]) && !(token[0] >= '0' && token[0] <= '9') &&
+           token[0] != '$' && token[0] != '#';
+}
+
+// {$...} or (*$...*): kept as a token; {$I file} / {$INCLUDE file} noted
+static void AddDirective(const char* text, size_t length, TPascalSource& source)
+{
+    std::string token = "{$";
+    for (size_t i = 0; i < length; i++)
+        token += LowerChar(text[i]);
+    token += "}";
+
+    size_t nameEnd = 2;
+    while (nameEnd < token.size() && token[nameEnd] >= 'a' && token[nameEnd] <= 'z')
+        nameEnd++;
+    std::string name = token.substr(2, nameEnd - 2);
+    if ((name == "i" || name == "include") && nameEnd < token.size() && token[nameEnd] == ' ')
+    {
+        std::string file = token.substr(nameEnd, token.size() - 1 - nameEnd);
+        size_t first = file.find_first_not_of(" '");
+        size_t last = file.find_last_not_of(" '");
+        if (first != std::string::npos)
+        {
+            TPascalInclude include;
+            include.FileName = String(file.substr(first, last - first + 1).c_str());
+            include.Position = source.Tokens.size();
+            source.Includes.push_back(include);
+        }
+    }
+    source.Tokens.push_back(token);
+}
+
+static void Tokenize(const char* p, size_t n, TPascalSource& source)
+{
+    source.InterfaceEnd = std::string::npos;
+    size_t i = 0;
+    while (i < n)
+    {
+        char c = p[i];
+        if ((unsigned char)c <= ' ')
+        {
+            i++;
+        }
+        else if (c == '{')
+        {
+            size_t close = i + 1;
+            while (close < n && p[close] != '}')
+                close++;
+            if (i + 1 < n && p[i + 1] == '$')
+                AddDirective(p + i + 2, close - (i + 2), source);
+            i = close + 1;
+        }
+        else if (c == '(' && i + 1 < n && p[i + 1] == '*')
+        {
+            size_t close = i + 2;
+            while (close + 1 < n && !(p[close] == '*' && p[close + 1] == ')'))
+                close++;
+            if (close + 1 >= n)
+                close = n;
+            if (i + 2 < n && p[i + 2] == '$')
+                AddDirective(p + i + 3, close - (i + 3), source);
+            i = close + 2;
+        }
+        else if (c == '/' && i + 1 < n && p[i + 1] == '/')
+        {
+            while (i < n && p[i] != '\n')
+                i++;
+        }
+        else if (c == '\'')
+        {
+            // '' inside a literal is a quote
+            size_t j = i + 1;
+            for (;;)
+            {
+                while (j < n && p[j] != '\'' && p[j] != '\n')
+                    j++;
+                if (j + 1 < n && p[j] == '\'' && p[j + 1] == '\'')
+                    j += 2;
+                else
+                    break;
+            }
+            size_t end = j < n ? j + 1 : n;
+            source.Tokens.push_back(std::string(p + i, end - i));
+            i = end;
+        }
+        else if (IsWordChar(c))
+        {
+            std::string token;
+            while (i < n && IsWordChar(p[i]))
+                token += LowerChar(p[i++]);
+            if (token == "implementation" && source.InterfaceEnd == std::string::npos)
+                source.InterfaceEnd = source.Tokens.size();
+            source.Tokens.push_back(token);
+        }
+        else
+        {
+            static const char* const pairs[] = { ":=", "<=", ">=", "<>", "..", "(.", ".)" };
+            size_t length = 1;
+            for (const char* pair : pairs)
+            {
+                if (i + 1 < n && c == pair[0] && p[i + 1] == pair[1])
+                    length = 2;
+            }
+            source.Tokens.push_back(std::string(p + i, length));
+            i += length;
+        }
+    }
+
+    if (source.InterfaceEnd == std::string::npos)
+        source.InterfaceEnd = source.Tokens.size();
+}
+
+// Inline routines and generic declarations ('function F<T>', 'TList<T> =')
+// put implementation code into the units that use them
+static bool ExportsImplementation(const TPascalSource& source)
+{
+    const auto& tokens = source.Tokens;
+    size_t end = source.InterfaceEnd;
+    for (size_t k = 0; k < end; k++)
+    {
+        if (tokens[k] == "inline")
+            return true;
+        if (tokens[k] != "<" || k == 0 || !IsIdentifier(tokens[k - 1]))
+            continue;
+        if (k >= 2 && (tokens[k - 2] == "function" || tokens[k - 2] == "procedure"))
+            return true;
+
+        int depth = 1;
+        size_t j = k + 1;
+        for (; j < end && depth > 0 && tokens[j] != ";"; j++)
+        {
+            if (tokens[j] == "<")
+                depth++;
+            else if (tokens[j] == ">")
+                depth--;
+            else if (tokens[j] == ">=" && depth == 1)
+                return true;
+        }
+        if (depth == 0 && j < end && tokens[j] == "=")
+            return true;
+    }
+    return false;
+}
+
+//---------------------------------------------------------------------------
+// TInterfaceHash implementation
+//---------------------------------------------------------------------------
+bool TInterfaceHash::AppendSource(const String& fileName, bool wholeFile, int depth, std::string& data)
+{
+    if (depth > MAX_INCLUDE_DEPTH || !FileExists(fileName))
+        return false;
+
+    TBytes bytes;
+    try
+    {
+        bytes = TFile::ReadAllBytes(fileName);
+    }
+    catch (const Exception&)
+    {
+        return false;
+    }
+
+    TPascalSource source;
+    if (bytes.Length > 0)
+        Tokenize(reinterpret_cast<const char*>(&bytes[0]), bytes.Length, source);
+    else
+        source.InterfaceEnd = 0;
+    size_t end = wholeFile || ExportsImplementation(source) ? source.Tokens.size() : source.InterfaceEnd;
+
+    for (size_t i = 0; i < end; i++)
+    {
+        data += source.Tokens[i];
+        data += ' ';
+    }
+    data += '\n';
+
+    // Include files are small; they count whole
+    for (const auto& include : source.Includes)
+    {
+        if (include.Position >= end)
+            break;
+        String includeFile = TPath::Combine(ExtractFilePath(fileName), include.FileName);
+        if (!AppendSource(includeFile, true, depth + 1, data))
+            return false;
+    }
+    return true;
+}
+
+bool TInterfaceHash::HashUnit(const String& pasFile, const String& hppFile, THash128& hash)
+{
+    std::string data;
+    if (!AppendSource(pasFile, false, 0, data))
+        return false;
+
+    if (!hppFile.IsEmpty() && FileExists(hppFile))
+    {
+        THash128 hppHash;
+        if (!TContentHash::HashFile(hppFile, hppHash))
+            return false;
+        data.append(reinterpret_cast<const char*>(&hppHash.Low), sizeof(hppHash.Low));
+        data.append(reinterpret_cast<const char*>(&hppHash.High), sizeof(hppHash.High));
+    }
+
+    hash = TContentHash::HashBuffer(data.data(), data.size());
+    return true;
+}
+
+THash128 TInterfaceHash::Combine(const std::vector<THash128>& parts)
+{
+    std::vector<uint64_t> words;
+    for (const auto& part : parts)
+    {
+        words.push_back(part.Low);
+        words.push_back(part.High);
+    }
+    return TContentHash::HashBuffer(words.data(), words.size() * sizeof(uint64_t));
+}
+
+} // namespace DxCore
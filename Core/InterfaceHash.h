@@ -0,0 +1,46 @@
+//---------------------------------------------------------------------------
+// InterfaceHash - Fingerprints of what dependent packages compile against
+//
+// A package that requires another one only sees the interface sections of
+// its units. The fingerprint of a unit is a hash of its source up to
+// 'implementation', with comments, whitespace and case normalised, plus
+// the include files named there and - when C++ files were generated - the
+// .hpp the compiler wrote for it. Two exceptions widen it to the whole
+// unit: inline routines and generic declarations, whose implementation
+// the compiler copies into the units that use them.
+//
+// The .dcp/.dcu format is undocumented, so the binary interface is not
+// read; a fingerprint may change when the binary one would not (an extra
+// rebuild), never the other way round.
+//---------------------------------------------------------------------------
+#ifndef InterfaceHashH
+#define InterfaceHashH
+
+#include <System.hpp>
+#include <vector>
+#include "ContentHash.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Interface hash
+//---------------------------------------------------------------------------
+class TInterfaceHash
+{
+private:
+    static bool AppendSource(const String& fileName, bool wholeFile, int depth, std::string& data);
+
+public:
+    // hppFile may be empty or missing. Returns false if the unit or an
+    // include file cannot be read.
+    static bool HashUnit(const String& pasFile, const String& hppFile, THash128& hash);
+
+    // Order-dependent combination (units of a package, then the
+    // fingerprints of the packages it requires)
+    static THash128 Combine(const std::vector<THash128>& parts);
+};
+
+} // namespace DxCore
+
+#endif
@@ -26,6 +26,52 @@ TCompileOptions::~TCompileOptions()
     delete Defines;
 }
 
+//---------------------------------------------------------------------------
+// Process priority
+//---------------------------------------------------------------------------
+// A child that needs more than a priority class starts suspended, so that
+// it does no work before ApplyProcessPriority has finished it
+static DWORD PriorityCreationFlags(const TProcessPriority& priority)
+{
+    DWORD flags = 0;
+    if (priority.Background)
+        flags |= BELOW_NORMAL_PRIORITY_CLASS;
+    if (priority.Background || priority.AffinityMask != 0)
+        flags |= CREATE_SUSPENDED;
+    return flags;
+}
+
+// PROCESS_MODE_BACKGROUND_BEGIN only applies to the calling process; the
+// I/O priority of a child is set through ntdll, where available
+static void SetLowIoPriority(HANDLE process)
+{
+    typedef LONG (NTAPI *TNtSetInformationProcess)(HANDLE, ULONG, PVOID, ULONG);
+    static const TNtSetInformationProcess setInformation = reinterpret_cast<TNtSetInformationProcess>(
+        GetProcAddress(GetModuleHandleW(L"ntdll.dll"), "NtSetInformationProcess"));
+    if (!setInformation)
+        return;
+    
+    const ULONG ProcessIoPriority = 33;
+    ULONG ioPriority = 1;   // IoPriorityLow; VeryLow would starve it behind any other I/O
+    setInformation(process, ProcessIoPriority, &ioPriority, sizeof(ioPriority));
+}
+
+static void ApplyProcessPriority(const PROCESS_INFORMATION& pi, const TProcessPriority& priority)
+{
+    if (priority.AffinityMask != 0)
+    {
+        DWORD_PTR processMask = 0, systemMask = 0;
+        GetProcessAffinityMask(GetCurrentProcess(), &processMask, &systemMask);
+        DWORD_PTR mask = priority.AffinityMask & processMask;
+        if (mask != 0)
+            SetProcessAffinityMask(pi.hProcess, mask);
+    }
+    if (priority.Background)
+        SetLowIoPriority(pi.hProcess);
+    if (PriorityCreationFlags(priority) & CREATE_SUSPENDED)
+        ResumeThread(pi.hThread);
+}
+
 //---------------------------------------------------------------------------
 // TPackageCompiler implementation
 //---------------------------------------------------------------------------
@@ -79,38 +125,6 @@ bool TPackageCompiler::IsPlatformSupported(const TIDEInfoPtr& ide, TIDEPlatform
     }
 }
 
-TCompileResult TPackageCompiler::Compile(const TIDEInfoPtr& ide,
-                                          TIDEPlatform platform,
-                                          const TCompileOptions& options)
-{
-    TCompileResult result;
-    
-    if (!IsPlatformSupported(ide, platform))
-    {
-        result.Success = false;
-        result.ErrorMessage = L"Platform not supported by this IDE";
-        return result;
-    }
-    
-    String compilerPath = GetCompilerPath(ide, platform);
-    if (!FileExists(compilerPath))
-    {
-        result.Success = false;
-        result.ErrorMessage = L"Compiler not found: " + compilerPath;
-        return result;
-    }
-    
-    String cmdLine = BuildCommandLine(ide, platform, options);
-    String workDir = TPath::GetDirectoryName(options.PackagePath);
-    
-    OutputLine(L"Compiling: " + TPath::GetFileName(options.PackagePath));
-    OutputLine(L"Compiler: " + compilerPath);
-    
-    result = ExecuteCompiler(compilerPath, cmdLine, workDir);
-    
-    return result;
-}
-
 String TPackageCompiler::BuildCommandLine(const TIDEInfoPtr& ide,
                                            TIDEPlatform platform,
                                            const TCompileOptions& options)
@@ -197,104 +211,25 @@ String TPackageCompiler::BuildCommandLine(const TIDEInfoPtr& ide,
     return cmd;
 }
 
-TCompileResult TPackageCompiler::ExecuteCompiler(const String& compilerPath,
-                                                  const String& cmdLine,
-                                                  const String& workDir)
+TCompileResult TPackageCompiler::ExecuteTool(const String& toolPath,
+                                              const String& cmdLine,
+                                              const String& workDir)
 {
-    TCompileResult result;
-    
-    SECURITY_ATTRIBUTES sa;
-    sa.nLength = sizeof(sa);
-    sa.bInheritHandle = TRUE;
-    sa.lpSecurityDescriptor = nullptr;
-    
-    HANDLE hReadPipe, hWritePipe;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0))
-    {
-        result.Success = false;
-        result.ErrorMessage = L"Failed to create pipe";
-        return result;
-    }
-    
-    SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
-    
-    STARTUPINFOW si = {0};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-    si.wShowWindow = SW_HIDE;
-    
-    PROCESS_INFORMATION pi = {0};
-    
-    String fullCmd = L"\"" + compilerPath + L"\" " + cmdLine;
-    
-    std::vector<wchar_t> cmdBuffer(fullCmd.Length() + 1);
-    wcscpy(cmdBuffer.data(), fullCmd.c_str());
-    
-    BOOL created = CreateProcessW(
-        nullptr,
-        cmdBuffer.data(),
-        nullptr,
-        nullptr,
-        TRUE,
-        CREATE_NO_WINDOW,
-        nullptr,
-        workDir.c_str(),
-        &si,
-        &pi
-    );
-    
-    CloseHandle(hWritePipe);
+    TCompilerProcess process([this](const String& line) { OutputLine(line); });
+    process.SetPriority(FPriority);
     
-    if (!created)
+    String errorMessage;
+    if (!process.Start(toolPath, cmdLine, workDir, errorMessage))
     {
-        CloseHandle(hReadPipe);
+        TCompileResult result;
         result.Success = false;
-        result.ErrorMessage = L"Failed to start compiler";
+        result.ErrorMessage = errorMessage;
         return result;
     }
     
-    String output;
-    char buffer[4096];
-    DWORD bytesRead;
-    
-    while (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, nullptr) && bytesRead > 0)
-    {
-        buffer[bytesRead] = '\0';
-        String line = String(buffer);
-        output = output + line;
-        
-        int pos;
-        while ((pos = output.Pos(L"\n")) > 0)
-        {
-            String singleLine = output.SubString(1, pos - 1).Trim();
-            if (!singleLine.IsEmpty())
-                OutputLine(singleLine);
-            output = output.SubString(pos + 1, output.Length() - pos);
-        }
-    }
-    
-    if (!output.Trim().IsEmpty())
-        OutputLine(output.Trim());
-    
-    WaitForSingleObject(pi.hProcess, INFINITE);
-    
-    DWORD exitCode;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
-    
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    CloseHandle(hReadPipe);
-    
-    result.ExitCode = static_cast<int>(exitCode);
-    result.Success = (exitCode == 0);
-    result.Output = output;
-    
-    if (!result.Success)
-        result.ErrorMessage = L"Compilation failed with exit code " + String(static_cast<int>(exitCode));
-    
-    return result;
+    process.ReadToEnd();
+    WaitForSingleObject(process.GetProcessHandle(), INFINITE);
+    return process.Finish();
 }
 
 TCompileResult TPackageCompiler::GenerateCoffLib(const TIDEInfoPtr& ide,
@@ -333,106 +268,250 @@ TCompileResult TPackageCompiler::GenerateCoffLib(const TIDEInfoPtr& ide,
     OutputLine(L"From BPL: " + TPath::GetFileName(bplPath));
     OutputLine(L"Using: " + mkexpPath);
     
-    // Execute mkexp
+    result = ExecuteTool(mkexpPath, cmdLine, TPath::GetDirectoryName(bplPath));
+    if (result.Success && !FileExists(libOutputPath))
+    {
+        result.Success = false;
+        result.ErrorMessage = L"mkexp.exe did not create output file: " + libOutputPath;
+    }
+    
+    return result;
+}
+
+//---------------------------------------------------------------------------
+// TCompilerProcess implementation
+//---------------------------------------------------------------------------
+TCompilerProcess::TCompilerProcess(TOutputCallback onOutput)
+    : FOnOutput(onOutput),
+      FProcess(nullptr),
+      FReadPipe(nullptr),
+      FMultiplexer(nullptr),
+      FChannel(0),
+      FOutputClosed(false),
+      FExited(false)
+{
+}
+
+TCompilerProcess::~TCompilerProcess()
+{
+    Terminate();
+}
+
+bool TCompilerProcess::Start(const String& compilerPath, const String& cmdLine,
+                             const String& workDir, String& errorMessage,
+                             TPipeMultiplexer* multiplexer)
+{
     SECURITY_ATTRIBUTES sa;
     sa.nLength = sizeof(sa);
     sa.bInheritHandle = TRUE;
     sa.lpSecurityDescriptor = nullptr;
     
+    // A roomy pipe: output is drained by polling, the compiler must not
+    // stall on a full pipe in between. The multiplexer needs an
+    // overlapped read end, which anonymous pipes do not have.
     HANDLE hReadPipe, hWritePipe;
-    if (!CreatePipe(&hReadPipe, &hWritePipe, &sa, 0))
+    bool piped = multiplexer
+        ? TPipeMultiplexer::CreateOverlappedPipe(hReadPipe, hWritePipe, 64 * 1024)
+        : CreatePipe(&hReadPipe, &hWritePipe, &sa, 64 * 1024) != 0;
+    if (!piped)
     {
-        result.Success = false;
-        result.ErrorMessage = L"Failed to create pipe";
-        return result;
+        errorMessage = L"Failed to create pipe";
+        return false;
     }
     
     SetHandleInformation(hReadPipe, HANDLE_FLAG_INHERIT, 0);
     
-    STARTUPINFOW si = {0};
-    si.cb = sizeof(si);
-    si.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
-    si.hStdOutput = hWritePipe;
-    si.hStdError = hWritePipe;
-    si.wShowWindow = SW_HIDE;
+    STARTUPINFOEXW si = {0};
+    si.StartupInfo.cb = sizeof(si);
+    si.StartupInfo.dwFlags = STARTF_USESTDHANDLES | STARTF_USESHOWWINDOW;
+    si.StartupInfo.hStdOutput = hWritePipe;
+    si.StartupInfo.hStdError = hWritePipe;
+    si.StartupInfo.wShowWindow = SW_HIDE;
+    
+    // Inherit only this pipe. Concurrent compilers would otherwise
+    // inherit each other's write ends and delay their EOF.
+    SIZE_T attrSize = 0;
+    InitializeProcThreadAttributeList(nullptr, 1, 0, &attrSize);
+    std::vector<BYTE> attrBuffer(attrSize);
+    DWORD creationFlags = CREATE_NO_WINDOW | PriorityCreationFlags(FPriority);
+    
+    si.lpAttributeList = reinterpret_cast<LPPROC_THREAD_ATTRIBUTE_LIST>(attrBuffer.data());
+    if (InitializeProcThreadAttributeList(si.lpAttributeList, 1, 0, &attrSize))
+    {
+        if (UpdateProcThreadAttribute(si.lpAttributeList, 0, PROC_THREAD_ATTRIBUTE_HANDLE_LIST,
+                                      &hWritePipe, sizeof(HANDLE), nullptr, nullptr))
+        {
+            creationFlags |= EXTENDED_STARTUPINFO_PRESENT;
+        }
+        else
+        {
+            DeleteProcThreadAttributeList(si.lpAttributeList);
+            si.lpAttributeList = nullptr;
+        }
+    }
+    else
+    {
+        si.lpAttributeList = nullptr;
+    }
     
     PROCESS_INFORMATION pi = {0};
     
-    String fullCmd = L"\"" + mkexpPath + L"\" " + cmdLine;
+    String fullCmd = L"\"" + compilerPath + L"\" " + cmdLine;
     
     std::vector<wchar_t> cmdBuffer(fullCmd.Length() + 1);
     wcscpy(cmdBuffer.data(), fullCmd.c_str());
     
-    String workDir = TPath::GetDirectoryName(bplPath);
-    
     BOOL created = CreateProcessW(
         nullptr,
         cmdBuffer.data(),
         nullptr,
         nullptr,
         TRUE,
-        CREATE_NO_WINDOW,
+        creationFlags,
         nullptr,
         workDir.c_str(),
-        &si,
+        &si.StartupInfo,
         &pi
     );
     
+    if (si.lpAttributeList)
+        DeleteProcThreadAttributeList(si.lpAttributeList);
     CloseHandle(hWritePipe);
     
     if (!created)
     {
         CloseHandle(hReadPipe);
-        result.Success = false;
-        result.ErrorMessage = L"Failed to start mkexp.exe";
-        return result;
+        errorMessage = L"Failed to start compiler";
+        return false;
     }
     
-    String output;
-    char buffer[4096];
-    DWORD bytesRead;
-    
-    while (ReadFile(hReadPipe, buffer, sizeof(buffer) - 1, &bytesRead, nullptr) && bytesRead > 0)
+    ApplyProcessPriority(pi, FPriority);
+    CloseHandle(pi.hThread);
+    FProcess = pi.hProcess;
+    FReadPipe = hReadPipe;
+    FPartialLine = L"";
+    FOutput = L"";
+    FOutputClosed = false;
+    FExited = false;
+    
+    if (multiplexer)
     {
-        buffer[bytesRead] = '\0';
-        String line = String(buffer);
-        output = output + line;
-        
-        int pos;
-        while ((pos = output.Pos(L"\n")) > 0)
+        FChannel = multiplexer->Add(FReadPipe, FProcess,
+            [this](const char* data, DWORD size) { AddOutput(data, size); },
+            [this]() { FOutputClosed = true; },
+            [this]() { FExited = true; });
+        if (FChannel == 0)
         {
-            String singleLine = output.SubString(1, pos - 1).Trim();
-            if (!singleLine.IsEmpty())
-                OutputLine(singleLine);
-            output = output.SubString(pos + 1, output.Length() - pos);
+            Terminate();
+            errorMessage = L"Failed to watch compiler output";
+            return false;
         }
+        FMultiplexer = multiplexer;
     }
+    return true;
+}
+
+void TCompilerProcess::AddOutput(const char* data, DWORD size)
+{
+    String text = String(AnsiString(data, size));
+    FOutput = FOutput + text;
+    FPartialLine = FPartialLine + text;
     
-    if (!output.Trim().IsEmpty())
-        OutputLine(output.Trim());
+    int pos;
+    while ((pos = FPartialLine.Pos(L"\n")) > 0)
+    {
+        String singleLine = FPartialLine.SubString(1, pos - 1).Trim();
+        if (!singleLine.IsEmpty() && FOnOutput)
+            FOnOutput(singleLine);
+        FPartialLine = FPartialLine.SubString(pos + 1, FPartialLine.Length() - pos);
+    }
+}
+
+void TCompilerProcess::FlushPartialLine()
+{
+    String rest = FPartialLine.Trim();
+    FPartialLine = L"";
+    if (!rest.IsEmpty() && FOnOutput)
+        FOnOutput(rest);
+}
+
+void TCompilerProcess::ReadAvailable()
+{
+    if (!FReadPipe || FMultiplexer)
+        return;
+    
+    char buffer[4096];
+    DWORD available = 0;
+    while (PeekNamedPipe(FReadPipe, nullptr, 0, nullptr, &available, nullptr) && available > 0)
+    {
+        DWORD bytesRead = 0;
+        DWORD toRead = available < sizeof(buffer) ? available : (DWORD)sizeof(buffer);
+        if (!ReadFile(FReadPipe, buffer, toRead, &bytesRead, nullptr) || bytesRead == 0)
+            break;
+        AddOutput(buffer, bytesRead);
+    }
+}
+
+void TCompilerProcess::ReadToEnd()
+{
+    if (!FReadPipe || FMultiplexer)
+        return;
     
-    WaitForSingleObject(pi.hProcess, INFINITE);
+    char buffer[4096];
+    DWORD bytesRead;
+    while (ReadFile(FReadPipe, buffer, sizeof(buffer), &bytesRead, nullptr) && bytesRead > 0)
+        AddOutput(buffer, bytesRead);
+}
+
+TCompileResult TCompilerProcess::Finish()
+{
+    TCompileResult result;
+    if (!FProcess)
+    {
+        result.ErrorMessage = L"Compiler is not running";
+        return result;
+    }
     
-    DWORD exitCode;
-    GetExitCodeProcess(pi.hProcess, &exitCode);
+    ReadToEnd();
+    FlushPartialLine();
     
-    CloseHandle(pi.hProcess);
-    CloseHandle(pi.hThread);
-    CloseHandle(hReadPipe);
+    DWORD exitCode = (DWORD)-1;
+    GetExitCodeProcess(FProcess, &exitCode);
+    CloseHandles();
     
     result.ExitCode = static_cast<int>(exitCode);
-    result.Success = (exitCode == 0) && FileExists(libOutputPath);
-    result.Output = output;
+    result.Success = (exitCode == 0);
+    result.Output = FOutput;
     
     if (!result.Success)
-    {
-        if (!FileExists(libOutputPath))
-            result.ErrorMessage = L"mkexp.exe did not create output file: " + libOutputPath;
-        else
-            result.ErrorMessage = L"mkexp.exe failed with exit code " + String(static_cast<int>(exitCode));
-    }
+        result.ErrorMessage = L"Compilation failed with exit code " + String(static_cast<int>(exitCode));
     
     return result;
 }
 
+void TCompilerProcess::Terminate()
+{
+    if (FProcess)
+    {
+        TerminateProcess(FProcess, 1);
+        WaitForSingleObject(FProcess, 5000);
+    }
+    CloseHandles();
+}
+
+void TCompilerProcess::CloseHandles()
+{
+    if (FMultiplexer)
+        FMultiplexer->Remove(FChannel);
+    FMultiplexer = nullptr;
+    FChannel = 0;
+    
+    if (FProcess)
+        CloseHandle(FProcess);
+    if (FReadPipe)
+        CloseHandle(FReadPipe);
+    FProcess = nullptr;
+    FReadPipe = nullptr;
+}
+
 } // namespace DxCore
@@ -6,8 +6,10 @@
 
 #include <System.hpp>
 #include <System.Classes.hpp>
+#include <Winapi.Windows.hpp>
 #include "IDEDetector.h"
 #include "Component.h"
+#include "PipeMultiplexer.h"
 
 namespace DxCore
 {
@@ -43,12 +45,81 @@ struct TCompileOptions
     ~TCompileOptions();
 };
 
+//---------------------------------------------------------------------------
+// Process priority of started compilers. Background runs them at
+// below-normal CPU and low I/O priority so that the machine stays usable
+// while an install rebuilds; a non-zero AffinityMask restricts them to
+// those CPUs (bits outside the installer's own mask are dropped).
+//---------------------------------------------------------------------------
+struct TProcessPriority
+{
+    bool Background;
+    DWORD_PTR AffinityMask;
+    
+    TProcessPriority() : Background(false), AffinityMask(0) {}
+};
+
 //---------------------------------------------------------------------------
 // Output callback type
 //---------------------------------------------------------------------------
 #include <functional>
 typedef std::function<void(const String&)> TOutputCallback;
 
+//---------------------------------------------------------------------------
+// Compiler process - one running compiler that is polled instead of
+// waited for, so a single thread can drive several of them. Started with
+// a TPipeMultiplexer, its output arrives through the multiplexer's Pump
+// instead; ReadAvailable and ReadToEnd then do nothing.
+//---------------------------------------------------------------------------
+class TCompilerProcess
+{
+private:
+    TOutputCallback FOnOutput;
+    HANDLE FProcess;
+    HANDLE FReadPipe;
+    String FPartialLine;
+    String FOutput;
+    TProcessPriority FPriority;
+    
+    TPipeMultiplexer* FMultiplexer;
+    ULONG_PTR FChannel;
+    bool FOutputClosed;
+    bool FExited;
+    
+    void AddOutput(const char* data, DWORD size);
+    void FlushPartialLine();
+    void CloseHandles();
+    
+public:
+    explicit TCompilerProcess(TOutputCallback onOutput = nullptr);
+    ~TCompilerProcess();    // Terminates a compiler that is still running
+    
+    // Applies to the next Start
+    void SetPriority(const TProcessPriority& value) { FPriority = value; }
+    
+    // Starts the compiler and returns immediately
+    bool Start(const String& compilerPath, const String& cmdLine,
+               const String& workDir, String& errorMessage,
+               TPipeMultiplexer* multiplexer = nullptr);
+    
+    bool IsRunning() const { return FProcess != nullptr; }
+    HANDLE GetProcessHandle() const { return FProcess; }   // Signalled on exit
+    // Multiplexed: the compiler has exited and all its output was passed on
+    bool IsDone() const { return FOutputClosed && FExited; }
+    
+    // Passes on whatever output is available, without blocking
+    void ReadAvailable();
+    // Blocks until the compiler closes its output
+    void ReadToEnd();
+    
+    // Collects the result of an exited compiler (reads remaining output)
+    TCompileResult Finish();
+    void Terminate();
+    
+    TCompilerProcess(const TCompilerProcess&) = delete;
+    TCompilerProcess& operator=(const TCompilerProcess&) = delete;
+};
+
 //---------------------------------------------------------------------------
 // Package Compiler
 //---------------------------------------------------------------------------
@@ -56,23 +127,22 @@ class TPackageCompiler
 {
 private:
     TOutputCallback FOnOutput;
+    TProcessPriority FPriority;
     
-    String BuildCommandLine(const TIDEInfoPtr& ide, 
-                            TIDEPlatform platform,
-                            const TCompileOptions& options);
-    TCompileResult ExecuteCompiler(const String& compilerPath, 
-                                    const String& cmdLine,
-                                    const String& workDir);
+    // Runs a tool to completion, passing its output on line by line
+    TCompileResult ExecuteTool(const String& toolPath,
+                               const String& cmdLine,
+                               const String& workDir);
     void OutputLine(const String& line);
     
 public:
     TPackageCompiler();
     ~TPackageCompiler();
     
-    // Compile a package
-    TCompileResult Compile(const TIDEInfoPtr& ide,
-                           TIDEPlatform platform,
-                           const TCompileOptions& options);
+    // Compiler arguments for a package (everything after the compiler path)
+    String BuildCommandLine(const TIDEInfoPtr& ide, 
+                            TIDEPlatform platform,
+                            const TCompileOptions& options);
     
     // Generate COFF .lib from .bpl using mkexp.exe (for Win64x)
     TCompileResult GenerateCoffLib(const TIDEInfoPtr& ide,
@@ -82,6 +152,10 @@ public:
     // Output callback
     void SetOnOutput(TOutputCallback callback) { FOnOutput = callback; }
     
+    // Priority of the compiler and mkexp processes
+    const TProcessPriority& GetPriority() const { return FPriority; }
+    void SetPriority(const TProcessPriority& value) { FPriority = value; }
+    
     // Get compiler path for platform
     static String GetCompilerPath(const TIDEInfoPtr& ide, TIDEPlatform platform);
     
@@ -0,0 +1,359 @@
+//---------------------------------------------------------------------------
+// PackageRules implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "PackageRules.h"
+#include <mutex>
+#include <deque>
+#include <algorithm>
+#include <iterator>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Names
+//---------------------------------------------------------------------------
+static const wchar_t* const RuleSetNames[PackageRuleSetCount] = { L"Category", L"Installed", L"Vendor" };
+
+// Category and Installed tags, in TPackageCategory / TThirdPartyComponent terms
+struct TComponentTag
+{
+    const wchar_t* Name;
+    TPackageCategory Category;
+    TThirdPartyComponent Component;
+};
+
+static const TComponentTag ComponentTags[] =
+{
+    { L"IBX",      TPackageCategory::IBX,      TThirdPartyComponent::IBX },
+    { L"TeeChart", TPackageCategory::TeeChart, TThirdPartyComponent::TeeChart },
+    { L"FireDAC",  TPackageCategory::FireDAC,  TThirdPartyComponent::FireDAC },
+    { L"BDE",      TPackageCategory::BDE,      TThirdPartyComponent::BDE }
+};
+
+static const int ComponentTagCount = sizeof(ComponentTags) / sizeof(ComponentTags[0]);
+
+static int FindComponentTag(const String& tag)
+{
+    for (int i = 0; i < ComponentTagCount; i++)
+    {
+        if (SameText(tag, ComponentTags[i].Name))
+            return i;
+    }
+    return -1;
+}
+
+static bool IsValidPattern(const String& pattern)
+{
+    if (pattern.IsEmpty())
+        return false;
+    for (int i = 1; i <= pattern.Length(); i++)
+    {
+        if (pattern[i] <= L' ' || pattern[i] >= 0x7F)
+            return false;
+    }
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// TPackageClassifier construction
+//---------------------------------------------------------------------------
+TPackageClassifier::TPackageClassifier(const TPackageRuleList& rules)
+{
+    FGoto.assign(AlphabetSize, -1);
+    FOutput.resize(1);
+
+    // Trie of all patterns
+    for (const auto& rule : rules)
+    {
+        if (!IsValidPattern(rule.Pattern))
+            continue;
+
+        TCompiledRule compiled;
+        compiled.Set = rule.Set;
+        compiled.Prefix = rule.Match == TPackageRuleMatch::Prefix;
+        compiled.Length = rule.Pattern.Length();
+        compiled.Tag = rule.Tag;
+        compiled.Value = -1;
+        if (rule.Set != TPackageRuleSet::Vendor)
+        {
+            int tag = FindComponentTag(rule.Tag);
+            if (tag < 0)
+                continue;
+            compiled.Tag = ComponentTags[tag].Name;
+            compiled.Value = rule.Set == TPackageRuleSet::Category
+                ? (int)ComponentTags[tag].Category
+                : (int)ComponentTags[tag].Component;
+        }
+
+        int node = 0;
+        for (int i = 1; i <= rule.Pattern.Length(); i++)
+        {
+            int c = (int)rule.Pattern[i];
+            if (c >= L'A' && c <= L'Z')
+                c += L'a' - L'A';
+
+            int& next = FGoto[node * AlphabetSize + c];
+            if (next < 0)
+            {
+                next = (int)FOutput.size();
+                FOutput.resize(FOutput.size() + 1);
+                FGoto.resize(FGoto.size() + AlphabetSize, -1);
+            }
+            node = FGoto[node * AlphabetSize + c];   // FGoto may have moved
+        }
+
+        FOutput[node].push_back((int)FRules.size());
+        FRules.push_back(compiled);
+    }
+
+    // Failure links, breadth first. Missing transitions are replaced by
+    // those of the failure node, which turns the trie into a DFA; outputs
+    // of the failure node are merged in, keeping rule order.
+    std::vector<int> fail(FOutput.size(), 0);
+    std::deque<int> queue;
+    for (int c = 0; c < AlphabetSize; c++)
+    {
+        int& next = FGoto[c];
+        if (next < 0)
+            next = 0;
+        else
+            queue.push_back(next);
+    }
+
+    while (!queue.empty())
+    {
+        int node = queue.front();
+        queue.pop_front();
+
+        for (int c = 0; c < AlphabetSize; c++)
+        {
+            int& next = FGoto[node * AlphabetSize + c];
+            int fallback = FGoto[fail[node] * AlphabetSize + c];
+            if (next < 0)
+            {
+                next = fallback;
+                continue;
+            }
+
+            fail[next] = fallback;
+            if (!FOutput[fallback].empty())
+            {
+                std::vector<int> merged;
+                std::merge(FOutput[next].begin(), FOutput[next].end(),
+                           FOutput[fallback].begin(), FOutput[fallback].end(),
+                           std::back_inserter(merged));
+                FOutput[next].swap(merged);
+            }
+            queue.push_back(next);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// Matching
+//---------------------------------------------------------------------------
+TPackageClassifier::TResult TPackageClassifier::Classify(const String& name) const
+{
+    TResult result;
+    std::fill(result.Rule, result.Rule + PackageRuleSetCount, -1);
+
+    const wchar_t* p = name.c_str();
+    int length = name.Length();
+    int node = 0;
+    for (int i = 0; i < length; i++)
+    {
+        int c = (int)p[i];
+        if (c >= AlphabetSize)
+        {
+            node = 0;   // No pattern contains it
+            continue;
+        }
+        if (c >= L'A' && c <= L'Z')
+            c += L'a' - L'A';
+
+        node = FGoto[node * AlphabetSize + c];
+        for (int rule : FOutput[node])
+        {
+            const TCompiledRule& compiled = FRules[rule];
+            if (compiled.Prefix && compiled.Length != i + 1)
+                continue;
+
+            int& best = result.Rule[(int)compiled.Set];
+            if (best < 0 || rule < best)
+                best = rule;
+        }
+    }
+    return result;
+}
+
+String TPackageClassifier::GetVendor(const String& fileName) const
+{
+    int rule = Classify(fileName).Rule[(int)TPackageRuleSet::Vendor];
+    return rule >= 0 ? FRules[rule].Tag : String();
+}
+
+bool TPackageClassifier::IsDevExpress(const String& fileName) const
+{
+    return SameText(GetVendor(fileName), PackageRuleKeys::DevExpressVendor);
+}
+
+TPackageCategory TPackageClassifier::GetCategory(const String& packageName) const
+{
+    int rule = Classify(packageName).Rule[(int)TPackageRuleSet::Category];
+    return rule >= 0 ? (TPackageCategory)FRules[rule].Value : TPackageCategory::Normal;
+}
+
+bool TPackageClassifier::GetInstalledComponent(const String& knownPackage, TThirdPartyComponent& component) const
+{
+    int rule = Classify(knownPackage).Rule[(int)TPackageRuleSet::Installed];
+    if (rule < 0)
+        return false;
+    component = (TThirdPartyComponent)FRules[rule].Value;
+    return true;
+}
+
+//---------------------------------------------------------------------------
+// Rule tables
+//---------------------------------------------------------------------------
+const TPackageRuleList& TPackageClassifier::GetBuiltInRules()
+{
+    static const TPackageRuleList rules =
+    {
+        // Packages of DevExpress components that depend on a third party
+        { TPackageRuleSet::Category, TPackageRuleMatch::Contains, L"ibx", L"IBX" },
+        { TPackageRuleSet::Category, TPackageRuleMatch::Contains, L"teechart", L"TeeChart" },
+        { TPackageRuleSet::Category, TPackageRuleMatch::Contains, L"firedac", L"FireDAC" },
+        { TPackageRuleSet::Category, TPackageRuleMatch::Contains, L"bde", L"BDE" },
+
+        // Design-time packages in Known Packages that show a third party is installed
+        { TPackageRuleSet::Installed, TPackageRuleMatch::Contains, L"dclib", L"IBX" },
+        { TPackageRuleSet::Installed, TPackageRuleMatch::Contains, L"dcltee", L"TeeChart" },
+        { TPackageRuleSet::Installed, TPackageRuleMatch::Contains, L"dclfiredac", L"FireDAC" },
+        { TPackageRuleSet::Installed, TPackageRuleMatch::Contains, L"anydac_", L"FireDAC" },
+        { TPackageRuleSet::Installed, TPackageRuleMatch::Contains, L"dclbde", L"BDE" },
+
+        // dxCore, cxGrid, dcldxCore, dclcxGrid
+        { TPackageRuleSet::Vendor, TPackageRuleMatch::Prefix, L"dx", PackageRuleKeys::DevExpressVendor },
+        { TPackageRuleSet::Vendor, TPackageRuleMatch::Prefix, L"cx", PackageRuleKeys::DevExpressVendor },
+        { TPackageRuleSet::Vendor, TPackageRuleMatch::Prefix, L"dcldx", PackageRuleKeys::DevExpressVendor },
+        { TPackageRuleSet::Vendor, TPackageRuleMatch::Prefix, L"dclcx", PackageRuleKeys::DevExpressVendor }
+    };
+    return rules;
+}
+
+TPackageRuleList TPackageClassifier::WithBuiltInRules(const TPackageRuleList& profileRules)
+{
+    // The first matching rule of a set wins
+    TPackageRuleList rules = profileRules;
+    const TPackageRuleList& builtIn = GetBuiltInRules();
+    rules.insert(rules.end(), builtIn.begin(), builtIn.end());
+    return rules;
+}
+
+bool TPackageClassifier::ParseProfileEntry(const String& key, const String& value, TPackageRuleList& rules)
+{
+    int dot = key.Pos(L".");
+    if (dot <= 1 || dot == key.Length())
+        return false;
+
+    String setName = key.SubString(1, dot - 1).Trim();
+    String tag = key.SubString(dot + 1, key.Length() - dot).Trim();
+    int set = -1;
+    for (int i = 0; i < PackageRuleSetCount; i++)
+    {
+        if (SameText(setName, RuleSetNames[i]))
+            set = i;
+    }
+    if (set < 0 || tag.IsEmpty())
+        return false;
+    if (set != (int)TPackageRuleSet::Vendor && FindComponentTag(tag) < 0)
+        return false;
+
+    TPackageRuleList parsed;
+    const wchar_t* p = value.c_str();
+    const wchar_t* end = p + value.Length();
+    while (p < end)
+    {
+        while (p < end && (*p == L',' || *p <= L' '))
+            p++;
+
+        const wchar_t* start = p;
+        while (p < end && *p != L',' && *p > L' ')
+            p++;
+        if (p == start)
+            continue;
+
+        String token(start, static_cast<int>(p - start));
+        TPackageRuleMatch match = TPackageRuleMatch::Contains;
+        int colon = token.Pos(L":");
+        if (colon > 0)
+        {
+            String kind = token.SubString(1, colon - 1);
+            if (SameText(kind, L"prefix"))
+                match = TPackageRuleMatch::Prefix;
+            else if (!SameText(kind, L"contains"))
+                return false;
+            token = token.SubString(colon + 1, token.Length() - colon);
+        }
+        if (!IsValidPattern(token))
+            return false;
+
+        parsed.push_back(TPackageRule((TPackageRuleSet)set, match, token.LowerCase(), tag));
+    }
+
+    if (parsed.empty())
+        return false;
+    rules.insert(rules.end(), parsed.begin(), parsed.end());
+    return true;
+}
+
+void TPackageClassifier::FormatProfileEntries(const TPackageRuleList& rules, TStrings* lines)
+{
+    std::vector<String> keys;
+    std::vector<String> values;
+    for (const auto& rule : rules)
+    {
+        String key = String(RuleSetNames[(int)rule.Set]) + L"." + rule.Tag;
+        String pattern = (rule.Match == TPackageRuleMatch::Prefix ? L"prefix:" : L"contains:") + rule.Pattern;
+
+        size_t i = 0;
+        while (i < keys.size() && !SameText(keys[i], key))
+            i++;
+        if (i == keys.size())
+        {
+            keys.push_back(key);
+            values.push_back(pattern);
+        }
+        else
+        {
+            values[i] = values[i] + L", " + pattern;
+        }
+    }
+
+    for (size_t i = 0; i < keys.size(); i++)
+        lines->Add(keys[i] + L" = " + values[i]);
+}
+
+//---------------------------------------------------------------------------
+// Shared classifier
+//---------------------------------------------------------------------------
+static std::mutex SharedLock;
+static TPackageClassifierPtr SharedClassifier;
+
+TPackageClassifierPtr TPackageClassifier::GetShared()
+{
+    std::lock_guard<std::mutex> guard(SharedLock);
+    if (!SharedClassifier)
+        SharedClassifier = std::make_shared<TPackageClassifier>(GetBuiltInRules());
+    return SharedClassifier;
+}
+
+void TPackageClassifier::SetShared(TPackageClassifierPtr classifier)
+{
+    std::lock_guard<std::mutex> guard(SharedLock);
+    SharedClassifier = classifier;
+}
+
+} // namespace DxCore
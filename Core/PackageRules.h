@@ -0,0 +1,142 @@
+//---------------------------------------------------------------------------
+// PackageRules - Name-based package classification
+//
+// Packages are classified by name in several places: the package category
+// (dxFireDACEMF -> FireDAC), third-party detection from the Known Packages
+// key (dclib*.bpl -> IBX installed) and the DevExpress test of the
+// uninstall cleanup (dx*, cx*, dcldx*, dclcx*). All of them use one rule
+// table. A rule is a pattern that must start the name (prefix) or appear
+// anywhere in it (contains) and assigns a tag within its rule set. The
+// first matching rule of a set wins; rules from Profile.ini come before
+// the built-in ones, so they can override them.
+//
+// The patterns of all sets are compiled into one Aho-Corasick automaton
+// over case-folded ASCII: a name is scanned once, without copying or
+// case-converting it, whatever the number of rules.
+//
+// Profile.ini may add rules in a [@PackageRules] section:
+//
+//   [@PackageRules]
+//   Vendor.dxgettext = prefix:dxgettext
+//   Installed.FireDAC = contains:dclfiredac, contains:anydac_
+//
+// The key is <set>.<tag>, the value a list of prefix:/contains: patterns
+// (contains: if omitted). Category and Installed tags are IBX, TeeChart,
+// FireDAC and BDE. Vendor tags are free-form; files of the "DevExpress"
+// vendor are the ones the uninstall removes.
+//---------------------------------------------------------------------------
+#ifndef PackageRulesH
+#define PackageRulesH
+
+#include <System.hpp>
+#include <System.Classes.hpp>
+#include <vector>
+#include <memory>
+#include "Component.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Rule
+//---------------------------------------------------------------------------
+enum class TPackageRuleSet
+{
+    Category,     // Package name -> TPackageCategory
+    Installed,    // Known Packages value name -> TThirdPartyComponent
+    Vendor        // File name -> vendor
+};
+
+const int PackageRuleSetCount = 3;
+
+enum class TPackageRuleMatch
+{
+    Prefix,
+    Contains
+};
+
+struct TPackageRule
+{
+    TPackageRuleSet Set;
+    TPackageRuleMatch Match;
+    String Pattern;           // ASCII, case-insensitive
+    String Tag;
+
+    TPackageRule() : Set(TPackageRuleSet::Category), Match(TPackageRuleMatch::Contains) {}
+    TPackageRule(TPackageRuleSet set, TPackageRuleMatch match, const String& pattern, const String& tag)
+        : Set(set), Match(match), Pattern(pattern), Tag(tag) {}
+};
+
+typedef std::vector<TPackageRule> TPackageRuleList;
+
+//---------------------------------------------------------------------------
+// Compiled rule table
+//---------------------------------------------------------------------------
+class TPackageClassifier
+{
+public:
+    // Winning rule per set, -1 if none matched
+    struct TResult
+    {
+        int Rule[PackageRuleSetCount];
+    };
+
+private:
+    static const int AlphabetSize = 128;
+
+    struct TCompiledRule
+    {
+        TPackageRuleSet Set;
+        bool Prefix;
+        int Length;
+        String Tag;
+        int Value;            // TPackageCategory / TThirdPartyComponent, -1 if not mapped
+    };
+
+    std::vector<TCompiledRule> FRules;
+    std::vector<int> FGoto;                  // Node * AlphabetSize + char -> node
+    std::vector<std::vector<int>> FOutput;   // Node -> rules ending there, by rule order
+
+public:
+    explicit TPackageClassifier(const TPackageRuleList& rules);
+
+    TResult Classify(const String& name) const;
+    int GetRuleCount() const { return (int)FRules.size(); }
+    const String& GetTag(int rule) const { return FRules[rule].Tag; }
+
+    // Convenience for the individual rule sets
+    String GetVendor(const String& fileName) const;                  // Empty if none
+    bool IsDevExpress(const String& fileName) const;
+    TPackageCategory GetCategory(const String& packageName) const;   // Normal if none
+    bool GetInstalledComponent(const String& knownPackage, TThirdPartyComponent& component) const;
+
+    // Built-in rules, the ones previously hard-coded at each call site
+    static const TPackageRuleList& GetBuiltInRules();
+    // Profile rules followed by the built-in ones, the order the installer
+    // compiles them in
+    static TPackageRuleList WithBuiltInRules(const TPackageRuleList& profileRules);
+
+    // Profile.ini entry ("Vendor.TMS", "prefix:tms, prefix:dcltms"). Returns
+    // false, adding nothing, if the key or a pattern is invalid.
+    static bool ParseProfileEntry(const String& key, const String& value, TPackageRuleList& rules);
+    // Inverse of ParseProfileEntry, one line per set and tag
+    static void FormatProfileEntries(const TPackageRuleList& rules, TStrings* lines);
+
+    // Process-wide classifier used by TPackage and the installer. Starts
+    // out with the built-in rules; TInstaller replaces it once the profile
+    // is loaded.
+    static std::shared_ptr<const TPackageClassifier> GetShared();
+    static void SetShared(std::shared_ptr<const TPackageClassifier> classifier);
+};
+
+typedef std::shared_ptr<const TPackageClassifier> TPackageClassifierPtr;
+
+namespace PackageRuleKeys
+{
+    const String Section = L"@PackageRules";
+    const String DevExpressVendor = L"DevExpress";
+}
+
+} // namespace DxCore
+
+#endif
@@ -0,0 +1,148 @@
+//---------------------------------------------------------------------------
+// PathList implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "PathList.h"
+#include <unordered_set>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// TPathList implementation
+//---------------------------------------------------------------------------
+TPathList::TPathList()
+    : FModified(false)
+{
+}
+
+TPathList::TPathList(const String& text)
+    : FModified(false)
+{
+    Parse(text);
+}
+
+String TPathList::Normalize(const String& path)
+{
+    String result = StringReplace(path.Trim(), L"/", L"\\", TReplaceFlags() << rfReplaceAll);
+
+    // Strip trailing delimiters, but keep a drive root like "C:\"
+    while (result.Length() > 1 && result[result.Length()] == L'\\' &&
+           !(result.Length() == 3 && result[2] == L':'))
+    {
+        result.SetLength(result.Length() - 1);
+    }
+
+    return result.LowerCase();
+}
+
+void TPathList::AddEntry(const String& entry)
+{
+    FEntries.push_back(entry);
+    FIndex[Normalize(entry)]++;
+}
+
+void TPathList::Parse(const String& text)
+{
+    FEntries.clear();
+    FIndex.clear();
+    FModified = false;
+
+    const wchar_t* p = text.c_str();
+    int length = text.Length();
+    int start = 0;
+
+    for (int i = 0; i <= length; i++)
+    {
+        if (i < length && p[i] != L';')
+            continue;
+
+        String entry = String(p + start, i - start).Trim();
+        if (!entry.IsEmpty())
+            AddEntry(entry);
+        start = i + 1;
+    }
+}
+
+String TPathList::ToString() const
+{
+    String result;
+    for (size_t i = 0; i < FEntries.size(); i++)
+    {
+        if (i > 0)
+            result += L";";
+        result += FEntries[i];
+    }
+    return result;
+}
+
+bool TPathList::Contains(const String& path) const
+{
+    return FIndex.find(Normalize(path)) != FIndex.end();
+}
+
+bool TPathList::Add(const String& path)
+{
+    String entry = path.Trim();
+    if (entry.IsEmpty() || Contains(entry))
+        return false;
+
+    AddEntry(entry);
+    FModified = true;
+    return true;
+}
+
+int TPathList::Remove(const String& path)
+{
+    std::vector<String> paths;
+    paths.push_back(path);
+    return RemoveRange(paths);
+}
+
+int TPathList::AddRange(const std::vector<String>& paths)
+{
+    int added = 0;
+    for (const auto& path : paths)
+    {
+        if (Add(path))
+            added++;
+    }
+    return added;
+}
+
+int TPathList::RemoveRange(const std::vector<String>& paths)
+{
+    std::unordered_set<String, TStringHash> keys;
+    for (const auto& path : paths)
+    {
+        String key = Normalize(path);
+        if (FIndex.find(key) != FIndex.end())
+            keys.insert(key);
+    }
+
+    if (keys.empty())
+        return 0;
+
+    // Single compacting pass over the entries
+    size_t kept = 0;
+    for (size_t i = 0; i < FEntries.size(); i++)
+    {
+        if (keys.find(Normalize(FEntries[i])) == keys.end())
+        {
+            if (kept != i)
+                FEntries[kept] = FEntries[i];
+            kept++;
+        }
+    }
+
+    int removed = (int)(FEntries.size() - kept);
+    FEntries.resize(kept);
+
+    for (const auto& key : keys)
+        FIndex.erase(key);
+
+    FModified = true;
+    return removed;
+}
+
+} // namespace DxCore
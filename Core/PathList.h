@@ -0,0 +1,60 @@
+//---------------------------------------------------------------------------
+// PathList - Parsed ';' separated path list (IDE search/browsing paths)
+//
+// Membership is exact per entry, not a substring test: "...\Win32" is not
+// found in a list that only contains "...\Win32x". Entries are compared in
+// normalized form (trimmed, '/' -> '\', no trailing delimiter, case-
+// insensitive) through a hash index, so lookups stay O(1) on 200-entry
+// search paths. Entry order and original spelling are preserved.
+//---------------------------------------------------------------------------
+#ifndef PathListH
+#define PathListH
+
+#include <System.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <unordered_map>
+#include "StringHash.h"
+
+namespace DxCore
+{
+
+class TPathList
+{
+private:
+    std::vector<String> FEntries;                           // Original spelling
+    std::unordered_map<String, int, TStringHash> FIndex;    // Normalized -> count
+    bool FModified;
+
+    void AddEntry(const String& entry);
+
+public:
+    TPathList();
+    explicit TPathList(const String& text);
+
+    // Comparison key of one entry
+    static String Normalize(const String& path);
+
+    void Parse(const String& text);
+    String ToString() const;
+
+    bool Contains(const String& path) const;
+    int GetCount() const { return (int)FEntries.size(); }
+    const String& GetEntry(int index) const { return FEntries[index]; }
+
+    // Append if not present; returns true if added
+    bool Add(const String& path);
+    // Remove every occurrence; returns number of removed entries
+    int Remove(const String& path);
+
+    // Batch variants keep the order of the remaining/added entries
+    int AddRange(const std::vector<String>& paths);
+    int RemoveRange(const std::vector<String>& paths);
+
+    // True once Add/Remove changed the list since Parse
+    bool IsModified() const { return FModified; }
+};
+
+} // namespace DxCore
+
+#endif
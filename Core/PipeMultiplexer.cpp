@@ -0,0 +1,211 @@
+//---------------------------------------------------------------------------
+// PipeMultiplexer implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "PipeMultiplexer.h"
+#include <vector>
+#include <atomic>
+
+namespace DxCore
+{
+
+// Events dispatched per wait on the port
+static const ULONG MAX_ENTRIES = 64;
+
+// How long the destructor waits for cancelled reads to come back
+static const DWORD SHUTDOWN_TIMEOUT_MS = 5000;
+
+// Packets posted to the port that are not read completions
+static OVERLAPPED ExitMarker;
+static OVERLAPPED ClosedMarker;
+
+//---------------------------------------------------------------------------
+// TPipeMultiplexer implementation
+//---------------------------------------------------------------------------
+TPipeMultiplexer::TPipeMultiplexer()
+    : FPort(CreateIoCompletionPort(INVALID_HANDLE_VALUE, nullptr, 0, 1)),
+      FNextKey(1)
+{
+}
+
+TPipeMultiplexer::~TPipeMultiplexer()
+{
+    std::vector<ULONG_PTR> keys;
+    for (const auto& it : FChannels)
+        keys.push_back(it.first);
+    for (ULONG_PTR key : keys)
+        Remove(key);
+
+    // A cancelled read still completes through the port, into the
+    // channel's buffer
+    DWORD start = GetTickCount();
+    while (!FChannels.empty() && GetTickCount() - start < SHUTDOWN_TIMEOUT_MS)
+        Pump(100);
+    for (auto& it : FChannels)
+        it.second.release();    // Still owned by the kernel - leaked, not freed
+
+    if (FPort)
+        CloseHandle(FPort);
+}
+
+ULONG_PTR TPipeMultiplexer::Add(HANDLE pipe, HANDLE process,
+                                TPipeDataEvent onData, TPipeEvent onClosed, TPipeEvent onExited)
+{
+    if (!FPort)
+        return 0;
+
+    ULONG_PTR key = FNextKey++;
+    if (CreateIoCompletionPort(pipe, FPort, key, 0) == nullptr)
+        return 0;
+
+    std::unique_ptr<TChannel> channel(new TChannel());
+    ZeroMemory(&channel->Overlapped, sizeof(channel->Overlapped));
+    channel->Owner = this;
+    channel->Key = key;
+    channel->Pipe = pipe;
+    channel->ExitWait = nullptr;
+    channel->ReadPending = false;
+    channel->Removed = false;
+    channel->OnData = onData;
+    channel->OnClosed = onClosed;
+    channel->OnExited = onExited;
+
+    TChannel* raw = channel.get();
+    FChannels[key] = std::move(channel);
+
+    if (!RegisterWaitForSingleObject(&raw->ExitWait, process, ProcessExited, raw,
+                                     INFINITE, WT_EXECUTEONLYONCE))
+    {
+        raw->ExitWait = nullptr;
+        Remove(key);
+        return 0;
+    }
+
+    StartRead(raw);
+    return key;
+}
+
+void TPipeMultiplexer::Remove(ULONG_PTR key)
+{
+    auto it = FChannels.find(key);
+    if (it == FChannels.end() || it->second->Removed)
+        return;
+
+    TChannel* channel = it->second.get();
+    channel->Removed = true;
+
+    // Waits for a running callback; an exit packet it posted is ignored
+    if (channel->ExitWait)
+        UnregisterWaitEx(channel->ExitWait, INVALID_HANDLE_VALUE);
+    channel->ExitWait = nullptr;
+
+    if (channel->ReadPending)
+        CancelIoEx(channel->Pipe, &channel->Overlapped);
+    else
+        FChannels.erase(it);
+}
+
+void CALLBACK TPipeMultiplexer::ProcessExited(void* context, BOOLEAN timedOut)
+{
+    // Thread-pool thread: only hand the event over to the port
+    TChannel* channel = static_cast<TChannel*>(context);
+    PostQueuedCompletionStatus(channel->Owner->FPort, 0, channel->Key, &ExitMarker);
+}
+
+void TPipeMultiplexer::StartRead(TChannel* channel)
+{
+    ZeroMemory(&channel->Overlapped, sizeof(channel->Overlapped));
+    if (ReadFile(channel->Pipe, channel->Buffer, BUFFER_SIZE, nullptr, &channel->Overlapped) ||
+        GetLastError() == ERROR_IO_PENDING)
+    {
+        channel->ReadPending = true;    // Completes through the port either way
+        return;
+    }
+
+    // Broken pipe: every writer is gone
+    PostQueuedCompletionStatus(FPort, 0, channel->Key, &ClosedMarker);
+}
+
+int TPipeMultiplexer::Pump(DWORD timeoutMs)
+{
+    OVERLAPPED_ENTRY entries[MAX_ENTRIES];
+    ULONG count = 0;
+    if (!FPort || !GetQueuedCompletionStatusEx(FPort, entries, MAX_ENTRIES, &count, timeoutMs, FALSE))
+        return 0;
+
+    for (ULONG i = 0; i < count; i++)
+        Dispatch(entries[i]);
+    return (int)count;
+}
+
+void TPipeMultiplexer::Dispatch(const OVERLAPPED_ENTRY& entry)
+{
+    auto it = FChannels.find(entry.lpCompletionKey);
+    if (it == FChannels.end())
+        return;     // Exit of a removed registration
+    TChannel* channel = it->second.get();
+
+    if (entry.lpOverlapped == &channel->Overlapped)
+    {
+        channel->ReadPending = false;
+        if (channel->Removed)
+        {
+            FChannels.erase(it);
+            return;
+        }
+
+        DWORD size = 0;
+        if (GetOverlappedResult(channel->Pipe, &channel->Overlapped, &size, FALSE))
+        {
+            // A zero-byte write completes a read too; it is not the end
+            if (size > 0 && channel->OnData)
+                channel->OnData(channel->Buffer, size);
+            StartRead(channel);
+        }
+        else if (channel->OnClosed)
+        {
+            channel->OnClosed();
+        }
+        return;
+    }
+
+    if (channel->Removed)
+        return;
+    if (entry.lpOverlapped == &ClosedMarker && channel->OnClosed)
+        channel->OnClosed();
+    else if (entry.lpOverlapped == &ExitMarker && channel->OnExited)
+        channel->OnExited();
+}
+
+bool TPipeMultiplexer::CreateOverlappedPipe(HANDLE& readPipe, HANDLE& writePipe, DWORD bufferSize)
+{
+    static std::atomic<unsigned int> counter(0);
+    String name = L"\\\\.\\pipe\\DxAutoInstaller." + String((int)GetCurrentProcessId()) +
+                  L"." + String((int)++counter);
+
+    readPipe = CreateNamedPipeW(name.c_str(),
+        PIPE_ACCESS_INBOUND | FILE_FLAG_OVERLAPPED | FILE_FLAG_FIRST_PIPE_INSTANCE,
+        PIPE_TYPE_BYTE | PIPE_READMODE_BYTE | PIPE_WAIT | PIPE_REJECT_REMOTE_CLIENTS,
+        1, 0, bufferSize, 0, nullptr);
+    if (readPipe == INVALID_HANDLE_VALUE)
+    {
+        readPipe = nullptr;
+        return false;
+    }
+
+    SECURITY_ATTRIBUTES sa;
+    sa.nLength = sizeof(sa);
+    sa.bInheritHandle = TRUE;
+    sa.lpSecurityDescriptor = nullptr;
+    writePipe = CreateFileW(name.c_str(), GENERIC_WRITE, 0, &sa, OPEN_EXISTING, FILE_ATTRIBUTE_NORMAL, nullptr);
+    if (writePipe == INVALID_HANDLE_VALUE)
+    {
+        CloseHandle(readPipe);
+        readPipe = nullptr;
+        writePipe = nullptr;
+        return false;
+    }
+    return true;
+}
+
+} // namespace DxCore
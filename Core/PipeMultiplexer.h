@@ -0,0 +1,90 @@
+//---------------------------------------------------------------------------
+// PipeMultiplexer - Output of many child processes read on one thread
+//
+// Every registered pipe has one overlapped read outstanding on a shared
+// I/O completion port; each process handle has a thread-pool wait that
+// posts a packet to the same port when the process exits. Pump() blocks
+// on the port and dispatches whatever arrived - output chunks, end of
+// output, process exits - to the callbacks of the registration, on the
+// calling thread. N children therefore cost no thread of their own.
+//
+// The read end of a pipe must be opened with FILE_FLAG_OVERLAPPED
+// (CreateOverlappedPipe). A registration keeps the handles it was given
+// but does not own them: Remove it before closing them.
+//
+// Not thread-safe: Add, Remove and Pump belong to one thread, and the
+// callbacks must not call Add or Remove.
+//---------------------------------------------------------------------------
+#ifndef PipeMultiplexerH
+#define PipeMultiplexerH
+
+#include <System.hpp>
+#include <Winapi.Windows.hpp>
+#include <map>
+#include <memory>
+#include <functional>
+
+namespace DxCore
+{
+
+typedef std::function<void(const char* data, DWORD size)> TPipeDataEvent;
+typedef std::function<void()> TPipeEvent;
+
+//---------------------------------------------------------------------------
+// Pipe multiplexer
+//---------------------------------------------------------------------------
+class TPipeMultiplexer
+{
+private:
+    static const DWORD BUFFER_SIZE = 4096;
+
+    struct TChannel
+    {
+        OVERLAPPED Overlapped;
+        TPipeMultiplexer* Owner;
+        ULONG_PTR Key;
+        HANDLE Pipe;
+        HANDLE ExitWait;
+        bool ReadPending;
+        bool Removed;
+        TPipeDataEvent OnData;
+        TPipeEvent OnClosed;
+        TPipeEvent OnExited;
+        char Buffer[BUFFER_SIZE];
+    };
+
+    HANDLE FPort;
+    ULONG_PTR FNextKey;
+    std::map<ULONG_PTR, std::unique_ptr<TChannel>> FChannels;   // Removed ones until their read completes
+
+    void StartRead(TChannel* channel);
+    void Dispatch(const OVERLAPPED_ENTRY& entry);
+    static void CALLBACK ProcessExited(void* context, BOOLEAN timedOut);
+
+public:
+    TPipeMultiplexer();
+    ~TPipeMultiplexer();
+
+    // Output chunks go to onData until the pipe reports end of output
+    // (onClosed); onExited follows the exit of process. Returns the key
+    // for Remove, 0 on error.
+    ULONG_PTR Add(HANDLE pipe, HANDLE process,
+                  TPipeDataEvent onData, TPipeEvent onClosed, TPipeEvent onExited);
+    // No callbacks run for key afterwards
+    void Remove(ULONG_PTR key);
+
+    // Waits up to timeoutMs for the first event, then dispatches all that
+    // are queued. Returns the number of events dispatched.
+    int Pump(DWORD timeoutMs);
+
+    // Anonymous pipes do not support overlapped I/O; this creates a
+    // uniquely named one. The write end is inheritable and synchronous.
+    static bool CreateOverlappedPipe(HANDLE& readPipe, HANDLE& writePipe, DWORD bufferSize);
+
+    TPipeMultiplexer(const TPipeMultiplexer&) = delete;
+    TPipeMultiplexer& operator=(const TPipeMultiplexer&) = delete;
+};
+
+} // namespace DxCore
+
+#endif
@@ -0,0 +1,108 @@
+//---------------------------------------------------------------------------
+// Prefetcher implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "Prefetcher.h"
+#include <Winapi.Windows.hpp>
+#include <chrono>
+
+namespace DxCore
+{
+
+// Longest wait for the window before the stop flag is checked again
+static const DWORD STOP_CHECK_MS = 100;
+
+//---------------------------------------------------------------------------
+// TPrefetcher implementation
+//---------------------------------------------------------------------------
+TPrefetcher::TPrefetcher(size_t jobCount, TPrefetchInputs inputs, __int64 windowBytes,
+                         const std::atomic<bool>* stopped)
+    : FInputs(inputs),
+      FJobCount(jobCount),
+      FWindowBytes(windowBytes),
+      FStopped(stopped),
+      FStarted(jobCount, false),
+      FBytes(jobCount, 0),
+      FFirstPending(0),
+      FAheadBytes(0),
+      FShutdown(false)
+{
+    FThread = std::thread([this]() { Run(); });
+}
+
+TPrefetcher::~TPrefetcher()
+{
+    {
+        std::lock_guard<std::mutex> guard(FLock);
+        FShutdown = true;
+    }
+    FChanged.notify_all();
+    if (FThread.joinable())
+        FThread.join();
+}
+
+void TPrefetcher::JobStarted(size_t index)
+{
+    {
+        std::lock_guard<std::mutex> guard(FLock);
+        if (index >= FJobCount || FStarted[index])
+            return;
+        FStarted[index] = true;
+        FAheadBytes -= FBytes[index];
+        while (FFirstPending < FJobCount && FStarted[FFirstPending])
+            FFirstPending++;
+    }
+    FChanged.notify_all();
+}
+
+void TPrefetcher::Run()
+{
+    std::vector<char> buffer(BUFFER_SIZE);
+    for (size_t index = 0; index < FJobCount; index++)
+    {
+        {
+            std::unique_lock<std::mutex> lock(FLock);
+            if (FStarted[index])
+                continue;   // Too late - the compiler reads it already
+
+            // Job FFirstPending is the next to start; it is never held back
+            while (!FShutdown && !IsStopped() && index > FFirstPending && FAheadBytes >= FWindowBytes)
+                FChanged.wait_for(lock, std::chrono::milliseconds(STOP_CHECK_MS));
+            if (FShutdown || IsStopped())
+                return;
+        }
+
+        __int64 bytes = 0;
+        for (const auto& path : FInputs(index))
+        {
+            if (IsStopped())
+                return;
+            bytes += ReadInput(path, buffer);
+        }
+
+        std::lock_guard<std::mutex> guard(FLock);
+        FBytes[index] = bytes;
+        if (!FStarted[index])
+            FAheadBytes += bytes;
+    }
+}
+
+__int64 TPrefetcher::ReadInput(const String& path, std::vector<char>& buffer)
+{
+    HANDLE file = CreateFileW(path.c_str(), GENERIC_READ, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE,
+                              nullptr, OPEN_EXISTING, FILE_FLAG_SEQUENTIAL_SCAN, nullptr);
+    if (file == INVALID_HANDLE_VALUE)
+        return 0;
+
+    __int64 total = 0;
+    DWORD read = 0;
+    while (ReadFile(file, buffer.data(), (DWORD)buffer.size(), &read, nullptr) && read > 0)
+        total += read;
+    CloseHandle(file);
+
+    FTotalBytes += total;
+    FTotalFiles++;
+    return total;
+}
+
+} // namespace DxCore
@@ -0,0 +1,80 @@
+//---------------------------------------------------------------------------
+// Prefetcher - Reads the inputs of upcoming compile jobs into the cache
+//
+// dcc reads its inputs with many small synchronous reads; from a cold
+// file cache (the first build after a reboot, sources on a network drive)
+// each of them waits for the disk. The prefetcher walks the jobs in the
+// order they are planned - which is the order the scheduler starts them
+// in - and reads every input file of a job once, sequentially
+// (FILE_FLAG_SEQUENTIAL_SCAN), on a thread of its own. The compiler then
+// finds the data in the system file cache.
+//
+// Memory is bounded: file data passes through one reused buffer, and
+// reading stops WindowBytes ahead of the jobs that have not started yet,
+// so prefetched files are not evicted again before they are compiled.
+// The job after the last started one is always read, however large.
+//---------------------------------------------------------------------------
+#ifndef PrefetcherH
+#define PrefetcherH
+
+#include <System.hpp>
+#include <vector>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+
+namespace DxCore
+{
+
+// Input files of job index; called on the prefetch thread
+typedef std::function<std::vector<String>(size_t index)> TPrefetchInputs;
+
+//---------------------------------------------------------------------------
+// Prefetcher
+//---------------------------------------------------------------------------
+class TPrefetcher
+{
+private:
+    static const size_t BUFFER_SIZE = 256 * 1024;
+
+    TPrefetchInputs FInputs;
+    size_t FJobCount;
+    __int64 FWindowBytes;
+    const std::atomic<bool>* FStopped;
+
+    std::mutex FLock;
+    std::condition_variable FChanged;
+    std::vector<bool> FStarted;
+    std::vector<__int64> FBytes;      // Read for each job
+    size_t FFirstPending;             // Lowest job not started yet
+    __int64 FAheadBytes;              // Read for jobs not started yet
+    bool FShutdown;
+
+    std::atomic<__int64> FTotalBytes{0};
+    std::atomic<int> FTotalFiles{0};
+    std::thread FThread;
+
+    void Run();
+    __int64 ReadInput(const String& path, std::vector<char>& buffer);
+    bool IsStopped() const { return FStopped && FStopped->load(); }
+
+public:
+    TPrefetcher(size_t jobCount, TPrefetchInputs inputs, __int64 windowBytes,
+                const std::atomic<bool>* stopped = nullptr);
+    ~TPrefetcher();           // Stops reading and waits for the thread
+
+    // The scheduler started job index; reading may move on
+    void JobStarted(size_t index);
+
+    __int64 GetTotalBytes() const { return FTotalBytes.load(); }
+    int GetTotalFiles() const { return FTotalFiles.load(); }
+
+    TPrefetcher(const TPrefetcher&) = delete;
+    TPrefetcher& operator=(const TPrefetcher&) = delete;
+};
+
+} // namespace DxCore
+
+#endif
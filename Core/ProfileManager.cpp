@@ -4,14 +4,17 @@
 #pragma hdrstop
 #include "ProfileManager.h"
 #include <IOUtils.hpp>
-#include <System.IniFiles.hpp>
-#include <Vcl.Forms.hpp>
+#include <map>
+#include <set>
+#include <vector>
+#include <algorithm>
+#include <cstring>
 
 namespace DxCore
 {
 
 //---------------------------------------------------------------------------
-// TProfileManager implementation
+// TProfileManager construction
 //---------------------------------------------------------------------------
 TProfileManager::TProfileManager()
 {
@@ -21,6 +24,17 @@ TProfileManager::~TProfileManager()
 {
 }
 
+//---------------------------------------------------------------------------
+// TStringPool implementation
+//---------------------------------------------------------------------------
+const String& TStringPool::Intern(const String& s)
+{
+    return *FStrings.insert(s).first;
+}
+
+//---------------------------------------------------------------------------
+// TProfileManager implementation
+//---------------------------------------------------------------------------
 void TProfileManager::LoadFromFile(const String& fileName)
 {
     FFileName = fileName;
@@ -30,76 +44,441 @@ void TProfileManager::LoadFromFile(const String& fileName)
 void TProfileManager::LoadFromResource()
 {
     String customFile = GetCustomProfileFileName();
-    if (!FileExists(customFile))
+    FFileName = customFile;
+    
+    if (FileExists(customFile))
+    {
+        // Profile.ini as exported: the precompiled profile is the same data
+        std::unique_ptr<TMemoryStream> text(new TMemoryStream());
+        if (LoadResourceStream(ProfileBinary::TextResourceName, text.get()))
+        {
+            std::unique_ptr<TMemoryStream> file(new TMemoryStream());
+            file->LoadFromFile(customFile);
+            if (file->Size == text->Size &&
+                memcmp(file->Memory, text->Memory, static_cast<size_t>(text->Size)) == 0 &&
+                LoadFromBuiltInBinary())
+            {
+                return;
+            }
+        }
+        LoadComponents();
+        return;
+    }
+    
+    // First run: a precompiled profile loads without parsing; the text
+    // form is still exported so the user has a Profile.ini to edit
+    if (LoadFromBuiltInBinary())
+    {
         ExportBuiltInProfile(customFile);
+        return;
+    }
     
-    FFileName = customFile;
+    ExportBuiltInProfile(customFile);
     LoadComponents();
 }
 
+bool TProfileManager::LoadFromBuiltInBinary()
+{
+    std::unique_ptr<TMemoryStream> bin(new TMemoryStream());
+    return LoadResourceStream(ProfileBinary::ResourceName, bin.get()) &&
+           LoadFromBinaryStream(bin.get());
+}
+
+String TProfileManager::GetBuiltInProfileText()
+{
+    std::unique_ptr<TMemoryStream> text(new TMemoryStream());
+    if (LoadResourceStream(ProfileBinary::TextResourceName, text.get()))
+    {
+        std::unique_ptr<TStringList> lines(new TStringList());
+        lines->LoadFromStream(text.get());   // BOM detection as TFile::ReadAllText
+        return lines->Text;
+    }
+    
+    TProfileManager builtIn;
+    return builtIn.LoadFromBuiltInBinary() ? builtIn.SaveToText() : String();
+}
+
+bool TProfileManager::LoadResourceStream(const String& resName, TMemoryStream* stream)
+{
+    HINSTANCE inst = reinterpret_cast<HINSTANCE>(HInstance);
+    if (FindResourceW(inst, resName.c_str(), RT_RCDATA) == nullptr)
+        return false;
+    
+    try
+    {
+        std::unique_ptr<TResourceStream> rs(new TResourceStream(
+            reinterpret_cast<NativeUInt>(HInstance), resName, RT_RCDATA));
+        stream->CopyFrom(rs.get(), rs->Size);
+        stream->Position = 0;
+        return true;
+    }
+    catch (...)
+    {
+        return false;
+    }
+}
+
 void TProfileManager::ExportBuiltInProfile(const String& fileName)
 {
-    TResourceStream* rs = nullptr;
     try
     {
-        rs = new TResourceStream(
-            reinterpret_cast<NativeUInt>(HInstance),
-            L"PROFILE",
-            RT_RCDATA
-        );
+        std::unique_ptr<TMemoryStream> text(new TMemoryStream());
+        if (LoadResourceStream(ProfileBinary::TextResourceName, text.get()))
+        {
+            text->SaveToFile(fileName);
+            return;
+        }
         
-        std::unique_ptr<TFileStream> fs(new TFileStream(fileName, fmCreate));
-        fs->CopyFrom(rs, rs->Size);
+        // Only the binary form is embedded - render it back to INI text
+        std::unique_ptr<TMemoryStream> bin(new TMemoryStream());
+        if (LoadResourceStream(ProfileBinary::ResourceName, bin.get()))
+        {
+            TProfileManager builtIn;
+            if (builtIn.LoadFromBinaryStream(bin.get()))
+                TFile::WriteAllText(fileName, builtIn.SaveToText(), TEncoding::UTF8);
+        }
     }
     catch (...)
     {
         // Resource not found - will use empty profile
     }
-    
-    delete rs;
 }
 
 void TProfileManager::LoadComponents()
 {
     FComponents.clear();
+    FPackageRules.clear();
     
     if (!FileExists(FFileName))
         return;
+    
+    // Whole file is read once; TEncoding detection handles BOMs
+    ParseProfileText(TFile::ReadAllText(FFileName));
+}
+
+void TProfileManager::LoadFromText(const String& text)
+{
+    FComponents.clear();
+    FPackageRules.clear();
+    ParseProfileText(text);
+}
+
+void TProfileManager::ParseProfileText(const String& text)
+{
+    std::map<String, std::shared_ptr<TComponentProfile>> sectionMap;  // uppercase name -> profile
+    std::set<String> assignedKeys;                      // "SECTION\\KEY" already read
+    std::shared_ptr<TComponentProfile> current;
+    String currentKey;
+    bool inRules = false;
+    
+    const wchar_t* p = text.c_str();
+    const wchar_t* end = p + text.Length();
+    
+    while (p < end)
+    {
+        // Line bounds
+        const wchar_t* lineStart = p;
+        while (p < end && *p != L'\r' && *p != L'\n')
+            p++;
+        const wchar_t* lineEnd = p;
+        while (p < end && (*p == L'\r' || *p == L'\n'))
+            p++;
+        
+        // Trim
+        while (lineStart < lineEnd && *lineStart <= L' ')
+            lineStart++;
+        while (lineEnd > lineStart && lineEnd[-1] <= L' ')
+            lineEnd--;
+        
+        if (lineStart == lineEnd || *lineStart == L';')
+            continue;
+        
+        if (*lineStart == L'[')
+        {
+            const wchar_t* close = lineStart + 1;
+            while (close < lineEnd && *close != L']')
+                close++;
+            
+            String section = String(lineStart + 1, static_cast<int>(close - lineStart - 1)).Trim();
+            currentKey = section.UpperCase();
+            inRules = SameText(section, PackageRuleKeys::Section);
+            if (inRules)
+                continue;
+            
+            // Duplicate sections merge into the first one (first value wins,
+            // as with GetPrivateProfileString)
+            auto it = sectionMap.find(currentKey);
+            if (it != sectionMap.end())
+            {
+                current = it->second;
+            }
+            else
+            {
+                current = std::make_shared<TComponentProfile>();
+                current->ComponentName = section;
+                sectionMap[currentKey] = current;
+                FComponents.push_back(current);
+            }
+            continue;
+        }
+        
+        if (!current && !inRules)
+            continue;  // Key before first section
+        
+        const wchar_t* eq = lineStart;
+        while (eq < lineEnd && *eq != L'=')
+            eq++;
+        if (eq == lineEnd)
+            continue;  // Not a key=value line
+        
+        String key = String(lineStart, static_cast<int>(eq - lineStart)).Trim();
+        String value = String(eq + 1, static_cast<int>(lineEnd - eq - 1)).Trim();
+        
+        if (value.Length() >= 2 &&
+            ((value[1] == L'"' && value[value.Length()] == L'"') ||
+             (value[1] == L'\'' && value[value.Length()] == L'\'')))
+        {
+            value = value.SubString(2, value.Length() - 2);
+        }
+        
+        if (!assignedKeys.insert(currentKey + L"\\" + key.UpperCase()).second)
+            continue;
+        
+        if (inRules)
+            TPackageClassifier::ParseProfileEntry(key, value, FPackageRules);   // Invalid entries are ignored
+        else if (SameText(key, ProfileKeys::RequiredPackages))
+            SplitPackageList(value, current->RequiredPackages);
+        else if (SameText(key, ProfileKeys::OptionalPackages))
+            SplitPackageList(value, current->OptionalPackages);
+        else if (SameText(key, ProfileKeys::OutdatedPackages))
+            SplitPackageList(value, current->OutdatedPackages);
+        else if (SameText(key, ProfileKeys::IsBase))
+            current->IsBase = StrToIntDef(value, 0) != 0;
+    }
+}
+
+void TProfileManager::SplitPackageList(const String& s, std::vector<String>& list)
+{
+    list.clear();
+    
+    const wchar_t* p = s.c_str();
+    const wchar_t* end = p + s.Length();
+    
+    while (p < end)
+    {
+        while (p < end && (*p == L',' || *p <= L' '))
+            p++;
+        
+        const wchar_t* start = p;
+        while (p < end && *p != L',' && *p > L' ')
+            p++;
+        
+        if (p > start)
+            list.push_back(FNamePool.Intern(String(start, static_cast<int>(p - start))));
+    }
+}
+
+//---------------------------------------------------------------------------
+// Binary profile form
+//---------------------------------------------------------------------------
+static void WriteUInt32(TStream* stream, unsigned int value)
+{
+    stream->WriteBuffer(&value, sizeof(value));
+}
+
+static unsigned int ReadUInt32(TStream* stream)
+{
+    unsigned int value = 0;
+    stream->ReadBuffer(&value, sizeof(value));
+    return value;
+}
+
+void TProfileManager::SaveToBinaryStream(TStream* stream) const
+{
+    // String table: component names and package names, each stored once
+    std::vector<String> strings;
+    std::map<String, unsigned int> indices;
+    auto indexOf = [&](const String& value) -> unsigned int {
+        auto it = indices.find(value);
+        if (it != indices.end())
+            return it->second;
+        unsigned int idx = static_cast<unsigned int>(strings.size());
+        strings.push_back(value);
+        indices[value] = idx;
+        return idx;
+    };
+    
+    for (const auto& profile : FComponents)
+    {
+        indexOf(profile->ComponentName);
+        const std::vector<String>* lists[] = { &profile->RequiredPackages, &profile->OptionalPackages, &profile->OutdatedPackages };
+        for (auto* pkgList : lists)
+            for (const auto& name : *pkgList)
+                indexOf(name);
+    }
+    for (const auto& rule : FPackageRules)
+    {
+        indexOf(rule.Pattern);
+        indexOf(rule.Tag);
+    }
+    
+    WriteUInt32(stream, ProfileBinary::Magic);
+    WriteUInt32(stream, ProfileBinary::Version);
+    
+    WriteUInt32(stream, static_cast<unsigned int>(strings.size()));
+    for (const auto& value : strings)
+    {
+        unsigned short len = static_cast<unsigned short>(value.Length());
+        stream->WriteBuffer(&len, sizeof(len));
+        if (len > 0)
+            stream->WriteBuffer(value.c_str(), len * sizeof(wchar_t));
+    }
+    
+    WriteUInt32(stream, static_cast<unsigned int>(FComponents.size()));
+    for (const auto& profile : FComponents)
+    {
+        WriteUInt32(stream, indexOf(profile->ComponentName));
+        unsigned char isBase = profile->IsBase ? 1 : 0;
+        stream->WriteBuffer(&isBase, sizeof(isBase));
         
-    std::unique_ptr<TIniFile> ini(new TIniFile(FFileName));
-    std::unique_ptr<TStringList> sections(new TStringList());
+        const std::vector<String>* lists[] = { &profile->RequiredPackages, &profile->OptionalPackages, &profile->OutdatedPackages };
+        for (auto* pkgList : lists)
+        {
+            WriteUInt32(stream, static_cast<unsigned int>(pkgList->size()));
+            for (const auto& name : *pkgList)
+                WriteUInt32(stream, indexOf(name));
+        }
+    }
     
-    ini->ReadSections(sections.get());
+    WriteUInt32(stream, static_cast<unsigned int>(FPackageRules.size()));
+    for (const auto& rule : FPackageRules)
+    {
+        unsigned char kinds[] = { static_cast<unsigned char>(rule.Set), static_cast<unsigned char>(rule.Match) };
+        stream->WriteBuffer(kinds, sizeof(kinds));
+        WriteUInt32(stream, indexOf(rule.Pattern));
+        WriteUInt32(stream, indexOf(rule.Tag));
+    }
+}
+
+bool TProfileManager::LoadFromBinaryStream(TStream* stream)
+{
+    FComponents.clear();
+    FPackageRules.clear();
     
-    for (int i = 0; i < sections->Count; i++)
+    try
     {
-        String section = sections->Strings[i].Trim();
+        if (ReadUInt32(stream) != ProfileBinary::Magic || ReadUInt32(stream) != ProfileBinary::Version)
+            return false;
+        
+        unsigned int stringCount = ReadUInt32(stream);
+        std::vector<String> strings;
+        strings.reserve(stringCount);
+        for (unsigned int i = 0; i < stringCount; i++)
+        {
+            unsigned short len = 0;
+            stream->ReadBuffer(&len, sizeof(len));
+            String value;
+            value.SetLength(len);
+            if (len > 0)
+                stream->ReadBuffer(&value[1], len * sizeof(wchar_t));
+            strings.push_back(FNamePool.Intern(value));
+        }
         
-        auto profile = std::make_shared<TComponentProfile>();
-        profile->ComponentName = section;
+        auto readString = [&]() -> const String& {
+            unsigned int idx = ReadUInt32(stream);
+            if (idx >= strings.size())
+                throw EReadError(L"Invalid string index in binary profile");
+            return strings[idx];
+        };
         
-        StrToList(ini->ReadString(section, ProfileKeys::RequiredPackages, L""), 
-                  profile->RequiredPackages);
-        StrToList(ini->ReadString(section, ProfileKeys::OptionalPackages, L""), 
-                  profile->OptionalPackages);
-        StrToList(ini->ReadString(section, ProfileKeys::OutdatedPackages, L""), 
-                  profile->OutdatedPackages);
-        profile->IsBase = ini->ReadBool(section, ProfileKeys::IsBase, false);
+        unsigned int componentCount = ReadUInt32(stream);
+        for (unsigned int c = 0; c < componentCount; c++)
+        {
+            auto profile = std::make_shared<TComponentProfile>();
+            profile->ComponentName = readString();
+            unsigned char isBase = 0;
+            stream->ReadBuffer(&isBase, sizeof(isBase));
+            profile->IsBase = isBase != 0;
+            
+            std::vector<String>* lists[] = { &profile->RequiredPackages, &profile->OptionalPackages, &profile->OutdatedPackages };
+            for (auto* pkgList : lists)
+            {
+                unsigned int count = ReadUInt32(stream);
+                pkgList->reserve(count);
+                for (unsigned int i = 0; i < count; i++)
+                    pkgList->push_back(readString());
+            }
+            
+            FComponents.push_back(profile);
+        }
         
-        FComponents.push_back(profile);
+        unsigned int ruleCount = ReadUInt32(stream);
+        for (unsigned int r = 0; r < ruleCount; r++)
+        {
+            unsigned char kinds[2] = { 0, 0 };
+            stream->ReadBuffer(kinds, sizeof(kinds));
+            if (kinds[0] >= PackageRuleSetCount || kinds[1] > static_cast<unsigned char>(TPackageRuleMatch::Contains))
+                throw EReadError(L"Invalid package rule in binary profile");
+            String pattern = readString();
+            String tag = readString();
+            FPackageRules.push_back(TPackageRule(static_cast<TPackageRuleSet>(kinds[0]),
+                                                 static_cast<TPackageRuleMatch>(kinds[1]), pattern, tag));
+        }
+        return true;
+    }
+    catch (Exception&)
+    {
+        FComponents.clear();
+        FPackageRules.clear();
+        return false;
     }
 }
 
-void TProfileManager::StrToList(const String& s, TStringList* list)
+String TProfileManager::SaveToText() const
 {
-    list->Clear();
-    list->CommaText = s;
+    std::unique_ptr<TStringList> lines(new TStringList());
     
-    for (int i = list->Count - 1; i >= 0; i--)
+    for (const auto& profile : FComponents)
     {
-        if (list->Strings[i].Trim().IsEmpty())
-            list->Delete(i);
+        lines->Add(L"[" + profile->ComponentName + L"]");
+        
+        const String keys[] = { ProfileKeys::RequiredPackages, ProfileKeys::OptionalPackages, ProfileKeys::OutdatedPackages };
+        const std::vector<String>* lists[] = { &profile->RequiredPackages, &profile->OptionalPackages, &profile->OutdatedPackages };
+        for (int k = 0; k < 3; k++)
+        {
+            if (lists[k]->empty())
+                continue;
+            String value;
+            for (size_t i = 0; i < lists[k]->size(); i++)
+                value = value + (i > 0 ? L", " : L"") + (*lists[k])[i];
+            lines->Add(keys[k] + L" = " + value);
+        }
+        
+        if (profile->IsBase)
+            lines->Add(ProfileKeys::IsBase + L" = 1");
+        lines->Add(L"");
     }
+    
+    if (!FPackageRules.empty())
+    {
+        lines->Add(L"[" + PackageRuleKeys::Section + L"]");
+        TPackageClassifier::FormatProfileEntries(FPackageRules, lines.get());
+        lines->Add(L"");
+    }
+    
+    return lines->Text;
+}
+
+bool TProfileManager::CompileProfile(const String& iniFileName, const String& binFileName)
+{
+    TProfileManager profile;
+    profile.LoadFromFile(iniFileName);
+    if (profile.GetComponents().empty())
+        return false;
+    
+    std::unique_ptr<TFileStream> fs(new TFileStream(binFileName, fmCreate));
+    profile.SaveToBinaryStream(fs.get());
+    return true;
 }
 
 bool TProfileManager::IsCustomProfile() const
@@ -114,36 +493,15 @@ bool TProfileManager::IsCustomProfile() const
 String TProfileManager::GetCustomProfileFileName()
 {
     return TPath::Combine(
-        TPath::GetDirectoryName(Application->ExeName),
+        TPath::GetDirectoryName(ParamStr(0)),
         L"Profile.ini"
     );
 }
 
 String TProfileManager::GetIDEVersionNumberStr(const TIDEInfoPtr& ide)
 {
-    // Package suffix mapping (BDS version -> Package suffix)
-    // RAD Studio 12 Athens: BDS 23.0 -> suffix 290
-    // RAD Studio 13 Florence: BDS 37.0 -> suffix 370
-    
-    String bdsVersion = ide->BDSVersion;
-    
-    if (bdsVersion == L"23.0")
-        return L"290";  // RAD Studio 12
-    else if (bdsVersion == L"37.0")
-        return L"370";  // RAD Studio 13
-    else
-    {
-        // Future versions - try to derive suffix
-        // BDS 23 -> 290, BDS 37 -> 370 (multiply by ~12.6 and round to nearest 10)
-        int dotPos = bdsVersion.Pos(L".");
-        if (dotPos > 0)
-        {
-            int bdsNum = StrToIntDef(bdsVersion.SubString(1, dotPos - 1), 0);
-            // For unknown versions, use BDS * 10 + 60 as approximation
-            return String(bdsNum * 10 + 60);
-        }
-        return L"290";  // fallback
-    }
+    // Derived from BDSVersion once and memoized in TIDEInfo
+    return ide->GetPackageSuffix();
 }
 
 String TProfileManager::GetComponentDir(const String& installFileDir, const String& componentName)
@@ -166,6 +524,44 @@ String TProfileManager::GetPackageName(const String& packageBaseName, const TIDE
     return packageBaseName + GetIDEVersionNumberStr(ide);
 }
 
+std::vector<String> TProfileManager::GetPackageBaseNames(const String& fileBaseName,
+                                                         const std::vector<String>& ideSuffixes)
+{
+    std::vector<String> names;
+    for (const auto& suffix : ideSuffixes)
+    {
+        // Same forms as TFileIndex::FindPackageFile, compared case-sensitively
+        String rsNum = suffix.SubString(1, suffix.Length() - 1);  // "290" -> "29"
+        const String forms[] = { suffix, L"RS" + rsNum, L"D" + rsNum };
+        for (const auto& form : forms)
+        {
+            int baseLength = fileBaseName.Length() - form.Length();
+            if (baseLength > 0 && fileBaseName.SubString(baseLength + 1, form.Length()) == form)
+            {
+                String base = fileBaseName.SubString(1, baseLength);
+                if (std::find(names.begin(), names.end(), base) == names.end())
+                    names.push_back(base);
+            }
+        }
+    }
+    names.push_back(fileBaseName);
+    return names;
+}
+
+String TProfileManager::NormalizePackageName(const String& fileBaseName,
+                                             const std::vector<String>& ideSuffixes)
+{
+    return GetPackageBaseNames(fileBaseName, ideSuffixes).front();
+}
+
+std::vector<String> TProfileManager::GetKnownPackageSuffixes()
+{
+    std::vector<String> suffixes;
+    suffixes.push_back(TIDEInfo::GetPackageSuffixForVersion(BDSVersions::BDS_23_0));
+    suffixes.push_back(TIDEInfo::GetPackageSuffixForVersion(BDSVersions::BDS_37_0));
+    return suffixes;
+}
+
 String TProfileManager::GetPackageFullFileName(const String& installFileDir,
                                                 const String& componentName,
                                                 const String& packageBaseName,
@@ -184,11 +580,15 @@ unsigned int TProfileManager::GetDxBuildNumber(const String& installFileDir)
     if (!FileExists(sourceFile))
         return 0;
         
-    const String VERSION_IDENT = L"dxVersion = ";
-    const String BUILD_NUMBER_IDENT = L"dxBuildNumber: Cardinal = ";
-    
     std::unique_ptr<TStringList> lines(new TStringList());
     lines->LoadFromFile(sourceFile);
+    return GetDxBuildNumber(lines.get());
+}
+
+unsigned int TProfileManager::GetDxBuildNumber(TStrings* lines)
+{
+    const String VERSION_IDENT = L"dxVersion = ";
+    const String BUILD_NUMBER_IDENT = L"dxBuildNumber: Cardinal = ";
     
     for (int i = 0; i < lines->Count; i++)
     {
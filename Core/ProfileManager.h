@@ -6,24 +6,57 @@
 
 #include <System.hpp>
 #include <System.Classes.hpp>
-#include <System.IniFiles.hpp>
+#include <unordered_set>
+#include <vector>
 #include "Component.h"
 #include "IDEDetector.h"
+#include "StringHash.h"
+#include "PackageRules.h"
 
 namespace DxCore
 {
 
+//---------------------------------------------------------------------------
+// String pool - package names repeat across components (cxADOAdapters,
+// dxServerMode, ...). Interned names share one String buffer.
+//---------------------------------------------------------------------------
+class TStringPool
+{
+private:
+    std::unordered_set<String, TStringHash> FStrings;
+    
+public:
+    const String& Intern(const String& s);
+    int GetCount() const { return static_cast<int>(FStrings.size()); }
+};
+
 //---------------------------------------------------------------------------
 // Profile Manager
+//
+// Profile.ini is parsed in one pass from memory (no TIniFile, which calls
+// GetPrivateProfileString - and rereads the file - for every key). Parsing
+// rules match the Windows profile API: ';' starts a comment line, section
+// and key names are trimmed and case-insensitive, values are trimmed and
+// one pair of surrounding quotes is removed. Package lists are split on
+// commas and blanks like TStringList::CommaText. The [@PackageRules]
+// section holds classification rules (see PackageRules.h), not a component.
+//
+// A precompiled binary form (see SaveToBinaryStream) is embedded as the
+// PROFILEBIN resource; it loads without any text parsing, on first run and
+// whenever the exported Profile.ini is byte-identical to the built-in one.
 //---------------------------------------------------------------------------
 class TProfileManager
 {
 private:
     String FFileName;
     TComponentProfileList FComponents;
+    TStringPool FNamePool;
+    TPackageRuleList FPackageRules;
     
     void LoadComponents();
-    void StrToList(const String& s, TStringList* list);
+    void ParseProfileText(const String& text);
+    void SplitPackageList(const String& s, std::vector<String>& list);
+    static bool LoadResourceStream(const String& resName, TMemoryStream* stream);
     
 public:
     TProfileManager();
@@ -32,13 +65,23 @@ public:
     // Load profile from file
     void LoadFromFile(const String& fileName);
     void LoadFromResource();  // Load built-in profile
+    void LoadFromText(const String& text);
+    bool LoadFromBuiltInBinary();             // PROFILEBIN only; false if not embedded
+    static String GetBuiltInProfileText();    // PROFILE, or rendered from PROFILEBIN
     
     // Export built-in profile to file
     void ExportBuiltInProfile(const String& fileName);
     
+    // Binary profile form (embedded as PROFILEBIN resource)
+    void SaveToBinaryStream(TStream* stream) const;
+    bool LoadFromBinaryStream(TStream* stream);
+    String SaveToText() const;
+    static bool CompileProfile(const String& iniFileName, const String& binFileName);
+    
     // Properties
     const String& GetFileName() const { return FFileName; }
     const TComponentProfileList& GetComponents() const { return FComponents; }
+    const TPackageRuleList& GetPackageRules() const { return FPackageRules; }
     bool IsCustomProfile() const;
     
     // Path helpers
@@ -48,6 +91,20 @@ public:
     static String GetComponentSourcesDir(const String& installFileDir, const String& componentName);
     static String GetComponentPackagesDir(const String& installFileDir, const String& componentName);
     static String GetPackageName(const String& packageBaseName, const TIDEInfoPtr& ide);
+    
+    // Base names a .dpk base name can stand for, in the order FindPackageFile
+    // tries its naming rules: <base><suffix> ("dxCore370"), <base>RS<nn>
+    // ("dxCoreRS37"), <base>D<nn> ("dxCoreD37") for each of ideSuffixes,
+    // then the name itself ({$LIBSUFFIX AUTO} packages). Only these exact
+    // forms are stripped, so digits that belong to the name stay
+    // ("dxSkinVS2010370" -> "dxSkinVS2010").
+    static std::vector<String> GetPackageBaseNames(const String& fileBaseName,
+                                                   const std::vector<String>& ideSuffixes);
+    // First of GetPackageBaseNames
+    static String NormalizePackageName(const String& fileBaseName,
+                                       const std::vector<String>& ideSuffixes);
+    // Suffixes of the supported IDE versions (see BDSVersions)
+    static std::vector<String> GetKnownPackageSuffixes();
     static String GetPackageFullFileName(const String& installFileDir, 
                                           const String& componentName,
                                           const String& packageBaseName,
@@ -55,6 +112,7 @@ public:
     
     // DevExpress version detection
     static unsigned int GetDxBuildNumber(const String& installFileDir);
+    static unsigned int GetDxBuildNumber(TStrings* dxCoreLines);   // dxCore.pas, already read
     static String GetDxBuildNumberAsVersion(unsigned int buildNumber);
 };
 
@@ -69,6 +127,26 @@ namespace ProfileKeys
     const String IsBase = L"IsBase";
 }
 
+//---------------------------------------------------------------------------
+// Binary profile format
+//
+//   uint32  Magic ('DXPF')
+//   uint32  Version
+//   uint32  String count, then per string: uint16 length + UTF-16 chars
+//   uint32  Component count, then per component:
+//           uint32 name index, uint8 IsBase,
+//           3 x (uint32 count + uint32 indices) - Required/Optional/Outdated
+//   uint32  Package rule count, then per rule:
+//           uint8 set, uint8 match, uint32 pattern index, uint32 tag index
+//---------------------------------------------------------------------------
+namespace ProfileBinary
+{
+    const unsigned int Magic = 0x46505844;   // "DXPF"
+    const unsigned int Version = 2;
+    const wchar_t* const ResourceName = L"PROFILEBIN";
+    const wchar_t* const TextResourceName = L"PROFILE";
+}
+
 } // namespace DxCore
 
 #endif
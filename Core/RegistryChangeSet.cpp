@@ -0,0 +1,435 @@
+//---------------------------------------------------------------------------
+// RegistryChangeSet implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "RegistryChangeSet.h"
+#include "PathList.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// TWinRegistryBackend implementation
+//---------------------------------------------------------------------------
+TWinRegistryBackend::TWinRegistryBackend(HKEY rootKey, bool readOnly)
+    : FRootKey(rootKey),
+      FReadOnly(readOnly)
+{
+}
+
+TWinRegistryBackend::~TWinRegistryBackend()
+{
+    if (FRegistry)
+        FRegistry->CloseKey();
+}
+
+bool TWinRegistryBackend::OpenKey(const String& key, bool canCreate)
+{
+    if (!FRegistry)
+    {
+        FRegistry.reset(new TRegistry(FReadOnly ? KEY_READ : KEY_READ | KEY_WRITE));
+        FRegistry->RootKey = FRootKey;
+    }
+
+    // Consecutive operations on the same key reuse the open handle
+    if (!FOpenKey.IsEmpty() && SameText(FOpenKey, key))
+        return true;
+
+    FRegistry->CloseKey();
+    FOpenKey = L"";
+
+    if (FReadOnly ? !FRegistry->OpenKeyReadOnly(key) : !FRegistry->OpenKey(key, canCreate))
+        return false;
+
+    FOpenKey = key;
+    return true;
+}
+
+bool TWinRegistryBackend::ReadValue(const String& key, const String& name, String& value)
+{
+    if (!OpenKey(key, false) || !FRegistry->ValueExists(name))
+        return false;
+
+    value = FRegistry->ReadString(name);
+    return true;
+}
+
+bool TWinRegistryBackend::WriteValue(const String& key, const String& name, const String& value)
+{
+    if (FReadOnly || !OpenKey(key, true))
+        return false;
+
+    try
+    {
+        FRegistry->WriteString(name, value);
+        return true;
+    }
+    catch (const ERegistryException&)
+    {
+        return false;
+    }
+}
+
+bool TWinRegistryBackend::DeleteValue(const String& key, const String& name)
+{
+    if (FReadOnly)
+        return false;
+    if (!OpenKey(key, false))
+        return true;    // Nothing to delete
+
+    if (!FRegistry->ValueExists(name))
+        return true;
+
+    return FRegistry->DeleteValue(name);
+}
+
+void TWinRegistryBackend::GetValueNames(const String& key, TStrings* names)
+{
+    names->Clear();
+    if (OpenKey(key, false))
+        FRegistry->GetValueNames(names);
+}
+
+//---------------------------------------------------------------------------
+// TMemoryRegistryBackend implementation
+//---------------------------------------------------------------------------
+bool TMemoryRegistryBackend::ReadValue(const String& key, const String& name, String& value)
+{
+    auto keyIt = FKeys.find(key.LowerCase());
+    if (keyIt == FKeys.end())
+        return false;
+
+    auto valueIt = keyIt->second.find(name.LowerCase());
+    if (valueIt == keyIt->second.end())
+        return false;
+
+    value = valueIt->second.Value;
+    return true;
+}
+
+bool TMemoryRegistryBackend::WriteValue(const String& key, const String& name, const String& value)
+{
+    auto& values = FKeys[key.LowerCase()];
+    auto& stored = values[name.LowerCase()];
+    if (stored.Name.IsEmpty())
+        stored.Name = name;
+    stored.Value = value;
+    return true;
+}
+
+bool TMemoryRegistryBackend::DeleteValue(const String& key, const String& name)
+{
+    auto keyIt = FKeys.find(key.LowerCase());
+    if (keyIt != FKeys.end())
+        keyIt->second.erase(name.LowerCase());
+    return true;
+}
+
+void TMemoryRegistryBackend::GetValueNames(const String& key, TStrings* names)
+{
+    names->Clear();
+
+    auto keyIt = FKeys.find(key.LowerCase());
+    if (keyIt == FKeys.end())
+        return;
+
+    for (const auto& it : keyIt->second)
+        names->Add(it.second.Name);
+}
+
+bool TMemoryRegistryBackend::KeyExists(const String& key) const
+{
+    return FKeys.find(key.LowerCase()) != FKeys.end();
+}
+
+//---------------------------------------------------------------------------
+// TRegistryChangeSet implementation
+//---------------------------------------------------------------------------
+TRegistryChangeSet::TRegistryChangeSet(TRegistryBackendPtr backend)
+    : FBackend(backend),
+      FChangeCount(0)
+{
+}
+
+TRegistryChangeSet::~TRegistryChangeSet()
+{
+}
+
+TRegistryChangeSet::TValueChanges& TRegistryChangeSet::GetValueChanges(const String& key,
+                                                                        const String& name)
+{
+    String id = key.LowerCase() + L"\n" + name.LowerCase();
+
+    auto it = FValues.find(id);
+    if (it == FValues.end())
+    {
+        TValueChanges changes;
+        changes.Key = key;
+        changes.Name = name;
+        it = FValues.insert(std::make_pair(id, changes)).first;
+    }
+    return it->second;
+}
+
+void TRegistryChangeSet::Record(const String& key, const String& name,
+                                TRegistryChangeKind kind, const String& data)
+{
+    TValueChanges& changes = GetValueChanges(key, name);
+
+    // A plain set or delete overrides everything recorded before it
+    if (kind == TRegistryChangeKind::SetValue || kind == TRegistryChangeKind::DeleteValue)
+        changes.Changes.clear();
+
+    TRegistryChange change;
+    change.Kind = kind;
+    change.Data = data;
+    changes.Changes.push_back(change);
+    FChangeCount++;
+}
+
+void TRegistryChangeSet::SetValue(const String& key, const String& name, const String& value)
+{
+    Record(key, name, TRegistryChangeKind::SetValue, value);
+}
+
+void TRegistryChangeSet::DeleteValue(const String& key, const String& name)
+{
+    Record(key, name, TRegistryChangeKind::DeleteValue, L"");
+}
+
+void TRegistryChangeSet::AddPathEntry(const String& key, const String& name, const String& path)
+{
+    Record(key, name, TRegistryChangeKind::AddPathEntry, path);
+}
+
+void TRegistryChangeSet::RemovePathEntry(const String& key, const String& name, const String& path)
+{
+    Record(key, name, TRegistryChangeKind::RemovePathEntry, path);
+}
+
+void TRegistryChangeSet::AddRecord(const TRegistryChangeRecord& record)
+{
+    Record(record.Key, record.Name, record.Kind, record.Data);
+}
+
+std::vector<TRegistryChangeRecord> TRegistryChangeSet::GetRecords() const
+{
+    std::vector<TRegistryChangeRecord> records;
+    for (const auto& it : FValues)
+    {
+        for (const auto& change : it.second.Changes)
+        {
+            TRegistryChangeRecord record;
+            record.Key = it.second.Key;
+            record.Name = it.second.Name;
+            record.Kind = change.Kind;
+            record.Data = change.Data;
+            records.push_back(record);
+        }
+    }
+    return records;
+}
+
+void TRegistryChangeSet::Evaluate(const TValueChanges& changes,
+                                  bool exists, const String& value,
+                                  bool& newExists, String& newValue)
+{
+    newExists = exists;
+    newValue = exists ? value : String();
+
+    // Consecutive path edits share one parsed list; removals are batched
+    std::unique_ptr<TPathList> list;
+    std::vector<String> pendingRemovals;
+
+    auto flushRemovals = [&]() {
+        if (!pendingRemovals.empty())
+        {
+            list->RemoveRange(pendingRemovals);
+            pendingRemovals.clear();
+        }
+    };
+
+    auto flushList = [&]() {
+        if (!list)
+            return;
+        flushRemovals();
+        // An untouched list keeps its original spelling
+        if (list->IsModified())
+            newValue = list->ToString();
+        list.reset();
+    };
+
+    for (const auto& change : changes.Changes)
+    {
+        switch (change.Kind)
+        {
+            case TRegistryChangeKind::SetValue:
+                list.reset();
+                pendingRemovals.clear();
+                newExists = true;
+                newValue = change.Data;
+                break;
+
+            case TRegistryChangeKind::DeleteValue:
+                list.reset();
+                pendingRemovals.clear();
+                newExists = false;
+                newValue = L"";
+                break;
+
+            case TRegistryChangeKind::AddPathEntry:
+                if (!list)
+                    list.reset(new TPathList(newValue));
+                flushRemovals();
+                newExists = true;
+                list->Add(change.Data);
+                break;
+
+            case TRegistryChangeKind::RemovePathEntry:
+                // Removing from a missing value leaves it missing
+                if (!newExists)
+                    break;
+                if (!list)
+                    list.reset(new TPathList(newValue));
+                pendingRemovals.push_back(change.Data);
+                break;
+        }
+    }
+
+    flushList();
+}
+
+bool TRegistryChangeSet::ReadValue(const String& key, const String& name, String& value) const
+{
+    String current;
+    bool exists = FBackend->ReadValue(key, name, current);
+
+    auto it = FValues.find(key.LowerCase() + L"\n" + name.LowerCase());
+    if (it == FValues.end())
+    {
+        value = exists ? current : String();
+        return exists;
+    }
+
+    bool newExists;
+    Evaluate(it->second, exists, current, newExists, value);
+    return newExists;
+}
+
+void TRegistryChangeSet::GetValueNames(const String& key, TStrings* names) const
+{
+    FBackend->GetValueNames(key, names);
+
+    String prefix = key.LowerCase() + L"\n";
+    for (auto it = FValues.lower_bound(prefix); it != FValues.end(); ++it)
+    {
+        if (!it->first.StartsWith(prefix))
+            break;
+
+        String value;
+        bool exists = ReadValue(key, it->second.Name, value);
+        int index = -1;
+        for (int i = 0; i < names->Count; i++)
+        {
+            if (SameText(names->Strings[i], it->second.Name))
+            {
+                index = i;
+                break;
+            }
+        }
+
+        if (exists && index < 0)
+            names->Add(it->second.Name);
+        else if (!exists && index >= 0)
+            names->Delete(index);
+    }
+}
+
+void TRegistryChangeSet::Diff(TStrings* lines) const
+{
+    for (const auto& it : FValues)
+    {
+        const TValueChanges& changes = it.second;
+
+        String current;
+        bool exists = FBackend->ReadValue(changes.Key, changes.Name, current);
+        bool newExists;
+        String newValue;
+        Evaluate(changes, exists, current, newExists, newValue);
+
+        String target = changes.Key + L"\\" + changes.Name;
+
+        if (!exists && newExists)
+            lines->Add(L"+ " + target + L" = \"" + newValue + L"\"");
+        else if (exists && !newExists)
+            lines->Add(L"- " + target + L" (was \"" + current + L"\")");
+        else if (exists && newValue != current)
+            lines->Add(L"~ " + target + L": \"" + current + L"\" -> \"" + newValue + L"\"");
+    }
+}
+
+bool TRegistryChangeSet::Apply(int* writtenCount)
+{
+    std::vector<TUndoEntry> undo;
+    bool success = true;
+
+    for (const auto& it : FValues)
+    {
+        const TValueChanges& changes = it.second;
+
+        String current;
+        bool exists = FBackend->ReadValue(changes.Key, changes.Name, current);
+        bool newExists;
+        String newValue;
+        Evaluate(changes, exists, current, newExists, newValue);
+
+        // Skip values that end up unchanged
+        if (exists == newExists && (!exists || newValue == current))
+            continue;
+
+        TUndoEntry entry;
+        entry.Key = changes.Key;
+        entry.Name = changes.Name;
+        entry.Existed = exists;
+        entry.Value = current;
+
+        bool ok = newExists
+            ? FBackend->WriteValue(changes.Key, changes.Name, newValue)
+            : FBackend->DeleteValue(changes.Key, changes.Name);
+
+        if (!ok)
+        {
+            success = false;
+            break;
+        }
+
+        undo.push_back(entry);
+    }
+
+    if (!success)
+    {
+        // Restore in reverse order
+        for (auto it = undo.rbegin(); it != undo.rend(); ++it)
+        {
+            if (it->Existed)
+                FBackend->WriteValue(it->Key, it->Name, it->Value);
+            else
+                FBackend->DeleteValue(it->Key, it->Name);
+        }
+        undo.clear();
+    }
+
+    if (writtenCount)
+        *writtenCount = (int)undo.size();
+
+    Discard();
+    return success;
+}
+
+void TRegistryChangeSet::Discard()
+{
+    FValues.clear();
+    FChangeCount = 0;
+}
+
+} // namespace DxCore
@@ -0,0 +1,198 @@
+//---------------------------------------------------------------------------
+// RegistryChangeSet - Batched, transactional registry writer
+//
+// Installing into one IDE touches the same handful of keys hundreds of
+// times (search paths, C++ paths, Known Packages). Instead of opening the
+// key, reading the value and writing it back for every call, mutations are
+// recorded here, merged per key/value and applied in a single pass:
+//
+// - Each value is read once and written at most once
+// - Values whose final content equals the current content are not written
+// - Apply() keeps an undo log and restores already written values if a
+//   write fails; Discard() drops pending changes (cancelled install)
+// - Diff() describes the pending changes without touching the registry
+//
+// The registry itself is reached through TRegistryBackend, so the merge
+// logic can run against TMemoryRegistryBackend as well.
+//---------------------------------------------------------------------------
+#ifndef RegistryChangeSetH
+#define RegistryChangeSetH
+
+#include <System.hpp>
+#include <System.Classes.hpp>
+#include <System.SysUtils.hpp>
+#include <Registry.hpp>
+#include <vector>
+#include <map>
+#include <memory>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Registry backend - string values addressed by key path and value name
+//---------------------------------------------------------------------------
+class TRegistryBackend
+{
+public:
+    virtual ~TRegistryBackend() {}
+
+    // Returns false if the key or the value does not exist
+    virtual bool ReadValue(const String& key, const String& name, String& value) = 0;
+    // Creates the key if needed
+    virtual bool WriteValue(const String& key, const String& name, const String& value) = 0;
+    virtual bool DeleteValue(const String& key, const String& name) = 0;
+    virtual void GetValueNames(const String& key, TStrings* names) = 0;
+};
+
+typedef std::shared_ptr<TRegistryBackend> TRegistryBackendPtr;
+
+//---------------------------------------------------------------------------
+// Windows registry backend (keeps the last used key open). A read-only
+// backend opens keys with KEY_READ; its writes fail.
+//---------------------------------------------------------------------------
+class TWinRegistryBackend : public TRegistryBackend
+{
+private:
+    HKEY FRootKey;
+    bool FReadOnly;
+    std::unique_ptr<TRegistry> FRegistry;
+    String FOpenKey;
+
+    bool OpenKey(const String& key, bool canCreate);
+
+public:
+    explicit TWinRegistryBackend(HKEY rootKey = HKEY_CURRENT_USER, bool readOnly = false);
+    ~TWinRegistryBackend();
+
+    bool ReadValue(const String& key, const String& name, String& value) override;
+    bool WriteValue(const String& key, const String& name, const String& value) override;
+    bool DeleteValue(const String& key, const String& name) override;
+    void GetValueNames(const String& key, TStrings* names) override;
+};
+
+//---------------------------------------------------------------------------
+// In-memory backend (case-insensitive keys and names, like the registry)
+//---------------------------------------------------------------------------
+class TMemoryRegistryBackend : public TRegistryBackend
+{
+private:
+    struct TMemoryValue
+    {
+        String Name;
+        String Value;
+    };
+
+    // Key = lowercase key path, then lowercase value name
+    std::map<String, std::map<String, TMemoryValue>> FKeys;
+
+public:
+    bool ReadValue(const String& key, const String& name, String& value) override;
+    bool WriteValue(const String& key, const String& name, const String& value) override;
+    bool DeleteValue(const String& key, const String& name) override;
+    void GetValueNames(const String& key, TStrings* names) override;
+
+    bool KeyExists(const String& key) const;
+    void Clear() { FKeys.clear(); }
+};
+
+//---------------------------------------------------------------------------
+// Recorded mutation of one value
+//---------------------------------------------------------------------------
+enum class TRegistryChangeKind
+{
+    SetValue,           // Replace the value
+    DeleteValue,        // Remove the value
+    AddPathEntry,       // Append an entry to a ';' separated list
+    RemovePathEntry     // Remove an entry from a ';' separated list
+};
+
+struct TRegistryChange
+{
+    TRegistryChangeKind Kind;
+    String Data;
+};
+
+// Change together with its target (export/replay of a change set)
+struct TRegistryChangeRecord
+{
+    String Key;
+    String Name;
+    TRegistryChangeKind Kind;
+    String Data;
+};
+
+//---------------------------------------------------------------------------
+// Registry change set
+//---------------------------------------------------------------------------
+class TRegistryChangeSet
+{
+private:
+    struct TValueChanges
+    {
+        String Key;
+        String Name;
+        std::vector<TRegistryChange> Changes;
+    };
+
+    struct TUndoEntry
+    {
+        String Key;
+        String Name;
+        bool Existed;
+        String Value;
+    };
+
+    TRegistryBackendPtr FBackend;
+    // Key = lowercase "key\nname"; ordered, so values of one key are adjacent
+    std::map<String, TValueChanges> FValues;
+    int FChangeCount;
+
+    TValueChanges& GetValueChanges(const String& key, const String& name);
+    void Record(const String& key, const String& name, TRegistryChangeKind kind, const String& data);
+
+    // Final state of a value after all recorded changes
+    static void Evaluate(const TValueChanges& changes,
+                         bool exists, const String& value,
+                         bool& newExists, String& newValue);
+
+public:
+    explicit TRegistryChangeSet(TRegistryBackendPtr backend);
+    ~TRegistryChangeSet();
+
+    TRegistryBackend* GetBackend() const { return FBackend.get(); }
+
+    // Record changes
+    void SetValue(const String& key, const String& name, const String& value);
+    void DeleteValue(const String& key, const String& name);
+    void AddPathEntry(const String& key, const String& name, const String& path);
+    void RemovePathEntry(const String& key, const String& name, const String& path);
+    void AddRecord(const TRegistryChangeRecord& record);
+
+    // Merged changes, grouped by value (replaying them gives the same result)
+    std::vector<TRegistryChangeRecord> GetRecords() const;
+
+    // Reads see the pending changes
+    bool ReadValue(const String& key, const String& name, String& value) const;
+    void GetValueNames(const String& key, TStrings* names) const;
+
+    bool IsEmpty() const { return FValues.empty(); }
+    int GetChangeCount() const { return FChangeCount; }    // Recorded calls
+    int GetValueCount() const { return (int)FValues.size(); } // Distinct values
+
+    // Describe pending changes (one line per modified value)
+    void Diff(TStrings* lines) const;
+
+    // Write all pending changes. On failure already written values are
+    // restored and false is returned. Pending changes are cleared either way.
+    bool Apply(int* writtenCount = nullptr);
+
+    // Drop pending changes without writing anything
+    void Discard();
+};
+
+typedef std::shared_ptr<TRegistryChangeSet> TRegistryChangeSetPtr;
+
+} // namespace DxCore
+
+#endif
@@ -0,0 +1,129 @@
+//---------------------------------------------------------------------------
+// ScratchDir implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "ScratchDir.h"
+#include "FileOps.h"
+#include <Winapi.Windows.hpp>
+#include <mutex>
+
+namespace DxCore
+{
+
+static bool IsInDir(const String& path, const String& dir)
+{
+    return path.LowerCase().StartsWith(IncludeTrailingPathDelimiter(dir).LowerCase());
+}
+
+//---------------------------------------------------------------------------
+// TScratchDir implementation
+//---------------------------------------------------------------------------
+TScratchDir::TScratchDir(const String& root)
+{
+    static std::atomic<unsigned int> counter(0);
+    FDir = IncludeTrailingPathDelimiter(root) + L"DxAutoInstaller." +
+           String((int)GetCurrentProcessId()) + L"." + String((int)++counter);
+}
+
+TScratchDir::~TScratchDir()
+{
+    TFileOps::DeleteTree(FDir);
+}
+
+String TScratchDir::Map(const String& persistentDir)
+{
+    String persistent = ExcludeTrailingPathDelimiter(persistentDir);
+    for (const auto& mapping : FMappings)
+    {
+        if (SameText(mapping.Persistent, persistent))
+            return mapping.Scratch;
+    }
+
+    TMapping mapping;
+    mapping.Persistent = persistent;
+    mapping.Scratch = FDir + L"\\" + String((int)FMappings.size()) + L"." + ExtractFileName(persistent);
+    ForceDirectories(mapping.Scratch);
+    FMappings.push_back(mapping);
+    return mapping.Scratch;
+}
+
+const TScratchDir::TMapping* TScratchDir::FindMapping(const String& path) const
+{
+    for (const auto& mapping : FMappings)
+    {
+        if (SameText(path, mapping.Persistent) || IsInDir(path, mapping.Persistent))
+            return &mapping;
+    }
+    return nullptr;
+}
+
+String TScratchDir::MapPath(const String& path) const
+{
+    const TMapping* mapping = FindMapping(ExcludeTrailingPathDelimiter(path));
+    if (!mapping)
+        return path;
+    return mapping->Scratch + path.SubString(mapping->Persistent.Length() + 1,
+                                             path.Length() - mapping->Persistent.Length());
+}
+
+String TScratchDir::MapCommandLine(const String& cmdLine) const
+{
+    // BuildCommandLine quotes every directory it passes
+    String result = cmdLine;
+    for (const auto& mapping : FMappings)
+    {
+        result = StringReplace(result, L"\"" + mapping.Persistent + L"\"", L"\"" + mapping.Scratch + L"\"",
+                               TReplaceFlags() << rfReplaceAll << rfIgnoreCase);
+    }
+    return result;
+}
+
+int TScratchDir::Persist(const std::atomic<bool>* stopped)
+{
+    std::mutex lock;
+    std::vector<TFileCopy> copies;
+    for (const auto& mapping : FMappings)
+    {
+        const TMapping* current = &mapping;
+        TFileOps::Walk(mapping.Scratch, true, [&](const TWalkEntry& entry) {
+            TFileCopy copy;
+            copy.Source = entry.FullPath;
+            copy.Dest = current->Persistent + entry.FullPath.SubString(current->Scratch.Length() + 1,
+                                                                      entry.FullPath.Length() - current->Scratch.Length());
+            std::lock_guard<std::mutex> guard(lock);
+            copies.push_back(copy);
+        }, stopped);
+    }
+
+    int copied = TFileOps::CopyFiles(copies, stopped);
+    return copied == (int)copies.size() ? copied : -1;
+}
+
+bool TScratchDir::CheckCapacity(const String& root, __int64 needed, __int64 reserve, String& reason)
+{
+    ULARGE_INTEGER freeBytes;
+    if (!GetDiskFreeSpaceExW(root.c_str(), &freeBytes, nullptr, nullptr))
+    {
+        reason = L"Scratch directory not available: " + root;
+        return false;
+    }
+    if ((__int64)freeBytes.QuadPart < needed)
+    {
+        reason = L"Scratch volume has " + String((__int64)(freeBytes.QuadPart >> 20)) + L" MB free, " +
+                 String(needed >> 20) + L" MB needed";
+        return false;
+    }
+
+    // A RAM disk grows into physical memory that the compilers need too
+    MEMORYSTATUSEX memory;
+    memory.dwLength = sizeof(memory);
+    if (GlobalMemoryStatusEx(&memory) && (__int64)memory.ullAvailPhys - needed < reserve)
+    {
+        reason = L"Only " + String((__int64)(memory.ullAvailPhys >> 20)) + L" MB of memory available, " +
+                 String((needed + reserve) >> 20) + L" MB needed";
+        return false;
+    }
+    return true;
+}
+
+} // namespace DxCore
@@ -0,0 +1,70 @@
+//---------------------------------------------------------------------------
+// ScratchDir - Intermediate build output on a RAM-backed volume
+//
+// In RAM build mode the unit output dirs (Library\{suffix}\{platform}:
+// .dcu, .hpp and the .res copies the compiler reads) are redirected into a
+// private directory below a scratch root, normally a RAM disk. Dependent
+// packages then read the .dcu files of earlier ones from memory instead of
+// through the file system filters of an encrypted, scanned disk. Persist
+// copies the result to the real dirs in one parallel batch afterwards.
+//
+// Windows has no built-in RAM disk; the scratch root is whatever volume
+// the user provides (ImDisk, a RAM drive, or a fast local disk).
+//---------------------------------------------------------------------------
+#ifndef ScratchDirH
+#define ScratchDirH
+
+#include <System.hpp>
+#include <vector>
+#include <atomic>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Scratch directory
+//---------------------------------------------------------------------------
+class TScratchDir
+{
+private:
+    struct TMapping
+    {
+        String Persistent;    // No trailing delimiter
+        String Scratch;
+    };
+
+    String FDir;              // <root>\DxAutoInstaller.<pid>.<n>
+    std::vector<TMapping> FMappings;
+
+    const TMapping* FindMapping(const String& path) const;
+
+public:
+    explicit TScratchDir(const String& root);
+    ~TScratchDir();           // Deletes the scratch tree
+
+    const String& GetDir() const { return FDir; }
+
+    // Redirects persistentDir (and everything below it) into the scratch
+    // dir and returns its counterpart
+    String Map(const String& persistentDir);
+
+    // Scratch counterpart of path if it is in a mapped dir, else path
+    String MapPath(const String& path) const;
+    // Replaces every quoted mapped dir ("dir") in a compiler command line
+    String MapCommandLine(const String& cmdLine) const;
+
+    // Copies all scratch files to their persistent dirs. Returns the
+    // number of files copied, -1 if some could not be copied.
+    int Persist(const std::atomic<bool>* stopped = nullptr);
+
+    // Whether needed bytes fit on the volume of root and leave reserve
+    // bytes of physical memory for everything else. reason says why not.
+    static bool CheckCapacity(const String& root, __int64 needed, __int64 reserve, String& reason);
+
+    TScratchDir(const TScratchDir&) = delete;
+    TScratchDir& operator=(const TScratchDir&) = delete;
+};
+
+} // namespace DxCore
+
+#endif
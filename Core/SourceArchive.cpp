@@ -0,0 +1,252 @@
+//---------------------------------------------------------------------------
+// SourceArchive implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "SourceArchive.h"
+#include "TaskPool.h"
+#include <Winapi.Windows.hpp>
+#include <map>
+#include <algorithm>
+
+namespace DxCore
+{
+
+// Files per extraction task - every task opens the archive on its own
+static const size_t EXTRACT_MIN_BATCH = 64;
+static const size_t EXTRACT_BATCHES = 32;
+
+//---------------------------------------------------------------------------
+// Helpers
+//---------------------------------------------------------------------------
+static TDateTime DosTimeToDateTime(unsigned int dosTime)
+{
+    try
+    {
+        return FileDateToDateTime((int)dosTime);
+    }
+    catch (Exception&)
+    {
+        return 0;
+    }
+}
+
+// The zip stores local time; the file system wants UTC
+static bool DosTimeToFileTime(unsigned int dosTime, FILETIME& fileTime)
+{
+    FILETIME local;
+    if (!DosDateTimeToFileTime(HIWORD(dosTime), LOWORD(dosTime), &local))
+        return false;
+    return LocalFileTimeToFileTime(&local, &fileTime) != 0;
+}
+
+//---------------------------------------------------------------------------
+// TSourceArchive implementation
+//---------------------------------------------------------------------------
+TSourceArchive::TSourceArchive()
+{
+}
+
+TSourceArchive::~TSourceArchive()
+{
+    Close();
+}
+
+void TSourceArchive::Close()
+{
+    std::lock_guard<std::mutex> guard(FZipLock);
+    if (FZip)
+        FZip->Close();
+    FZip.reset();
+    FStream.reset();
+    FEntries.clear();
+    FByPath.clear();
+    FArchiveFile = L"";
+    FRoot = L"";
+}
+
+void TSourceArchive::Open(const String& archiveFile, const String& root)
+{
+    Close();
+
+    std::unique_ptr<TFileStream> stream(new TFileStream(archiveFile, fmOpenRead | fmShareDenyWrite));
+    std::unique_ptr<TZipFile> zip(new TZipFile());
+    zip->Open(stream.get(), zmRead);
+
+    // Central directory only - no entry is decompressed here
+    std::vector<TSourceArchiveEntry> entries;
+    entries.reserve(zip->FileCount);
+    for (int i = 0; i < zip->FileCount; i++)
+    {
+        String name = StringReplace(zip->FileName[i], L"/", L"\\", TReplaceFlags() << rfReplaceAll);
+        if (name.IsEmpty() || name[name.Length()] == L'\\')
+            continue;   // Directory entry
+
+        TZipHeader header = zip->FileInfo[i];
+        TSourceArchiveEntry entry;
+        entry.Path = name;
+        entry.Index = i;
+        entry.Size = header.UncompressedSize;
+        entry.DosTime = header.ModifiedDateTime;
+        entries.push_back(entry);
+    }
+
+    // A wrapping top-level folder is not part of the install layout
+    String prefix;
+    if (!entries.empty())
+    {
+        int sep = entries[0].Path.Pos(L"\\");
+        prefix = sep > 0 ? entries[0].Path.SubString(1, sep) : String();
+        for (const auto& entry : entries)
+        {
+            if (prefix.IsEmpty())
+                break;
+            if (!SameText(entry.Path.SubString(1, prefix.Length()), prefix))
+                prefix = L"";
+        }
+    }
+
+    FArchiveFile = archiveFile;
+    FRoot = ExcludeTrailingPathDelimiter(root);
+    FEntries.swap(entries);
+    for (size_t i = 0; i < FEntries.size(); i++)
+    {
+        if (!prefix.IsEmpty())
+            FEntries[i].Path = FEntries[i].Path.SubString(prefix.Length() + 1, FEntries[i].Path.Length() - prefix.Length());
+        FByPath[FEntries[i].Path.LowerCase()] = i;
+    }
+
+    FStream = std::move(stream);
+    FZip = std::move(zip);
+}
+
+const TSourceArchiveEntry* TSourceArchive::Find(const String& path) const
+{
+    int rootLen = FRoot.Length();
+    if (rootLen == 0 || path.Length() <= rootLen + 1 ||
+        path[rootLen + 1] != L'\\' || !SameText(path.SubString(1, rootLen), FRoot))
+        return nullptr;
+
+    auto it = FByPath.find(path.SubString(rootLen + 2, path.Length() - rootLen - 1).LowerCase());
+    if (it == FByPath.end())
+        return nullptr;
+    return &FEntries[it->second];
+}
+
+std::vector<TFileIndexEntry> TSourceArchive::GetListing() const
+{
+    std::vector<TFileIndexEntry> listing;
+    listing.reserve(FEntries.size());
+    for (const auto& entry : FEntries)
+    {
+        TFileIndexEntry item;
+        item.FullPath = FRoot + L"\\" + entry.Path;
+        item.Name = ExtractFileName(entry.Path);
+        item.Size = entry.Size;
+        item.TimeStamp = DosTimeToDateTime(entry.DosTime);
+        listing.push_back(item);
+    }
+    return listing;
+}
+
+bool TSourceArchive::ReadBytes(const String& path, TBytes& bytes)
+{
+    const TSourceArchiveEntry* entry = Find(path);
+    if (entry == nullptr)
+        return false;
+
+    std::lock_guard<std::mutex> guard(FZipLock);
+    if (!FZip)
+        return false;
+    FZip->Read(entry->Index, bytes);
+    return true;
+}
+
+bool TSourceArchive::ReadLines(const String& path, TStrings* lines)
+{
+    TBytes bytes;
+    if (!ReadBytes(path, bytes))
+        return false;
+
+    TEncoding* encoding = nullptr;
+    int bomLength = TEncoding::GetBufferEncoding(bytes, encoding, TEncoding::Default);
+    lines->Text = encoding->GetString(bytes, bomLength, bytes.Length - bomLength);
+    return true;
+}
+
+std::vector<TFileCopy> TSourceArchive::Extract(const std::vector<TFileCopy>& copies,
+                                               const std::atomic<bool>* stopped)
+{
+    // Like TFileOps::CopyFiles, a later copy to the same destination wins
+    std::vector<TFileCopy> others;
+    std::map<String, std::pair<const TSourceArchiveEntry*, String>> byDest;
+    for (const auto& copy : copies)
+    {
+        const TSourceArchiveEntry* entry = Find(copy.Source);
+        if (entry == nullptr)
+        {
+            others.push_back(copy);
+            continue;
+        }
+        byDest[copy.Dest.LowerCase()] = std::make_pair(entry, copy.Dest);
+    }
+
+    // Sorted by entry index, so every task reads the archive front to back
+    std::vector<std::pair<const TSourceArchiveEntry*, String>> items;
+    items.reserve(byDest.size());
+    for (const auto& it : byDest)
+        items.push_back(it.second);
+    std::sort(items.begin(), items.end(),
+        [](const std::pair<const TSourceArchiveEntry*, String>& a,
+           const std::pair<const TSourceArchiveEntry*, String>& b) {
+            return a.first->Index < b.first->Index;
+        });
+
+    std::map<String, String> dirs;      // lower-case -> path
+    for (const auto& item : items)
+    {
+        String dir = ExtractFileDir(item.second);
+        dirs[dir.LowerCase()] = dir;
+    }
+    for (const auto& it : dirs)
+    {
+        if (!it.second.IsEmpty())
+            ForceDirectories(it.second);
+    }
+
+    size_t count = items.size();
+    size_t batch = std::max(EXTRACT_MIN_BATCH, count / EXTRACT_BATCHES + 1);
+    String archiveFile = FArchiveFile;
+    TTaskGroup group(stopped);
+    for (size_t first = 0; first < count; first += batch)
+    {
+        group.RunIO([&, first]() {
+            size_t last = std::min(count, first + batch);
+            std::unique_ptr<TFileStream> stream(new TFileStream(archiveFile, fmOpenRead | fmShareDenyWrite));
+            std::unique_ptr<TZipFile> zip(new TZipFile());
+            zip->Open(stream.get(), zmRead);
+
+            for (size_t i = first; i < last && !group.IsCancelled(); i++)
+            {
+                const TSourceArchiveEntry* entry = items[i].first;
+                TBytes bytes;
+                zip->Read(entry->Index, bytes);
+
+                std::unique_ptr<TFileStream> out(new TFileStream(items[i].second, fmCreate));
+                if (bytes.Length > 0)
+                    out->WriteBuffer(&bytes[0], bytes.Length);
+                TIOThrottle::Shared().Consume(bytes.Length, stopped);
+
+                // The compiler compares source and .dcu time stamps
+                FILETIME writeTime;
+                if (DosTimeToFileTime(entry->DosTime, writeTime))
+                    SetFileTime((HANDLE)out->Handle, nullptr, nullptr, &writeTime);
+            }
+            zip->Close();
+        });
+    }
+
+    group.Wait();
+    return others;
+}
+
+} // namespace DxCore
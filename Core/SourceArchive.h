@@ -0,0 +1,95 @@
+//---------------------------------------------------------------------------
+// SourceArchive - A zipped DevExpress source drop used in place of the
+// extracted install directory
+//
+// Only the central directory is read up front. It is turned into a listing
+// of virtual paths below the install directory (root), so TFileIndex and
+// everything planned from it see the archive as if it had been unpacked
+// there. Package files and dxCore.pas are read into memory; the files an
+// install actually needs (Library\Sources, the platform dirs and the
+// package dirs the compiler runs in) are extracted straight to their
+// destination, in parallel. Nothing else is ever written.
+//
+// A single top-level folder that wraps the whole archive is skipped, so
+// "DevExpressVCL\ExpressCore Library\..." maps like "ExpressCore Library\...".
+//---------------------------------------------------------------------------
+#ifndef SourceArchiveH
+#define SourceArchiveH
+
+#include <System.hpp>
+#include <System.Classes.hpp>
+#include <System.SysUtils.hpp>
+#include <System.Zip.hpp>
+#include <vector>
+#include <memory>
+#include <mutex>
+#include <atomic>
+#include <unordered_map>
+#include "StringHash.h"
+#include "FileIndex.h"
+#include "FileOps.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// One file of the archive
+//---------------------------------------------------------------------------
+struct TSourceArchiveEntry
+{
+    String Path;              // Relative to root, '\' separated, original case
+    int Index;                // Entry index in the zip
+    __int64 Size;             // Uncompressed
+    unsigned int DosTime;     // Modification time as stored in the zip
+
+    TSourceArchiveEntry() : Index(-1), Size(0), DosTime(0) {}
+};
+
+//---------------------------------------------------------------------------
+// Source archive
+//---------------------------------------------------------------------------
+class TSourceArchive
+{
+private:
+    String FArchiveFile;
+    String FRoot;             // Virtual root without trailing delimiter
+    std::vector<TSourceArchiveEntry> FEntries;
+    std::unordered_map<String, size_t, TStringHash> FByPath;  // Lowercase relative path
+
+    // Kept open for ReadBytes; extraction tasks open their own
+    std::unique_ptr<TFileStream> FStream;
+    std::unique_ptr<TZipFile> FZip;
+    std::mutex FZipLock;
+
+    const TSourceArchiveEntry* Find(const String& path) const;
+
+public:
+    TSourceArchive();
+    ~TSourceArchive();
+
+    // Reads the central directory. Throws if archiveFile is not a zip.
+    void Open(const String& archiveFile, const String& root);
+    void Close();
+
+    const String& GetArchiveFile() const { return FArchiveFile; }
+    const String& GetRoot() const { return FRoot; }
+    int GetFileCount() const { return (int)FEntries.size(); }
+
+    // Listing for TFileIndex::Build(root, listing)
+    std::vector<TFileIndexEntry> GetListing() const;
+
+    // path: absolute, below root
+    bool Contains(const String& path) const { return Find(path) != nullptr; }
+    bool ReadBytes(const String& path, TBytes& bytes);
+    // Decoded like TStrings::LoadFromFile (BOM, else ANSI)
+    bool ReadLines(const String& path, TStrings* lines);
+
+    // Writes every copy whose Source is in the archive to its Dest and
+    // returns the others. Throws on error; stops early on the stop flag.
+    std::vector<TFileCopy> Extract(const std::vector<TFileCopy>& copies,
+                                   const std::atomic<bool>* stopped = nullptr);
+};
+
+} // namespace DxCore
+
+#endif
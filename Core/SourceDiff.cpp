@@ -0,0 +1,521 @@
+//---------------------------------------------------------------------------
+// SourceDiff implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "SourceDiff.h"
+#include "TaskPool.h"
+#include <System.JSON.hpp>
+#include <System.StrUtils.hpp>
+#include <IOUtils.hpp>
+#include <unordered_map>
+#include <algorithm>
+#include <map>
+#include <mutex>
+#include "StringHash.h"
+
+namespace DxCore
+{
+
+// Size model for the estimate: fixed cost per compiler run plus source
+// throughput, roughly what dcc32 achieves on DevExpress units
+static const double COMPILE_SECONDS_PER_PACKAGE = 1.5;
+static const double COMPILE_BYTES_PER_SECOND = 2.0 * 1024 * 1024;
+
+//---------------------------------------------------------------------------
+// Helpers
+//---------------------------------------------------------------------------
+static String BaseName(const String& path)
+{
+    return TPath::GetFileNameWithoutExtension(path).LowerCase();
+}
+
+static String KindToString(TSourceChangeKind kind)
+{
+    switch (kind)
+    {
+        case TSourceChangeKind::Added: return L"added";
+        case TSourceChangeKind::Removed: return L"removed";
+        default: return L"modified";
+    }
+}
+
+static TSourceChangeKind KindFromString(const String& value)
+{
+    if (SameText(value, L"added"))
+        return TSourceChangeKind::Added;
+    if (SameText(value, L"removed"))
+        return TSourceChangeKind::Removed;
+    return TSourceChangeKind::Modified;
+}
+
+static String ReadString(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    return value ? value->Value() : String();
+}
+
+static double ReadNumber(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    if (TJSONNumber* number = dynamic_cast<TJSONNumber*>(value))
+        return number->AsDouble;
+    return 0;
+}
+
+static bool ReadBool(TJSONObject* obj, const String& name)
+{
+    TJSONValue* value = obj->GetValue(name);
+    if (TJSONBool* flag = dynamic_cast<TJSONBool*>(value))
+        return flag->AsBoolean;
+    return false;
+}
+
+// Names (with extension, lower-case) of the files a source file includes
+// with {$I name} / {$INCLUDE name}. {$I+} and {$I-} are compiler switches.
+static void ParseIncludes(const String& fileName, std::vector<String>& includes)
+{
+    TBytes bytes = TFile::ReadAllBytes(fileName);
+    if (bytes.Length == 0)
+        return;
+    String text = String(AnsiString((const char*)&bytes[0], bytes.Length)).LowerCase();
+
+    const String directives[] = { L"{$i ", L"{$include " };
+    for (const auto& directive : directives)
+    {
+        int pos = 1;
+        while ((pos = PosEx(directive, text, pos)) > 0)
+        {
+            int start = pos + directive.Length();
+            int end = start;
+            while (end <= text.Length() && text[end] != L'}')
+                end++;
+            pos = end;
+
+            String name = text.SubString(start, end - start).Trim();
+            name = StringReplace(name, L"'", L"", TReplaceFlags() << rfReplaceAll).Trim();
+            if (name.IsEmpty())
+                continue;
+            name = ExtractFileName(name);
+            if (ExtractFileExt(name).IsEmpty())
+                name += L".inc";
+            includes.push_back(name);
+        }
+    }
+}
+
+//---------------------------------------------------------------------------
+// TRebuildSet implementation
+//---------------------------------------------------------------------------
+std::set<String> TRebuildSet::GetPackageNames() const
+{
+    std::set<String> names;
+    for (const auto& package : Packages)
+        names.insert(package.PackageName.LowerCase());
+    return names;
+}
+
+std::set<String> TRebuildSet::GetChangedPackageNames() const
+{
+    std::set<String> names;
+    for (const auto& package : Packages)
+    {
+        if (package.Direct)
+            names.insert(package.PackageName.LowerCase());
+    }
+    return names;
+}
+
+String TRebuildSet::ToJSON() const
+{
+    std::unique_ptr<TJSONObject> root(new TJSONObject());
+
+    root->AddPair(L"formatVersion", new TJSONNumber(FormatVersion));
+    root->AddPair(L"oldRoot", OldRoot);
+    root->AddPair(L"newRoot", NewRoot);
+    root->AddPair(L"bdsVersion", BDSVersion);
+    root->AddPair(L"totalPackages", new TJSONNumber(TotalPackages));
+    root->AddPair(L"estimatedSeconds", new TJSONNumber(EstimatedSeconds));
+    root->AddPair(L"fullBuildSeconds", new TJSONNumber(FullBuildSeconds));
+
+    TJSONArray* changes = new TJSONArray();
+    for (const auto& change : Changes)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"path", change.Path);
+        obj->AddPair(L"kind", KindToString(change.Kind));
+        changes->AddElement(obj);
+    }
+    root->AddPair(L"changes", changes);
+
+    TJSONArray* unmapped = new TJSONArray();
+    for (const auto& file : UnmappedFiles)
+        unmapped->Add(file);
+    root->AddPair(L"unmappedFiles", unmapped);
+
+    TJSONArray* packages = new TJSONArray();
+    for (const auto& package : Packages)
+    {
+        TJSONObject* obj = new TJSONObject();
+        obj->AddPair(L"package", package.PackageName);
+        obj->AddPair(L"component", package.ComponentName);
+        obj->AddPair(L"reason", package.Reason);
+        obj->AddPair(L"direct", new TJSONBool(package.Direct));
+        obj->AddPair(L"sourceBytes", new TJSONNumber(package.SourceBytes));
+        obj->AddPair(L"estimatedSeconds", new TJSONNumber(package.EstimatedSeconds));
+        packages->AddElement(obj);
+    }
+    root->AddPair(L"packages", packages);
+
+    return root->Format(2);
+}
+
+bool TRebuildSet::FromJSON(const String& json, TRebuildSet& set)
+{
+    std::unique_ptr<TJSONValue> parsed(TJSONObject::ParseJSONValue(json));
+    TJSONObject* root = dynamic_cast<TJSONObject*>(parsed.get());
+    if (!root || (int)ReadNumber(root, L"formatVersion") != FormatVersion)
+        return false;
+
+    TRebuildSet result;
+    result.OldRoot = ReadString(root, L"oldRoot");
+    result.NewRoot = ReadString(root, L"newRoot");
+    result.BDSVersion = ReadString(root, L"bdsVersion");
+    result.TotalPackages = (int)ReadNumber(root, L"totalPackages");
+    result.EstimatedSeconds = ReadNumber(root, L"estimatedSeconds");
+    result.FullBuildSeconds = ReadNumber(root, L"fullBuildSeconds");
+
+    if (TJSONArray* changes = dynamic_cast<TJSONArray*>(root->GetValue(L"changes")))
+    {
+        for (int i = 0; i < changes->Count; i++)
+        {
+            TJSONObject* obj = dynamic_cast<TJSONObject*>(changes->Items[i]);
+            if (!obj)
+                return false;
+            TSourceChange change;
+            change.Path = ReadString(obj, L"path");
+            change.Kind = KindFromString(ReadString(obj, L"kind"));
+            result.Changes.push_back(change);
+        }
+    }
+
+    if (TJSONArray* unmapped = dynamic_cast<TJSONArray*>(root->GetValue(L"unmappedFiles")))
+    {
+        for (int i = 0; i < unmapped->Count; i++)
+            result.UnmappedFiles.push_back(unmapped->Items[i]->Value());
+    }
+
+    TJSONArray* packages = dynamic_cast<TJSONArray*>(root->GetValue(L"packages"));
+    if (!packages)
+        return false;
+    for (int i = 0; i < packages->Count; i++)
+    {
+        TJSONObject* obj = dynamic_cast<TJSONObject*>(packages->Items[i]);
+        if (!obj)
+            return false;
+        TRebuildPackage package;
+        package.PackageName = ReadString(obj, L"package");
+        package.ComponentName = ReadString(obj, L"component");
+        package.Reason = ReadString(obj, L"reason");
+        package.Direct = ReadBool(obj, L"direct");
+        package.SourceBytes = (__int64)ReadNumber(obj, L"sourceBytes");
+        package.EstimatedSeconds = ReadNumber(obj, L"estimatedSeconds");
+        result.Packages.push_back(package);
+    }
+
+    set = result;
+    return true;
+}
+
+void TRebuildSet::SaveToFile(const String& fileName) const
+{
+    TFile::WriteAllText(fileName, ToJSON(), TEncoding::UTF8);
+}
+
+bool TRebuildSet::LoadFromFile(const String& fileName, TRebuildSet& set)
+{
+    if (!FileExists(fileName))
+        return false;
+    return FromJSON(TFile::ReadAllText(fileName, TEncoding::UTF8), set);
+}
+
+//---------------------------------------------------------------------------
+// TSourceDiff implementation
+//---------------------------------------------------------------------------
+const std::vector<String>& TSourceDiff::GetSourceExtensions()
+{
+    static const std::vector<String> extensions = {
+        L".pas", L".inc", L".dfm", L".fmx", L".res", L".dcr", L".rc", L".dpk"
+    };
+    return extensions;
+}
+
+double TSourceDiff::EstimateCompileSeconds(__int64 sourceBytes)
+{
+    return COMPILE_SECONDS_PER_PACKAGE + sourceBytes / COMPILE_BYTES_PER_SECOND;
+}
+
+bool TSourceDiff::HashSources(const String& root, std::vector<TFileHash>& files,
+                              THashCache* cache, const std::atomic<bool>* stopped)
+{
+    if (!TContentHash::HashTree(root, files, cache, GetSourceExtensions(), stopped))
+        return false;
+
+    files.erase(std::remove_if(files.begin(), files.end(), [](const TFileHash& file) {
+        return file.Path.LowerCase().StartsWith(L"library\\");
+    }), files.end());
+    return true;
+}
+
+void TSourceDiff::DiffHashes(const std::vector<TFileHash>& oldFiles,
+                             const std::vector<TFileHash>& newFiles,
+                             std::vector<TSourceChange>& changes)
+{
+    // Both lists are sorted by CompareText - merge them
+    changes.clear();
+    size_t i = 0, j = 0;
+    while (i < oldFiles.size() || j < newFiles.size())
+    {
+        int order = i == oldFiles.size() ? 1 :
+                    j == newFiles.size() ? -1 :
+                    CompareText(oldFiles[i].Path, newFiles[j].Path);
+
+        TSourceChange change;
+        if (order < 0)
+        {
+            change.Path = oldFiles[i++].Path;
+            change.Kind = TSourceChangeKind::Removed;
+        }
+        else if (order > 0)
+        {
+            change.Path = newFiles[j++].Path;
+            change.Kind = TSourceChangeKind::Added;
+        }
+        else
+        {
+            bool same = oldFiles[i].Size == newFiles[j].Size && oldFiles[i].Hash == newFiles[j].Hash;
+            change.Path = newFiles[j].Path;
+            change.Kind = TSourceChangeKind::Modified;
+            i++;
+            j++;
+            if (same)
+                continue;
+        }
+        changes.push_back(change);
+    }
+}
+
+bool TSourceDiff::CompareTrees(const String& oldRoot, const String& newRoot,
+                               std::vector<TSourceChange>& changes,
+                               THashCache* cache,
+                               const std::atomic<bool>* stopped)
+{
+    std::vector<TFileHash> oldFiles, newFiles;
+    if (!HashSources(oldRoot, oldFiles, cache, stopped) || !HashSources(newRoot, newFiles, cache, stopped))
+        return false;
+
+    DiffHashes(oldFiles, newFiles, changes);
+    return true;
+}
+
+bool TSourceDiff::Analyze(const String& oldRoot, const String& newRoot,
+                          const TComponentList& components,
+                          TRebuildSet& result,
+                          THashCache* cache,
+                          const std::atomic<bool>* stopped)
+{
+    result = TRebuildSet();
+    result.OldRoot = oldRoot;
+    result.NewRoot = newRoot;
+
+    std::vector<TFileHash> oldFiles, newFiles;
+    if (!HashSources(oldRoot, oldFiles, cache, stopped) || !HashSources(newRoot, newFiles, cache, stopped))
+        return false;
+    DiffHashes(oldFiles, newFiles, result.Changes);
+
+    // Packages of the new tree, in component order
+    struct TNode
+    {
+        TPackagePtr Package;
+        String ComponentName;
+    };
+    std::vector<TNode> nodes;
+    std::unordered_map<String, size_t, TStringHash> byName;                  // Lower-case package name
+    std::unordered_map<String, std::vector<size_t>, TStringHash> unitOwners; // Lower-case unit name
+    for (const auto& comp : components)
+    {
+        for (const auto& pkg : comp->Packages)
+        {
+            if (!pkg->Exists || byName.count(pkg->Name.LowerCase()) > 0)
+                continue;
+            size_t index = nodes.size();
+            nodes.push_back({ pkg, comp->Profile->ComponentName });
+            byName[pkg->Name.LowerCase()] = index;
+            for (int i = 0; i < pkg->Contains->Count; i++)
+                unitOwners[pkg->Contains->Strings[i].LowerCase()].push_back(index);
+        }
+    }
+    result.TotalPackages = (int)nodes.size();
+
+    // Source size of every unit, for the estimate
+    std::unordered_map<String, __int64, TStringHash> unitBytes;
+    for (const auto& file : newFiles)
+    {
+        if (SameText(ExtractFileExt(file.Path), L".pas"))
+            unitBytes[BaseName(file.Path)] += file.Size;
+    }
+
+    // Include graph: included file name -> names of the files including it.
+    // Only built when an include file changed; it reads every unit.
+    std::unordered_map<String, std::vector<String>, TStringHash> includers;
+    bool includeChanged = false;
+    for (const auto& change : result.Changes)
+        includeChanged = includeChanged || SameText(ExtractFileExt(change.Path), L".inc");
+    if (includeChanged)
+    {
+        std::mutex lock;
+        TTaskGroup group(stopped);
+        String base = IncludeTrailingPathDelimiter(newRoot);
+        for (const auto& file : newFiles)
+        {
+            String ext = ExtractFileExt(file.Path).LowerCase();
+            if (ext != L".pas" && ext != L".inc")
+                continue;
+            String path = file.Path;
+            group.RunIO([&, path]() {
+                std::vector<String> includes;
+                ParseIncludes(base + path, includes);
+                std::lock_guard<std::mutex> guard(lock);
+                for (const auto& name : includes)
+                    includers[name].push_back(ExtractFileName(path).LowerCase());
+            });
+        }
+        if (!group.Wait())
+            return false;
+    }
+
+    // Directly affected packages
+    std::vector<bool> rebuild(nodes.size(), false);
+    std::vector<String> reasons(nodes.size());
+    std::vector<size_t> pending;
+    auto mark = [&](size_t index, const String& reason) {
+        if (rebuild[index])
+            return;
+        rebuild[index] = true;
+        reasons[index] = reason;
+        pending.push_back(index);
+    };
+    auto markUnit = [&](const String& unit, const String& reason) -> bool {
+        auto it = unitOwners.find(unit);
+        if (it == unitOwners.end())
+            return false;
+        for (size_t index : it->second)
+            mark(index, reason);
+        return true;
+    };
+
+    for (const auto& change : result.Changes)
+    {
+        String ext = ExtractFileExt(change.Path).LowerCase();
+        String name = BaseName(change.Path);
+        String reason = KindToString(change.Kind) + L": " + change.Path;
+        bool mapped = false;
+
+        if (ext == L".dpk" || ext == L".res" || ext == L".rc")
+        {
+            // Package source or package resource; unit resources share the unit name
+            auto it = byName.find(name);
+            if (it != byName.end())
+            {
+                mark(it->second, reason);
+                mapped = true;
+            }
+            else if (ext != L".dpk")
+                mapped = markUnit(name, reason);
+        }
+        else if (ext == L".inc")
+        {
+            // Walk up through nested include files to the units
+            std::set<String> seen;
+            std::vector<String> queue(1, ExtractFileName(change.Path).LowerCase());
+            while (!queue.empty())
+            {
+                String file = queue.back();
+                queue.pop_back();
+                if (!seen.insert(file).second)
+                    continue;
+                auto it = includers.find(file);
+                if (it == includers.end())
+                    continue;
+                for (const auto& includer : it->second)
+                {
+                    if (ExtractFileExt(includer) == L".inc")
+                        queue.push_back(includer);
+                    else
+                        mapped = markUnit(BaseName(includer), reason) || mapped;
+                }
+            }
+        }
+        else
+        {
+            // .pas, and the .dfm/.fmx/.dcr that belong to a unit
+            mapped = markUnit(name, reason);
+        }
+
+        if (!mapped)
+            result.UnmappedFiles.push_back(change.Path);
+    }
+
+    // Reverse 'requires' closure
+    std::vector<std::vector<size_t>> requiredBy(nodes.size());
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        TStringList* required = nodes[i].Package->Requires;
+        for (int r = 0; r < required->Count; r++)
+        {
+            auto it = byName.find(required->Strings[r].LowerCase());
+            if (it != byName.end())
+                requiredBy[it->second].push_back(i);
+        }
+    }
+
+    std::vector<bool> direct(rebuild);
+    while (!pending.empty())
+    {
+        size_t index = pending.back();
+        pending.pop_back();
+        for (size_t dependent : requiredBy[index])
+            mark(dependent, L"requires " + nodes[index].Package->Name);
+    }
+
+    // Rebuild set and estimate, in component/package order
+    for (size_t i = 0; i < nodes.size(); i++)
+    {
+        __int64 bytes = 0;
+        TStringList* units = nodes[i].Package->Contains;
+        for (int u = 0; u < units->Count; u++)
+        {
+            auto it = unitBytes.find(units->Strings[u].LowerCase());
+            if (it != unitBytes.end())
+                bytes += it->second;
+        }
+        double seconds = EstimateCompileSeconds(bytes);
+        result.FullBuildSeconds += seconds;
+
+        if (!rebuild[i])
+            continue;
+
+        TRebuildPackage package;
+        package.PackageName = nodes[i].Package->Name;
+        package.ComponentName = nodes[i].ComponentName;
+        package.Reason = reasons[i];
+        package.Direct = direct[i];
+        package.SourceBytes = bytes;
+        package.EstimatedSeconds = seconds;
+        result.Packages.push_back(package);
+        result.EstimatedSeconds += seconds;
+    }
+
+    return true;
+}
+
+} // namespace DxCore
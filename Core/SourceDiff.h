@@ -0,0 +1,128 @@
+//---------------------------------------------------------------------------
+// SourceDiff - Packages to rebuild after a DevExpress update
+//
+// Compares two DevExpress source trees (the installed release and the new
+// one) by content hash and maps every changed file to the packages it ends
+// up in: units through the 'contains' clause of each .dpk, forms and
+// resources through their unit, include files through the units (and the
+// include files) that include them. The set is then closed over 'requires':
+// a package that requires a rebuilt package is rebuilt as well.
+//
+// The time estimate is a rough size-based model. It is meant to compare an
+// incremental install with a full one, not to predict the clock.
+//---------------------------------------------------------------------------
+#ifndef SourceDiffH
+#define SourceDiffH
+
+#include <System.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <set>
+#include <atomic>
+#include "Component.h"
+#include "ContentHash.h"
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// One file that differs between the trees
+//---------------------------------------------------------------------------
+enum class TSourceChangeKind
+{
+    Added,
+    Modified,
+    Removed
+};
+
+struct TSourceChange
+{
+    String Path;              // Relative to both roots
+    TSourceChangeKind Kind;
+
+    TSourceChange() : Kind(TSourceChangeKind::Modified) {}
+};
+
+//---------------------------------------------------------------------------
+// One package of the rebuild set
+//---------------------------------------------------------------------------
+struct TRebuildPackage
+{
+    String PackageName;
+    String ComponentName;
+    String Reason;            // First changed file, or the required package
+    bool Direct;              // Contains a change (false: through 'requires')
+    __int64 SourceBytes;      // Units of the package in the new tree
+    double EstimatedSeconds;
+
+    TRebuildPackage() : Direct(false), SourceBytes(0), EstimatedSeconds(0) {}
+};
+
+//---------------------------------------------------------------------------
+// Result of an analysis
+//---------------------------------------------------------------------------
+struct TRebuildSet
+{
+    static const int FormatVersion = 1;
+
+    String OldRoot;
+    String NewRoot;
+    String BDSVersion;        // Package names carry this IDE's suffix
+    std::vector<TSourceChange> Changes;
+    std::vector<String> UnmappedFiles;          // Changed, but in no package
+    std::vector<TRebuildPackage> Packages;      // In component/package order
+    int TotalPackages;
+    double EstimatedSeconds;  // Rebuild set, one compiler at a time
+    double FullBuildSeconds;  // Every package, same model
+
+    TRebuildSet() : TotalPackages(0), EstimatedSeconds(0), FullBuildSeconds(0) {}
+
+    // Lower-case, as TInstaller::SetRebuildPackages expects
+    std::set<String> GetPackageNames() const;
+    // Only the packages that contain a change (Direct)
+    std::set<String> GetChangedPackageNames() const;
+
+    String ToJSON() const;
+    static bool FromJSON(const String& json, TRebuildSet& set);
+
+    void SaveToFile(const String& fileName) const;
+    static bool LoadFromFile(const String& fileName, TRebuildSet& set);
+};
+
+//---------------------------------------------------------------------------
+// Source diff
+//---------------------------------------------------------------------------
+class TSourceDiff
+{
+private:
+    static bool HashSources(const String& root, std::vector<TFileHash>& files,
+                            THashCache* cache, const std::atomic<bool>* stopped);
+    static void DiffHashes(const std::vector<TFileHash>& oldFiles,
+                           const std::vector<TFileHash>& newFiles,
+                           std::vector<TSourceChange>& changes);
+
+public:
+    // Files that can change what the compiler produces
+    static const std::vector<String>& GetSourceExtensions();
+
+    // Returns false if a tree cannot be read or the stop flag was set.
+    // Library\ (the installer's copies and build output) is not compared.
+    static bool CompareTrees(const String& oldRoot, const String& newRoot,
+                             std::vector<TSourceChange>& changes,
+                             THashCache* cache = nullptr,
+                             const std::atomic<bool>* stopped = nullptr);
+
+    // components: the new tree's components for one IDE
+    // (TInstaller::GetComponents after SetInstallFileDir(newRoot))
+    static bool Analyze(const String& oldRoot, const String& newRoot,
+                        const TComponentList& components,
+                        TRebuildSet& result,
+                        THashCache* cache = nullptr,
+                        const std::atomic<bool>* stopped = nullptr);
+
+    static double EstimateCompileSeconds(__int64 sourceBytes);
+};
+
+} // namespace DxCore
+
+#endif
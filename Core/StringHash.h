@@ -0,0 +1,34 @@
+//---------------------------------------------------------------------------
+// StringHash - Hash functor for String keys in std::unordered_* containers
+//---------------------------------------------------------------------------
+#ifndef StringHashH
+#define StringHashH
+
+#include <System.hpp>
+#include <cstddef>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// FNV-1a over UTF-16 code units. Keys are expected to be normalized
+// (e.g. lowercased) by the caller - the hash itself is case-sensitive.
+//---------------------------------------------------------------------------
+struct TStringHash
+{
+    std::size_t operator()(const String& s) const
+    {
+        unsigned long long h = 1469598103934665603ULL;
+        const wchar_t* p = s.c_str();
+        for (int i = 0, n = s.Length(); i < n; i++)
+        {
+            h ^= static_cast<unsigned long long>(p[i]);
+            h *= 1099511628211ULL;
+        }
+        return static_cast<std::size_t>(h);
+    }
+};
+
+} // namespace DxCore
+
+#endif
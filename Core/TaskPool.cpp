@@ -0,0 +1,324 @@
+//---------------------------------------------------------------------------
+// TaskPool implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "TaskPool.h"
+#include <System.Classes.hpp>
+#include <chrono>
+#include <exception>
+
+namespace DxCore
+{
+
+// Worker identity of the current thread (-1 outside of any pool)
+static thread_local const TTaskPool* t_Pool = nullptr;
+static thread_local int t_WorkerIndex = -1;
+// I/O budget the current thread holds a slot of (nullptr if none)
+static thread_local TWorkerBudget* t_IOSlot = nullptr;
+
+//---------------------------------------------------------------------------
+// TTaskPool implementation
+//---------------------------------------------------------------------------
+TTaskPool::TTaskPool(int threadCount, int ioCapacity)
+    : FIOBudget(ioCapacity)
+{
+    if (threadCount <= 0)
+        threadCount = TThread::ProcessorCount;
+    if (threadCount < 2)
+        threadCount = 2;
+
+    for (int i = 0; i < threadCount; i++)
+        FQueues.push_back(std::unique_ptr<TWorkQueue>(new TWorkQueue()));
+
+    for (int i = 0; i < threadCount; i++)
+        FThreads.push_back(std::thread(&TTaskPool::WorkerLoop, this, i));
+}
+
+TTaskPool::~TTaskPool()
+{
+    {
+        std::lock_guard<std::mutex> lock(FWakeLock);
+        FShutdown.store(true);
+    }
+    FWake.notify_all();
+
+    for (auto& thread : FThreads)
+    {
+        if (thread.joinable())
+            thread.join();
+    }
+}
+
+TTaskPool& TTaskPool::Shared()
+{
+    static TTaskPool pool;
+    return pool;
+}
+
+int TTaskPool::GetCurrentWorker() const
+{
+    return t_Pool == this ? t_WorkerIndex : -1;
+}
+
+void TTaskPool::Submit(TTaskProc task)
+{
+    // Workers keep their own follow-up work; other threads spread it out
+    int index = GetCurrentWorker();
+    if (index < 0)
+        index = (int)(FNextQueue++ % FQueues.size());
+
+    {
+        std::lock_guard<std::mutex> lock(FQueues[index]->Lock);
+        FQueues[index]->Tasks.push_back(std::move(task));
+    }
+    FPending++;
+
+    {
+        std::lock_guard<std::mutex> lock(FWakeLock);
+    }
+    FWake.notify_one();
+}
+
+void TTaskPool::Retry(TTaskProc task)
+{
+    int index = GetCurrentWorker();
+    if (index < 0)
+        index = (int)(FNextQueue++ % FQueues.size());
+
+    {
+        std::lock_guard<std::mutex> lock(FQueues[index]->Lock);
+        FQueues[index]->Tasks.push_front(std::move(task));
+    }
+    FPending++;
+
+    {
+        std::lock_guard<std::mutex> lock(FWakeLock);
+    }
+    FWake.notify_one();
+
+    // The slots are busy for a while; do not spin on the same task
+    std::this_thread::sleep_for(std::chrono::milliseconds(1));
+}
+
+bool TTaskPool::PopLocal(int index, TTaskProc& task)
+{
+    TWorkQueue& queue = *FQueues[index];
+    std::lock_guard<std::mutex> lock(queue.Lock);
+    if (queue.Tasks.empty())
+        return false;
+
+    task = std::move(queue.Tasks.back());
+    queue.Tasks.pop_back();
+    return true;
+}
+
+bool TTaskPool::Steal(int thief, TTaskProc& task)
+{
+    // Start next to the thief so victims are spread evenly
+    int count = (int)FQueues.size();
+    int start = thief >= 0 ? thief + 1 : (int)(FNextQueue.load() % count);
+    for (int i = 0; i < count; i++)
+    {
+        int victim = (start + i) % count;
+        if (victim == thief)
+            continue;
+
+        TWorkQueue& queue = *FQueues[victim];
+        std::lock_guard<std::mutex> lock(queue.Lock);
+        if (queue.Tasks.empty())
+            continue;
+
+        // Oldest task: near the root of a walk, so it carries the most work
+        task = std::move(queue.Tasks.front());
+        queue.Tasks.pop_front();
+        return true;
+    }
+    return false;
+}
+
+bool TTaskPool::TakeTask(int index, TTaskProc& task)
+{
+    if (FPending.load() <= 0)
+        return false;
+
+    if ((index >= 0 && PopLocal(index, task)) || Steal(index, task))
+    {
+        FPending--;
+        return true;
+    }
+    return false;
+}
+
+bool TTaskPool::TryRunOne()
+{
+    TTaskProc task;
+    if (!TakeTask(GetCurrentWorker(), task))
+        return false;
+
+    task();
+    return true;
+}
+
+void TTaskPool::WorkerLoop(int index)
+{
+    t_Pool = this;
+    t_WorkerIndex = index;
+
+    while (!FShutdown.load())
+    {
+        TTaskProc task;
+        if (TakeTask(index, task))
+        {
+            // Groups catch their own errors; a bare task must not end the process
+            try
+            {
+                task();
+            }
+            catch (...)
+            {
+            }
+            continue;
+        }
+
+        std::unique_lock<std::mutex> lock(FWakeLock);
+        FWake.wait_for(lock, std::chrono::milliseconds(50), [this]() {
+            return FShutdown.load() || FPending.load() > 0;
+        });
+    }
+}
+
+//---------------------------------------------------------------------------
+// TTaskGroup implementation
+//---------------------------------------------------------------------------
+TTaskGroup::TTaskGroup(const std::atomic<bool>* stopped, TTaskPool& pool)
+    : FPool(pool),
+      FStopped(stopped)
+{
+}
+
+TTaskGroup::~TTaskGroup()
+{
+    // Queued tasks refer to this group
+    WaitAll();
+}
+
+void TTaskGroup::Run(TTaskProc task)
+{
+    Submit(std::move(task), false);
+}
+
+void TTaskGroup::RunIO(TTaskProc task)
+{
+    Submit(std::move(task), true);
+}
+
+bool TTaskGroup::IsCancelled() const
+{
+    return FFailed.load() || (FStopped && FStopped->load());
+}
+
+void TTaskGroup::Submit(TTaskProc task, bool io)
+{
+    FOutstanding++;
+    FPool.Submit([this, task, io]() { Execute(task, io); });
+}
+
+void TTaskGroup::Execute(const TTaskProc& task, bool io)
+{
+    // Cancelled tasks still complete, they just do nothing
+    if (!IsCancelled())
+    {
+        // Waiting for a slot here could block the task a slot owner is
+        // waiting for; a thread that holds one lends it to nested I/O
+        TWorkerBudget& budget = FPool.GetIOBudget();
+        TWorkerBudget* held = t_IOSlot;
+        bool acquire = io && held != &budget;
+        if (acquire)
+        {
+            if (!budget.TryAcquire())
+            {
+                FPool.Retry([this, task, io]() { Execute(task, io); });
+                return;
+            }
+            t_IOSlot = &budget;
+        }
+
+        try
+        {
+            task();
+        }
+        catch (Exception& e)
+        {
+            Fail(e.Message);
+        }
+        catch (std::exception& e)
+        {
+            Fail(e.what());
+        }
+        catch (...)
+        {
+            Fail(L"Unknown error in background task");
+        }
+
+        if (acquire)
+        {
+            t_IOSlot = held;
+            budget.Release();
+        }
+    }
+    Finish();
+}
+
+void TTaskGroup::Fail(const String& message)
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    if (!FFailed.load())
+    {
+        FError = message;
+        FFailed.store(true);
+    }
+}
+
+void TTaskGroup::Finish()
+{
+    // Decrement under the lock: a waiter that saw zero may destroy the group
+    std::lock_guard<std::mutex> lock(FLock);
+    if (--FOutstanding == 0)
+        FDone.notify_all();
+}
+
+void TTaskGroup::WaitAll()
+{
+    while (FOutstanding.load() > 0)
+    {
+        if (FPool.TryRunOne())
+            continue;
+
+        std::unique_lock<std::mutex> lock(FLock);
+        FDone.wait_for(lock, std::chrono::milliseconds(10), [this]() {
+            return FOutstanding.load() == 0;
+        });
+    }
+
+    // Let the last Finish() leave the lock before the group can go away
+    std::lock_guard<std::mutex> lock(FLock);
+}
+
+bool TTaskGroup::Wait()
+{
+    WaitAll();
+
+    if (FFailed.load())
+    {
+        String message;
+        {
+            std::lock_guard<std::mutex> lock(FLock);
+            message = FError;
+        }
+        throw Exception(message);
+    }
+
+    return !(FStopped && FStopped->load());
+}
+
+} // namespace DxCore
@@ -0,0 +1,137 @@
+//---------------------------------------------------------------------------
+// TaskPool - Shared work-stealing thread pool for bulk file operations
+//
+// Each worker owns a queue: tasks submitted from a worker go to the back
+// of its own queue and are taken from there again (depth first, warm
+// caches); idle workers steal from the front of the other queues. A
+// directory walk therefore spreads out on its own - every subdirectory is
+// just another task.
+//
+// Work is submitted through a TTaskGroup, which tracks completion, stops
+// starting new tasks once the installer's stop flag is set, and reports
+// the first task failure to the waiting thread. I/O tasks additionally
+// take a slot of the pool's I/O budget, so disks and network shares see a
+// bounded number of concurrent requests regardless of the CPU count.
+//
+// No thread ever blocks for an I/O slot. An I/O task that finds the budget
+// exhausted goes back to the front of a queue; a thread that already holds
+// a slot - an I/O task waiting for a nested group and helping meanwhile -
+// runs further I/O tasks under that slot. Groups may therefore nest deeper
+// than the I/O capacity without every slot ending up with a thread that
+// waits for one.
+//---------------------------------------------------------------------------
+#ifndef TaskPoolH
+#define TaskPoolH
+
+#include <System.hpp>
+#include <System.SysUtils.hpp>
+#include <vector>
+#include <deque>
+#include <memory>
+#include <thread>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+#include <functional>
+#include "WorkerBudget.h"
+
+namespace DxCore
+{
+
+typedef std::function<void()> TTaskProc;
+
+//---------------------------------------------------------------------------
+// Task pool
+//---------------------------------------------------------------------------
+class TTaskPool
+{
+private:
+    struct TWorkQueue
+    {
+        std::mutex Lock;
+        std::deque<TTaskProc> Tasks;
+    };
+
+    std::vector<std::unique_ptr<TWorkQueue>> FQueues;
+    std::vector<std::thread> FThreads;
+    std::mutex FWakeLock;
+    std::condition_variable FWake;
+    std::atomic<int> FPending{0};
+    std::atomic<unsigned> FNextQueue{0};
+    std::atomic<bool> FShutdown{false};
+    TWorkerBudget FIOBudget;
+
+    bool PopLocal(int index, TTaskProc& task);
+    bool Steal(int thief, TTaskProc& task);
+    bool TakeTask(int index, TTaskProc& task);
+    void WorkerLoop(int index);
+
+public:
+    static const int DefaultIOCapacity = 8;
+
+    // threadCount 0 = number of CPUs
+    explicit TTaskPool(int threadCount = 0, int ioCapacity = DefaultIOCapacity);
+    ~TTaskPool();
+
+    // Process-wide pool used by the installer
+    static TTaskPool& Shared();
+
+    int GetThreadCount() const { return (int)FThreads.size(); }
+    // Index of the calling worker thread, -1 if it is not one of this pool's
+    int GetCurrentWorker() const;
+    TWorkerBudget& GetIOBudget() { return FIOBudget; }
+
+    void Submit(TTaskProc task);
+    // Queues a task that could not run yet (no I/O slot) where waiting
+    // threads and thieves find it first
+    void Retry(TTaskProc task);
+
+    // Runs one pending task on the calling thread, if there is any.
+    // Waiting threads use this to help instead of blocking.
+    bool TryRunOne();
+
+    TTaskPool(const TTaskPool&) = delete;
+    TTaskPool& operator=(const TTaskPool&) = delete;
+};
+
+//---------------------------------------------------------------------------
+// Task group - a batch of related tasks that is waited for as a whole
+//---------------------------------------------------------------------------
+class TTaskGroup
+{
+private:
+    TTaskPool& FPool;
+    const std::atomic<bool>* FStopped;
+    std::atomic<int> FOutstanding{0};
+    std::mutex FLock;
+    std::condition_variable FDone;
+    std::atomic<bool> FFailed{false};
+    String FError;
+
+    void Submit(TTaskProc task, bool io);
+    void Execute(const TTaskProc& task, bool io);
+    void Finish();
+    void Fail(const String& message);
+    void WaitAll();
+
+public:
+    explicit TTaskGroup(const std::atomic<bool>* stopped = nullptr,
+                        TTaskPool& pool = TTaskPool::Shared());
+    ~TTaskGroup();
+
+    void Run(TTaskProc task);       // CPU work
+    void RunIO(TTaskProc task);     // File system work, limited by the I/O budget
+
+    bool IsCancelled() const;
+
+    // Helps running tasks until all of them are done. Returns false if
+    // the stop flag cut the batch short; throws the first task error.
+    bool Wait();
+
+    TTaskGroup(const TTaskGroup&) = delete;
+    TTaskGroup& operator=(const TTaskGroup&) = delete;
+};
+
+} // namespace DxCore
+
+#endif
@@ -0,0 +1,75 @@
+//---------------------------------------------------------------------------
+// WorkerBudget implementation
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#include "WorkerBudget.h"
+#include <System.Classes.hpp>
+#include <chrono>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// TWorkerBudget implementation
+//---------------------------------------------------------------------------
+TWorkerBudget::TWorkerBudget(int capacity)
+    : FCapacity(1),
+      FInUse(0)
+{
+    SetCapacity(capacity);
+}
+
+void TWorkerBudget::SetCapacity(int capacity)
+{
+    if (capacity <= 0)
+        capacity = TThread::ProcessorCount;
+    if (capacity < 1)
+        capacity = 1;
+    
+    {
+        std::lock_guard<std::mutex> lock(FLock);
+        FCapacity = capacity;
+    }
+    FChanged.notify_all();
+}
+
+int TWorkerBudget::GetInUse()
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    return FInUse;
+}
+
+bool TWorkerBudget::Acquire(const std::atomic<bool>* stopped)
+{
+    std::unique_lock<std::mutex> lock(FLock);
+    while (FInUse >= FCapacity)
+    {
+        if (stopped && stopped->load())
+            return false;
+        FChanged.wait_for(lock, std::chrono::milliseconds(100));
+    }
+    
+    FInUse++;
+    return true;
+}
+
+bool TWorkerBudget::TryAcquire()
+{
+    std::lock_guard<std::mutex> lock(FLock);
+    if (FInUse >= FCapacity)
+        return false;
+    
+    FInUse++;
+    return true;
+}
+
+void TWorkerBudget::Release()
+{
+    {
+        std::lock_guard<std::mutex> lock(FLock);
+        FInUse--;
+    }
+    FChanged.notify_one();
+}
+
+} // namespace DxCore
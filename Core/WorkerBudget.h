@@ -0,0 +1,67 @@
+//---------------------------------------------------------------------------
+// WorkerBudget - Counting limit on concurrent heavy work
+//
+// One budget is shared by every IDE pipeline of an install, so running
+// several IDEs at once never starts more compiler processes than the
+// machine was given. Waiters wake up periodically to honour a stop flag.
+//---------------------------------------------------------------------------
+#ifndef WorkerBudgetH
+#define WorkerBudgetH
+
+#include <System.hpp>
+#include <mutex>
+#include <condition_variable>
+#include <atomic>
+
+namespace DxCore
+{
+
+//---------------------------------------------------------------------------
+// Worker budget
+//---------------------------------------------------------------------------
+class TWorkerBudget
+{
+private:
+    std::mutex FLock;
+    std::condition_variable FChanged;
+    int FCapacity;
+    int FInUse;
+    
+public:
+    explicit TWorkerBudget(int capacity = 0);   // 0 = number of CPUs
+    
+    int GetCapacity() const { return FCapacity; }
+    void SetCapacity(int capacity);             // Takes effect for new acquisitions
+    int GetInUse();
+    
+    // Blocks until a slot is free. Returns false (without a slot) if
+    // *stopped becomes true while waiting.
+    bool Acquire(const std::atomic<bool>* stopped = nullptr);
+    // Takes a slot only if one is free right now
+    bool TryAcquire();
+    void Release();
+};
+
+//---------------------------------------------------------------------------
+// Scoped slot
+//---------------------------------------------------------------------------
+class TWorkerSlot
+{
+private:
+    TWorkerBudget& FBudget;
+    bool FAcquired;
+    
+public:
+    TWorkerSlot(TWorkerBudget& budget, const std::atomic<bool>* stopped = nullptr)
+        : FBudget(budget), FAcquired(budget.Acquire(stopped)) {}
+    ~TWorkerSlot() { if (FAcquired) FBudget.Release(); }
+    
+    bool IsAcquired() const { return FAcquired; }
+    
+    TWorkerSlot(const TWorkerSlot&) = delete;
+    TWorkerSlot& operator=(const TWorkerSlot&) = delete;
+};
+
+} // namespace DxCore
+
+#endif
@@ -0,0 +1,1501 @@
+//---------------------------------------------------------------------------
+// DxAutoInstaller command-line edition
+// Headless front end for TInstaller - links only the Core modules
+//
+// Usage:
+//   DxAutoInstallerCli list      [--dir <path>] [--archive <zip>]
+//   DxAutoInstallerCli install   --dir <path> [--archive <zip>] [--rebuild <file.json>] [selection options]
+//   DxAutoInstallerCli uninstall [--ide <id>...] [--ide64] [--keep-files]
+//   DxAutoInstallerCli plan      --dir <path> [--archive <zip>] --ide <id> --out <file.json> [--rebuild <file.json>] [selection options]
+//   DxAutoInstallerCli apply     --plan <file.json>
+//   DxAutoInstallerCli compile-profile <Profile.ini> <Profile.bin>
+//   DxAutoInstallerCli hash-bench [<tree>] [--dir <path>] [--cache <file>]
+//   DxAutoInstallerCli rules-bench [<count>]
+//   DxAutoInstallerCli pathlist-bench [<count>]
+//   DxAutoInstallerCli background-bench [<seconds>] [--jobs <n>]
+//   DxAutoInstallerCli self-test [<area>...]
+//   DxAutoInstallerCli diff      --from <old path> --dir <path> --ide <id> [--out <file.json>] [--cache <file>]
+//   DxAutoInstallerCli export    --ide <id> --out <file.dxpack>
+//   DxAutoInstallerCli import    --pack <file.dxpack> --dir <path> --ide <id>
+//
+// Selection options:
+//   --ide <id>            BDS version ("23.0"), IDE name or "all" (repeatable,
+//                         comma separated lists accepted; default: all)
+//   --platform <list>     Runtime targets: win32,win64,win64x
+//   --register <list>     Design-time IDE bitness: 32,64
+//   --component <list>    Install only these components (and what they need)
+//   --exclude <list>      Do not install these components
+//   --enable <list>       Options: cpp,browsing-path,native-look
+//   --disable <list>      Same names as --enable
+//   --parallel            Install the selected IDEs concurrently
+//   --jobs <n>            Compiler processes at once, all IDEs together
+//                         (default: number of CPUs)
+//   --background          Compile at low CPU and I/O priority, copy at
+//                         --copy-rate (default 32 MB/s)
+//   --copy-rate <MB/s>    Limit staging copies (0 = unlimited)
+//   --affinity <cpus>     Run compilers on these CPUs only ("0-3,6")
+//   --ram-dir <path>      Compile into this (RAM disk) directory and copy
+//                         the unit output to Library\ afterwards
+//   --no-cutoff           With --rebuild, compile every package of the set,
+//                         even when the interfaces it requires are unchanged
+//   --dry-run             Log registry changes instead of writing them
+//   --force               Run even if an IDE is open
+//
+// hash-bench measures the content hash on every instruction set the CPU
+// supports, then hashes <tree> (default: <dir>\Library\Sources) twice -
+// once reading the files, once answered from the hash cache. Instruction
+// sets that disagree with the scalar hash fail the command.
+//
+// rules-bench classifies <count> (default 10000) synthetic Known Packages
+// entries with the compiled package rules (built-in plus Profile.ini) and
+// with a plain per-rule substring search, and checks that both agree.
+//
+// pathlist-bench edits a <count> (default 200) entry search path the way
+// an install does - add the DevExpress dirs, remove them again - with
+// TPathList and with the substring edits it replaced, and reports the
+// entries each one got wrong (\Win64 is "present" in ...\Win64x).
+//
+// background-bench measures how responsive the machine stays under a
+// compile-like load (CPU work plus flushed writes in --jobs processes):
+// the wake-up delay of a 1 ms sleep and the time of a small flushed write,
+// idle, with the load at normal priority and with it in background mode.
+//
+// self-test runs the self-checks of the Core modules (see CliSelfTest.h)
+// for the given areas, default all; one "check" event per check.
+//
+// diff compares the sources of the installed release (--from) with a new
+// one (--dir) and lists the packages that have to be rebuilt for the IDE,
+// with an estimated compile time. Pass its output to install/plan with
+// --rebuild to compile only those packages and keep the rest.
+//
+// export packs the build output of an installed IDE (BPL/DCP/HPP files,
+// Library\{suffix}, Library\Sources and its registry values); import
+// installs such a pack on a machine with the same IDE, without compiling.
+// --dir of import is where Library\ goes; it need not exist yet.
+//
+// --archive installs from a zipped DevExpress source drop without unpacking
+// it: only Library\Sources, the platform dirs and the package dirs that get
+// compiled are extracted, into --dir (default: the zip's path without the
+// extension, created if needed). A plan made this way remembers the zip.
+//
+// Output: one JSON object per line on stdout ("event": progress, state,
+// ide, component, plan, result, error). Exit codes: see TExitCode.
+//---------------------------------------------------------------------------
+#pragma hdrstop
+#pragma argsused
+#include <windows.h>
+#include <tchar.h>
+#include <stdio.h>
+#include <System.hpp>
+#include <System.SysUtils.hpp>
+#include <System.Classes.hpp>
+#include <System.JSON.hpp>
+#include <System.Threading.hpp>
+#include <System.Diagnostics.hpp>
+#include <IOUtils.hpp>
+#include <memory>
+#include <atomic>
+#include <mutex>
+#include <vector>
+#include <algorithm>
+#include <functional>
+#include "Core/Installer.h"
+#include "Core/ContentHash.h"
+#include "Core/SourceDiff.h"
+#include "Core/PathList.h"
+#include "CliSelfTest.h"
+
+using namespace DxCore;
+
+//---------------------------------------------------------------------------
+// Exit codes
+//---------------------------------------------------------------------------
+enum TExitCode
+{
+    ExitSuccess = 0,
+    ExitUsage = 1,          // Bad command line
+    ExitEnvironment = 2,    // No matching IDE, bad install dir/plan, IDE running
+    ExitCompileFailed = 3,  // Finished, but some packages did not compile
+    ExitCancelled = 4,      // Stopped (Ctrl+C)
+    ExitFatal = 5           // Unexpected exception
+};
+
+//---------------------------------------------------------------------------
+// JSON-lines output
+//---------------------------------------------------------------------------
+static std::mutex g_OutputLock;
+
+static void Emit(TJSONObject* event)
+{
+    std::unique_ptr<TJSONObject> owner(event);
+    UTF8String line = UTF8String(event->ToJSON());
+
+    std::lock_guard<std::mutex> lock(g_OutputLock);
+    fwrite(line.c_str(), 1, line.Length(), stdout);
+    fputc('\n', stdout);
+    fflush(stdout);
+}
+
+static TJSONObject* NewEvent(const String& name)
+{
+    TJSONObject* event = new TJSONObject();
+    event->AddPair(L"event", name);
+    return event;
+}
+
+static void EmitError(const String& message)
+{
+    TJSONObject* event = NewEvent(L"error");
+    event->AddPair(L"message", message);
+    Emit(event);
+}
+
+static int EmitResult(int exitCode, const String& message)
+{
+    TJSONObject* event = NewEvent(L"result");
+    event->AddPair(L"exitCode", new TJSONNumber(exitCode));
+    event->AddPair(L"success", new TJSONBool(exitCode == ExitSuccess));
+    if (!message.IsEmpty())
+        event->AddPair(L"message", message);
+    Emit(event);
+    return exitCode;
+}
+
+//---------------------------------------------------------------------------
+// Command line
+//---------------------------------------------------------------------------
+struct TCliArgs
+{
+    String Command;
+    String InstallDir;
+    String FromDir;
+    std::vector<String> IDEs;
+    std::vector<String> Platforms;
+    std::vector<String> Register;
+    std::vector<String> Components;
+    std::vector<String> Excludes;
+    std::vector<String> Enable;
+    std::vector<String> Disable;
+    std::vector<String> Positional;
+    String PlanFile;
+    String OutFile;
+    String CacheFile;
+    String RebuildFile;
+    String PackFile;
+    String ArchiveFile;
+    String ScratchRoot;
+    int Jobs;
+    bool Parallel;
+    bool DryRun;
+    bool Force;
+    bool Uninstall64BitIDE;
+    bool KeepFiles;
+    bool Background;
+    bool NoCutoff;
+    __int64 CopyRate;           // Bytes per second, 0 = default
+    DWORD_PTR Affinity;
+
+    TCliArgs() : Jobs(0), Parallel(false), DryRun(false), Force(false), Uninstall64BitIDE(false), KeepFiles(false),
+                 Background(false), NoCutoff(false), CopyRate(0), Affinity(0) {}
+};
+
+static void SplitList(const String& value, std::vector<String>& list)
+{
+    std::unique_ptr<TStringList> items(new TStringList());
+    items->StrictDelimiter = true;
+    items->Delimiter = L',';
+    items->DelimitedText = value;
+    for (int i = 0; i < items->Count; i++)
+    {
+        String item = items->Strings[i].Trim();
+        if (!item.IsEmpty())
+            list.push_back(item);
+    }
+}
+
+static bool ContainsText(const std::vector<String>& list, const String& value)
+{
+    for (const auto& item : list)
+    {
+        if (SameText(item, value))
+            return true;
+    }
+    return false;
+}
+
+// "0-3,6" -> CPUs 0, 1, 2, 3 and 6; 0 if the list is invalid
+static DWORD_PTR ParseCpuList(const String& value)
+{
+    const int maxCpu = (int)sizeof(DWORD_PTR) * 8 - 1;
+    std::vector<String> items;
+    SplitList(value, items);
+
+    DWORD_PTR mask = 0;
+    for (const auto& item : items)
+    {
+        int dash = item.Pos(L"-");
+        int first = StrToIntDef(dash > 0 ? item.SubString(1, dash - 1) : item, -1);
+        int last = dash > 0 ? StrToIntDef(item.SubString(dash + 1, item.Length() - dash), -1) : first;
+        if (first < 0 || last < first || last > maxCpu)
+            return 0;
+        for (int cpu = first; cpu <= last; cpu++)
+            mask |= DWORD_PTR(1) << cpu;
+    }
+    return mask;
+}
+
+// Returns an error message, or an empty string on success
+static String ParseArgs(TCliArgs& args)
+{
+    int count = ParamCount();
+    if (count < 1)
+        return L"Missing command";
+
+    args.Command = ParamStr(1).LowerCase();
+
+    for (int i = 2; i <= count; i++)
+    {
+        String arg = ParamStr(i);
+
+        auto next = [&](String& value) -> bool {
+            if (i + 1 > count)
+                return false;
+            value = ParamStr(++i);
+            return true;
+        };
+
+        String value;
+        if (!arg.StartsWith(L"--"))
+            args.Positional.push_back(arg);
+        else if (SameText(arg, L"--dry-run"))
+            args.DryRun = true;
+        else if (SameText(arg, L"--parallel"))
+            args.Parallel = true;
+        else if (SameText(arg, L"--force"))
+            args.Force = true;
+        else if (SameText(arg, L"--ide64"))
+            args.Uninstall64BitIDE = true;
+        else if (SameText(arg, L"--keep-files"))
+            args.KeepFiles = true;
+        else if (SameText(arg, L"--background"))
+            args.Background = true;
+        else if (SameText(arg, L"--no-cutoff"))
+            args.NoCutoff = true;
+        else if (!next(value))
+            return L"Missing value for " + arg;
+        else if (SameText(arg, L"--dir"))
+            args.InstallDir = IncludeTrailingPathDelimiter(ExpandFileName(value));
+        else if (SameText(arg, L"--ide"))
+            SplitList(value, args.IDEs);
+        else if (SameText(arg, L"--platform"))
+            SplitList(value, args.Platforms);
+        else if (SameText(arg, L"--register"))
+            SplitList(value, args.Register);
+        else if (SameText(arg, L"--component"))
+            SplitList(value, args.Components);
+        else if (SameText(arg, L"--exclude"))
+            SplitList(value, args.Excludes);
+        else if (SameText(arg, L"--enable"))
+            SplitList(value, args.Enable);
+        else if (SameText(arg, L"--disable"))
+            SplitList(value, args.Disable);
+        else if (SameText(arg, L"--jobs"))
+        {
+            args.Jobs = StrToIntDef(value, -1);
+            if (args.Jobs < 1)
+                return L"Invalid value for --jobs: " + value;
+        }
+        else if (SameText(arg, L"--copy-rate"))
+        {
+            double rate = StrToFloatDef(value, -1);
+            if (rate < 0)
+                return L"Invalid value for --copy-rate: " + value;
+            args.CopyRate = (__int64)(rate * 1024 * 1024);
+        }
+        else if (SameText(arg, L"--affinity"))
+        {
+            args.Affinity = ParseCpuList(value);
+            if (args.Affinity == 0)
+                return L"Invalid value for --affinity: " + value;
+        }
+        else if (SameText(arg, L"--plan"))
+            args.PlanFile = ExpandFileName(value);
+        else if (SameText(arg, L"--out"))
+            args.OutFile = ExpandFileName(value);
+        else if (SameText(arg, L"--cache"))
+            args.CacheFile = ExpandFileName(value);
+        else if (SameText(arg, L"--from"))
+            args.FromDir = IncludeTrailingPathDelimiter(ExpandFileName(value));
+        else if (SameText(arg, L"--rebuild"))
+            args.RebuildFile = ExpandFileName(value);
+        else if (SameText(arg, L"--pack"))
+            args.PackFile = ExpandFileName(value);
+        else if (SameText(arg, L"--archive"))
+            args.ArchiveFile = ExpandFileName(value);
+        else if (SameText(arg, L"--ram-dir"))
+            args.ScratchRoot = ExcludeTrailingPathDelimiter(ExpandFileName(value));
+        else
+            return L"Unknown option " + arg;
+    }
+
+    return L"";
+}
+
+static void PrintUsage()
+{
+    fwprintf(stderr,
+        L"Usage:\n"
+        L"  DxAutoInstallerCli list      [--dir <path>] [--archive <zip>]\n"
+        L"  DxAutoInstallerCli install   --dir <path> [--archive <zip>] [options]\n"
+        L"  DxAutoInstallerCli uninstall [--ide <id>] [--ide64] [--keep-files] [--dry-run]\n"
+        L"  DxAutoInstallerCli plan      --dir <path> [--archive <zip>] --ide <id> --out <file> [options]\n"
+        L"  DxAutoInstallerCli apply     --plan <file> [--dry-run]\n"
+        L"  DxAutoInstallerCli compile-profile <Profile.ini> <Profile.bin>\n"
+        L"  DxAutoInstallerCli hash-bench [<tree>] [--dir <path>] [--cache <file>]\n"
+        L"  DxAutoInstallerCli rules-bench [<count>]\n"
+        L"  DxAutoInstallerCli pathlist-bench [<count>]\n"
+        L"  DxAutoInstallerCli self-test [<area>...]\n"
+        L"  DxAutoInstallerCli background-bench [<seconds>] [--jobs <n>]\n"
+        L"  DxAutoInstallerCli diff      --from <old path> --dir <path> --ide <id> [--out <file>]\n"
+        L"  DxAutoInstallerCli export    --ide <id> --out <file.dxpack>\n"
+        L"  DxAutoInstallerCli import    --pack <file.dxpack> --dir <path> --ide <id> [--dry-run]\n"
+        L"\n"
+        L"Options:\n"
+        L"  --ide <id>          BDS version, IDE name or 'all' (default: all)\n"
+        L"  --platform <list>   win32,win64,win64x\n"
+        L"  --register <list>   32,64 (design-time IDE bitness)\n"
+        L"  --component <list>  Install only these components\n"
+        L"  --exclude <list>    Skip these components\n"
+        L"  --enable <list>     cpp,browsing-path,native-look\n"
+        L"  --disable <list>    cpp,browsing-path,native-look\n"
+        L"  --parallel          Install the selected IDEs concurrently\n"
+        L"  --jobs <n>          Compiler processes at once (default: CPUs)\n"
+        L"  --background        Low CPU/I/O priority, copies limited to --copy-rate\n"
+        L"  --copy-rate <MB/s>  Limit staging copies (background default: 32)\n"
+        L"  --affinity <cpus>   Run compilers on these CPUs only (e.g. 0-3,6)\n"
+        L"  --ram-dir <path>    Compile into a RAM disk, then copy the output\n"
+        L"  --rebuild <file>    Compile only the packages of a diff result\n"
+        L"  --no-cutoff         Rebuild all of them, even with unchanged interfaces\n"
+        L"  --archive <zip>     Install from a zipped source drop (list/install/plan)\n"
+        L"  --dry-run           Log registry changes instead of writing them\n"
+        L"  --force             Run even if an IDE is open\n");
+}
+
+//---------------------------------------------------------------------------
+// Progress reporter - receives TInstaller callbacks on the main thread
+//---------------------------------------------------------------------------
+class TCliReporter
+{
+public:
+    void __fastcall OnProgress(const TIDEInfoPtr& ide,
+                               const TComponentProfilePtr& component,
+                               const String& task,
+                               const String& target)
+    {
+        TJSONObject* event = NewEvent(L"progress");
+        if (ide)
+            event->AddPair(L"ide", ide->BDSVersion);
+        if (component)
+            event->AddPair(L"component", component->ComponentName);
+        event->AddPair(L"task", task);
+        event->AddPair(L"target", target);
+        Emit(event);
+    }
+
+    void __fastcall OnProgressState(const String& stateText)
+    {
+        TJSONObject* event = NewEvent(L"state");
+        event->AddPair(L"text", stateText);
+        Emit(event);
+    }
+};
+
+//---------------------------------------------------------------------------
+// Ctrl+C / Ctrl+Break stop the installer at the next check point
+//---------------------------------------------------------------------------
+static TInstaller* g_Installer = nullptr;
+
+static BOOL WINAPI ConsoleCtrlHandler(DWORD ctrlType)
+{
+    if (ctrlType == CTRL_C_EVENT || ctrlType == CTRL_BREAK_EVENT)
+    {
+        if (g_Installer)
+            g_Installer->Stop();
+        return TRUE;
+    }
+    return FALSE;
+}
+
+//---------------------------------------------------------------------------
+// Runs work on a background task while the main thread dispatches the
+// callbacks TInstaller queues with TThread::Queue. Rethrows its exception.
+//---------------------------------------------------------------------------
+static void RunAndPump(std::function<void()> work)
+{
+    std::atomic<bool> done{false};
+    String errorMessage;
+    bool aborted = false;
+    bool failed = false;
+
+    _di_ITask task = TTask::Run([&]() {
+        try
+        {
+            work();
+        }
+        catch (const EAbort&)
+        {
+            aborted = true;
+        }
+        catch (Exception& e)
+        {
+            failed = true;
+            errorMessage = e.Message;
+        }
+        done.store(true);
+    });
+
+    while (!done.load())
+        CheckSynchronize(50);
+    task->Wait();
+    CheckSynchronize();
+
+    if (aborted)
+        throw EAbort(L"Operation cancelled by user");
+    if (failed)
+        throw Exception(errorMessage);
+}
+
+//---------------------------------------------------------------------------
+// Selection
+//---------------------------------------------------------------------------
+static bool SelectIDEs(TInstaller* installer, const std::vector<String>& ids,
+                       std::vector<TIDEInfoPtr>& result)
+{
+    TIDEDetector* detector = installer->GetIDEDetector();
+
+    if (ids.empty() || ContainsText(ids, L"all"))
+    {
+        for (int i = 0; i < detector->GetCount(); i++)
+            result.push_back(detector->GetIDE(i));
+        return !result.empty();
+    }
+
+    for (const auto& id : ids)
+    {
+        TIDEInfoPtr ide = detector->FindByVersion(id);
+        if (!ide)
+            ide = detector->FindByName(id);
+        if (!ide)
+        {
+            EmitError(L"IDE not found: " + id);
+            return false;
+        }
+        result.push_back(ide);
+    }
+    return true;
+}
+
+static void SetOption(TInstallOptionSet& opts, TInstallOption option, bool enabled)
+{
+    if (enabled)
+        opts.insert(option);
+    else
+        opts.erase(option);
+}
+
+static bool ApplyOptionNames(TInstallOptionSet& opts, const std::vector<String>& names, bool enabled)
+{
+    for (const auto& name : names)
+    {
+        if (SameText(name, L"cpp"))
+            SetOption(opts, TInstallOption::GenerateCppFiles, enabled);
+        else if (SameText(name, L"browsing-path"))
+            SetOption(opts, TInstallOption::AddBrowsingPath, enabled);
+        else if (SameText(name, L"native-look"))
+            SetOption(opts, TInstallOption::NativeLookAndFeel, enabled);
+        else
+        {
+            EmitError(L"Unknown option name: " + name);
+            return false;
+        }
+    }
+    return true;
+}
+
+// Applies --platform/--register/--enable/--disable/--component/--exclude
+static bool ApplySelection(TInstaller* installer, const TIDEInfoPtr& ide, const TCliArgs& args)
+{
+    TInstallOptionSet opts = installer->GetOptions(ide);
+
+    if (!args.Platforms.empty())
+    {
+        for (const auto& platform : args.Platforms)
+        {
+            if (!SameText(platform, PlatformNames::Win32) &&
+                !SameText(platform, PlatformNames::Win64) &&
+                !SameText(platform, PlatformNames::Win64Modern))
+            {
+                EmitError(L"Unknown platform: " + platform);
+                return false;
+            }
+        }
+        SetOption(opts, TInstallOption::CompileWin32Runtime,
+                  ContainsText(args.Platforms, PlatformNames::Win32));
+        SetOption(opts, TInstallOption::CompileWin64Runtime,
+                  ide->SupportsWin64 && ContainsText(args.Platforms, PlatformNames::Win64));
+        SetOption(opts, TInstallOption::CompileWin64xRuntime,
+                  ide->SupportsWin64Modern && ContainsText(args.Platforms, PlatformNames::Win64Modern));
+    }
+
+    if (!args.Register.empty())
+    {
+        SetOption(opts, TInstallOption::RegisterFor32BitIDE, ContainsText(args.Register, L"32"));
+        SetOption(opts, TInstallOption::RegisterFor64BitIDE, ContainsText(args.Register, L"64"));
+    }
+
+    if (!ApplyOptionNames(opts, args.Enable, true) || !ApplyOptionNames(opts, args.Disable, false))
+        return false;
+
+    installer->SetOptions(ide, opts);
+
+    const TComponentList& components = installer->GetComponents(ide);
+
+    for (const auto& name : args.Components)
+    {
+        bool found = false;
+        for (const auto& comp : components)
+            found = found || SameText(comp->Profile->ComponentName, name);
+        if (!found)
+        {
+            EmitError(L"Component not found: " + name);
+            return false;
+        }
+    }
+
+    // --component: clear everything, then select (parents follow)
+    if (!args.Components.empty())
+    {
+        for (const auto& comp : components)
+            comp->SetState(TComponentState::NotInstall);
+        for (const auto& comp : components)
+        {
+            if (ContainsText(args.Components, comp->Profile->ComponentName))
+                comp->SetState(TComponentState::Install);
+        }
+    }
+
+    // --exclude: deselect (dependents follow)
+    for (const auto& comp : components)
+    {
+        if (ContainsText(args.Excludes, comp->Profile->ComponentName))
+            comp->SetState(TComponentState::NotInstall);
+    }
+
+    return true;
+}
+
+// --rebuild: the IDE the rebuild set was made for compiles only its packages
+static bool ApplyRebuildSet(TInstaller* installer, const std::vector<TIDEInfoPtr>& ides, const TCliArgs& args)
+{
+    if (args.RebuildFile.IsEmpty())
+        return true;
+
+    TRebuildSet set;
+    if (!TRebuildSet::LoadFromFile(args.RebuildFile, set))
+    {
+        EmitError(L"Invalid rebuild file: " + args.RebuildFile);
+        return false;
+    }
+
+    for (const auto& ide : ides)
+    {
+        if (SameText(ide->BDSVersion, set.BDSVersion))
+        {
+            installer->SetRebuildPackages(ide, set.GetPackageNames(), set.GetChangedPackageNames());
+            return true;
+        }
+    }
+
+    EmitError(L"Rebuild file is for BDS " + set.BDSVersion + L", which is not selected");
+    return false;
+}
+
+static String ComponentStateToString(TComponentState state)
+{
+    switch (state)
+    {
+        case TComponentState::Install: return L"install";
+        case TComponentState::NotInstall: return L"notInstall";
+        case TComponentState::NotFound: return L"notFound";
+        case TComponentState::NotSupported: return L"notSupported";
+        default: return L"missing";
+    }
+}
+
+//---------------------------------------------------------------------------
+// Commands
+//---------------------------------------------------------------------------
+static int CommandList(TInstaller* installer, const TCliArgs& args)
+{
+    TIDEDetector* detector = installer->GetIDEDetector();
+
+    for (int i = 0; i < detector->GetCount(); i++)
+    {
+        TIDEInfoPtr ide = detector->GetIDE(i);
+        TJSONObject* event = NewEvent(L"ide");
+        event->AddPair(L"bdsVersion", ide->BDSVersion);
+        event->AddPair(L"name", ide->Name);
+        event->AddPair(L"rootDir", ide->RootDir);
+        event->AddPair(L"win64", new TJSONBool(ide->SupportsWin64));
+        event->AddPair(L"win64x", new TJSONBool(ide->SupportsWin64Modern));
+        event->AddPair(L"running", new TJSONBool(ide->IsRunning()));
+        Emit(event);
+
+        if (args.InstallDir.IsEmpty())
+            continue;
+
+        for (const auto& comp : installer->GetComponents(ide))
+        {
+            TJSONObject* compEvent = NewEvent(L"component");
+            compEvent->AddPair(L"ide", ide->BDSVersion);
+            compEvent->AddPair(L"name", comp->Profile->ComponentName);
+            compEvent->AddPair(L"state", ComponentStateToString(comp->State));
+            compEvent->AddPair(L"packages", new TJSONNumber(comp->GetExistsPackageCount()));
+            Emit(compEvent);
+        }
+    }
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandInstall(TInstaller* installer, const TCliArgs& args)
+{
+    std::vector<TIDEInfoPtr> ides;
+    if (!SelectIDEs(installer, args.IDEs, ides))
+        return EmitResult(ExitEnvironment, L"No IDE selected");
+
+    for (const auto& ide : ides)
+    {
+        if (!ApplySelection(installer, ide, args))
+            return EmitResult(ExitUsage, L"Invalid selection");
+    }
+    if (!ApplyRebuildSet(installer, ides, args))
+        return EmitResult(ExitUsage, L"Invalid rebuild set");
+
+    RunAndPump([&]() { installer->Install(ides); });
+
+    if (installer->IsStopped())
+        return EmitResult(ExitCancelled, L"Operation cancelled by user");
+
+    int failed = installer->GetFailedJobCount();
+    if (failed > 0)
+        return EmitResult(ExitCompileFailed, String(failed) + L" package(s) failed to compile");
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandUninstall(TInstaller* installer, const TCliArgs& args)
+{
+    std::vector<TIDEInfoPtr> ides;
+    if (!SelectIDEs(installer, args.IDEs, ides))
+        return EmitResult(ExitEnvironment, L"No IDE selected");
+
+    TUninstallOptions opts;
+    opts.Uninstall64BitIDE = args.Uninstall64BitIDE;
+    opts.DeleteCompiledFiles = !args.KeepFiles;
+
+    RunAndPump([&]() { installer->Uninstall(ides, opts); });
+
+    if (installer->IsStopped())
+        return EmitResult(ExitCancelled, L"Operation cancelled by user");
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandPlan(TInstaller* installer, const TCliArgs& args)
+{
+    std::vector<TIDEInfoPtr> ides;
+    if (!SelectIDEs(installer, args.IDEs, ides))
+        return EmitResult(ExitEnvironment, L"No IDE selected");
+    if (ides.size() != 1)
+        return EmitResult(ExitUsage, L"plan needs exactly one --ide");
+    if (args.OutFile.IsEmpty())
+        return EmitResult(ExitUsage, L"plan needs --out");
+
+    if (!ApplySelection(installer, ides[0], args))
+        return EmitResult(ExitUsage, L"Invalid selection");
+    if (!ApplyRebuildSet(installer, ides, args))
+        return EmitResult(ExitUsage, L"Invalid rebuild set");
+
+    TInstallPlanPtr plan;
+    RunAndPump([&]() { plan = installer->BuildInstallPlan(ides[0]); });
+    plan->SaveToFile(args.OutFile);
+
+    TJSONObject* event = NewEvent(L"plan");
+    event->AddPair(L"file", args.OutFile);
+    event->AddPair(L"ide", plan->BDSVersion);
+    event->AddPair(L"copies", new TJSONNumber((int)plan->Copies.size()));
+    event->AddPair(L"compileJobs", new TJSONNumber((int)plan->CompileJobs.size()));
+    event->AddPair(L"skipped", new TJSONNumber((int)plan->Skipped.size()));
+    event->AddPair(L"registryChanges", new TJSONNumber((int)plan->RegistryChanges.size()));
+    Emit(event);
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandApply(TInstaller* installer, const TCliArgs& args)
+{
+    if (args.PlanFile.IsEmpty())
+        return EmitResult(ExitUsage, L"apply needs --plan");
+
+    TInstallPlan plan;
+    if (!TInstallPlan::LoadFromFile(args.PlanFile, plan))
+        return EmitResult(ExitEnvironment, L"Invalid plan file: " + args.PlanFile);
+
+    TIDEInfoPtr ide = installer->GetIDEDetector()->FindByVersion(plan.BDSVersion);
+    if (!ide)
+        return EmitResult(ExitEnvironment, L"IDE not found: " + plan.BDSVersion);
+
+    if (!plan.SourceArchive.IsEmpty())
+    {
+        if (!FileExists(plan.SourceArchive))
+            return EmitResult(ExitEnvironment, L"File not found: " + plan.SourceArchive);
+        installer->SetInstallArchive(plan.SourceArchive, plan.InstallFileDir);
+    }
+    else
+        installer->SetInstallFileDir(plan.InstallFileDir);
+    RunAndPump([&]() { installer->ExecuteInstallPlan(ide, plan); });
+
+    int failed = installer->GetFailedJobCount();
+    if (failed > 0)
+        return EmitResult(ExitCompileFailed, String(failed) + L" package(s) failed to compile");
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandDiff(TInstaller* installer, const TCliArgs& args)
+{
+    std::vector<TIDEInfoPtr> ides;
+    if (!SelectIDEs(installer, args.IDEs, ides))
+        return EmitResult(ExitEnvironment, L"No IDE selected");
+    if (ides.size() != 1)
+        return EmitResult(ExitUsage, L"diff needs exactly one --ide");
+    if (args.FromDir.IsEmpty())
+        return EmitResult(ExitUsage, L"diff needs --from");
+    if (!DirectoryExists(args.FromDir))
+        return EmitResult(ExitEnvironment, L"Directory not found: " + args.FromDir);
+
+    THashCache cache;
+    if (!args.CacheFile.IsEmpty())
+        cache.LoadFromFile(args.CacheFile);
+
+    TRebuildSet set;
+    bool completed = false;
+    TStopwatch watch = TStopwatch::StartNew();
+    RunAndPump([&]() {
+        completed = TSourceDiff::Analyze(ExcludeTrailingPathDelimiter(args.FromDir),
+                                         ExcludeTrailingPathDelimiter(args.InstallDir),
+                                         installer->GetComponents(ides[0]), set, &cache);
+    });
+    if (!completed)
+        return EmitResult(ExitEnvironment, L"Cannot read the source trees");
+    set.BDSVersion = ides[0]->BDSVersion;
+
+    if (!args.CacheFile.IsEmpty())
+        cache.SaveToFile(args.CacheFile);
+    if (!args.OutFile.IsEmpty())
+        set.SaveToFile(args.OutFile);
+
+    for (const auto& package : set.Packages)
+    {
+        TJSONObject* event = NewEvent(L"rebuild");
+        event->AddPair(L"package", package.PackageName);
+        event->AddPair(L"component", package.ComponentName);
+        event->AddPair(L"direct", new TJSONBool(package.Direct));
+        event->AddPair(L"reason", package.Reason);
+        event->AddPair(L"estimatedSeconds", new TJSONNumber(package.EstimatedSeconds));
+        Emit(event);
+    }
+    for (const auto& file : set.UnmappedFiles)
+    {
+        TJSONObject* event = NewEvent(L"unmapped");
+        event->AddPair(L"path", file);
+        Emit(event);
+    }
+
+    TJSONObject* event = NewEvent(L"diff");
+    event->AddPair(L"ide", set.BDSVersion);
+    event->AddPair(L"changes", new TJSONNumber((int)set.Changes.size()));
+    event->AddPair(L"unmapped", new TJSONNumber((int)set.UnmappedFiles.size()));
+    event->AddPair(L"packages", new TJSONNumber((int)set.Packages.size()));
+    event->AddPair(L"totalPackages", new TJSONNumber(set.TotalPackages));
+    event->AddPair(L"estimatedSeconds", new TJSONNumber(set.EstimatedSeconds));
+    event->AddPair(L"fullBuildSeconds", new TJSONNumber(set.FullBuildSeconds));
+    event->AddPair(L"analysisMs", new TJSONNumber(watch.Elapsed.TotalMilliseconds));
+    if (!args.OutFile.IsEmpty())
+        event->AddPair(L"file", args.OutFile);
+    Emit(event);
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandExport(TInstaller* installer, const TCliArgs& args)
+{
+    std::vector<TIDEInfoPtr> ides;
+    if (!SelectIDEs(installer, args.IDEs, ides))
+        return EmitResult(ExitEnvironment, L"No IDE selected");
+    if (ides.size() != 1)
+        return EmitResult(ExitUsage, L"export needs exactly one --ide");
+    if (args.OutFile.IsEmpty())
+        return EmitResult(ExitUsage, L"export needs --out");
+
+    TStopwatch watch = TStopwatch::StartNew();
+    RunAndPump([&]() { installer->ExportBinaryPack(ides[0], args.OutFile); });
+
+    TJSONObject* event = NewEvent(L"pack");
+    event->AddPair(L"file", args.OutFile);
+    event->AddPair(L"ide", ides[0]->BDSVersion);
+    event->AddPair(L"ms", new TJSONNumber(watch.Elapsed.TotalMilliseconds));
+    Emit(event);
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandImport(TInstaller* installer, const TCliArgs& args)
+{
+    std::vector<TIDEInfoPtr> ides;
+    if (!SelectIDEs(installer, args.IDEs, ides))
+        return EmitResult(ExitEnvironment, L"No IDE selected");
+    if (ides.size() != 1)
+        return EmitResult(ExitUsage, L"import needs exactly one --ide");
+    if (args.PackFile.IsEmpty())
+        return EmitResult(ExitUsage, L"import needs --pack");
+    if (!FileExists(args.PackFile))
+        return EmitResult(ExitEnvironment, L"File not found: " + args.PackFile);
+
+    TStopwatch watch = TStopwatch::StartNew();
+    RunAndPump([&]() { installer->ImportBinaryPack(ides[0], args.PackFile, args.InstallDir); });
+
+    if (installer->IsStopped())
+        return EmitResult(ExitCancelled, L"Operation cancelled by user");
+
+    TJSONObject* event = NewEvent(L"unpack");
+    event->AddPair(L"file", args.PackFile);
+    event->AddPair(L"ide", ides[0]->BDSVersion);
+    event->AddPair(L"ms", new TJSONNumber(watch.Elapsed.TotalMilliseconds));
+    Emit(event);
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandCompileProfile(const TCliArgs& args)
+{
+    if (args.Positional.size() != 2)
+        return EmitResult(ExitUsage, L"compile-profile needs <Profile.ini> <Profile.bin>");
+
+    if (!TProfileManager::CompileProfile(args.Positional[0], args.Positional[1]))
+        return EmitResult(ExitEnvironment, L"Cannot compile " + args.Positional[0]);
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandHashBench(const TCliArgs& args)
+{
+    String root;
+    if (args.Positional.size() == 1)
+        root = ExpandFileName(args.Positional[0]);
+    else if (args.Positional.empty() && !args.InstallDir.IsEmpty())
+        root = TInstaller::GetInstallSourcesDir(ExcludeTrailingPathDelimiter(args.InstallDir));
+    else
+        return EmitResult(ExitUsage, L"hash-bench needs <tree> or --dir");
+
+    if (!DirectoryExists(root))
+        return EmitResult(ExitEnvironment, L"Directory not found: " + root);
+
+    // In-memory throughput of every supported instruction set
+    const size_t bufferSize = 64 * 1024 * 1024;
+    std::vector<uint8_t> buffer(bufferSize);
+    uint64_t seed = 0x9E3779B97F4A7C15ULL;
+    for (auto& b : buffer)
+    {
+        seed = seed * 6364136223846793005ULL + 1442695040888963407ULL;
+        b = (uint8_t)(seed >> 56);
+    }
+
+    THashIsa best = TContentHash::GetBestIsa();
+    THash128 scalarHash;
+    bool kernelsAgree = true;
+    const THashIsa isas[] = { THashIsa::Scalar, THashIsa::SSE2, THashIsa::AVX2, THashIsa::AVX512 };
+    for (THashIsa isa : isas)
+    {
+        TJSONObject* event = NewEvent(L"isa");
+        event->AddPair(L"name", TContentHash::GetIsaName(isa));
+        event->AddPair(L"supported", new TJSONBool(TContentHash::IsIsaSupported(isa)));
+        event->AddPair(L"selected", new TJSONBool(isa == best));
+        if (TContentHash::SetIsa(isa))
+        {
+            double bestMs = 0;
+            THash128 hash;
+            for (int run = 0; run < 3; run++)
+            {
+                TStopwatch watch = TStopwatch::StartNew();
+                hash = TContentHash::HashBuffer(buffer.data(), buffer.size());
+                double ms = watch.Elapsed.TotalMilliseconds;
+                if (run == 0 || ms < bestMs)
+                    bestMs = ms;
+            }
+            if (isa == THashIsa::Scalar)
+                scalarHash = hash;
+            else if (hash != scalarHash)
+                kernelsAgree = false;
+            event->AddPair(L"hash", hash.ToString());
+            event->AddPair(L"matchesScalar", new TJSONBool(hash == scalarHash));
+            event->AddPair(L"gbPerSec", new TJSONNumber(bestMs > 0 ? bufferSize / (bestMs * 1e6) : 0));
+        }
+        Emit(event);
+    }
+    TContentHash::SetIsa(best);
+
+    // The tree, twice: reading files, then from the cache
+    THashCache cache;
+    if (!args.CacheFile.IsEmpty())
+        cache.LoadFromFile(args.CacheFile);
+
+    const wchar_t* passes[] = { L"read", L"cached" };
+    for (const wchar_t* pass : passes)
+    {
+        std::vector<TFileHash> files;
+        TStopwatch watch = TStopwatch::StartNew();
+        if (!TContentHash::HashTree(root, files, &cache))
+            return EmitResult(ExitEnvironment, L"Cannot hash " + root);
+        double ms = watch.Elapsed.TotalMilliseconds;
+
+        __int64 bytes = 0;
+        int cached = 0;
+        for (const auto& file : files)
+        {
+            bytes += file.Size;
+            if (file.Cached)
+                cached++;
+        }
+
+        TJSONObject* event = NewEvent(L"hashTree");
+        event->AddPair(L"pass", pass);
+        event->AddPair(L"root", root);
+        event->AddPair(L"files", new TJSONNumber((int)files.size()));
+        event->AddPair(L"cached", new TJSONNumber(cached));
+        event->AddPair(L"bytes", new TJSONNumber(bytes));
+        event->AddPair(L"ms", new TJSONNumber(ms));
+        event->AddPair(L"mbPerSec", new TJSONNumber(ms > 0 ? bytes / (ms * 1000.0) : 0));
+        Emit(event);
+    }
+
+    if (!args.CacheFile.IsEmpty())
+        cache.SaveToFile(args.CacheFile);
+
+    if (!kernelsAgree)
+        return EmitResult(ExitFatal, L"Instruction sets disagree on the content hash");
+    return EmitResult(ExitSuccess, L"");
+}
+
+// Rule by rule, on a lower-case copy - what the call sites used to do
+static TPackageClassifier::TResult ClassifyNaive(const TPackageRuleList& rules, const String& name)
+{
+    TPackageClassifier::TResult result;
+    for (int i = 0; i < PackageRuleSetCount; i++)
+        result.Rule[i] = -1;
+
+    String lowerName = name.LowerCase();
+    for (int i = 0; i < (int)rules.size(); i++)
+    {
+        int& best = result.Rule[(int)rules[i].Set];
+        if (best >= 0)
+            continue;
+        int pos = lowerName.Pos(rules[i].Pattern);
+        if (rules[i].Match == TPackageRuleMatch::Prefix ? pos == 1 : pos > 0)
+            best = i;
+    }
+    return result;
+}
+
+static int CommandRulesBench(const TCliArgs& args)
+{
+    int count = 10000;
+    if (args.Positional.size() == 1)
+        count = StrToIntDef(args.Positional[0], -1);
+    if (args.Positional.size() > 1 || count <= 0)
+        return EmitResult(ExitUsage, L"rules-bench needs a positive <count>");
+
+    // Same rule order as TInstaller::ApplyPackageRules
+    TProfileManager profile;
+    String profileFile = TProfileManager::GetCustomProfileFileName();
+    if (FileExists(profileFile))
+        profile.LoadFromFile(profileFile);
+    TPackageRuleList rules = TPackageClassifier::WithBuiltInRules(profile.GetPackageRules());
+
+    TStopwatch compileWatch = TStopwatch::StartNew();
+    TPackageClassifier classifier(rules);
+    double compileMs = compileWatch.Elapsed.TotalMilliseconds;
+
+    // Known Packages value names: DevExpress, RTL/VCL, third parties
+    const wchar_t* dirs[] = {
+        L"C:\\Program Files (x86)\\Embarcadero\\Studio\\23.0\\bin\\",
+        L"C:\\Users\\Public\\Documents\\Embarcadero\\Studio\\23.0\\Bpl\\",
+        L"$(BDS)\\bin64\\"
+    };
+    const wchar_t* names[] = {
+        L"dcldxCore", L"dclcxGrid", L"dxBar", L"cxEdit", L"dcldxSpreadSheet", L"dxFireDACEMF",
+        L"dclib", L"dcltee9", L"dclFireDAC", L"AnyDAC_Comp", L"dclbde", L"dclIndyCore",
+        L"dclRESTComponents", L"VclSmp", L"dclTMSVCLUIPack", L"JvCore", L"dclusr", L"bcboffice2k"
+    };
+    const int dirCount = sizeof(dirs) / sizeof(dirs[0]);
+    const int nameCount = sizeof(names) / sizeof(names[0]);
+    std::vector<String> values;
+    values.reserve(count);
+    for (int i = 0; i < count; i++)
+        values.push_back(String(dirs[i % dirCount]) + names[(i / dirCount) % nameCount] + String(290 + i % 7) + L".bpl");
+
+    // Best of five; each pass classifies every value for every set
+    const wchar_t* passes[] = { L"naive", L"compiled" };
+    std::vector<TPackageClassifier::TResult> results[2];
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double bestMs = 0;
+        for (int run = 0; run < 5; run++)
+        {
+            std::vector<TPackageClassifier::TResult> found;
+            found.reserve(values.size());
+            TStopwatch watch = TStopwatch::StartNew();
+            for (const auto& value : values)
+                found.push_back(pass == 0 ? ClassifyNaive(rules, value) : classifier.Classify(value));
+            double ms = watch.Elapsed.TotalMilliseconds;
+            if (run == 0 || ms < bestMs)
+                bestMs = ms;
+            results[pass].swap(found);
+        }
+
+        TJSONObject* event = NewEvent(L"classify");
+        event->AddPair(L"pass", passes[pass]);
+        event->AddPair(L"entries", new TJSONNumber(count));
+        event->AddPair(L"rules", new TJSONNumber((int)rules.size()));
+        event->AddPair(L"ms", new TJSONNumber(bestMs));
+        event->AddPair(L"nsPerEntry", new TJSONNumber(bestMs * 1e6 / count));
+        if (pass == 1)
+            event->AddPair(L"compileMs", new TJSONNumber(compileMs));
+        Emit(event);
+    }
+
+    int mismatches = 0;
+    for (int i = 0; i < count; i++)
+    {
+        for (int set = 0; set < PackageRuleSetCount; set++)
+        {
+            if (results[0][i].Rule[set] != results[1][i].Rule[set])
+            {
+                mismatches++;
+                break;
+            }
+        }
+    }
+    if (mismatches > 0)
+        return EmitResult(ExitFatal, String(mismatches) + L" entries classified differently");
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+// The substring edits TPathList replaced, for comparison in pathlist-bench
+static String AppendPathEntryNaive(const String& list, const String& path)
+{
+    if (list.Pos(path) > 0)
+        return list;
+
+    String result = list;
+    if (!result.IsEmpty() && !result.EndsWith(L";"))
+        result = result + L";";
+    return result + path;
+}
+
+static String RemovePathEntryNaive(const String& list, const String& path)
+{
+    String result = StringReplace(list, path + L";", L"", TReplaceFlags() << rfReplaceAll);
+    result = StringReplace(result, L";" + path, L"", TReplaceFlags() << rfReplaceAll);
+    result = StringReplace(result, path, L"", TReplaceFlags() << rfReplaceAll);
+    return result;
+}
+
+static int CommandPathListBench(const TCliArgs& args)
+{
+    int count = 200;
+    if (args.Positional.size() == 1)
+        count = StrToIntDef(args.Positional[0], -1);
+    if (args.Positional.size() > 1 || count <= 0)
+        return EmitResult(ExitUsage, L"pathlist-bench needs a positive <count>");
+
+    // A search path that already lists the Win64x dirs of a previous install
+    const String dxRoot = L"D:\\DevExpress\\Library\\370\\";
+    std::unique_ptr<TStringList> entries(new TStringList());
+    entries->Add(dxRoot + L"Win64x");
+    for (int i = 1; i < count; i++)
+        entries->Add(L"C:\\Components\\Vendor" + String(i % 17) + L"\\Package" + String(i) + L"\\Lib\\Win32");
+    entries->Delimiter = L';';
+    entries->StrictDelimiter = true;
+    const String original = entries->DelimitedText;
+
+    // One install: the platform dirs and the source dir of every component
+    std::vector<String> edits;
+    const wchar_t* platforms[] = { L"Win32", L"Win64", L"Win64x" };
+    for (const wchar_t* platform : platforms)
+        edits.push_back(dxRoot + platform);
+    for (int i = 0; i < 40; i++)
+        edits.push_back(L"D:\\DevExpress\\Component" + String(i) + L"\\Sources");
+
+    // Removing what was added gives back the original entries, minus the
+    // Win64x dir that is on the edit list as well
+    TPathList expectedList(original);
+    expectedList.Remove(dxRoot + L"Win64x");
+    const String expected = expectedList.ToString();
+
+    // Best of five; each run repeats the add/remove cycle
+    const int rounds = 100;
+    const wchar_t* passes[] = { L"substring", L"pathlist" };
+    String added[2];
+    String removed[2];
+    int missed[2] = { 0, 0 };
+    for (int pass = 0; pass < 2; pass++)
+    {
+        double bestMs = 0;
+        for (int run = 0; run < 5; run++)
+        {
+            TStopwatch watch = TStopwatch::StartNew();
+            for (int round = 0; round < rounds; round++)
+            {
+                if (pass == 0)
+                {
+                    String value = original;
+                    for (const auto& edit : edits)
+                        value = AppendPathEntryNaive(value, edit);
+                    added[pass] = value;
+                    for (const auto& edit : edits)
+                        value = RemovePathEntryNaive(value, edit);
+                    removed[pass] = value;
+                }
+                else
+                {
+                    // As TRegistryChangeSet: one parsed list, removals batched
+                    TPathList list(original);
+                    list.AddRange(edits);
+                    added[pass] = list.ToString();
+                    TPathList after(added[pass]);
+                    after.RemoveRange(edits);
+                    removed[pass] = after.ToString();
+                }
+            }
+            double ms = watch.Elapsed.TotalMilliseconds;
+            if (run == 0 || ms < bestMs)
+                bestMs = ms;
+        }
+
+        // Entries the add stage missed; whether removal left the others intact
+        TPathList check(added[pass]);
+        for (const auto& edit : edits)
+        {
+            if (!check.Contains(edit))
+                missed[pass]++;
+        }
+
+        TJSONObject* event = NewEvent(L"edit");
+        event->AddPair(L"pass", passes[pass]);
+        event->AddPair(L"entries", new TJSONNumber(count));
+        event->AddPair(L"edits", new TJSONNumber((int)edits.size() * 2));
+        event->AddPair(L"ms", new TJSONNumber(bestMs));
+        event->AddPair(L"usPerEdit", new TJSONNumber(bestMs * 1e3 / (rounds * edits.size() * 2)));
+        event->AddPair(L"missed", new TJSONNumber(missed[pass]));
+        event->AddPair(L"restored", new TJSONBool(removed[pass] == expected));
+        Emit(event);
+    }
+
+    if (missed[1] > 0 || removed[1] != expected)
+        return EmitResult(ExitFatal, L"TPathList add/remove did not restore the search path");
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+static int CommandSelfTest(const TCliArgs& args)
+{
+    // Internal: self-test stub-compiler <tag> <lines> <exitCode> <delayMs>
+    if (args.Positional.size() == 5 && SameText(args.Positional[0], L"stub-compiler"))
+        return TSelfTest::RunStubCompiler(args.Positional[1], StrToIntDef(args.Positional[2], 0),
+                                          StrToIntDef(args.Positional[3], 0), StrToIntDef(args.Positional[4], 0));
+
+    std::vector<String> areas = args.Positional;
+    if (areas.empty() || (areas.size() == 1 && SameText(areas[0], L"all")))
+        areas = TSelfTest::GetAreas();
+
+    TSelfTest test([](const TSelfCheck& check) {
+        TJSONObject* event = NewEvent(L"check");
+        event->AddPair(L"area", check.Area);
+        event->AddPair(L"name", check.Name);
+        event->AddPair(L"passed", new TJSONBool(check.Passed));
+        if (!check.Passed)
+            event->AddPair(L"detail", check.Detail);
+        Emit(event);
+    });
+
+    for (const auto& area : areas)
+    {
+        std::vector<String> known = TSelfTest::GetAreas();
+        if (std::find_if(known.begin(), known.end(), [&](const String& name) { return SameText(name, area); }) == known.end())
+            return EmitResult(ExitUsage, L"Unknown self-test area: " + area);
+    }
+    for (const auto& area : areas)
+        test.Run(area);
+
+    if (test.GetFailures() > 0)
+        return EmitResult(ExitFatal, String(test.GetFailures()) + L" of " + String(test.GetChecks()) + L" checks failed");
+    return EmitResult(ExitSuccess, L"");
+}
+
+// One compiler's worth of load for background-bench: CPU work with a
+// flushed 1 MB write every 50 ms. Runs in a child process, silently.
+static int RunBenchLoad(int ms, const String& dir)
+{
+    String fileName = IncludeTrailingPathDelimiter(dir) + L"DxBenchLoad." +
+                      String((int)GetCurrentProcessId()) + L".tmp";
+    HANDLE file = CreateFileW(fileName.c_str(), GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS,
+                              FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+    std::vector<char> block(1024 * 1024, 'x');
+
+    volatile unsigned int sink = 0;
+    ULONGLONG start = GetTickCount64();
+    ULONGLONG lastWrite = start;
+    while (GetTickCount64() - start < (ULONGLONG)ms)
+    {
+        for (unsigned int i = 0; i < 100000; i++)
+            sink += i * i;
+
+        if (file != INVALID_HANDLE_VALUE && GetTickCount64() - lastWrite >= 50)
+        {
+            DWORD written = 0;
+            SetFilePointer(file, 0, nullptr, FILE_BEGIN);
+            WriteFile(file, block.data(), (DWORD)block.size(), &written, nullptr);
+            FlushFileBuffers(file);
+            lastWrite = GetTickCount64();
+        }
+    }
+
+    if (file != INVALID_HANDLE_VALUE)
+        CloseHandle(file);
+    return 0;
+}
+
+static void AddLatencies(TJSONObject* event, const String& name, std::vector<double>& samples)
+{
+    std::sort(samples.begin(), samples.end());
+    size_t count = samples.size();
+    TJSONObject* stats = new TJSONObject();
+    stats->AddPair(L"samples", new TJSONNumber((int)count));
+    stats->AddPair(L"p50Ms", new TJSONNumber(count ? samples[count / 2] : 0.0));
+    stats->AddPair(L"p99Ms", new TJSONNumber(count ? samples[std::min(count - 1, count * 99 / 100)] : 0.0));
+    stats->AddPair(L"maxMs", new TJSONNumber(count ? samples.back() : 0.0));
+    event->AddPair(name, stats);
+}
+
+static int CommandBackgroundBench(const TCliArgs& args)
+{
+    // Internal: background-bench load <ms> <dir>
+    if (args.Positional.size() == 3 && SameText(args.Positional[0], L"load"))
+        return RunBenchLoad(StrToIntDef(args.Positional[1], 0), args.Positional[2]);
+
+    int seconds = 5;
+    if (args.Positional.size() == 1)
+        seconds = StrToIntDef(args.Positional[0], -1);
+    if (args.Positional.size() > 1 || seconds <= 0)
+        return EmitResult(ExitUsage, L"background-bench needs a positive <seconds>");
+
+    int jobs = args.Jobs > 0 ? args.Jobs : TThread::ProcessorCount;
+    int loadMs = seconds * 1000;
+    String dir = ExcludeTrailingPathDelimiter(TPath::GetTempPath());
+    String probeName = IncludeTrailingPathDelimiter(dir) + L"DxBenchProbe." +
+                       String((int)GetCurrentProcessId()) + L".tmp";
+    std::vector<char> probeBlock(4096, 'x');
+
+    const wchar_t* modes[] = { L"idle", L"normal", L"background" };
+    for (int mode = 0; mode < 3; mode++)
+    {
+        // The loads go through TCompilerProcess, as compilers do
+        TProcessPriority priority;
+        priority.Background = mode == 2;
+        priority.AffinityMask = args.Affinity;
+
+        std::vector<std::unique_ptr<TCompilerProcess>> loads;
+        for (int i = 0; mode > 0 && i < jobs; i++)
+        {
+            std::unique_ptr<TCompilerProcess> load(new TCompilerProcess());
+            load->SetPriority(priority);
+            String errorMessage;
+            String cmdLine = L"background-bench load " + String(loadMs) + L" \"" + dir + L"\"";
+            if (!load->Start(ParamStr(0), cmdLine, dir, errorMessage))
+                return EmitResult(ExitEnvironment, errorMessage);
+            loads.push_back(std::move(load));
+        }
+
+        // Probe on this thread, at normal priority, while the loads run
+        Sleep(200);
+        HANDLE probe = CreateFileW(probeName.c_str(), GENERIC_WRITE | DELETE, 0, nullptr, CREATE_ALWAYS,
+                                   FILE_ATTRIBUTE_TEMPORARY | FILE_FLAG_DELETE_ON_CLOSE, nullptr);
+        std::vector<double> wakes;
+        std::vector<double> writes;
+        TStopwatch total = TStopwatch::StartNew();
+        while (total.ElapsedMilliseconds < loadMs - 500)
+        {
+            TStopwatch watch = TStopwatch::StartNew();
+            Sleep(1);
+            wakes.push_back(std::max(0.0, watch.Elapsed.TotalMilliseconds - 1.0));
+
+            if (probe != INVALID_HANDLE_VALUE && wakes.size() % 10 == 0)
+            {
+                DWORD written = 0;
+                watch = TStopwatch::StartNew();
+                SetFilePointer(probe, 0, nullptr, FILE_BEGIN);
+                WriteFile(probe, probeBlock.data(), (DWORD)probeBlock.size(), &written, nullptr);
+                FlushFileBuffers(probe);
+                writes.push_back(watch.Elapsed.TotalMilliseconds);
+            }
+        }
+        if (probe != INVALID_HANDLE_VALUE)
+            CloseHandle(probe);
+
+        for (auto& load : loads)
+        {
+            load->ReadToEnd();
+            WaitForSingleObject(load->GetProcessHandle(), INFINITE);
+            load->Finish();
+        }
+
+        TJSONObject* event = NewEvent(L"responsiveness");
+        event->AddPair(L"mode", modes[mode]);
+        event->AddPair(L"loads", new TJSONNumber((int)loads.size()));
+        AddLatencies(event, L"wake", wakes);
+        AddLatencies(event, L"write", writes);
+        Emit(event);
+    }
+
+    return EmitResult(ExitSuccess, L"");
+}
+
+//---------------------------------------------------------------------------
+int _tmain(int argc, _TCHAR* argv[])
+{
+    TCliArgs args;
+    String usageError = ParseArgs(args);
+    if (!usageError.IsEmpty())
+    {
+        PrintUsage();
+        return EmitResult(ExitUsage, usageError);
+    }
+
+    if (args.Command == L"compile-profile")
+        return CommandCompileProfile(args);
+    if (args.Command == L"hash-bench")
+        return CommandHashBench(args);
+    if (args.Command == L"rules-bench")
+        return CommandRulesBench(args);
+    if (args.Command == L"pathlist-bench")
+        return CommandPathListBench(args);
+    if (args.Command == L"background-bench")
+        return CommandBackgroundBench(args);
+    if (args.Command == L"self-test")
+        return CommandSelfTest(args);
+
+    bool needsDir = args.Command == L"install" || args.Command == L"plan" || args.Command == L"diff" ||
+                    args.Command == L"import";
+    if (args.Command != L"list" && args.Command != L"uninstall" &&
+        args.Command != L"apply" && args.Command != L"export" && !needsDir)
+    {
+        PrintUsage();
+        return EmitResult(ExitUsage, L"Unknown command: " + args.Command);
+    }
+
+    try
+    {
+        std::unique_ptr<TInstaller> installer(new TInstaller());
+        TCliReporter reporter;
+        installer->SetOnProgress(reporter.OnProgress);
+        installer->SetOnProgressState(reporter.OnProgressState);
+        installer->SetRegistryDryRun(args.DryRun);
+        installer->SetConcurrentIDEs(args.Parallel);
+        installer->SetMaxParallelCompiles(args.Jobs);
+        installer->SetBackgroundMode(args.Background);
+        installer->SetCompilerAffinity(args.Affinity);
+        installer->SetCopyRateLimit(args.CopyRate);
+        installer->SetScratchRoot(args.ScratchRoot);
+        installer->SetEarlyCutoff(!args.NoCutoff);
+        installer->Initialize();
+
+        // Sources in a zip - --dir only receives what gets extracted
+        if (!args.ArchiveFile.IsEmpty())
+        {
+            if (args.Command != L"list" && args.Command != L"install" && args.Command != L"plan")
+                return EmitResult(ExitUsage, L"--archive is not supported by " + args.Command);
+            if (!FileExists(args.ArchiveFile))
+                return EmitResult(ExitEnvironment, L"File not found: " + args.ArchiveFile);
+            if (args.InstallDir.IsEmpty())
+                args.InstallDir = IncludeTrailingPathDelimiter(ChangeFileExt(args.ArchiveFile, L""));
+            if (!ForceDirectories(args.InstallDir))
+                return EmitResult(ExitEnvironment, L"Cannot create directory: " + args.InstallDir);
+            installer->SetInstallArchive(args.ArchiveFile, args.InstallDir);
+        }
+        else if (needsDir && args.InstallDir.IsEmpty())
+            return EmitResult(ExitUsage, args.Command + L" needs --dir");
+        else if (!args.InstallDir.IsEmpty() && args.Command != L"import")   // import creates its target directory
+        {
+            if (!DirectoryExists(args.InstallDir))
+                return EmitResult(ExitEnvironment, L"Directory not found: " + args.InstallDir);
+            installer->SetInstallFileDir(args.InstallDir);
+        }
+
+        bool modifiesIDE = args.Command == L"install" || args.Command == L"uninstall" ||
+                           args.Command == L"apply" || args.Command == L"import";
+        if (modifiesIDE && !args.Force && installer->GetIDEDetector()->AnyIDERunning())
+            return EmitResult(ExitEnvironment, L"Close all running IDEs or pass --force");
+
+        g_Installer = installer.get();
+        SetConsoleCtrlHandler(ConsoleCtrlHandler, TRUE);
+
+        int exitCode;
+        try
+        {
+            if (args.Command == L"list")
+                exitCode = CommandList(installer.get(), args);
+            else if (args.Command == L"install")
+                exitCode = CommandInstall(installer.get(), args);
+            else if (args.Command == L"uninstall")
+                exitCode = CommandUninstall(installer.get(), args);
+            else if (args.Command == L"plan")
+                exitCode = CommandPlan(installer.get(), args);
+            else if (args.Command == L"diff")
+                exitCode = CommandDiff(installer.get(), args);
+            else if (args.Command == L"export")
+                exitCode = CommandExport(installer.get(), args);
+            else if (args.Command == L"import")
+                exitCode = CommandImport(installer.get(), args);
+            else
+                exitCode = CommandApply(installer.get(), args);
+        }
+        catch (const EAbort&)
+        {
+            exitCode = EmitResult(ExitCancelled, L"Operation cancelled by user");
+        }
+
+        SetConsoleCtrlHandler(ConsoleCtrlHandler, FALSE);
+        g_Installer = nullptr;
+        TInstaller::CloseLogFile();
+        return exitCode;
+    }
+    catch (Exception& e)
+    {
+        g_Installer = nullptr;
+        return EmitResult(ExitFatal, e.Message);
+    }
+}
+//---------------------------------------------------------------------------
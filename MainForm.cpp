@@ -26,9 +26,8 @@ void __fastcall TfrmMain::FormCreate(TObject *Sender)
     LblAppName->Caption = Application->Title;
     LblVersion->Caption = L"v2.0.0 C++ Edition";
     
-    // Initialize installer
+    // Create installer - it initializes in the background (see OnInstallerReady)
     FInstaller = std::make_unique<DxCore::TInstaller>();
-    FInstaller->Initialize();
     FInstaller->SetOnProgress(OnProgress);
     FInstaller->SetOnProgressState(OnProgressState);
     
@@ -41,15 +40,23 @@ void __fastcall TfrmMain::FormCreate(TObject *Sender)
     FProgressForm = new TfrmProgress(this);
     FProgressForm->SetInstaller(FInstaller.get());
     
-    // Initialize UI
+    // Initialize UI - IDE lists and the profile follow once the installer
+    // is ready; until then nothing that needs them can be used
     PageFuns->ActivePage = TabInstall;
-    InitializeIDEList();
-    InitializeUninstallList();
-    InitializeProfileInfo();
+    CheckListIDEs->Items->Add(L"Detecting IDEs...");
+    CheckListIDEs->Enabled = false;
+    BtnBrowse->Enabled = false;
+    ActUninstall->Enabled = false;
+    GroupProfile->Enabled = false;
+    GroupSearch->Enabled = false;
     
     // Initial state
     UpdateControlStates();
     
+    FInstaller->InitializeAsync([this](bool success, const String& message) {
+        OnInstallerReady(success, message);
+    });
+    
     // Setup links
     LinkDownload->Caption = L"<a href=\"https://github.com/Platon7788/DxAutoInstaller\">GitHub Repository</a>";
     LinkEmail->Caption = L"<a href=\"mailto:vteme777@gmail.com\">vteme777@gmail.com</a>";
@@ -73,6 +80,25 @@ void __fastcall TfrmMain::FormCreate(TObject *Sender)
     MemoChangelog->Lines->Add(L"  - DevExpress VCL 25.1.x support");
 }
 
+//---------------------------------------------------------------------------
+void TfrmMain::OnInstallerReady(bool success, const String& message)
+{
+    // Called from main thread when the installer has initialized
+    InitializeIDEList();
+    InitializeUninstallList();
+    InitializeProfileInfo();
+    
+    CheckListIDEs->Enabled = true;
+    BtnBrowse->Enabled = true;
+    ActUninstall->Enabled = true;
+    GroupProfile->Enabled = true;
+    GroupSearch->Enabled = true;
+    UpdateControlStates();
+    
+    if (!success)
+        ShowMessage(L"Initialization failed: " + message);
+}
+
 //---------------------------------------------------------------------------
 void __fastcall TfrmMain::FormDestroy(TObject *Sender)
 {
@@ -126,6 +152,7 @@ void TfrmMain::InitializeProfileInfo()
 void TfrmMain::RefreshComponentList()
 {
     CheckListComponents->Clear();
+    FComponentItems.clear();
     
     if (FSelectedIDE == nullptr)
         return;
@@ -139,6 +166,8 @@ void TfrmMain::RefreshComponentList()
         return;
     }
     
+    FComponentItems.assign(components.size(), -1);
+    
     for (const auto& comp : components)
     {
         // Show all components for now, including base
@@ -168,6 +197,7 @@ void TfrmMain::RefreshComponentList()
                 break;
             case DxCore::TComponentState::Missing:
                 itemText = itemText + L" [missing deps]";
+                canCheck = false;
                 break;
         }
         
@@ -175,6 +205,8 @@ void TfrmMain::RefreshComponentList()
         CheckListComponents->Items->Objects[idx] = reinterpret_cast<TObject*>(comp.get());
         CheckListComponents->Checked[idx] = isChecked;
         CheckListComponents->ItemEnabled[idx] = canCheck;
+        if (comp->Index >= 0 && comp->Index < (int)FComponentItems.size())
+            FComponentItems[comp->Index] = idx;
     }
 }
 
@@ -182,20 +214,29 @@ void TfrmMain::RefreshComponentList()
 void TfrmMain::RefreshIDEList()
 {
     for (int i = 0; i < CheckListIDEs->Items->Count; i++)
+        RefreshIDEItem(i);
+}
+
+//---------------------------------------------------------------------------
+void TfrmMain::RefreshIDEItem(int item)
+{
+    intptr_t ideIndex = reinterpret_cast<intptr_t>(CheckListIDEs->Items->Objects[item]);
+    auto ide = FInstaller->GetIDEDetector()->GetIDE(static_cast<int>(ideIndex));
+    
+    // Lists still being built in the background fill in when ready
+    if (!FInstaller->IsComponentListReady(ide))
     {
-        intptr_t ideIndex = reinterpret_cast<intptr_t>(CheckListIDEs->Items->Objects[i]);
-        auto ide = FInstaller->GetIDEDetector()->GetIDE(static_cast<int>(ideIndex));
-        
-        const auto& components = FInstaller->GetComponents(ide);
-        int installCount = 0;
-        for (const auto& comp : components)
-        {
-            if (comp->State == DxCore::TComponentState::Install)
-                installCount++;
-        }
-        
-        CheckListIDEs->Items->Strings[i] = ide->Name + L" (" + String(installCount) + L")";
+        CheckListIDEs->Items->Strings[item] = ide->Name + L" (...)";
+        return;
     }
+    
+    // Popcount of the graph's install set
+    const auto& components = FInstaller->GetComponents(ide);
+    int installCount = 0;
+    if (!components.empty() && components[0]->Graph)
+        installCount = components[0]->Graph->GetInstallCount();
+    
+    CheckListIDEs->Items->Strings[item] = ide->Name + L" (" + String(installCount) + L")";
 }
 
 //---------------------------------------------------------------------------
@@ -221,17 +262,26 @@ void __fastcall TfrmMain::CheckListIDEsClick(TObject *Sender)
 //---------------------------------------------------------------------------
 void __fastcall TfrmMain::CheckListComponentsClickCheck(TObject *Sender)
 {
-    // Update component states based on checkbox
-    for (int i = 0; i < CheckListComponents->Items->Count; i++)
-    {
-        DxCore::TComponent* comp = reinterpret_cast<DxCore::TComponent*>(CheckListComponents->Items->Objects[i]);
-        if (comp != nullptr && CheckListComponents->ItemEnabled[i])
-        {
-            comp->State = CheckListComponents->Checked[i] ? 
-                DxCore::TComponentState::Install : DxCore::TComponentState::NotInstall;
-        }
-    }
-    RefreshIDEList();
+    int idx = CheckListComponents->ItemIndex;
+    if (idx < 0)
+        return;
+    
+    DxCore::TComponent* comp = reinterpret_cast<DxCore::TComponent*>(CheckListComponents->Items->Objects[idx]);
+    if (comp == nullptr || !comp->Graph)
+        return;
+    
+    // Checking selects the components it depends on, unchecking deselects
+    // the ones that depend on it; only the items that changed are updated
+    DxCore::TComponentGraph* graph = comp->Graph.get();
+    DxCore::TBitSet changed = graph->SetState(comp->Index, CheckListComponents->Checked[idx] ?
+        DxCore::TComponentState::Install : DxCore::TComponentState::NotInstall);
+    changed.ForEach([this, graph](int i) {
+        if (FComponentItems[i] >= 0)
+            CheckListComponents->Checked[FComponentItems[i]] = graph->GetComponent(i)->State == DxCore::TComponentState::Install;
+    });
+    
+    if (CheckListIDEs->ItemIndex >= 0)
+        RefreshIDEItem(CheckListIDEs->ItemIndex);
 }
 
 //---------------------------------------------------------------------------
@@ -371,16 +421,20 @@ void __fastcall TfrmMain::BtnBrowseClick(TObject *Sender)
         String dir = IncludeTrailingPathDelimiter(FolderOpenDialog->FileName);
         EditSourceDir->Text = dir;
 
-        unsigned int buildNum = DxCore::TProfileManager::GetDxBuildNumber(dir);
-        EditDxVersion->Text = DxCore::TProfileManager::GetDxBuildNumberAsVersion(buildNum);
-
         Screen->Cursor = crHourGlass;
         __try
         {
             FInstaller->SetInstallFileDir(dir);
-            RefreshIDEList();
+            EditDxVersion->Text = DxCore::TProfileManager::GetDxBuildNumberAsVersion(
+                FInstaller->GetDxBuildNumber());
+
+            // Only the selected IDE's list is built here, the others in the background
             RefreshComponentList();
+            RefreshIDEList();
             UpdateControlStates();
+            FInstaller->PrefetchComponentLists([this](const DxCore::TIDEInfoPtr& ide) {
+                RefreshIDEList();
+            });
         }
         __finally
         {
@@ -447,6 +501,7 @@ void TfrmMain::RunInstaller()
     FProgressForm->Initialize();
     
     // Start async installation
+    FInstaller->SetBackgroundMode(ChkBackground->Checked);
     FInstaller->InstallAsync(ides);
 }
 
@@ -509,6 +564,7 @@ void __fastcall TfrmMain::BtnExportProfileClick(TObject *Sender)
     }
     FInstaller->GetProfile()->ExportBuiltInProfile(fileName);
     FInstaller->GetProfile()->LoadFromFile(fileName);
+    FInstaller->ApplyPackageRules();
     InitializeProfileInfo();
     RefreshComponentList();
     ShowMessage(L"Profile reset to built-in defaults: " + fileName);
@@ -539,7 +595,7 @@ void __fastcall TfrmMain::BtnSearchNewClick(TObject *Sender)
         MemoSearchResults->Lines->Assign(list.get());
         
         if (list->Count == 0)
-            MemoSearchResults->Lines->Add(L"No new packages found.");
+            MemoSearchResults->Lines->Add(L"No new, renamed or removed packages found.");
     }
     __finally
     {
@@ -72,6 +72,7 @@ __published:
     TCheckBox *ChkNativeLookAndFeel;
     TCheckBox *ChkGenerateCpp;
     TCheckBox *ChkHideBase;
+    TCheckBox *ChkBackground;
     
     // Uninstall tab
     TLabel *LblSelectIDE;
@@ -121,11 +122,13 @@ private:
     std::unique_ptr<DxCore::TInstaller> FInstaller;
     TfrmProgress *FProgressForm;
     DxCore::TIDEInfoPtr FSelectedIDE;  // Currently selected IDE for options
+    std::vector<int> FComponentItems;  // Component index -> CheckListComponents item, -1 if hidden
     
     void InitializeIDEList();
     void InitializeUninstallList();
     void InitializeProfileInfo();
     void RefreshIDEList();
+    void RefreshIDEItem(int item);
     void RefreshComponentList();
     void RunInstaller();
     void UpdateControlStates();
@@ -142,7 +145,8 @@ private:
                                const String& target);
     void __fastcall OnProgressState(const String& stateText);
     
-    // Completion callback (called from main thread)
+    // Completion callbacks (called from main thread)
+    void OnInstallerReady(bool success, const String& message);
     void OnInstallComplete(bool success, const String& message);
     
 public:
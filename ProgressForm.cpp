@@ -119,8 +119,8 @@ void TfrmProgress::UpdateProgress(const DxCore::TIDEInfoPtr& ide,
         }
     }
 
-    // Build title
-    String title = ide->Name;
+    // Build title (no IDE for steps shared by all selected IDEs)
+    String title = ide ? ide->Name : String(L"All IDEs");
     if (component)
         title = title + L" > " + component->ComponentName;
     if (!task.IsEmpty())